@@ -38,6 +38,11 @@
 #include "asf.h"
 #include "conf_winc.h"
 
+#ifdef CONF_WINC_USE_FREERTOS
+#include "FreeRTOS.h"
+#include "task.h"
+#endif
+
 static tpfNmBspIsr gpfIsr;
 
 static void chip_isr(void)
@@ -129,6 +134,13 @@ void nm_bsp_reset(void)
  */
 void nm_bsp_sleep(uint32 u32TimeMsec)
 {
+#ifdef CONF_WINC_USE_FREERTOS
+	/* Blocks the calling task only, once the scheduler runs. */
+	if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED) {
+		vTaskDelay(pdMS_TO_TICKS(u32TimeMsec));
+		return;
+	}
+#endif
 	while (u32TimeMsec--) {
 		delay_ms(1);
 	}
@@ -164,6 +164,24 @@ sint8 nm_bus_reinit(void *);
 uint8 nm_bus_get_chip_type(void);
 sint8 nm_bus_break(void);
 #endif
+#ifdef CONF_WINC_BUS_STATS
+/**
+*	@struct	tstrNmBusStats
+*	@brief	Counters of the bus since the start
+*/
+typedef struct
+{
+	uint32	u32Transfers;	/*!< Transfers, each framed by the chip select */
+	uint32	u32Bytes;		/*!< Bytes sent or received */
+} tstrNmBusStats;
+
+/**
+*	@fn		nm_bus_get_stats
+*	@brief	Get the counters of the bus
+*	@return	Counters, updated by every transfer
+*/
+const tstrNmBusStats *nm_bus_get_stats(void);
+#endif
 #ifdef __cplusplus
 	 }
  #endif
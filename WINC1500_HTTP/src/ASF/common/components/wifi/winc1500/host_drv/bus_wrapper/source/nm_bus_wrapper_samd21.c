@@ -38,6 +38,7 @@
 #include "bus_wrapper/include/nm_bus_wrapper.h"
 #include "asf.h"
 #include "conf_winc.h"
+#include "conf_ramfunc.h"
 
 #define NM_BUS_MAX_TRX_SZ	256
 
@@ -48,6 +49,10 @@ tstrNmBusCapabilities egstrNmBusCapabilities =
 	NM_BUS_MAX_TRX_SZ
 };
 
+#ifdef CONF_WINC_BUS_STATS
+static tstrNmBusStats gstrNmBusStats;
+#endif
+
 #ifdef CONF_WINC_USE_I2C
 
 struct i2c_master_module i2c_master_instance;
@@ -170,61 +175,79 @@ static inline sint8 spi_rw_dma(uint8* pu8Mosi, uint8* pu8Miso, uint16 u16Sz)
 }
 #endif //CONF_WINC_SPI_DMA
 
-static inline sint8 spi_rw_pio(uint8* pu8Mosi, uint8* pu8Miso, uint16 u16Sz)
+/* Send a buffer, the received bytes are dropped.
+ * DATA is refilled as soon as it is empty, thus the next byte is already
+ * queued when the shifter completes the current one. */
+static inline void spi_tx_pio(SercomSpi *const spi_hw, const uint8* pu8Mosi, uint16 u16Sz)
 {
-	uint8 u8Dummy = 0;
-	uint8 u8SkipMosi = 0, u8SkipMiso = 0;
-	uint16_t txd_data = 0;
-	uint16_t rxd_data = 0;
+	while (u16Sz) {
+		if (spi_hw->INTFLAG.reg & SERCOM_SPI_INTFLAG_DRE) {
+			spi_hw->DATA.reg = *pu8Mosi++;
+			u16Sz--;
+		}
+		if (spi_hw->INTFLAG.reg & SERCOM_SPI_INTFLAG_RXC) {
+			(void)spi_hw->DATA.reg;
+		}
+	}
 
-	if(((pu8Miso == NULL) && (pu8Mosi == NULL)) ||(u16Sz == 0)) {
-		return M2M_ERR_INVALID_ARG;
+	/* Wait the last byte shifted out then flush the receiver. */
+	while (!(spi_hw->INTFLAG.reg & SERCOM_SPI_INTFLAG_TXC))
+		;
+	while (spi_hw->INTFLAG.reg & SERCOM_SPI_INTFLAG_RXC) {
+		(void)spi_hw->DATA.reg;
 	}
+	spi_hw->STATUS.reg = SERCOM_SPI_STATUS_BUFOVF;
+}
+
+/* Receive a buffer, sending zeros.
+ * Two bytes at most are in flight (one shifted, one queued in DATA), thus
+ * the two level receive buffer can not overflow. */
+static inline void spi_rx_pio(SercomSpi *const spi_hw, uint8* pu8Miso, uint16 u16Sz)
+{
+	uint16 u16TxSz = u16Sz;
 
-	if (!pu8Mosi) {
-		pu8Mosi = &u8Dummy;
-		u8SkipMosi = 1;
+	while (u16Sz) {
+		if (u16TxSz && ((uint16)(u16Sz - u16TxSz) < 2)
+				&& (spi_hw->INTFLAG.reg & SERCOM_SPI_INTFLAG_DRE)) {
+			spi_hw->DATA.reg = 0;
+			u16TxSz--;
+		}
+		if (spi_hw->INTFLAG.reg & SERCOM_SPI_INTFLAG_RXC) {
+			*pu8Miso++ = spi_hw->DATA.reg;
+			u16Sz--;
+		}
 	}
-	else if(!pu8Miso) {
-		pu8Miso = &u8Dummy;
-		u8SkipMiso = 1;
+
+	while (!(spi_hw->INTFLAG.reg & SERCOM_SPI_INTFLAG_TXC))
+		;
+}
+
+static inline sint8 spi_rw_pio(uint8* pu8Mosi, uint8* pu8Miso, uint16 u16Sz)
+{
+	SercomSpi *const spi_hw = &master.hw->SPI;
+
+	if(((pu8Miso == NULL) && (pu8Mosi == NULL)) ||(u16Sz == 0)) {
+		return M2M_ERR_INVALID_ARG;
 	}
-	else {
+	if ((pu8Mosi != NULL) && (pu8Miso != NULL)) {
 		return M2M_ERR_BUS_FAIL;
 	}
 
 	spi_select_slave(&master, &slave_inst, true);
 
-	while (u16Sz) {
-		txd_data = *pu8Mosi;
-		while (!spi_is_ready_to_write(&master))
-			;
-		while(spi_write(&master, txd_data) != STATUS_OK)
-			;
-
-		/* Read SPI master data register. */
-		while (!spi_is_ready_to_read(&master))
-			;
-		while (spi_read(&master, &rxd_data) != STATUS_OK)
-			;
-		*pu8Miso = rxd_data;
-			
-		u16Sz--;
-		if (!u8SkipMiso)
-			pu8Miso++;
-		if (!u8SkipMosi)
-			pu8Mosi++;
+	if (pu8Mosi) {
+		spi_tx_pio(spi_hw, pu8Mosi, u16Sz);
+	}
+	else {
+		spi_rx_pio(spi_hw, pu8Miso, u16Sz);
 	}
-
-	while (!spi_is_write_complete(&master))
-		;
 
 	spi_select_slave(&master, &slave_inst, false);
 
 	return M2M_SUCCESS;
 }
 
-sint8 spi_rw(uint8* pu8Mosi, uint8* pu8Miso, uint16 u16Sz)
+HOT_RAMFUNC sint8 spi_rw(uint8* pu8Mosi, uint8* pu8Miso, uint16 u16Sz)
 {
 #ifdef CONF_WINC_SPI_DMA
 	if (u16Sz >= 8) {
@@ -360,6 +383,10 @@ sint8 nm_bus_ioctl(uint8 u8Cmd, void* pvParameter)
 		case NM_BUS_IOCTL_RW: {
 			tstrNmSpiRw *pstrParam = (tstrNmSpiRw *)pvParameter;
 			s8Ret = spi_rw(pstrParam->pu8InBuf, pstrParam->pu8OutBuf, pstrParam->u16Sz);
+#ifdef CONF_WINC_BUS_STATS
+			gstrNmBusStats.u32Transfers++;
+			gstrNmBusStats.u32Bytes += pstrParam->u16Sz;
+#endif
 		}
 		break;
 #endif
@@ -372,6 +399,13 @@ sint8 nm_bus_ioctl(uint8 u8Cmd, void* pvParameter)
 	return s8Ret;
 }
 
+#ifdef CONF_WINC_BUS_STATS
+const tstrNmBusStats *nm_bus_get_stats(void)
+{
+	return &gstrNmBusStats;
+}
+#endif
+
 /*
 *	@fn		nm_bus_deinit
 *	@brief	De-initialize the bus wrapper
@@ -177,6 +177,16 @@ typedef void (*tpfAppEthCb) (uint8 u8MsgType, void * pvMsg,void * pvCtrlBuf);
 	u16PayloadSize should not exceed the buffer size given through m2m_wifi_enable_monitoring_mode.
 */
 typedef void (*tpfAppMonCb) (tstrM2MWifiRxPacketInfo *pstrWifiRxPacket, uint8 * pu8Payload, uint16 u16PayloadSize);
+
+/*!
+@typedef \
+	tpfM2mTickMs
+
+@brief
+	Millisecond clock supplied by the application to @ref m2m_wifi_handle_events_budget.
+	It only has to be monotonic; wrap-around is handled.
+*/
+typedef uint32 (*tpfM2mTickMs) (void);
 /**@}*/     //WLANCallbacks
 
 /**@addtogroup  WlanEnums
@@ -701,6 +711,53 @@ NMI_API void m2m_wifi_yield(void);
 */
 NMI_API sint8 m2m_wifi_handle_events(void * arg);
 
+/*!
+@fn	\
+	NMI_API sint8 m2m_wifi_handle_events_budget(uint16 u16MaxEvents, uint32 u32MaxTimeMs, tpfM2mTickMs pfTickMs);
+
+@brief
+    Synchronous M2M event handler function with a bounded amount of work.
+
+@details
+	Same as @ref m2m_wifi_handle_events, but returns once u16MaxEvents events have been handled or
+	u32MaxTimeMs milliseconds have elapsed, whichever comes first. The events left over stay pending
+	and are handled by the next call; @ref m2m_wifi_events_pending tells whether there are any.
+	This lets the main loop interleave network, storage and application work during a sustained
+	transfer instead of draining every pending event in one call.
+
+	The time budget is checked between events: a single event whose callback runs long (e.g. a socket
+	receive delivered in several application buffers) is always completed. A callback may still call
+	@ref m2m_wifi_yield to stop earlier.
+
+@param [in]	u16MaxEvents
+	Maximum number of events to handle, 0 for no limit.
+
+@param [in]	u32MaxTimeMs
+	Maximum time to spend in milliseconds, 0 for no limit.
+
+@param [in]	pfTickMs
+	Millisecond clock used for the time budget. NULL disables the time budget.
+
+@return
+    The function returns @ref M2M_SUCCESS for successful interrupt handling and a negative value otherwise.
+@see
+	m2m_wifi_handle_events
+	m2m_wifi_events_pending
+*/
+NMI_API sint8 m2m_wifi_handle_events_budget(uint16 u16MaxEvents, uint32 u32MaxTimeMs, tpfM2mTickMs pfTickMs);
+
+/*!
+@fn	\
+	NMI_API uint8 m2m_wifi_events_pending(void);
+
+@brief
+    Number of events signalled by the WINC and not handled yet.
+
+@return
+    Zero when there is nothing left for @ref m2m_wifi_handle_events_budget to do.
+*/
+NMI_API uint8 m2m_wifi_events_pending(void);
+
 /*!
 @fn	\
 	sint8 m2m_wifi_send_crl(tstrTlsCrlInfo* pCRL);
@@ -35,6 +35,7 @@
 #include "common/include/nm_common.h"
 #include "driver/source/nmbus.h"
 #include "bsp/include/nm_bsp.h"
+#include "bsp/include/nm_bsp_internal.h"
 #include "m2m_hif.h"
 #include "driver/include/m2m_types.h"
 #include "driver/source/nmasic.h"
@@ -52,13 +53,6 @@
 #define NMI_AHB_DATA_MEM_BASE  0x30000
 #define NMI_AHB_SHARE_MEM_BASE 0xd0000
 
-#define WIFI_HOST_RCV_CTRL_0	(0x1070)
-#define WIFI_HOST_RCV_CTRL_1	(0x1084)
-#define WIFI_HOST_RCV_CTRL_2    (0x1078)
-#define WIFI_HOST_RCV_CTRL_3    (0x106c)
-#define WIFI_HOST_RCV_CTRL_4	(0x150400)
-#define WIFI_HOST_RCV_CTRL_5	(0x1088)
-
 typedef struct {
  	uint8 u8ChipMode;
  	uint8 u8ChipSleep;
@@ -67,20 +61,26 @@ typedef struct {
 	uint8 u8Yield;
  	uint32 u32RxAddr;
  	uint32 u32RxSize;
-	tpfHifCallBack pfWifiCb;
-	tpfHifCallBack pfIpCb;
-	tpfHifCallBack pfOtaCb;
-	tpfHifCallBack pfSigmaCb;
-	tpfHifCallBack pfHifCb;
-	tpfHifCallBack pfCryptoCb;
-	tpfHifCallBack pfSslCb;
+	tpfHifCallBack apfCb[M2M_REQ_GROUP_INTERNAL];	/* Indexed by M2M_REQ_GROUP_* */
+	uint32 au32RxCnt[M2M_REQ_GROUP_INTERNAL];		/* Messages received per group */
 }tstrHifContext;
 
+/* Groups the firmware is allowed to send messages to. MAIN and HIF only carry
+ * host-to-firmware requests, so a message tagged with them is a corrupted frame. */
+#define HIF_RX_GROUP_MASK	((1ul << M2M_REQ_GROUP_WIFI)   | (1ul << M2M_REQ_GROUP_IP)     | \
+							 (1ul << M2M_REQ_GROUP_OTA)    | (1ul << M2M_REQ_GROUP_SSL)    | \
+							 (1ul << M2M_REQ_GROUP_CRYPTO) | (1ul << M2M_REQ_GROUP_SIGMA))
+
 volatile tstrHifContext gstrHifCxt;
 
-#ifdef ETH_MODE
+/* Wakes the network task up, see iot/winc_task.c. */
+#if (defined ETH_MODE) || (defined CONF_WINC_USE_FREERTOS)
 extern void os_hook_isr(void);
 #endif
+/* Reports the sleep of the chip, see iot/energy.h. */
+#ifdef CONF_WINC_ENERGY_STATS
+extern void os_hook_chip_state(uint8 u8Awake);
+#endif
 
 static void isr(void)
 {
@@ -88,7 +88,7 @@ static void isr(void)
 #ifdef NM_LEVEL_INTERRUPT
 	nm_bsp_interrupt_ctrl(0);
 #endif
-#ifdef ETH_MODE
+#if (defined ETH_MODE) || (defined CONF_WINC_USE_FREERTOS)
 	os_hook_isr();
 #endif
 }
@@ -153,6 +153,9 @@ sint8 hif_chip_wake(void)
 		{
 			ret = chip_wake();
 			if(ret != M2M_SUCCESS)goto ERR1;
+#ifdef CONF_WINC_ENERGY_STATS
+			os_hook_chip_state(1);
+#endif
 		}
 		else
 		{
@@ -179,6 +182,13 @@ ERR1:
 void hif_set_sleep_mode(uint8 u8Pstype)
 {
 	gstrHifCxt.u8ChipMode = u8Pstype;
+#ifdef CONF_WINC_ENERGY_STATS
+	if(u8Pstype == M2M_NO_PS)
+	{
+		/* The chip does not sleep anymore. */
+		os_hook_chip_state(1);
+	}
+#endif
 }
 /*!
 @fn	\
@@ -231,6 +241,9 @@ sint8 hif_chip_sleep(void)
 		{
 			ret = chip_sleep();
 			if(ret != M2M_SUCCESS)goto ERR1;
+#ifdef CONF_WINC_ENERGY_STATS
+			os_hook_chip_state(0);
+#endif
 		}
 		else
 		{
@@ -481,47 +494,15 @@ static sint8 hif_isr(void)
 					}
 				}
 
-				if(M2M_REQ_GROUP_WIFI == strHif.u8Gid)
-				{
-					if(gstrHifCxt.pfWifiCb)
-						gstrHifCxt.pfWifiCb(strHif.u8Opcode,strHif.u16Length - M2M_HIF_HDR_OFFSET, address + M2M_HIF_HDR_OFFSET);
-					else
-						M2M_ERR("WIFI callback is not registered\n");
-				}
-				else if(M2M_REQ_GROUP_IP == strHif.u8Gid)
-				{
-					if(gstrHifCxt.pfIpCb)
-						gstrHifCxt.pfIpCb(strHif.u8Opcode,strHif.u16Length - M2M_HIF_HDR_OFFSET, address + M2M_HIF_HDR_OFFSET);
-					else
-						M2M_ERR("Socket callback is not registered\n");
-				}
-				else if(M2M_REQ_GROUP_OTA == strHif.u8Gid)
-				{
-					if(gstrHifCxt.pfOtaCb)
-						gstrHifCxt.pfOtaCb(strHif.u8Opcode,strHif.u16Length - M2M_HIF_HDR_OFFSET, address + M2M_HIF_HDR_OFFSET);
-					else
-						M2M_ERR("Ota callback is not registered\n");
-				}
-				else if(M2M_REQ_GROUP_CRYPTO == strHif.u8Gid)
-				{
-					if(gstrHifCxt.pfCryptoCb)
-						gstrHifCxt.pfCryptoCb(strHif.u8Opcode,strHif.u16Length - M2M_HIF_HDR_OFFSET, address + M2M_HIF_HDR_OFFSET);
-					else
-						M2M_ERR("Crypto callback is not registered\n");
-				}
-				else if(M2M_REQ_GROUP_SIGMA == strHif.u8Gid)
+				if((strHif.u8Gid < M2M_REQ_GROUP_INTERNAL) && (HIF_RX_GROUP_MASK & (1ul << strHif.u8Gid)))
 				{
-					if(gstrHifCxt.pfSigmaCb)
-						gstrHifCxt.pfSigmaCb(strHif.u8Opcode,strHif.u16Length - M2M_HIF_HDR_OFFSET, address + M2M_HIF_HDR_OFFSET);
+					tpfHifCallBack pfCb = gstrHifCxt.apfCb[strHif.u8Gid];
+
+					gstrHifCxt.au32RxCnt[strHif.u8Gid]++;
+					if(pfCb)
+						pfCb(strHif.u8Opcode,strHif.u16Length - M2M_HIF_HDR_OFFSET, address + M2M_HIF_HDR_OFFSET);
 					else
-						M2M_ERR("Sigma callback is not registered\n");
-				}
-				else if(M2M_REQ_GROUP_SSL == strHif.u8Gid)
-				{
-				    if(gstrHifCxt.pfSslCb)
-						gstrHifCxt.pfSslCb(strHif.u8Opcode,strHif.u16Length - M2M_HIF_HDR_OFFSET, address + M2M_HIF_HDR_OFFSET);
-                    else
-                        M2M_ERR("SSL callback is not registered\n");
+						M2M_ERR("(hif) callback is not registered for group %u\n", strHif.u8Gid);
 				}
 				else
 				{
@@ -579,9 +560,33 @@ void hif_yield(void)
 */
 
 sint8 hif_handle_isr(void)
+{
+	return hif_handle_isr_budget(0, 0, NULL);
+}
+
+/**
+*	@fn		hif_handle_isr_budget
+*	@brief	Handle interrupts received from NMC1500 firmware until the budget is exhausted.
+*	@param [in]	u16MaxMsgs
+*				Maximum number of messages to handle, 0 for no limit.
+*	@param [in]	u32MaxMs
+*				Maximum time to spend, 0 for no limit. Checked between messages only.
+*	@param [in]	pfTickMs
+*				Millisecond clock used for u32MaxMs, NULL to ignore the time limit.
+*   @return     The function SHALL return 0 for success and a negative value otherwise.
+*/
+
+sint8 hif_handle_isr_budget(uint16 u16MaxMsgs, uint32 u32MaxMs, tpfHifTickMs pfTickMs)
 {
 	sint8 ret = M2M_SUCCESS;	
+	uint32 u32Start = 0;
+	uint16 u16Msgs = 0;
 	
+	if((pfTickMs != NULL) && (u32MaxMs != 0))
+		u32Start = pfTickMs();
+	else
+		pfTickMs = NULL;
+
 	gstrHifCxt.u8Yield = 0;
 	while(gstrHifCxt.u8Interrupt && !gstrHifCxt.u8Yield)
 	{
@@ -619,10 +624,26 @@ sint8 hif_handle_isr(void)
 					M2M_ERR("(HIF) Failed to handle interrupt %d try again... (%u)\n", ret, retries);
 			}
 		}
+
+		/* The remaining interrupts stay counted and are handled by the next call. */
+		if((u16MaxMsgs != 0) && (++u16Msgs >= u16MaxMsgs))
+			break;
+		if((pfTickMs != NULL) && ((uint32)(pfTickMs() - u32Start) >= u32MaxMs))
+			break;
 	}
 
 	return ret;
 }
+
+/**
+*	@fn		hif_pending(void)
+*	@brief	Number of interrupts received from NMC1500 firmware and not handled yet.
+*/
+
+uint8 hif_pending(void)
+{
+	return gstrHifCxt.u8Interrupt;
+}
 /*
 *	@fn		hif_receive
 *	@brief	Host interface interrupt service routine
@@ -695,35 +716,30 @@ ERR1:
 sint8 hif_register_cb(uint8 u8Grp,tpfHifCallBack fn)
 {
 	sint8 ret = M2M_SUCCESS;
-	switch(u8Grp)
+	if((u8Grp > M2M_REQ_GROUP_MAIN) && (u8Grp < M2M_REQ_GROUP_INTERNAL))
 	{
-		case M2M_REQ_GROUP_IP:
-			gstrHifCxt.pfIpCb = fn;
-			break;
-		case M2M_REQ_GROUP_WIFI:
-			gstrHifCxt.pfWifiCb = fn;
-			break;
-		case M2M_REQ_GROUP_OTA:
-			gstrHifCxt.pfOtaCb = fn;
-			break;
-		case M2M_REQ_GROUP_HIF:
-			gstrHifCxt.pfHifCb = fn;
-			break;
-		case M2M_REQ_GROUP_CRYPTO:
-			gstrHifCxt.pfCryptoCb = fn;
-			break;
-		case M2M_REQ_GROUP_SIGMA:
-			gstrHifCxt.pfSigmaCb = fn;
-			break;
-		case M2M_REQ_GROUP_SSL:
-			gstrHifCxt.pfSslCb = fn;
-			break;
-		default:
-			M2M_ERR("GRp ? %d\n",u8Grp);
-			ret = M2M_ERR_FAIL;
-			break;
+		gstrHifCxt.apfCb[u8Grp] = fn;
+	}
+	else
+	{
+		M2M_ERR("GRp ? %d\n",u8Grp);
+		ret = M2M_ERR_FAIL;
 	}
 	return ret;
 }
+/**
+*	@fn		hif_get_rx_count
+*	@brief	Number of messages received from the firmware for a group since hif_init
+*	@param [in]	u8Grp
+*				Group ID (M2M_REQ_GROUP_*).
+*    @return		The message count, or ZERO for an unknown group.
+*/
+
+uint32 hif_get_rx_count(uint8 u8Grp)
+{
+	if(u8Grp < M2M_REQ_GROUP_INTERNAL)
+		return gstrHifCxt.au32RxCnt[u8Grp];
+	return 0;
+}
 
 #endif
@@ -83,6 +83,11 @@ typedef struct
 				HIF group type.
 */
 typedef void (*tpfHifCallBack)(uint8 u8OpCode, uint16 u16DataSize, uint32 u32Addr);
+/*!
+@typedef typedef uint32 (*tpfHifTickMs)(void);
+@brief	Millisecond clock used to bound the time spent in @ref hif_handle_isr_budget.
+*/
+typedef uint32 (*tpfHifTickMs)(void);
 /**
 *   @fn			NMI_API sint8 hif_init(void * arg);
 *   @brief
@@ -157,6 +162,14 @@ NMI_API sint8 hif_receive(uint32 u32Addr, uint8 *pu8Buf, uint16 u16Sz, uint8 isD
 */
 NMI_API sint8 hif_register_cb(uint8 u8Grp,tpfHifCallBack fn);
 /**
+*	@fn		hif_get_rx_count
+*	@brief	Number of messages received from the firmware for a group since hif_init
+*	@param [in]	u8Grp
+*				Group ID (M2M_REQ_GROUP_*).
+*    @return		The message count, or ZERO for an unknown group.
+*/
+NMI_API uint32 hif_get_rx_count(uint8 u8Grp);
+/**
 *	@fn		NMI_API sint8 hif_chip_sleep(void);
 *	@brief
 				To make the chip sleep.
@@ -243,6 +256,22 @@ NMI_API void hif_yield(void);
 */
 NMI_API sint8 hif_handle_isr(void);
 
+/**
+*	@fn		hif_handle_isr_budget(uint16 u16MaxMsgs, uint32 u32MaxMs, tpfHifTickMs pfTickMs)
+*	@brief
+			Handle interrupts received from NMC1500 firmware until the message or time budget is exhausted.
+*   @return
+			The function SHALL return 0 for success and a negative value otherwise.
+*/
+NMI_API sint8 hif_handle_isr_budget(uint16 u16MaxMsgs, uint32 u32MaxMs, tpfHifTickMs pfTickMs);
+
+/**
+*	@fn		hif_pending(void)
+*	@brief
+			Number of interrupts received from NMC1500 firmware and not handled yet.
+*/
+NMI_API uint8 hif_pending(void);
+
 #ifdef __cplusplus
 }
 #endif
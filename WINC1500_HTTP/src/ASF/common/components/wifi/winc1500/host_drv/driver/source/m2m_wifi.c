@@ -522,6 +522,16 @@ sint8 m2m_wifi_handle_events(void * arg)
 	return hif_handle_isr();
 }
 
+sint8 m2m_wifi_handle_events_budget(uint16 u16MaxEvents, uint32 u32MaxTimeMs, tpfM2mTickMs pfTickMs)
+{
+	return hif_handle_isr_budget(u16MaxEvents, u32MaxTimeMs, pfTickMs);
+}
+
+uint8 m2m_wifi_events_pending(void)
+{
+	return hif_pending();
+}
+
 sint8 m2m_wifi_delete_sc(char *pcSsid, uint8 u8SsidLen)
 {
 	tstrM2mWifiApId	strApId;
@@ -44,11 +44,6 @@
 #define NMI_INTR_ENABLE				(NMI_INTR_REG_BASE)
 #define GET_UINT32(X,Y)				(X[0+Y] + ((uint32)X[1+Y]<<8) + ((uint32)X[2+Y]<<16) +((uint32)X[3+Y]<<24))
 
-/*SPI and I2C only*/
-#define CORT_HOST_COMM				(0x10)
-#define HOST_CORT_COMM				(0x0b)
-#define WAKE_CLK_REG				(0x1)
-#define CLOCKS_EN_REG				(0xf)
 
 
 
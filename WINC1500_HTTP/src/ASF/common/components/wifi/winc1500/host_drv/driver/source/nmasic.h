@@ -44,6 +44,17 @@
 #define rNMI_GLB_RESET			(0x1400)
 #define rNMI_BOOT_RESET_MUX		(0x1118)
 #define NMI_STATE_REG			(0x108c)
+#define WIFI_HOST_RCV_CTRL_0	(0x1070)
+#define WIFI_HOST_RCV_CTRL_1	(0x1084)
+#define WIFI_HOST_RCV_CTRL_2    (0x1078)
+#define WIFI_HOST_RCV_CTRL_3    (0x106c)
+#define WIFI_HOST_RCV_CTRL_4	(0x150400)
+#define WIFI_HOST_RCV_CTRL_5	(0x1088)
+/*SPI and I2C only*/
+#define CORT_HOST_COMM			(0x10)
+#define HOST_CORT_COMM			(0x0b)
+#define WAKE_CLK_REG			(0x1)
+#define CLOCKS_EN_REG			(0xf)
 #define BOOTROM_REG				(0xc000c)
 #define NMI_REV_REG  			(0x207ac)	/*Also, Used to load ATE firmware from SPI Flash and to ensure that it is running too*/
 #define NMI_REV_REG_ATE			(0x1048) 	/*Revision info register in case of ATE FW*/
@@ -39,6 +39,8 @@
 
 #include "bus_wrapper/include/nm_bus_wrapper.h"
 #include "nmspi.h"
+#include "driver/source/nmasic.h"
+#include "conf_ramfunc.h"
 
 #define NMI_PERIPH_REG_BASE 0x1000
 #define NMI_INTR_REG_BASE (NMI_PERIPH_REG_BASE+0xa00)
@@ -170,6 +172,97 @@ static uint8 crc7(uint8 crc, const uint8 *buffer, uint32 len)
 	return crc;
 }
 
+/********************************************
+
+	Precomputed register command frames
+
+********************************************/
+
+/*
+	Command frames of the registers accessed on each HIF transfer. They are
+	built at compile time, without the CRC byte, and sent as is once the CRC
+	is turned off. Same clockless selection as spi_read_reg/spi_write_reg.
+*/
+#define SPI_REG_RD_CLOCKLESS(adr)	((adr) <= 0xff)
+#define SPI_REG_WR_CLOCKLESS(adr)	((adr) <= 0x30)
+
+#define SPI_REG_FRAMES(adr) { \
+	{ \
+		SPI_REG_RD_CLOCKLESS(adr) ? CMD_INTERNAL_READ : CMD_SINGLE_READ, \
+		SPI_REG_RD_CLOCKLESS(adr) ? (uint8)(((adr) >> 8) | 0x80) : (uint8)((adr) >> 16), \
+		SPI_REG_RD_CLOCKLESS(adr) ? (uint8)(adr) : (uint8)((adr) >> 8), \
+		SPI_REG_RD_CLOCKLESS(adr) ? 0x00 : (uint8)(adr) \
+	}, \
+	{ \
+		SPI_REG_WR_CLOCKLESS(adr) ? CMD_INTERNAL_WRITE : CMD_SINGLE_WRITE, \
+		SPI_REG_WR_CLOCKLESS(adr) ? (uint8)(((adr) >> 8) | 0x80) : (uint8)((adr) >> 16), \
+		SPI_REG_WR_CLOCKLESS(adr) ? (uint8)(adr) : (uint8)((adr) >> 8), \
+		(uint8)(adr) \
+	}, \
+	SPI_REG_WR_CLOCKLESS(adr) ? 3 : 4 \
+}
+
+typedef struct {
+	uint8 au8Rd[4];		/* read command frame */
+	uint8 au8Wr[4];		/* write command header, followed by the value */
+	uint8 u8WrHdrSz;	/* size of the write command header */
+} tstrSpiRegFrames;
+
+enum {
+	SPI_REG_RCV_CTRL_0,
+	SPI_REG_RCV_CTRL_1,
+	SPI_REG_RCV_CTRL_2,
+	SPI_REG_RCV_CTRL_3,
+	SPI_REG_RCV_CTRL_4,
+	SPI_REG_RCV_CTRL_5,
+	SPI_REG_STATE,
+	SPI_REG_HOST_CORT_COMM,
+	SPI_REG_WAKE_CLK,
+	SPI_REG_CLOCKS_EN,
+	SPI_REG_FRAMES_NB
+};
+
+static const tstrSpiRegFrames gastrSpiRegFrames[SPI_REG_FRAMES_NB] = {
+	[SPI_REG_RCV_CTRL_0]		= SPI_REG_FRAMES(WIFI_HOST_RCV_CTRL_0),
+	[SPI_REG_RCV_CTRL_1]		= SPI_REG_FRAMES(WIFI_HOST_RCV_CTRL_1),
+	[SPI_REG_RCV_CTRL_2]		= SPI_REG_FRAMES(WIFI_HOST_RCV_CTRL_2),
+	[SPI_REG_RCV_CTRL_3]		= SPI_REG_FRAMES(WIFI_HOST_RCV_CTRL_3),
+	[SPI_REG_RCV_CTRL_4]		= SPI_REG_FRAMES(WIFI_HOST_RCV_CTRL_4),
+	[SPI_REG_RCV_CTRL_5]		= SPI_REG_FRAMES(WIFI_HOST_RCV_CTRL_5),
+	[SPI_REG_STATE]				= SPI_REG_FRAMES(NMI_STATE_REG),
+	[SPI_REG_HOST_CORT_COMM]	= SPI_REG_FRAMES(HOST_CORT_COMM),
+	[SPI_REG_WAKE_CLK]			= SPI_REG_FRAMES(WAKE_CLK_REG),
+	[SPI_REG_CLOCKS_EN]			= SPI_REG_FRAMES(CLOCKS_EN_REG),
+};
+
+/*
+	Returns the precomputed frames of a register, NULL if the register has
+	none or if the CRC is still on.
+*/
+static const tstrSpiRegFrames *spi_reg_frames(uint32 addr)
+{
+	uint8 idx;
+
+	if (!gu8Crc_off)
+		return NULL;
+
+	switch (addr) {
+	case WIFI_HOST_RCV_CTRL_0:	idx = SPI_REG_RCV_CTRL_0; break;
+	case WIFI_HOST_RCV_CTRL_1:	idx = SPI_REG_RCV_CTRL_1; break;
+	case WIFI_HOST_RCV_CTRL_2:	idx = SPI_REG_RCV_CTRL_2; break;
+	case WIFI_HOST_RCV_CTRL_3:	idx = SPI_REG_RCV_CTRL_3; break;
+	case WIFI_HOST_RCV_CTRL_4:	idx = SPI_REG_RCV_CTRL_4; break;
+	case WIFI_HOST_RCV_CTRL_5:	idx = SPI_REG_RCV_CTRL_5; break;
+	case NMI_STATE_REG:			idx = SPI_REG_STATE; break;
+	case HOST_CORT_COMM:		idx = SPI_REG_HOST_CORT_COMM; break;
+	case WAKE_CLK_REG:			idx = SPI_REG_WAKE_CLK; break;
+	case CLOCKS_EN_REG:			idx = SPI_REG_CLOCKS_EN; break;
+	default:
+		return NULL;
+	}
+	return &gastrSpiRegFrames[idx];
+}
+
 /********************************************
 
 	Spi protocol Function
@@ -734,7 +827,7 @@ _error_:
 	return result;
 }
 #endif
-static sint8 spi_data_read(uint8 *b, uint16 sz,uint8 clockless)
+static HOT_RAMFUNC sint8 spi_data_read(uint8 *b, uint16 sz,uint8 clockless)
 {
 	sint16 retry, ix, nbytes;
 	sint8 result = N_OK;
@@ -803,7 +896,7 @@ static sint8 spi_data_read(uint8 *b, uint16 sz,uint8 clockless)
 	return result;
 }
 
-static sint8 spi_data_write(uint8 *b, uint16 sz)
+static HOT_RAMFUNC sint8 spi_data_write(uint8 *b, uint16 sz)
 {
 	sint16 ix;
 	uint16 nbytes;
@@ -889,6 +982,9 @@ static sint8 spi_write_reg(uint32 addr, uint32 u32data)
 	sint8 result = N_OK;
 	uint8 cmd = CMD_SINGLE_WRITE;
 	uint8 clockless = 0;
+#if defined USE_OLD_SPI_SW
+	const tstrSpiRegFrames *pstrFrames;
+#endif
 	
 _RETRY_:	
 	if (addr <= 0x30)
@@ -906,7 +1002,19 @@ _RETRY_:
 	}
 
 #if defined USE_OLD_SPI_SW
-	result = spi_cmd(cmd, addr, u32data, 4, clockless);
+	pstrFrames = spi_reg_frames(addr);
+	if (pstrFrames != NULL) {
+		uint8 bc[8];
+
+		m2m_memcpy(bc, (uint8 *)pstrFrames->au8Wr, pstrFrames->u8WrHdrSz);
+		bc[pstrFrames->u8WrHdrSz]     = (uint8)(u32data >> 24);
+		bc[pstrFrames->u8WrHdrSz + 1] = (uint8)(u32data >> 16);
+		bc[pstrFrames->u8WrHdrSz + 2] = (uint8)(u32data >> 8);
+		bc[pstrFrames->u8WrHdrSz + 3] = (uint8)(u32data);
+		result = (M2M_SUCCESS == nmi_spi_write(bc, pstrFrames->u8WrHdrSz + 4)) ? N_OK : N_FAIL;
+	} else {
+		result = spi_cmd(cmd, addr, u32data, 4, clockless);
+	}
 	if (result != N_OK) {
 		M2M_ERR("[nmi spi]: Failed cmd, write reg (%08x)...\n", (unsigned int)addr);
 		goto _FAIL_;
@@ -1017,6 +1125,9 @@ static sint8 spi_read_reg(uint32 addr, uint32 *u32data)
 	uint8 cmd = CMD_SINGLE_READ;
 	uint8 tmp[4];
 	uint8 clockless = 0;
+#if defined USE_OLD_SPI_SW
+	const tstrSpiRegFrames *pstrFrames;
+#endif
 
 _RETRY_:
 
@@ -1035,7 +1146,12 @@ _RETRY_:
 	}
 
 #if defined USE_OLD_SPI_SW
-	result = spi_cmd(cmd, addr, 0, 4, clockless);
+	pstrFrames = spi_reg_frames(addr);
+	if (pstrFrames != NULL) {
+		result = (M2M_SUCCESS == nmi_spi_write((uint8 *)pstrFrames->au8Rd, sizeof(pstrFrames->au8Rd))) ? N_OK : N_FAIL;
+	} else {
+		result = spi_cmd(cmd, addr, 0, 4, clockless);
+	}
 	if (result != N_OK) {
 		M2M_ERR("[nmi spi]: Failed cmd, read reg (%08x)...\n", (unsigned int)addr);
 		goto _FAIL_;
@@ -951,6 +951,19 @@ NMI_API void socketDeinit(void);
                 Should return 1 after @ref socketInit and 0 after @ref socketDeinit
 */
 NMI_API uint8 IsSocketReady(void);
+
+/*!
+@fn	\
+		uint32 socketGetCmdCount(uint8 u8OpCode);
+
+@param [in]	u8OpCode
+				Socket opcode (SOCKET_CMD_*) to query.
+
+@see            socketInit
+@return         Number of messages received from the firmware for the opcode since @ref socketInit,
+                whether the driver handles the opcode or not. Opcodes out of the socket range return 0.
+*/
+NMI_API uint32 socketGetCmdCount(uint8 u8OpCode);
 /** @} */     //SocketInitializationFn
 
 /** @defgroup SocketCallbackFn registerSocketCallback
@@ -99,6 +99,32 @@ typedef struct{
 	uint8				bIsRecvPending;
 }tstrSocket;
 
+/* Range of the opcodes the firmware replies to on the IP group.
+*/
+#define SOCKET_CMD_FIRST		SOCKET_CMD_BIND
+#define SOCKET_CMD_LAST			SOCKET_CMD_SSL_EXP_CHECK
+#define SOCKET_CMD_COUNT		(SOCKET_CMD_LAST - SOCKET_CMD_FIRST + 1)
+
+typedef void (*tpfSocketReplyHandler)(void *pvReply, uint8 u8MsgId, uint16 u16BufferSize, uint32 u32Address);
+
+typedef struct{
+	tpfSocketReplyHandler	pfHandler;
+	uint8					u8ReplySize;	/* Size of the reply structure read before the handler runs */
+	uint8					u8MsgId;		/* SOCKET_MSG_* delivered to the application */
+	uint8					u8RxDone;		/* The reply is the whole message; set RX done when reading it */
+}tstrSocketCmdEntry;
+
+typedef union{
+	tstrBindReply		strBind;
+	tstrListenReply		strListen;
+	tstrAcceptReply		strAccept;
+	tstrConnectReply	strConnect;
+	tstrDnsReply		strDns;
+	tstrRecvReply		strRecv;
+	tstrSendReply		strSend;
+	tstrPingReply		strPing;
+}tuSocketReply;
+
 /*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*
 GLOBALS
 *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*/
@@ -113,6 +139,7 @@ volatile tpfAppSocketCb		    gpfAppSocketCb;
 volatile tpfAppResolveCb		gpfAppResolveCb;
 volatile uint8					gbSocketInit = 0;
 volatile tpfPingCb				gfpPingCb;
+volatile uint32					gau32SocketCmdCnt[SOCKET_CMD_COUNT];
 
 /*********************************************************************
 Function
@@ -162,6 +189,10 @@ NMI_API void Socket_ReadSocketData(SOCKET sock, tstrSocketRecvMsg *pstrRecv,uint
 				pstrRecv->s16BufferSize		= u16Read;
 				pstrRecv->u16RemainingSize	-= u16Read;
 
+				/* A recv() given before the last piece only moves the buffer for
+				the rest of this packet. The next packet is asked once it is read.
+				*/
+				gastrSockets[sock].bIsRecvPending = (pstrRecv->u16RemainingSize > 0);
 				if (gpfAppSocketCb)
 					gpfAppSocketCb(sock,u8SocketMsg, pstrRecv);
 
@@ -187,218 +218,235 @@ NMI_API void Socket_ReadSocketData(SOCKET sock, tstrSocketRecvMsg *pstrRecv,uint
 	}
 }
 /*********************************************************************
-Function
-		m2m_ip_cb
+Reply handlers for the messages delivered to m2m_ip_cb. Each one is
+handed the reply structure already read from the firmware, the
+application message ID for the opcode and the HIF payload location.
+*********************************************************************/
+static void m2m_ip_bind_reply(void *pvReply, uint8 u8MsgId, uint16 u16BufferSize, uint32 u32Address)
+{
+	tstrBindReply		*pstrBindReply = (tstrBindReply*)pvReply;
+	tstrSocketBindMsg	strBind;
 
-Description
-		Callback function used by the NMC1000 driver to deliver messages
-		for socket layer.
+	strBind.status = pstrBindReply->s8Status;
+	if(gpfAppSocketCb)
+		gpfAppSocketCb(pstrBindReply->sock,u8MsgId,&strBind);
+}
 
-Return
-		None.
+static void m2m_ip_listen_reply(void *pvReply, uint8 u8MsgId, uint16 u16BufferSize, uint32 u32Address)
+{
+	tstrListenReply			*pstrListenReply = (tstrListenReply*)pvReply;
+	tstrSocketListenMsg		strListen;
 
-Author
-		Ahmed Ezzat
+	strListen.status = pstrListenReply->s8Status;
+	if(gpfAppSocketCb)
+		gpfAppSocketCb(pstrListenReply->sock,u8MsgId, &strListen);
+}
 
-Version
-		1.0
+static void m2m_ip_accept_reply(void *pvReply, uint8 u8MsgId, uint16 u16BufferSize, uint32 u32Address)
+{
+	tstrAcceptReply			*pstrAcceptReply = (tstrAcceptReply*)pvReply;
+	tstrSocketAcceptMsg		strAccept;
 
-Date
-		17 July 2012
-*********************************************************************/
-static void m2m_ip_cb(uint8 u8OpCode, uint16 u16BufferSize,uint32 u32Address)
-{	
-	if((u8OpCode == SOCKET_CMD_BIND) || (u8OpCode == SOCKET_CMD_SSL_BIND))
+	if(pstrAcceptReply->sConnectedSock >= 0)
 	{
-		tstrBindReply		strBindReply;
-		tstrSocketBindMsg	strBind;
+		gastrSockets[pstrAcceptReply->sConnectedSock].u8SSLFlags 		= gastrSockets[pstrAcceptReply->sListenSock].u8SSLFlags;
+		gastrSockets[pstrAcceptReply->sConnectedSock].bIsUsed 		= 1;
+		gastrSockets[pstrAcceptReply->sConnectedSock].u16DataOffset 	= pstrAcceptReply->u16AppDataOffset - M2M_HIF_HDR_OFFSET;
+
+		/* The session ID is used to distinguish different socket connections
+			by comparing the assigned session ID to the one reported by the firmware*/
+		++gu16SessionID;
+		if(gu16SessionID == 0)
+			++gu16SessionID;
 
-		if(hif_receive(u32Address, (uint8*)&strBindReply, sizeof(tstrBindReply), 0) == M2M_SUCCESS)
-		{
-			strBind.status = strBindReply.s8Status;
-			if(gpfAppSocketCb)
-				gpfAppSocketCb(strBindReply.sock,SOCKET_MSG_BIND,&strBind);
-		}
+		gastrSockets[pstrAcceptReply->sConnectedSock].u16SessionID = gu16SessionID;
+		M2M_DBG("Socket %d session ID = %d\r\n",pstrAcceptReply->sConnectedSock , gu16SessionID );		
 	}
-	else if(u8OpCode == SOCKET_CMD_LISTEN)
+	strAccept.sock = pstrAcceptReply->sConnectedSock;
+	strAccept.strAddr.sin_family		= AF_INET;
+	strAccept.strAddr.sin_port = pstrAcceptReply->strAddr.u16Port;
+	strAccept.strAddr.sin_addr.s_addr = pstrAcceptReply->strAddr.u32IPAddr;
+	if(gpfAppSocketCb)
+		gpfAppSocketCb(pstrAcceptReply->sListenSock, u8MsgId, &strAccept);
+}
+
+static void m2m_ip_connect_reply(void *pvReply, uint8 u8MsgId, uint16 u16BufferSize, uint32 u32Address)
+{
+	tstrConnectReply		*pstrConnectReply = (tstrConnectReply*)pvReply;
+	tstrSocketConnectMsg	strConnMsg;
+
+	strConnMsg.sock		= pstrConnectReply->sock;
+	strConnMsg.s8Error	= pstrConnectReply->s8Error;
+	if(pstrConnectReply->s8Error == SOCK_ERR_NO_ERROR)
 	{
-		tstrListenReply			strListenReply;
-		tstrSocketListenMsg		strListen;
-		if(hif_receive(u32Address, (uint8*)&strListenReply, sizeof(tstrListenReply), 0) == M2M_SUCCESS)
-		{
-			strListen.status = strListenReply.s8Status;
-			if(gpfAppSocketCb)
-				gpfAppSocketCb(strListenReply.sock,SOCKET_MSG_LISTEN, &strListen);
-		}
+		gastrSockets[pstrConnectReply->sock].u16DataOffset = pstrConnectReply->u16AppDataOffset - M2M_HIF_HDR_OFFSET;
 	}
-	else if(u8OpCode == SOCKET_CMD_ACCEPT)
+	if(gpfAppSocketCb)
+		gpfAppSocketCb(pstrConnectReply->sock,u8MsgId, &strConnMsg);
+}
+
+static void m2m_ip_dns_reply(void *pvReply, uint8 u8MsgId, uint16 u16BufferSize, uint32 u32Address)
+{
+	tstrDnsReply	*pstrDnsReply = (tstrDnsReply*)pvReply;
+
+	if(gpfAppResolveCb)
+		gpfAppResolveCb((uint8*)pstrDnsReply->acHostName, pstrDnsReply->u32HostIP);
+}
+
+static void m2m_ip_recv_reply(void *pvReply, uint8 u8MsgId, uint16 u16BufferSize, uint32 u32Address)
+{
+	tstrRecvReply		*pstrRecvReply = (tstrRecvReply*)pvReply;
+	SOCKET				sock;
+	sint16				s16RecvStatus;
+	uint16				u16ReadSize;
+	tstrSocketRecvMsg	strRecvMsg;
+	uint16				u16DataOffset;
+	uint16				u16SessionID = 0;
+
+	sock			= pstrRecvReply->sock;
+	u16SessionID = pstrRecvReply->u16SessionID;
+	M2M_DBG("recv callback session ID = %d\r\n",u16SessionID);
+	
+	/* Reset the Socket RX Pending Flag.
+	*/
+	gastrSockets[sock].bIsRecvPending = 0;
+
+	s16RecvStatus	= NM_BSP_B_L_16(pstrRecvReply->s16RecvStatus);
+	u16DataOffset	= NM_BSP_B_L_16(pstrRecvReply->u16DataOffset);
+	strRecvMsg.strRemoteAddr.sin_port 			= pstrRecvReply->strRemoteAddr.u16Port;
+	strRecvMsg.strRemoteAddr.sin_addr.s_addr 	= pstrRecvReply->strRemoteAddr.u32IPAddr;
+
+	if(u16SessionID == gastrSockets[sock].u16SessionID)
 	{
-		tstrAcceptReply			strAcceptReply;
-		tstrSocketAcceptMsg		strAccept;
-		if(hif_receive(u32Address, (uint8*)&strAcceptReply, sizeof(tstrAcceptReply), 0) == M2M_SUCCESS)
+		if((s16RecvStatus > 0) && (s16RecvStatus < u16BufferSize))
 		{
-			if(strAcceptReply.sConnectedSock >= 0)
-			{
-				gastrSockets[strAcceptReply.sConnectedSock].u8SSLFlags 		= gastrSockets[strAcceptReply.sListenSock].u8SSLFlags;
-				gastrSockets[strAcceptReply.sConnectedSock].bIsUsed 		= 1;
-				gastrSockets[strAcceptReply.sConnectedSock].u16DataOffset 	= strAcceptReply.u16AppDataOffset - M2M_HIF_HDR_OFFSET;
-
-				/* The session ID is used to distinguish different socket connections
-					by comparing the assigned session ID to the one reported by the firmware*/
-				++gu16SessionID;
-				if(gu16SessionID == 0)
-					++gu16SessionID;
+			/* Skip incoming bytes until reaching the Start of Application Data. 
+			*/
+			u32Address += u16DataOffset;
 
-				gastrSockets[strAcceptReply.sConnectedSock].u16SessionID = gu16SessionID;
-				M2M_DBG("Socket %d session ID = %d\r\n",strAcceptReply.sConnectedSock , gu16SessionID );		
-			}
-			strAccept.sock = strAcceptReply.sConnectedSock;
-			strAccept.strAddr.sin_family		= AF_INET;
-			strAccept.strAddr.sin_port = strAcceptReply.strAddr.u16Port;
-			strAccept.strAddr.sin_addr.s_addr = strAcceptReply.strAddr.u32IPAddr;
-			if(gpfAppSocketCb)
-				gpfAppSocketCb(strAcceptReply.sListenSock, SOCKET_MSG_ACCEPT, &strAccept);
+			/* Read the Application data and deliver it to the application callback in
+			the given application buffer. If the buffer is smaller than the received data,
+			the data is passed to the application in chunks according to its buffer size.
+			*/
+			u16ReadSize = (uint16)s16RecvStatus;
+			Socket_ReadSocketData(sock, &strRecvMsg, u8MsgId, u32Address, u16ReadSize);
 		}
-	}
-	else if((u8OpCode == SOCKET_CMD_CONNECT) || (u8OpCode == SOCKET_CMD_SSL_CONNECT))
-	{
-		tstrConnectReply		strConnectReply;
-		tstrSocketConnectMsg	strConnMsg;
-		if(hif_receive(u32Address, (uint8*)&strConnectReply, sizeof(tstrConnectReply), 0) == M2M_SUCCESS)
+		else
 		{
-			strConnMsg.sock		= strConnectReply.sock;
-			strConnMsg.s8Error	= strConnectReply.s8Error;
-			if(strConnectReply.s8Error == SOCK_ERR_NO_ERROR)
-			{
-				gastrSockets[strConnectReply.sock].u16DataOffset = strConnectReply.u16AppDataOffset - M2M_HIF_HDR_OFFSET;
-			}
+			/* Don't tidy up here. Application must call close().
+			*/
+			strRecvMsg.s16BufferSize	= s16RecvStatus;
+			strRecvMsg.pu8Buffer		= NULL;
 			if(gpfAppSocketCb)
-				gpfAppSocketCb(strConnectReply.sock,SOCKET_MSG_CONNECT, &strConnMsg);
+				gpfAppSocketCb(sock,u8MsgId, &strRecvMsg);
 		}
 	}
-	else if(u8OpCode == SOCKET_CMD_DNS_RESOLVE)
+	else
 	{
-		tstrDnsReply	strDnsReply;
-		if(hif_receive(u32Address, (uint8*)&strDnsReply, sizeof(tstrDnsReply), 0) == M2M_SUCCESS)
+		M2M_DBG("Discard recv callback %d %d \r\n",u16SessionID , gastrSockets[sock].u16SessionID);
+		if(sizeof(tstrRecvReply) < u16BufferSize)
 		{
-			if(gpfAppResolveCb)
-				gpfAppResolveCb((uint8*)strDnsReply.acHostName, strDnsReply.u32HostIP);
+			if(hif_receive(0, NULL, 0, 1) == M2M_SUCCESS)
+				M2M_DBG("hif_receive Success\n");
+			else
+				M2M_DBG("hif_receive Fail\n");
 		}
 	}
-	else if((u8OpCode == SOCKET_CMD_RECV) || (u8OpCode == SOCKET_CMD_RECVFROM) || (u8OpCode == SOCKET_CMD_SSL_RECV))
-	{
-		SOCKET				sock;
-		sint16				s16RecvStatus;
-		tstrRecvReply		strRecvReply;
-		uint16				u16ReadSize;
-		tstrSocketRecvMsg	strRecvMsg;
-		uint8				u8CallbackMsgID = SOCKET_MSG_RECV;
-		uint16				u16DataOffset;
-
-		if(u8OpCode == SOCKET_CMD_RECVFROM)
-			u8CallbackMsgID = SOCKET_MSG_RECVFROM;
-
-		/* Read RECV REPLY data structure.
-		*/
-		u16ReadSize = sizeof(tstrRecvReply);
-		if(hif_receive(u32Address, (uint8*)&strRecvReply, u16ReadSize, 0) == M2M_SUCCESS)
-		{
-			uint16 u16SessionID = 0;
-
-			sock			= strRecvReply.sock;
-			u16SessionID = strRecvReply.u16SessionID;
-			M2M_DBG("recv callback session ID = %d\r\n",u16SessionID);
-			
-			/* Reset the Socket RX Pending Flag.
-			*/
-			gastrSockets[sock].bIsRecvPending = 0;
+}
 
-			s16RecvStatus	= NM_BSP_B_L_16(strRecvReply.s16RecvStatus);
-			u16DataOffset	= NM_BSP_B_L_16(strRecvReply.u16DataOffset);
-			strRecvMsg.strRemoteAddr.sin_port 			= strRecvReply.strRemoteAddr.u16Port;
-			strRecvMsg.strRemoteAddr.sin_addr.s_addr 	= strRecvReply.strRemoteAddr.u32IPAddr;
+static void m2m_ip_send_reply(void *pvReply, uint8 u8MsgId, uint16 u16BufferSize, uint32 u32Address)
+{
+	tstrSendReply	*pstrReply = (tstrSendReply*)pvReply;
+	SOCKET			sock;
+	sint16			s16Rcvd;
+	uint16			u16SessionID = 0;
+	
+	sock = pstrReply->sock;
+	u16SessionID = pstrReply->u16SessionID;
+	M2M_DBG("send callback session ID = %d\r\n",u16SessionID);
+	
+	s16Rcvd = NM_BSP_B_L_16(pstrReply->s16SentBytes);
 
-			if(u16SessionID == gastrSockets[sock].u16SessionID)
-			{
-				if((s16RecvStatus > 0) && (s16RecvStatus < u16BufferSize))
-				{
-					/* Skip incoming bytes until reaching the Start of Application Data. 
-					*/
-					u32Address += u16DataOffset;
-
-					/* Read the Application data and deliver it to the application callback in
-					the given application buffer. If the buffer is smaller than the received data,
-					the data is passed to the application in chunks according to its buffer size.
-					*/
-					u16ReadSize = (uint16)s16RecvStatus;
-					Socket_ReadSocketData(sock, &strRecvMsg, u8CallbackMsgID, u32Address, u16ReadSize);
-				}
-				else
-				{
-					/* Don't tidy up here. Application must call close().
-					*/
-					strRecvMsg.s16BufferSize	= s16RecvStatus;
-					strRecvMsg.pu8Buffer		= NULL;
-					if(gpfAppSocketCb)
-						gpfAppSocketCb(sock,u8CallbackMsgID, &strRecvMsg);
-				}
-			}
-			else
-			{
-				M2M_DBG("Discard recv callback %d %d \r\n",u16SessionID , gastrSockets[sock].u16SessionID);
-				if(u16ReadSize < u16BufferSize)
-				{
-					if(hif_receive(0, NULL, 0, 1) == M2M_SUCCESS)
-						M2M_DBG("hif_receive Success\n");
-					else
-						M2M_DBG("hif_receive Fail\n");
-				}
-			}
-		}
+	if(u16SessionID == gastrSockets[sock].u16SessionID)
+	{
+		if(gpfAppSocketCb)
+			gpfAppSocketCb(sock,u8MsgId, &s16Rcvd);
 	}
-	else if((u8OpCode == SOCKET_CMD_SEND) || (u8OpCode == SOCKET_CMD_SENDTO) || (u8OpCode == SOCKET_CMD_SSL_SEND))
+	else
 	{
-		SOCKET			sock;
-		sint16			s16Rcvd;
-		tstrSendReply	strReply;
-		uint8			u8CallbackMsgID = SOCKET_MSG_SEND;
-
-		if(u8OpCode == SOCKET_CMD_SENDTO)
-			u8CallbackMsgID = SOCKET_MSG_SENDTO;
+		M2M_DBG("Discard send callback %d %d \r\n",u16SessionID , gastrSockets[sock].u16SessionID);
+	}
+}
 
-		if(hif_receive(u32Address, (uint8*)&strReply, sizeof(tstrSendReply), 0) == M2M_SUCCESS)
-		{
-			uint16 u16SessionID = 0;
-			
-			sock = strReply.sock;
-			u16SessionID = strReply.u16SessionID;
-			M2M_DBG("send callback session ID = %d\r\n",u16SessionID);
-			
-			s16Rcvd = NM_BSP_B_L_16(strReply.s16SentBytes);
+static void m2m_ip_ping_reply(void *pvReply, uint8 u8MsgId, uint16 u16BufferSize, uint32 u32Address)
+{
+	tstrPingReply	*pstrPingReply = (tstrPingReply*)pvReply;
 
-			if(u16SessionID == gastrSockets[sock].u16SessionID)
-			{
-				if(gpfAppSocketCb)
-					gpfAppSocketCb(sock,u8CallbackMsgID, &s16Rcvd);
-			}
-			else
-			{
-				M2M_DBG("Discard send callback %d %d \r\n",u16SessionID , gastrSockets[sock].u16SessionID);
-			}
-		}
+	gfpPingCb = (void (*)(uint32 , uint32 , uint8))pstrPingReply->u32CmdPrivate;
+	if(gfpPingCb != NULL)
+	{
+		gfpPingCb(pstrPingReply->u32IPAddr, pstrPingReply->u32RTT, pstrPingReply->u8ErrorCode);
 	}
-	else if(u8OpCode == SOCKET_CMD_PING)
+}
+
+/* Dispatch table for the socket replies, indexed by (opcode - SOCKET_CMD_FIRST).
+ * Opcodes with no handler are requests the firmware never answers. */
+static const tstrSocketCmdEntry gastrSocketCmdTbl[SOCKET_CMD_COUNT] = {
+	[SOCKET_CMD_BIND - SOCKET_CMD_FIRST]		= {m2m_ip_bind_reply,		sizeof(tstrBindReply),		SOCKET_MSG_BIND,		0},
+	[SOCKET_CMD_SSL_BIND - SOCKET_CMD_FIRST]	= {m2m_ip_bind_reply,		sizeof(tstrBindReply),		SOCKET_MSG_BIND,		0},
+	[SOCKET_CMD_LISTEN - SOCKET_CMD_FIRST]		= {m2m_ip_listen_reply,		sizeof(tstrListenReply),	SOCKET_MSG_LISTEN,		0},
+	[SOCKET_CMD_ACCEPT - SOCKET_CMD_FIRST]		= {m2m_ip_accept_reply,		sizeof(tstrAcceptReply),	SOCKET_MSG_ACCEPT,		0},
+	[SOCKET_CMD_CONNECT - SOCKET_CMD_FIRST]		= {m2m_ip_connect_reply,	sizeof(tstrConnectReply),	SOCKET_MSG_CONNECT,		0},
+	[SOCKET_CMD_SSL_CONNECT - SOCKET_CMD_FIRST]	= {m2m_ip_connect_reply,	sizeof(tstrConnectReply),	SOCKET_MSG_CONNECT,		0},
+	[SOCKET_CMD_DNS_RESOLVE - SOCKET_CMD_FIRST]	= {m2m_ip_dns_reply,		sizeof(tstrDnsReply),		SOCKET_MSG_DNS_RESOLVE,	0},
+	[SOCKET_CMD_RECV - SOCKET_CMD_FIRST]		= {m2m_ip_recv_reply,		sizeof(tstrRecvReply),		SOCKET_MSG_RECV,		0},
+	[SOCKET_CMD_SSL_RECV - SOCKET_CMD_FIRST]	= {m2m_ip_recv_reply,		sizeof(tstrRecvReply),		SOCKET_MSG_RECV,		0},
+	[SOCKET_CMD_RECVFROM - SOCKET_CMD_FIRST]	= {m2m_ip_recv_reply,		sizeof(tstrRecvReply),		SOCKET_MSG_RECVFROM,	0},
+	[SOCKET_CMD_SEND - SOCKET_CMD_FIRST]		= {m2m_ip_send_reply,		sizeof(tstrSendReply),		SOCKET_MSG_SEND,		0},
+	[SOCKET_CMD_SSL_SEND - SOCKET_CMD_FIRST]	= {m2m_ip_send_reply,		sizeof(tstrSendReply),		SOCKET_MSG_SEND,		0},
+	[SOCKET_CMD_SENDTO - SOCKET_CMD_FIRST]		= {m2m_ip_send_reply,		sizeof(tstrSendReply),		SOCKET_MSG_SENDTO,		0},
+	[SOCKET_CMD_PING - SOCKET_CMD_FIRST]		= {m2m_ip_ping_reply,		sizeof(tstrPingReply),		0,						1},
+};
+
+/*********************************************************************
+Function
+		m2m_ip_cb
+
+Description
+		Callback function used by the NMC1000 driver to deliver messages
+		for socket layer. The opcode indexes gastrSocketCmdTbl, which
+		gives the reply size to read and the handler to run.
+
+Return
+		None.
+
+Author
+		Ahmed Ezzat
+
+Version
+		1.0
+
+Date
+		17 July 2012
+*********************************************************************/
+static void m2m_ip_cb(uint8 u8OpCode, uint16 u16BufferSize,uint32 u32Address)
+{	
+	const tstrSocketCmdEntry	*pstrEntry;
+	tuSocketReply				uReply;
+
+	if((u8OpCode < SOCKET_CMD_FIRST) || (u8OpCode > SOCKET_CMD_LAST))
 	{
-		tstrPingReply	strPingReply;
-		if(hif_receive(u32Address, (uint8*)&strPingReply, sizeof(tstrPingReply), 1) == M2M_SUCCESS)
-		{
-			gfpPingCb = (void (*)(uint32 , uint32 , uint8))strPingReply.u32CmdPrivate;
-			if(gfpPingCb != NULL)
-			{
-				gfpPingCb(strPingReply.u32IPAddr, strPingReply.u32RTT, strPingReply.u8ErrorCode);
-			}
-		}
+		M2M_DBG("Unknown socket opcode %02X\n", u8OpCode);
+		return;
 	}
+	gau32SocketCmdCnt[u8OpCode - SOCKET_CMD_FIRST]++;
+
+	pstrEntry = &gastrSocketCmdTbl[u8OpCode - SOCKET_CMD_FIRST];
+	if(pstrEntry->pfHandler == NULL)
+		return;
+
+	if(hif_receive(u32Address, (uint8*)&uReply, pstrEntry->u8ReplySize, pstrEntry->u8RxDone) == M2M_SUCCESS)
+		pstrEntry->pfHandler(&uReply, pstrEntry->u8MsgId, u16BufferSize, u32Address);
 }
 /*********************************************************************
 Function
@@ -423,6 +471,7 @@ void socketInit(void)
 	if(gbSocketInit == 0)
 	{
 		m2m_memset((uint8*)gastrSockets, 0, MAX_SOCKET * sizeof(tstrSocket));
+		m2m_memset((uint8*)gau32SocketCmdCnt, 0, sizeof(gau32SocketCmdCnt));
 		hif_register_cb(M2M_REQ_GROUP_IP,m2m_ip_cb);
 		gbSocketInit	= 1;
 		gu16SessionID	= 0;
@@ -1321,4 +1370,31 @@ Date
 uint8 IsSocketReady(void)
 {
     return gbSocketInit;
-}
\ No newline at end of file
+}
+/*********************************************************************
+Function
+		socketGetCmdCount
+
+Description
+		Number of messages received from the firmware for a socket
+		opcode (SOCKET_CMD_*) since socketInit, counted by m2m_ip_cb
+		whether the driver handles the opcode or not.
+
+Return
+		The message count, or 0 for an opcode out of the socket range.
+
+Author
+		Ahmed Ezzat
+
+Version
+		1.0
+
+Date
+		17 July 2012
+*********************************************************************/
+uint32 socketGetCmdCount(uint8 u8OpCode)
+{
+	if((u8OpCode < SOCKET_CMD_FIRST) || (u8OpCode > SOCKET_CMD_LAST))
+		return 0;
+	return gau32SocketCmdCnt[u8OpCode - SOCKET_CMD_FIRST];
+}
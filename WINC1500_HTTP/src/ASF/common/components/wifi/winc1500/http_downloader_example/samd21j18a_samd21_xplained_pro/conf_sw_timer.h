@@ -33,8 +33,9 @@
 #ifndef CONF_SW_TIMER_H_INCLUDED
 #define CONF_SW_TIMER_H_INCLUDED
 
-/* Maximum timer count. */
-#define CONF_SW_TIMER_COUNT                1
+/* Maximum timer count: HTTP client, WebSocket client handshake and pings, block synchronization,
+ * Merkle download. */
+#define CONF_SW_TIMER_COUNT                5
 
 /* Maximum timer count. */
 #define CONF_SW_TIMER_CALLBACK_CHANNEL     0
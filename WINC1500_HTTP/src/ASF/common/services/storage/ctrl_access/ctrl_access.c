@@ -118,6 +118,8 @@ static xSemaphoreHandle ctrl_access_semphr = NULL;
     TPASTE3(Lun_, lun, _unload),\
     TPASTE3(Lun_, lun, _wr_protect),\
     TPASTE3(Lun_, lun, _removal),\
+    TPASTE3(Lun_, lun, _flush),\
+    TPASTE3(Lun_, lun, _pre_erase),\
     TPASTE3(Lun_, lun, _usb_read_10),\
     TPASTE3(Lun_, lun, _usb_write_10),\
     TPASTE3(Lun_, lun, _mem_2_ram),\
@@ -132,6 +134,8 @@ static xSemaphoreHandle ctrl_access_semphr = NULL;
     TPASTE3(Lun_, lun, _unload),\
     TPASTE3(Lun_, lun, _wr_protect),\
     TPASTE3(Lun_, lun, _removal),\
+    TPASTE3(Lun_, lun, _flush),\
+    TPASTE3(Lun_, lun, _pre_erase),\
     TPASTE3(Lun_, lun, _usb_read_10),\
     TPASTE3(Lun_, lun, _usb_write_10),\
     TPASTE3(LUN_, lun, _NAME)\
@@ -144,6 +148,8 @@ static xSemaphoreHandle ctrl_access_semphr = NULL;
     TPASTE3(Lun_, lun, _unload),\
     TPASTE3(Lun_, lun, _wr_protect),\
     TPASTE3(Lun_, lun, _removal),\
+    TPASTE3(Lun_, lun, _flush),\
+    TPASTE3(Lun_, lun, _pre_erase),\
     TPASTE3(Lun_, lun, _mem_2_ram),\
     TPASTE3(Lun_, lun, _ram_2_mem),\
     TPASTE3(LUN_, lun, _NAME)\
@@ -156,6 +162,8 @@ static xSemaphoreHandle ctrl_access_semphr = NULL;
     TPASTE3(Lun_, lun, _unload),\
     TPASTE3(Lun_, lun, _wr_protect),\
     TPASTE3(Lun_, lun, _removal),\
+    TPASTE3(Lun_, lun, _flush),\
+    TPASTE3(Lun_, lun, _pre_erase),\
     TPASTE3(LUN_, lun, _NAME)\
   }
 #endif
@@ -168,6 +176,8 @@ static const struct
   bool (*unload)(bool);
   bool (*wr_protect)(void);
   bool (*removal)(void);
+  Ctrl_status (*flush)(void);
+  Ctrl_status (*pre_erase)(U32 addr, U32 nb_sector);
 #if ACCESS_USB == true
   Ctrl_status (*usb_read_10)(U32, U16);
   Ctrl_status (*usb_write_10)(U32, U16);
@@ -182,48 +192,96 @@ static const struct
 #if LUN_0 == ENABLE
 # ifndef Lun_0_unload
 #  define Lun_0_unload NULL
+# endif
+# ifndef Lun_0_flush
+#  define Lun_0_flush NULL
+# endif
+# ifndef Lun_0_pre_erase
+#  define Lun_0_pre_erase NULL
 # endif
   Lun_desc_entry(0),
 #endif
 #if LUN_1 == ENABLE
 # ifndef Lun_1_unload
 #  define Lun_1_unload NULL
+# endif
+# ifndef Lun_1_flush
+#  define Lun_1_flush NULL
+# endif
+# ifndef Lun_1_pre_erase
+#  define Lun_1_pre_erase NULL
 # endif
   Lun_desc_entry(1),
 #endif
 #if LUN_2 == ENABLE
 # ifndef Lun_2_unload
 #  define Lun_2_unload NULL
+# endif
+# ifndef Lun_2_flush
+#  define Lun_2_flush NULL
+# endif
+# ifndef Lun_2_pre_erase
+#  define Lun_2_pre_erase NULL
 # endif
   Lun_desc_entry(2),
 #endif
 #if LUN_3 == ENABLE
 # ifndef Lun_3_unload
 #  define Lun_3_unload NULL
+# endif
+# ifndef Lun_3_flush
+#  define Lun_3_flush NULL
+# endif
+# ifndef Lun_3_pre_erase
+#  define Lun_3_pre_erase NULL
 # endif
   Lun_desc_entry(3),
 #endif
 #if LUN_4 == ENABLE
 # ifndef Lun_4_unload
 #  define Lun_4_unload NULL
+# endif
+# ifndef Lun_4_flush
+#  define Lun_4_flush NULL
+# endif
+# ifndef Lun_4_pre_erase
+#  define Lun_4_pre_erase NULL
 # endif
   Lun_desc_entry(4),
 #endif
 #if LUN_5 == ENABLE
 # ifndef Lun_5_unload
 #  define Lun_5_unload NULL
+# endif
+# ifndef Lun_5_flush
+#  define Lun_5_flush NULL
+# endif
+# ifndef Lun_5_pre_erase
+#  define Lun_5_pre_erase NULL
 # endif
   Lun_desc_entry(5),
 #endif
 #if LUN_6 == ENABLE
 # ifndef Lun_6_unload
 #  define Lun_6_unload NULL
+# endif
+# ifndef Lun_6_flush
+#  define Lun_6_flush NULL
+# endif
+# ifndef Lun_6_pre_erase
+#  define Lun_6_pre_erase NULL
 # endif
   Lun_desc_entry(6),
 #endif
 #if LUN_7 == ENABLE
 # ifndef Lun_7_unload
 #  define Lun_7_unload NULL
+# endif
+# ifndef Lun_7_flush
+#  define Lun_7_flush NULL
+# endif
+# ifndef Lun_7_pre_erase
+#  define Lun_7_pre_erase NULL
 # endif
   Lun_desc_entry(7)
 #endif
@@ -448,6 +506,54 @@ bool mem_removal(U8 lun)
 }
 
 
+Ctrl_status mem_flush(U8 lun)
+{
+  Ctrl_status status;
+#if !MAX_LUN
+  UNUSED(lun);
+#endif
+
+  if (!Ctrl_access_lock()) return CTRL_FAIL;
+
+  status =
+#if MAX_LUN
+          (lun < MAX_LUN) ?
+              (lun_desc[lun].flush ?
+                  lun_desc[lun].flush() : CTRL_GOOD) :
+#endif
+                              CTRL_GOOD; /* Nothing buffered */
+
+  Ctrl_access_unlock();
+
+  return status;
+}
+
+
+Ctrl_status mem_pre_erase(U8 lun, U32 addr, U32 nb_sector)
+{
+  Ctrl_status status;
+#if !MAX_LUN
+  UNUSED(lun);
+  UNUSED(addr);
+  UNUSED(nb_sector);
+#endif
+
+  if (!Ctrl_access_lock()) return CTRL_FAIL;
+
+  status =
+#if MAX_LUN
+          (lun < MAX_LUN) ?
+              (lun_desc[lun].pre_erase ?
+                  lun_desc[lun].pre_erase(addr, nb_sector) : CTRL_GOOD) :
+#endif
+                              CTRL_GOOD; /* Announce ignored */
+
+  Ctrl_access_unlock();
+
+  return status;
+}
+
+
 const char *mem_name(U8 lun)
 {
 #if MAX_LUN==0
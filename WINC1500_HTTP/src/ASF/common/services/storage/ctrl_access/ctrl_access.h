@@ -259,6 +259,31 @@ extern bool mem_wr_protect(U8 lun);
  */
 extern bool mem_removal(U8 lun);
 
+/*! \brief Completes the pending writes of the memory.
+ *
+ * \param lun Logical Unit Number.
+ *
+ * \return Status.
+ *
+ * \note Only used by memories which keep a write transfer opened between
+ *       sector writes. Other memories report \c CTRL_GOOD.
+ */
+extern Ctrl_status mem_flush(U8 lun);
+
+/*! \brief Announces sectors to be written sequentially.
+ *
+ * \param lun        Logical Unit Number.
+ * \param addr       First sector of the run.
+ * \param nb_sector  Number of sectors of the run.
+ *
+ * \return Status.
+ *
+ * \note The memory may erase the whole run before the writes, thus the
+ *       sectors of the run which are not written have an undefined content.
+ *       Memories without erase optimization report \c CTRL_GOOD.
+ */
+extern Ctrl_status mem_pre_erase(U8 lun, U32 addr, U32 nb_sector);
+
 /*! \brief Returns a pointer to the LUN name.
  *
  * \param lun Logical Unit Number.
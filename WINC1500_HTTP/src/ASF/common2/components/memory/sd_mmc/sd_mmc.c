@@ -42,6 +42,10 @@
 #include "sd_mmc_protocol.h"
 #include "sd_mmc.h"
 #include "delay.h"
+#if (defined SD_MMC_0_CD_EXTINT)
+#  include "extint.h"
+#  include "extint_callback.h"
+#endif
 
 /**
  * \ingroup sd_mmc_stack
@@ -192,6 +196,31 @@ static uint16_t sd_mmc_nb_block_to_tranfer = 0;
 //! Number of block remaining to read or write on the current transfer
 static uint16_t sd_mmc_nb_block_remaining = 0;
 
+//! Streaming write session is opened (CMD25 kept running between writes)
+static bool sd_mmc_stream_opened = false;
+//! Slot of the streaming write session
+static uint8_t sd_mmc_stream_slot;
+//! Block number expected to continue the streaming write session
+static uint32_t sd_mmc_stream_next_block;
+
+//! Slot of the pre-erase run
+static uint8_t sd_mmc_erase_slot;
+//! Block number expected to continue the pre-erase run
+static uint32_t sd_mmc_erase_next_block;
+//! Number of blocks remaining in the pre-erase run
+static uint32_t sd_mmc_erase_nb_block = 0;
+//! The current write transfer continues the pre-erase run
+static bool sd_mmc_erase_running = false;
+
+//! Exclusive access is opened (card kept selected between accesses)
+static bool sd_mmc_excl_opened = false;
+//! Slot of the exclusive access
+static uint8_t sd_mmc_excl_slot;
+#if (defined SD_MMC_0_CD_EXTINT)
+//! Card detect pin changed during the exclusive access
+static volatile bool sd_mmc_excl_card_changed;
+#endif
+
 //! SD/MMC transfer rate unit codes (10K) list
 const uint32_t sd_mmc_trans_units[7] = {
 	10, 100, 1000, 10000, 0, 0, 0
@@ -233,6 +262,7 @@ static bool sdio_cmd53(uint8_t rw_flag, uint8_t func_nb, uint32_t reg_addr,
 #endif // SDIO_SUPPORT_ENABLE
 static bool sd_acmd6(void);
 static bool sd_acmd51(void);
+static bool sd_acmd23(uint32_t nb_block);
 //! @}
 
 //! \name Internal function to process the initialization and install
@@ -244,6 +274,14 @@ static bool sd_mmc_spi_card_init(void);
 static bool sd_mmc_mci_card_init(void);
 static bool sd_mmc_spi_install_mmc(void);
 static bool sd_mmc_mci_install_mmc(void);
+static bool sd_mmc_stream_on_slot(uint8_t slot);
+static void sd_mmc_stream_drop(void);
+static void sd_mmc_stream_abort(void);
+static bool sd_mmc_excl_on_slot(uint8_t slot);
+static void sd_mmc_excl_end(void);
+#if (defined SD_MMC_0_CD_EXTINT)
+static void sd_mmc_cd_extint_callback(void);
+#endif
 //! @}
 
 
@@ -1242,6 +1280,35 @@ static bool sd_acmd6(void)
 	return true;
 }
 
+/**
+ * \brief ACMD23 - Set the number of write blocks to be pre-erased.
+ *
+ * \note
+ * The setting applies to the next multiple block write command only.
+ * If the transfer is stopped before all pre-erased blocks are written,
+ * the content of the remaining blocks is undefined.
+ *
+ * \param nb_block Number of blocks to be pre-erased
+ *
+ * \return true if success, otherwise false
+ */
+static bool sd_acmd23(uint32_t nb_block)
+{
+	// CMD55 - Indicate to the card that the next command is an
+	// application specific command rather than a standard command.
+	if (!driver_send_cmd(SDMMC_CMD55_APP_CMD, (uint32_t)sd_mmc_card->rca << 16)) {
+		return false;
+	}
+	if (nb_block > SD_ACMD23_NB_BLOCK_MAX) {
+		nb_block = SD_ACMD23_NB_BLOCK_MAX;
+	}
+	if (!driver_send_cmd(SD_ACMD23_SET_WR_BLK_ERASE_COUNT, nb_block)) {
+		return false;
+	}
+	sd_mmc_debug("%lu blocks pre-erased.\n\r", (unsigned long)nb_block);
+	return true;
+}
+
 /**
  * \brief ACMD51 - Read the SD Configuration Register.
  *
@@ -1316,6 +1383,16 @@ static sd_mmc_err_t sd_mmc_select_slot(uint8_t slot)
 	}
 	Assert(sd_mmc_nb_block_remaining == 0);
 
+	if (sd_mmc_excl_on_slot(slot)) {
+		// Card and interface kept selected by the exclusive access
+		return SD_MMC_OK;
+	}
+	if (sd_mmc_excl_opened) {
+		// The card of the exclusive access must release the bus
+		sd_mmc_excl_end();
+		sd_mmc_deselect_slot();
+	}
+
 #if (defined SD_MMC_0_CD_GPIO)
 	//! Card Detect pins
 	if (port_pin_get_input_level(sd_mmc_cards[slot].cd_gpio)
@@ -1360,6 +1437,11 @@ static sd_mmc_err_t sd_mmc_select_slot(uint8_t slot)
 		sd_mmc_cards[slot].high_speed = 0;
 	}
 #endif
+	if ((sd_mmc_cards[slot].state == SD_MMC_CARD_STATE_INIT)
+			&& (slot == sd_mmc_erase_slot)) {
+		// The pre-erase run was announced for the previous card
+		sd_mmc_erase_nb_block = 0;
+	}
 
 	// Initialize interface
 	sd_mmc_slot_sel = slot;
@@ -1383,11 +1465,135 @@ static void sd_mmc_configure_slot(void)
  */
 static void sd_mmc_deselect_slot(void)
 {
+	if (sd_mmc_excl_opened && (sd_mmc_slot_sel == sd_mmc_excl_slot)) {
+		// Kept selected until the end of the exclusive access
+		return;
+	}
 	if (sd_mmc_slot_sel < SD_MMC_MEM_CNT) {
 		driver_deselect_device(sd_mmc_slot_sel);
 	}
 }
 
+/**
+ * \brief Checks if the streaming write session is running on a slot
+ *
+ * The card stays selected while the session runs, thus only the card
+ * detect pin is checked. A card removal drops the session.
+ *
+ * \param slot  Card slot number
+ *
+ * \return true if the session is running on this slot, otherwise false
+ */
+static bool sd_mmc_stream_on_slot(uint8_t slot)
+{
+	if ((!sd_mmc_stream_opened) || (slot != sd_mmc_stream_slot)) {
+		return false;
+	}
+	if (sd_mmc_excl_opened && (slot == sd_mmc_excl_slot)) {
+		// The card is watched by the exclusive access
+		return sd_mmc_excl_on_slot(slot);
+	}
+#if (defined SD_MMC_0_CD_GPIO)
+	if (port_pin_get_input_level(sd_mmc_cards[slot].cd_gpio)
+			!= SD_MMC_0_CD_DETECT_VALUE) {
+		// Card removed, nothing can be sent to stop the transfer
+		sd_mmc_stream_drop();
+		sd_mmc_cards[slot].state = SD_MMC_CARD_STATE_NO_CARD;
+		return false;
+	}
+#endif
+	return true;
+}
+
+/**
+ * \brief Drops the streaming write session without stopping the transfer
+ */
+static void sd_mmc_stream_drop(void)
+{
+	sd_mmc_stream_opened = false;
+	sd_mmc_nb_block_remaining = 0;
+	sd_mmc_deselect_slot();
+}
+
+/**
+ * \brief Stops the streaming write session after a transfer error
+ *
+ * The card may still be in the multiple block write, where it would take the
+ * next command as data, thus the transfer is stopped before the card is
+ * deselected.
+ */
+static void sd_mmc_stream_abort(void)
+{
+	if (sd_mmc_nb_block_to_tranfer > 1) {
+		if (sd_mmc_is_mci()) {
+			driver_adtc_stop(SDMMC_CMD12_STOP_TRANSMISSION, 0);
+		}
+#ifdef SD_MMC_SPI_MODE
+		sd_mmc_spi_abort_write_blocks();
+#endif
+	}
+	sd_mmc_stream_drop();
+}
+
+/**
+ * \brief Checks if the exclusive access is opened on a slot
+ *
+ * A card removal ends the exclusive access and drops the streaming write
+ * session, the card must then be installed again.
+ *
+ * \param slot  Card slot number
+ *
+ * \return true if the exclusive access is opened on this slot,
+ *         otherwise false
+ */
+static bool sd_mmc_excl_on_slot(uint8_t slot)
+{
+	bool card_present = true;
+
+	if ((!sd_mmc_excl_opened) || (slot != sd_mmc_excl_slot)) {
+		return false;
+	}
+#if (defined SD_MMC_0_CD_EXTINT)
+	// Any edge may be a card swap, thus the card is always installed again
+	card_present = !sd_mmc_excl_card_changed;
+#elif (defined SD_MMC_0_CD_GPIO)
+	card_present = (port_pin_get_input_level(sd_mmc_cards[slot].cd_gpio)
+			== SD_MMC_0_CD_DETECT_VALUE);
+#endif
+	if (card_present) {
+		return true;
+	}
+	// Card removed, nothing can be sent to stop a running transfer
+	sd_mmc_excl_end();
+	sd_mmc_stream_opened = false;
+	sd_mmc_nb_block_remaining = 0;
+	sd_mmc_deselect_slot();
+	sd_mmc_cards[slot].state = SD_MMC_CARD_STATE_NO_CARD;
+	return false;
+}
+
+/**
+ * \brief Ends the exclusive access without deselecting the card
+ */
+static void sd_mmc_excl_end(void)
+{
+	sd_mmc_excl_opened = false;
+#if (defined SD_MMC_0_CD_EXTINT)
+	extint_chan_disable_callback(SD_MMC_0_CD_EXTINT,
+			EXTINT_CALLBACK_TYPE_DETECT);
+#endif
+}
+
+#if (defined SD_MMC_0_CD_EXTINT)
+/**
+ * \brief Card detect pin interrupt, enabled during the exclusive access
+ */
+static void sd_mmc_cd_extint_callback(void)
+{
+	sd_mmc_excl_card_changed = true;
+}
+#endif
+
 /**
  * \brief Initialize the SD card in SPI mode.
  *
@@ -1762,7 +1968,26 @@ void sd_mmc_init(void)
 		sd_mmc_cards[slot].state = SD_MMC_CARD_STATE_NO_CARD;
 	}
 	sd_mmc_slot_sel = 0xFF; // No slot configurated
+	sd_mmc_stream_opened = false;
+	sd_mmc_erase_nb_block = 0;
+	sd_mmc_excl_opened = false;
 	driver_init();
+#if (defined SD_MMC_0_CD_EXTINT)
+	//! Card detect pin interrupt on both edges, enabled by exclusive access
+	struct extint_chan_conf config_extint_chan;
+
+	extint_chan_get_config_defaults(&config_extint_chan);
+	config_extint_chan.gpio_pin = SD_MMC_0_CD_GPIO;
+	config_extint_chan.gpio_pin_mux = SD_MMC_0_CD_EXTINT_MUX;
+	config_extint_chan.gpio_pin_pull = EXTINT_PULL_UP;
+	config_extint_chan.filter_input_signal = true;
+	config_extint_chan.detection_criteria = EXTINT_DETECT_BOTH;
+	extint_chan_disable_callback(SD_MMC_0_CD_EXTINT,
+			EXTINT_CALLBACK_TYPE_DETECT);
+	extint_chan_set_config(SD_MMC_0_CD_EXTINT, &config_extint_chan);
+	extint_register_callback(sd_mmc_cd_extint_callback, SD_MMC_0_CD_EXTINT,
+			EXTINT_CALLBACK_TYPE_DETECT);
+#endif
 }
 
 uint8_t sd_mmc_nb_slot(void)
@@ -1774,6 +1999,12 @@ sd_mmc_err_t sd_mmc_check(uint8_t slot)
 {
 	sd_mmc_err_t sd_mmc_err;
 
+	if (sd_mmc_stream_on_slot(slot)) {
+		return SD_MMC_OK;
+	}
+	if (SD_MMC_OK != sd_mmc_stream_flush()) {
+		return SD_MMC_ERR_COMM;
+	}
 	sd_mmc_err = sd_mmc_select_slot(slot);
 	if (sd_mmc_err != SD_MMC_INIT_ONGOING) {
 		sd_mmc_deselect_slot();
@@ -1798,7 +2029,11 @@ sd_mmc_err_t sd_mmc_check(uint8_t slot)
 
 card_type_t sd_mmc_get_type(uint8_t slot)
 {
-	if (SD_MMC_OK != sd_mmc_select_slot(slot)) {
+	if (sd_mmc_stream_on_slot(slot)) {
+		return sd_mmc_card->type;
+	}
+	if ((SD_MMC_OK != sd_mmc_stream_flush())
+			|| (SD_MMC_OK != sd_mmc_select_slot(slot))) {
 		return CARD_TYPE_UNKNOWN;
 	}
 	sd_mmc_deselect_slot();
@@ -1807,7 +2042,11 @@ card_type_t sd_mmc_get_type(uint8_t slot)
 
 card_version_t sd_mmc_get_version(uint8_t slot)
 {
-	if (SD_MMC_OK != sd_mmc_select_slot(slot)) {
+	if (sd_mmc_stream_on_slot(slot)) {
+		return sd_mmc_card->version;
+	}
+	if ((SD_MMC_OK != sd_mmc_stream_flush())
+			|| (SD_MMC_OK != sd_mmc_select_slot(slot))) {
 		return CARD_VER_UNKNOWN;
 	}
 	sd_mmc_deselect_slot();
@@ -1816,7 +2055,11 @@ card_version_t sd_mmc_get_version(uint8_t slot)
 
 uint32_t sd_mmc_get_capacity(uint8_t slot)
 {
-	if (SD_MMC_OK != sd_mmc_select_slot(slot)) {
+	if (sd_mmc_stream_on_slot(slot)) {
+		return sd_mmc_card->capacity;
+	}
+	if ((SD_MMC_OK != sd_mmc_stream_flush())
+			|| (SD_MMC_OK != sd_mmc_select_slot(slot))) {
 		return 0;
 	}
 	sd_mmc_deselect_slot();
@@ -1842,6 +2085,10 @@ sd_mmc_err_t sd_mmc_init_read_blocks(uint8_t slot, uint32_t start,
 	sd_mmc_err_t sd_mmc_err;
 	uint32_t cmd, arg, resp;
 
+	sd_mmc_err = sd_mmc_stream_flush();
+	if (sd_mmc_err != SD_MMC_OK) {
+		return sd_mmc_err;
+	}
 	sd_mmc_err = sd_mmc_select_slot(slot);
 	if (sd_mmc_err != SD_MMC_OK) {
 		return sd_mmc_err;
@@ -1932,6 +2179,10 @@ sd_mmc_err_t sd_mmc_init_write_blocks(uint8_t slot, uint32_t start,
 	sd_mmc_err_t sd_mmc_err;
 	uint32_t cmd, arg, resp;
 
+	sd_mmc_err = sd_mmc_stream_flush();
+	if (sd_mmc_err != SD_MMC_OK) {
+		return sd_mmc_err;
+	}
 	sd_mmc_err = sd_mmc_select_slot(slot);
 	if (sd_mmc_err != SD_MMC_OK) {
 		return sd_mmc_err;
@@ -1941,6 +2192,19 @@ sd_mmc_err_t sd_mmc_init_write_blocks(uint8_t slot, uint32_t start,
 		return SD_MMC_ERR_WP;
 	}
 
+	// Pre-erase the blocks of the announced run written by this transfer
+	sd_mmc_erase_running = (sd_mmc_erase_nb_block != 0)
+			&& (slot == sd_mmc_erase_slot)
+			&& (start == sd_mmc_erase_next_block);
+	if (sd_mmc_erase_running && (nb_block > 1)
+			&& (sd_mmc_card->type & CARD_TYPE_SD)) {
+		if (!sd_acmd23(min(sd_mmc_erase_nb_block, nb_block))) {
+			sd_mmc_erase_running = false;
+			sd_mmc_deselect_slot();
+			return SD_MMC_ERR_COMM;
+		}
+	}
+
 	if (nb_block > 1) {
 		cmd = SDMMC_CMD25_WRITE_MULTIPLE_BLOCK;
 	} else {
@@ -1982,6 +2246,15 @@ sd_mmc_err_t sd_mmc_start_write_blocks(const void *src, uint16_t nb_block)
 		return SD_MMC_ERR_COMM;
 	}
 	sd_mmc_nb_block_remaining -= nb_block;
+	if (sd_mmc_erase_running) {
+		sd_mmc_erase_next_block += nb_block;
+		if (sd_mmc_erase_nb_block > nb_block) {
+			sd_mmc_erase_nb_block -= nb_block;
+		} else {
+			sd_mmc_erase_nb_block = 0;
+			sd_mmc_erase_running = false;
+		}
+	}
 	return SD_MMC_OK;
 }
 
@@ -2011,10 +2284,146 @@ sd_mmc_err_t sd_mmc_wait_end_of_write_blocks(bool abort)
 			return SD_MMC_ERR_COMM;
 		}
 	}
+#ifdef SD_MMC_SPI_MODE
+	// The SPI driver sends the stop token only after the last block
+	// announced, thus an aborted multiblock write must be stopped here.
+	if (abort && !sd_mmc_spi_abort_write_blocks()) {
+		sd_mmc_deselect_slot();
+		return SD_MMC_ERR_COMM;
+	}
+#endif
 	sd_mmc_deselect_slot();
 	return SD_MMC_OK;
 }
 
+sd_mmc_err_t sd_mmc_stream_write_blocks(uint8_t slot, uint32_t start,
+		const void *src, uint16_t nb_block)
+{
+	sd_mmc_err_t sd_mmc_err;
+
+	if (sd_mmc_stream_on_slot(slot)
+			&& (start == sd_mmc_stream_next_block)
+			&& (sd_mmc_nb_block_remaining >= nb_block)) {
+		// Continue the running session after the programmation
+		// of the previous blocks
+		sd_mmc_err = sd_mmc_wait_end_of_write_blocks(false);
+		if (sd_mmc_err != SD_MMC_OK) {
+			sd_mmc_stream_abort();
+			return sd_mmc_err;
+		}
+	} else {
+		// Not contiguous, restart a session at this block
+		sd_mmc_err = sd_mmc_stream_flush();
+		if (sd_mmc_err != SD_MMC_OK) {
+			return sd_mmc_err;
+		}
+		sd_mmc_err = sd_mmc_init_write_blocks(slot, start,
+				SD_MMC_STREAM_NB_BLOCK_MAX);
+		if (sd_mmc_err != SD_MMC_OK) {
+			return sd_mmc_err;
+		}
+		sd_mmc_stream_opened = true;
+		sd_mmc_stream_slot = slot;
+		sd_mmc_stream_next_block = start;
+	}
+
+	// The busy of the last block is checked on the next access
+	sd_mmc_err = sd_mmc_start_write_blocks(src, nb_block);
+	if (sd_mmc_err != SD_MMC_OK) {
+		sd_mmc_stream_abort();
+		return sd_mmc_err;
+	}
+	sd_mmc_stream_next_block += nb_block;
+	if (sd_mmc_nb_block_remaining == 0) {
+		// Maximum session length reached, the transfer ends normally
+		sd_mmc_stream_opened = false;
+		return sd_mmc_wait_end_of_write_blocks(false);
+	}
+	return SD_MMC_OK;
+}
+
+sd_mmc_err_t sd_mmc_set_pre_erase(uint8_t slot, uint32_t start,
+		uint32_t nb_block)
+{
+	sd_mmc_err_t sd_mmc_err;
+
+	if (slot >= SD_MMC_MEM_CNT) {
+		return SD_MMC_ERR_SLOT;
+	}
+	if (sd_mmc_stream_on_slot(slot)) {
+		// The pre-erase is sent before the multiple block write command,
+		// thus the run must start a new session.
+		sd_mmc_err = sd_mmc_stream_flush();
+		if (sd_mmc_err != SD_MMC_OK) {
+			return sd_mmc_err;
+		}
+	}
+	sd_mmc_erase_slot = slot;
+	sd_mmc_erase_next_block = start;
+	sd_mmc_erase_nb_block = nb_block;
+	return SD_MMC_OK;
+}
+
+sd_mmc_err_t sd_mmc_stream_flush(void)
+{
+	sd_mmc_err_t sd_mmc_err;
+
+	if (!sd_mmc_stream_opened) {
+		return SD_MMC_OK;
+	}
+	sd_mmc_stream_opened = false;
+	// Wait the programmation of the last block then stop the transfer
+	sd_mmc_err = sd_mmc_wait_end_of_write_blocks(true);
+	if (sd_mmc_err != SD_MMC_OK) {
+		sd_mmc_stream_abort();
+	}
+	return sd_mmc_err;
+}
+
+sd_mmc_err_t sd_mmc_exclusive_open(uint8_t slot)
+{
+	sd_mmc_err_t sd_mmc_err;
+
+	if (sd_mmc_excl_on_slot(slot)) {
+		return SD_MMC_OK;
+	}
+	sd_mmc_err = sd_mmc_exclusive_close();
+	if (sd_mmc_err != SD_MMC_OK) {
+		return sd_mmc_err;
+	}
+#if (defined SD_MMC_0_CD_EXTINT)
+	// Watch the card before checking it, thus no removal is missed
+	sd_mmc_excl_card_changed = false;
+	extint_chan_clear_detected(SD_MMC_0_CD_EXTINT);
+	extint_chan_enable_callback(SD_MMC_0_CD_EXTINT,
+			EXTINT_CALLBACK_TYPE_DETECT);
+#endif
+	sd_mmc_err = sd_mmc_select_slot(slot);
+	if (sd_mmc_err != SD_MMC_OK) {
+		// The card must be installed by sd_mmc_check() before
+		sd_mmc_excl_end();
+		sd_mmc_deselect_slot();
+		return (sd_mmc_err == SD_MMC_INIT_ONGOING) ?
+				SD_MMC_ERR_NO_CARD : sd_mmc_err;
+	}
+	sd_mmc_excl_slot = slot;
+	sd_mmc_excl_opened = true;
+	return SD_MMC_OK;
+}
+
+sd_mmc_err_t sd_mmc_exclusive_close(void)
+{
+	sd_mmc_err_t sd_mmc_err;
+
+	if (!sd_mmc_excl_opened) {
+		return SD_MMC_OK;
+	}
+	sd_mmc_err = sd_mmc_stream_flush();
+	sd_mmc_excl_end();
+	sd_mmc_deselect_slot();
+	return sd_mmc_err;
+}
+
 #ifdef SDIO_SUPPORT_ENABLE
 sd_mmc_err_t sdio_read_direct(uint8_t slot, uint8_t func_num, uint32_t addr,
 		uint8_t *dest)
@@ -231,6 +231,94 @@ sd_mmc_err_t sd_mmc_start_write_blocks(const void *src, uint16_t nb_block);
  */
 sd_mmc_err_t sd_mmc_wait_end_of_write_blocks(bool abort);
 
+//! Maximum number of blocks written by one streaming write session
+#define SD_MMC_STREAM_NB_BLOCK_MAX 0xFFFF
+
+/**
+ * \brief Write blocks of data through the streaming write session
+ *
+ * A multiple block write is started without a fixed length and kept
+ * running between calls, as long as each call continues at the block
+ * following the previous one. The transfer is stopped on a non-contiguous
+ * write, on any other access to the card or by \ref sd_mmc_stream_flush().
+ * While the session runs, the card stays selected and the information
+ * requests (\ref sd_mmc_check(), \ref sd_mmc_get_capacity(), ...) are
+ * answered without any command sent to the card.
+ *
+ * \param slot     Card slot to use
+ * \param start    Start block number to be written.
+ * \param src      Pointer to write buffer.
+ * \param nb_block Number of blocks to be written.
+ *
+ * \return return SD_MMC_OK if success,
+ *         otherwise return an error code (\ref sd_mmc_err_t).
+ */
+sd_mmc_err_t sd_mmc_stream_write_blocks(uint8_t slot, uint32_t start,
+		const void *src, uint16_t nb_block);
+
+/**
+ * \brief Announce a run of blocks to be written sequentially
+ *
+ * Each multiple block write which continues the run is preceded by
+ * SET_WR_BLK_ERASE_COUNT (ACMD23) with the number of blocks remaining in the
+ * run, thus the SD card can erase them ahead instead of block per block
+ * during the transfer. MMC cards ignore the announce.
+ * The blocks of the run which are not written keep an undefined content,
+ * thus the whole run must belong to the caller.
+ * The run ends when all its blocks are written, on a new announce or
+ * on a card change. A \p nb_block of 0 cancels it.
+ *
+ * \param slot     Card slot to use
+ * \param start    First block number of the run.
+ * \param nb_block Number of blocks of the run.
+ *
+ * \return return SD_MMC_OK if success,
+ *         otherwise return an error code (\ref sd_mmc_err_t).
+ */
+sd_mmc_err_t sd_mmc_set_pre_erase(uint8_t slot, uint32_t start,
+		uint32_t nb_block);
+
+/**
+ * \brief Stop the streaming write session
+ *
+ * Waits the programmation of the last block written and stops the
+ * multiple block write. Nothing is done if no session is running.
+ *
+ * \return return SD_MMC_OK if success,
+ *         otherwise return an error code (\ref sd_mmc_err_t).
+ */
+sd_mmc_err_t sd_mmc_stream_flush(void);
+
+/**
+ * \brief Open an exclusive access on a card slot
+ *
+ * The card is selected once and the interface stays configured for it
+ * until \ref sd_mmc_exclusive_close(), thus the following accesses to this
+ * slot skip the card detection and the interface reconfiguration.
+ * When SD_MMC_n_CD_EXTINT is defined, the card detect pin is watched by
+ * interrupt, otherwise it is still read on each access.
+ * A card removal closes the exclusive access and the card is installed
+ * again on the next \ref sd_mmc_check().
+ * The card keeps its chip select asserted, thus the bus must not be shared
+ * with other devices during the exclusive access.
+ *
+ * \param slot     Card slot to use
+ *
+ * \return return SD_MMC_OK if success,
+ *         otherwise return an error code (\ref sd_mmc_err_t).
+ */
+sd_mmc_err_t sd_mmc_exclusive_open(uint8_t slot);
+
+/**
+ * \brief Close the exclusive access and deselect the card
+ *
+ * The streaming write session is stopped first.
+ *
+ * \return return SD_MMC_OK if success,
+ *         otherwise return an error code (\ref sd_mmc_err_t).
+ */
+sd_mmc_err_t sd_mmc_exclusive_close(void);
+
 #ifdef SDIO_SUPPORT_ENABLE
 /**
  * \brief Read one byte from SDIO using RW_DIRECT command.
@@ -155,6 +155,43 @@ bool sd_mmc_removal_1(void)
 {
 	return sd_mmc_removal(1);
 }
+
+Ctrl_status sd_mmc_flush(uint8_t slot)
+{
+	UNUSED(slot);
+	if (SD_MMC_OK != sd_mmc_stream_flush()) {
+		return CTRL_FAIL;
+	}
+	return CTRL_GOOD;
+}
+
+Ctrl_status sd_mmc_flush_0(void)
+{
+	return sd_mmc_flush(0);
+}
+
+Ctrl_status sd_mmc_flush_1(void)
+{
+	return sd_mmc_flush(1);
+}
+
+Ctrl_status sd_mmc_pre_erase(uint8_t slot, uint32_t addr, uint32_t nb_sector)
+{
+	if (SD_MMC_OK != sd_mmc_set_pre_erase(slot, addr, nb_sector)) {
+		return CTRL_FAIL;
+	}
+	return CTRL_GOOD;
+}
+
+Ctrl_status sd_mmc_pre_erase_0(uint32_t addr, uint32_t nb_sector)
+{
+	return sd_mmc_pre_erase(0, addr, nb_sector);
+}
+
+Ctrl_status sd_mmc_pre_erase_1(uint32_t addr, uint32_t nb_sector)
+{
+	return sd_mmc_pre_erase(1, addr, nb_sector);
+}
 //! @}
 
 #if ACCESS_USB == true
@@ -325,6 +362,17 @@ Ctrl_status sd_mmc_mem_2_ram_1(uint32_t addr, void *ram)
 
 Ctrl_status sd_mmc_ram_2_mem(uint8_t slot, uint32_t addr, const void *ram)
 {
+#ifdef SD_MMC_STREAM_WRITE_ENABLE
+	// Sequential sectors are written through one multiple block write
+	switch (sd_mmc_stream_write_blocks(slot, addr, ram, 1)) {
+	case SD_MMC_OK:
+		return CTRL_GOOD;
+	case SD_MMC_ERR_NO_CARD:
+		return CTRL_NO_PRESENT;
+	default:
+		return CTRL_FAIL;
+	}
+#else
 	switch (sd_mmc_init_write_blocks(slot, addr, 1)) {
 	case SD_MMC_OK:
 		break;
@@ -340,6 +388,7 @@ Ctrl_status sd_mmc_ram_2_mem(uint8_t slot, uint32_t addr, const void *ram)
 		return CTRL_FAIL;
 	}
 	return CTRL_GOOD;
+#endif
 }
 
 Ctrl_status sd_mmc_ram_2_mem_0(uint32_t addr, const void *ram)
@@ -132,6 +132,35 @@ extern bool sd_mmc_removal_0(void);
 //! Instance Declaration for sd_mmc_removal Slot 1
 extern bool sd_mmc_removal_1(void);
 
+/*! \brief Completes the pending writes of the memory.
+ *
+ * Stops the streaming write session kept opened by the sequential sector
+ * writes (see \ref sd_mmc_stream_write_blocks()).
+ *
+ * \param slot SD/MMC Slot Card Selected.
+ * \return Status.
+ */
+extern Ctrl_status sd_mmc_flush(uint8_t slot);
+//! Instance Declaration for sd_mmc_flush Slot O
+extern Ctrl_status sd_mmc_flush_0(void);
+//! Instance Declaration for sd_mmc_flush Slot 1
+extern Ctrl_status sd_mmc_flush_1(void);
+
+/*! \brief Announces sectors to be written sequentially.
+ *
+ * The SD card pre-erases the run (see \ref sd_mmc_set_pre_erase()).
+ *
+ * \param slot      SD/MMC Slot Card Selected.
+ * \param addr      First sector of the run.
+ * \param nb_sector Number of sectors of the run.
+ * \return Status.
+ */
+extern Ctrl_status sd_mmc_pre_erase(uint8_t slot, uint32_t addr, uint32_t nb_sector);
+//! Instance Declaration for sd_mmc_pre_erase Slot O
+extern Ctrl_status sd_mmc_pre_erase_0(uint32_t addr, uint32_t nb_sector);
+//! Instance Declaration for sd_mmc_pre_erase Slot 1
+extern Ctrl_status sd_mmc_pre_erase_1(uint32_t addr, uint32_t nb_sector);
+
 //! @}
 
 
@@ -317,6 +317,8 @@ typedef uint32_t sdmmc_cmd_def_t;
  * writing
  */
 #define SD_ACMD23_SET_WR_BLK_ERASE_COUNT (23 | SDMMC_CMD_R1)
+/** Maximum number of blocks pre-erased by ACMD23 (23 bits argument) */
+#define SD_ACMD23_NB_BLOCK_MAX           0x7FFFFF
 /**
  * ACMD41(bcr, R3): Send host capacity support information (HCS) and asks the
  * accessed card to send its operating condition register (OCR) content
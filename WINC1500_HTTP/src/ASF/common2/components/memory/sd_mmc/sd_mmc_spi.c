@@ -83,6 +83,11 @@ static uint16_t sd_mmc_spi_block_size;
 //! Total number of block requested by last mci_adtc_start()
 static uint16_t sd_mmc_spi_nb_block;
 
+#ifdef SD_MMC_SPI_BUSY_STATS
+//! Histogram of the busy durations
+static uint32_t sd_mmc_spi_busy_stats[SD_MMC_SPI_BUSY_STATS_NB_BIN];
+#endif
+
 static uint8_t sd_mmc_spi_crc7(uint8_t * buf, uint8_t size);
 static bool sd_mmc_spi_wait_busy(void);
 static bool sd_mmc_spi_start_read_block(void);
@@ -90,6 +95,7 @@ static void sd_mmc_spi_stop_read_block(void);
 static void sd_mmc_spi_start_write_block(void);
 static bool sd_mmc_spi_stop_write_block(void);
 static bool sd_mmc_spi_stop_multiwrite_block(void);
+static bool sd_mmc_spi_send_stop_tran(void);
 
 
 /**
@@ -150,6 +156,18 @@ static bool sd_mmc_spi_wait_busy(void)
 			return false;
 		}
 	} while (line != 0xFF);
+#ifdef SD_MMC_SPI_BUSY_STATS
+	{
+		// Bin n counts the busy durations of 2^(n-1) to 2^n - 1 polls
+		uint32_t nb_poll = 200000 - 1 - nec_timeout;
+		uint8_t bin = 0;
+		while (nb_poll && (bin < (SD_MMC_SPI_BUSY_STATS_NB_BIN - 1))) {
+			nb_poll >>= 1;
+			bin++;
+		}
+		sd_mmc_spi_busy_stats[bin]++;
+	}
+#endif
 	return true;
 }
 
@@ -286,8 +304,6 @@ static bool sd_mmc_spi_stop_write_block(void)
  */
 static bool sd_mmc_spi_stop_multiwrite_block(void)
 {
-	uint8_t value;
-
 	if (1 == sd_mmc_spi_nb_block) {
 		return true; // Single block write
 	}
@@ -295,6 +311,18 @@ static bool sd_mmc_spi_stop_multiwrite_block(void)
 		(sd_mmc_spi_transfert_pos / sd_mmc_spi_block_size)) {
 		return true; // It is not the End of multi write
 	}
+	return sd_mmc_spi_send_stop_tran();
+}
+
+/**
+ * \brief Sends the stop token of a multi blocks write transfer
+ *
+ * \return true if success, otherwise false
+ *         with a update of \ref sd_mmc_spi_err.
+ */
+static bool sd_mmc_spi_send_stop_tran(void)
+{
+	uint8_t value;
 
 	// Delay before start write block:
 	// Nwr timing minimum = 8 cylces
@@ -371,12 +399,18 @@ void sd_mmc_spi_select_device(uint8_t slot, uint32_t clock, uint8_t bus_width,
 		clock -= clock / 8;
 	}
 	spi_select_slave(&sd_mmc_master, &sd_mmc_spi_devices[slot], true);
+#ifdef SD_MMC_SPI_ENERGY_STATS
+	sd_mmc_spi_hook_select(true);
+#endif
 }
 
 void sd_mmc_spi_deselect_device(uint8_t slot)
 {
 	sd_mmc_spi_err = SD_MMC_SPI_NO_ERR;
 	spi_select_slave(&sd_mmc_master, &sd_mmc_spi_devices[slot], false);
+#ifdef SD_MMC_SPI_ENERGY_STATS
+	sd_mmc_spi_hook_select(false);
+#endif
 }
 
 void sd_mmc_spi_send_clock(void)
@@ -639,6 +673,31 @@ bool sd_mmc_spi_wait_end_of_write_blocks(void)
 	return sd_mmc_spi_stop_multiwrite_block();
 }
 
+#ifdef SD_MMC_SPI_BUSY_STATS
+const uint32_t *sd_mmc_spi_get_busy_stats(void)
+{
+	return sd_mmc_spi_busy_stats;
+}
+
+void sd_mmc_spi_clear_busy_stats(void)
+{
+	memset(sd_mmc_spi_busy_stats, 0, sizeof(sd_mmc_spi_busy_stats));
+}
+#endif
+
+bool sd_mmc_spi_abort_write_blocks(void)
+{
+	sd_mmc_spi_err = SD_MMC_SPI_NO_ERR;
+	if (1 == sd_mmc_spi_nb_block) {
+		return true; // Single block write, no stop token
+	}
+	if (sd_mmc_spi_nb_block ==
+		(sd_mmc_spi_transfert_pos / sd_mmc_spi_block_size)) {
+		return true; // Stop token already sent at the end of transfer
+	}
+	return sd_mmc_spi_send_stop_tran();
+}
+
 //! @}
 
 #endif // SD_MMC_SPI_MODE
@@ -218,6 +218,46 @@ bool sd_mmc_spi_start_write_blocks(const void *src, uint16_t nb_block);
  */
 bool sd_mmc_spi_wait_end_of_write_blocks(void);
 
+/** \brief Stop a multi blocks write before all blocks have been sent
+ *
+ * Sends the stop token when the write transfer started by
+ * sd_mmc_spi_adtc_start() has not reached its total number of blocks.
+ * The busy of the last block must have been waited before.
+ *
+ * \return true if success, otherwise false
+ */
+bool sd_mmc_spi_abort_write_blocks(void);
+
+#ifdef SD_MMC_SPI_BUSY_STATS
+//! Number of bins of the busy duration histogram
+#define SD_MMC_SPI_BUSY_STATS_NB_BIN  16
+
+/** \brief Returns the histogram of the busy durations on DAT0 line
+ *
+ * The duration is counted in polls of one byte (8 SPI clock cycles).
+ * Bin 0 counts the busy ends found on the first poll, bin n (n > 0)
+ * the durations of 2^(n-1) to 2^n - 1 polls, the last bin gathers the
+ * longer ones.
+ *
+ * \return array of \ref SD_MMC_SPI_BUSY_STATS_NB_BIN counters
+ */
+const uint32_t *sd_mmc_spi_get_busy_stats(void);
+
+/** \brief Clears the histogram of the busy durations
+ */
+void sd_mmc_spi_clear_busy_stats(void);
+#endif
+
+#ifdef SD_MMC_SPI_ENERGY_STATS
+/** \brief Reports the selection of the card, implemented by the application
+ *
+ * The card draws its active current while selected.
+ *
+ * \param selected true when the card is selected, false when released
+ */
+void sd_mmc_spi_hook_select(bool selected);
+#endif
+
 //! @}
 
 #ifdef __cplusplus
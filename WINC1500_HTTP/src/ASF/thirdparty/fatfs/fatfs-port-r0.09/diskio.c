@@ -338,13 +338,28 @@ DRESULT disk_ioctl(BYTE drv, BYTE ctrl, void *buff)
 
 	/* Make sure that data has been written */
 	case CTRL_SYNC:
-		if (mem_test_unit_ready(drv) == CTRL_GOOD) {
+		if (mem_flush(drv) != CTRL_GOOD) {
+			res = RES_ERROR;
+		} else if (mem_test_unit_ready(drv) == CTRL_GOOD) {
 			res = RES_OK;
 		} else {
 			res = RES_NOTRDY;
 		}
 		break;
 
+	/* Announce a block of sectors to be written sequentially (DWORD[2]:
+	 * start and end sector). The memory may erase them before the writes,
+	 * thus sectors of the block which are not written are undefined. */
+	case CTRL_PRE_ERASE:
+		if (mem_pre_erase(drv, ((DWORD *)buff)[0],
+				((DWORD *)buff)[1] - ((DWORD *)buff)[0] + 1)
+				== CTRL_GOOD) {
+			res = RES_OK;
+		} else {
+			res = RES_ERROR;
+		}
+		break;
+
 	default:
 		res = RES_PARERR;
 	}
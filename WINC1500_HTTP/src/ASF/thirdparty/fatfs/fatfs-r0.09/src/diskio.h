@@ -57,6 +57,7 @@ DRESULT disk_ioctl (BYTE, BYTE, void*);
 #define CTRL_POWER			5	/* Get/Set power status */
 #define CTRL_LOCK			6	/* Lock/Unlock media removal */
 #define CTRL_EJECT			7	/* Eject media */
+#define CTRL_PRE_ERASE		8	/* Announce a block of sectors to be written sequentially */
 
 /* MMC/SDC specific ioctl command */
 #define MMC_GET_TYPE		10	/* Get card type */
@@ -925,6 +925,160 @@ static FRESULT put_fat (
 
 
 
+/*-----------------------------------------------------------------------*/
+/* Free extent map - Remove a cluster from the map                       */
+/*-----------------------------------------------------------------------*/
+#if !_FS_READONLY && _FS_FREEMAP
+static
+void fmap_remove (
+	FATFS *fs,			/* File system object */
+	DWORD clst			/* Cluster# to be removed */
+)
+{
+	UINT i, j;
+	DWORD ecl;
+
+
+	for (i = 0; i < _FS_FREEMAP; i++) {
+		ecl = fs->fmap_clst[i] + fs->fmap_ncl[i];
+		if (!fs->fmap_ncl[i] || clst < fs->fmap_clst[i] || clst >= ecl) continue;
+		if (clst == fs->fmap_clst[i]) {		/* Head of the extent */
+			fs->fmap_clst[i]++;
+			fs->fmap_ncl[i]--;
+		} else {							/* Split the extent */
+			fs->fmap_ncl[i] = clst - fs->fmap_clst[i];
+			if (clst + 1 < ecl) {
+				for (j = 0; j < _FS_FREEMAP && fs->fmap_ncl[j]; j++) ;
+				if (j < _FS_FREEMAP) {		/* Keep the tail if possible, else a later scan finds it again */
+					fs->fmap_clst[j] = clst + 1;
+					fs->fmap_ncl[j] = ecl - clst - 1;
+				}
+			}
+		}
+		break;
+	}
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Free extent map - Add a freed cluster to the map                      */
+/*-----------------------------------------------------------------------*/
+
+static
+void fmap_add (
+	FATFS *fs,			/* File system object */
+	DWORD clst			/* Cluster# freed */
+)
+{
+	UINT i, j = _FS_FREEMAP;
+
+
+	for (i = 0; i < _FS_FREEMAP; i++) {
+		if (!fs->fmap_ncl[i]) {
+			if (j == _FS_FREEMAP) j = i;	/* First unused entry */
+			continue;
+		}
+		if (fs->fmap_clst[i] + fs->fmap_ncl[i] == clst) {	/* Stretch the tail */
+			fs->fmap_ncl[i]++;
+			return;
+		}
+		if (fs->fmap_clst[i] == clst + 1) {	/* Stretch the head */
+			fs->fmap_clst[i]--;
+			fs->fmap_ncl[i]++;
+			return;
+		}
+	}
+	if (j < _FS_FREEMAP) {					/* New extent, else a later scan finds it again */
+		fs->fmap_clst[j] = clst;
+		fs->fmap_ncl[j] = 1;
+	}
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Free extent map - Scan the FAT for free extents                       */
+/*-----------------------------------------------------------------------*/
+/* The map is filled only when it is empty, thus a free cluster is never
+/  recorded twice. The scan stops at the end of the FAT sector where the
+/  first free cluster was found, so a refill costs one FAT sector read
+/  for a sequential writer. */
+
+static
+DWORD fmap_fill (	/* 0:No free cluster, 1:Internal error, 0xFFFFFFFF:Disk error, 2:Map filled */
+	FATFS *fs		/* File system object */
+)
+{
+	DWORD clst, stat, nscan, epsec;
+	UINT i = 0;
+
+
+	epsec = (fs->fs_type == FS_FAT32) ? SS(fs) / 4 : SS(fs) / 2;	/* FAT entries per sector (about for FAT12) */
+	clst = fs->fmap_scan;
+	if (clst < 2 || clst >= fs->n_fatent) clst = 2;
+	for (nscan = 0; nscan < fs->n_fatent - 2; nscan++) {
+		stat = get_fat(fs, clst);
+		if (stat == 0xFFFFFFFF || stat == 1) return stat;
+		if (stat == 0) {
+			if (i && fs->fmap_clst[i - 1] + fs->fmap_ncl[i - 1] == clst) {
+				fs->fmap_ncl[i - 1]++;		/* Stretch the current extent */
+			} else {
+				if (i == _FS_FREEMAP) break;	/* Map is full, scan this cluster again next time */
+				fs->fmap_clst[i] = clst;	/* New extent */
+				fs->fmap_ncl[i] = 1;
+				i++;
+			}
+		}
+		if (++clst >= fs->n_fatent) clst = 2;	/* Wrap around */
+		if (i && clst % epsec == 0) break;	/* End of a FAT sector with free clusters found */
+	}
+	fs->fmap_scan = clst;
+
+	if (!i) {								/* Whole FAT scanned without free cluster */
+		if (fs->free_clust != 0) {
+			fs->free_clust = 0;
+			fs->fsi_flag = 1;
+		}
+		return 0;
+	}
+	return 2;
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Free extent map - Take a free cluster from the map                    */
+/*-----------------------------------------------------------------------*/
+
+static
+DWORD fmap_alloc (	/* 0:No free cluster, 1:Internal error, 0xFFFFFFFF:Disk error, >=2:Free cluster# */
+	FATFS *fs		/* File system object */
+)
+{
+	UINT i;
+	DWORD ncl;
+
+
+	for (;;) {
+		for (i = 0; i < _FS_FREEMAP && !fs->fmap_ncl[i]; i++) ;
+		if (i < _FS_FREEMAP) {
+			ncl = fs->fmap_clst[i]++;
+			fs->fmap_ncl[i]--;
+			return ncl;
+		}
+		ncl = fmap_fill(fs);				/* Map is empty, refill it */
+		if (ncl != 2) return ncl;
+	}
+}
+#endif
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* FAT handling - Remove a cluster chain                                 */
 /*-----------------------------------------------------------------------*/
@@ -953,6 +1107,9 @@ FRESULT remove_chain (
 			if (nxt == 0xFFFFFFFF) { res = FR_DISK_ERR; break; }	/* Disk error? */
 			res = put_fat(fs, clst, 0);			/* Mark the cluster "empty" */
 			if (res != FR_OK) break;
+#if _FS_FREEMAP
+			fmap_add(fs, clst);
+#endif
 			if (fs->free_clust != 0xFFFFFFFF) {	/* Update FSInfo */
 				fs->free_clust++;
 				fs->fsi_flag = 1;
@@ -1003,6 +1160,18 @@ DWORD create_chain (	/* 0:No free cluster, 1:Internal error, 0xFFFFFFFF:Disk err
 		scl = clst;
 	}
 
+#if _FS_FREEMAP
+	ncl = scl + 1;			/* Cluster following the start point */
+	cs = (ncl < fs->n_fatent) ? get_fat(fs, ncl) : 2;
+	if (cs == 0xFFFFFFFF || cs == 1)	/* An error occurred */
+		return cs;
+	if (cs == 0) {						/* Free, keep the chain contiguous */
+		fmap_remove(fs, ncl);
+	} else {							/* Take a cluster from the free extent map */
+		ncl = fmap_alloc(fs);
+		if (ncl < 2 || ncl == 0xFFFFFFFF) return ncl;
+	}
+#else
 	ncl = scl;				/* Start cluster */
 	for (;;) {
 		ncl++;							/* Next cluster */
@@ -1016,6 +1185,7 @@ DWORD create_chain (	/* 0:No free cluster, 1:Internal error, 0xFFFFFFFF:Disk err
 			return cs;
 		if (ncl == scl) return 0;		/* No free cluster */
 	}
+#endif
 
 	res = put_fat(fs, ncl, 0x0FFFFFFF);	/* Mark the new cluster "last link" */
 	if (res == FR_OK && clst != 0) {
@@ -2154,6 +2324,14 @@ FRESULT chk_mounted (	/* FR_OK(0): successful, !=0: any error occurred */
 				fs->free_clust = LD_DWORD(fs->win+FSI_Free_Count);
 		}
 	}
+	/* Do not trust out of range FSInfo values */
+	if (fs->free_clust > fs->n_fatent - 2) fs->free_clust = 0xFFFFFFFF;
+	if (fs->last_clust >= fs->n_fatent) fs->last_clust = 0;
+#if _FS_FREEMAP
+	/* Free extent map is built on the first allocation */
+	fs->fmap_scan = fs->last_clust + 1;
+	mem_set(fs->fmap_ncl, 0, sizeof(fs->fmap_ncl));
+#endif
 #endif
 	fs->fs_type = fmt;		/* FAT sub-type */
 	fs->id = ++Fsid;		/* File system mount ID */
@@ -3092,6 +3270,9 @@ FRESULT f_getfree (
 	DWORD n, clst, sect, stat;
 	UINT i;
 	BYTE fat, *p;
+#if _FS_FREEMAP
+	BYTE fill;
+#endif
 
 
 	/* Get drive number */
@@ -3101,6 +3282,11 @@ FRESULT f_getfree (
 		if ((*fatfs)->free_clust <= (*fatfs)->n_fatent - 2) {
 			*nclst = (*fatfs)->free_clust;
 		} else {
+#if _FS_FREEMAP
+			/* The scan fills the free extent map too if it is empty */
+			for (i = 0; i < _FS_FREEMAP && !(*fatfs)->fmap_ncl[i]; i++) ;
+			fill = (i == _FS_FREEMAP);
+#endif
 			/* Get number of free clusters */
 			fat = (*fatfs)->fs_type;
 			n = 0;
@@ -3110,7 +3296,12 @@ FRESULT f_getfree (
 					stat = get_fat(*fatfs, clst);
 					if (stat == 0xFFFFFFFF) { res = FR_DISK_ERR; break; }
 					if (stat == 1) { res = FR_INT_ERR; break; }
-					if (stat == 0) n++;
+					if (stat == 0) {
+						n++;
+#if _FS_FREEMAP
+						if (fill) fmap_add(*fatfs, clst);
+#endif
+					}
 				} while (++clst < (*fatfs)->n_fatent);
 			} else {
 				clst = (*fatfs)->n_fatent;
@@ -3124,14 +3315,27 @@ FRESULT f_getfree (
 						i = SS(*fatfs);
 					}
 					if (fat == FS_FAT16) {
-						if (LD_WORD(p) == 0) n++;
+						stat = LD_WORD(p);
 						p += 2; i -= 2;
 					} else {
-						if ((LD_DWORD(p) & 0x0FFFFFFF) == 0) n++;
+						stat = LD_DWORD(p) & 0x0FFFFFFF;
 						p += 4; i -= 4;
 					}
+					if (stat == 0) {
+						n++;
+#if _FS_FREEMAP
+						if (fill && (*fatfs)->n_fatent - clst >= 2) fmap_add(*fatfs, (*fatfs)->n_fatent - clst);
+#endif
+					}
 				} while (--clst);
 			}
+#if _FS_FREEMAP
+			if (fill) {		/* Next refill scans from the end of the last extent */
+				for (i = 0; i < _FS_FREEMAP; i++) {
+					if ((*fatfs)->fmap_ncl[i]) (*fatfs)->fmap_scan = (*fatfs)->fmap_clst[i] + (*fatfs)->fmap_ncl[i];
+				}
+			}
+#endif
 			(*fatfs)->free_clust = n;
 			if (fat == FS_FAT32) (*fatfs)->fsi_flag = 1;
 			*nclst = n;
@@ -93,6 +93,11 @@ typedef struct {
 	DWORD	last_clust;		/* Last allocated cluster */
 	DWORD	free_clust;		/* Number of free clusters */
 	DWORD	fsi_sector;		/* fsinfo sector (FAT32) */
+#if _FS_FREEMAP
+	DWORD	fmap_scan;		/* Next cluster# to be scanned for free extents */
+	DWORD	fmap_clst[_FS_FREEMAP];	/* Free extent map: first cluster# of each extent */
+	DWORD	fmap_ncl[_FS_FREEMAP];	/* Free extent map: number of clusters of each extent (0:unused) */
+#endif
 #endif
 #if _FS_RPATH
 	DWORD	cdir;			/* Current directory start cluster (0:root) */
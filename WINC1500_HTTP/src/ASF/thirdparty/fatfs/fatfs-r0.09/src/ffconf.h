@@ -54,6 +54,11 @@
 /* To enable fast seek feature, set _USE_FASTSEEK to 1. */
 
 
+#define	_FS_FREEMAP		0	/* 0:Disable or >=1:Enable */
+/* To enable the in-RAM free extent map, set _FS_FREEMAP to the number of free
+/  extents to be kept in the file system object. */
+
+
 
 /*---------------------------------------------------------------------------/
 / Locale and Namespace Configurations
@@ -102,6 +102,8 @@
 #define Lun_2_unload                            sd_mmc_unload_0
 #define Lun_2_wr_protect                        sd_mmc_wr_protect_0
 #define Lun_2_removal                           sd_mmc_removal_0
+#define Lun_2_flush                             sd_mmc_flush_0
+#define Lun_2_pre_erase                         sd_mmc_pre_erase_0
 #define Lun_2_usb_read_10                       sd_mmc_usb_read_10_0
 #define Lun_2_usb_write_10                      sd_mmc_usb_write_10_0
 #define Lun_2_mem_2_ram                         sd_mmc_mem_2_ram_0
@@ -89,6 +89,12 @@
 /* To enable fast seek feature, set _USE_FASTSEEK to 1. */
 
 
+#define    _FS_FREEMAP    4    /* 0:Disable or >=1:Enable */
+/* To enable the in-RAM free extent map, set _FS_FREEMAP to the number of free
+/  extents to be kept in the file system object. The map is built lazily from
+/  FAT scans and makes the cluster allocation O(1) for sequential writers. */
+
+
 
 /*---------------------------------------------------------------------------/
 / Locale and Namespace Configurations
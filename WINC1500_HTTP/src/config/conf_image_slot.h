@@ -0,0 +1,23 @@
+/**
+ * \file
+ *
+ * \brief Image slot configuration file.
+ *
+ */
+
+#ifndef CONF_IMAGE_SLOT_H_INCLUDED
+#define CONF_IMAGE_SLOT_H_INCLUDED
+
+// SD/MMC slot holding the image slot
+#define CONF_IMAGE_SLOT_SD_MMC_SLOT     0
+
+// First block of the image slot (header block).
+// The range must be left out of the partitions of the card. The default
+// range fits in the gap before the first partition of the cards formatted
+// with the SD Association layout (partition at block 8192).
+#define CONF_IMAGE_SLOT_START_BLOCK     0x00000800
+
+// Number of blocks of the image slot, including the header block (3 MB)
+#define CONF_IMAGE_SLOT_NB_BLOCK        0x00001800
+
+#endif /* CONF_IMAGE_SLOT_H_INCLUDED */
@@ -0,0 +1,25 @@
+/**
+ * \file
+ *
+ * \brief Code placement in RAM configuration file.
+ *
+ */
+
+#ifndef CONF_RAMFUNC_H_INCLUDED
+#define CONF_RAMFUNC_H_INCLUDED
+
+#include <compiler.h>
+
+// Define to run the hot paths of the SPI, HIF and HTTP layers from RAM,
+// without the flash wait states. The functions are copied from flash at
+// startup with the .data section (.ramfunc in the linker script).
+#define CONF_RAMFUNC_ENABLE
+
+#ifdef CONF_RAMFUNC_ENABLE
+// Not inlined, else the code would stay in the flash of the caller
+#  define HOT_RAMFUNC    RAMFUNC __attribute__((noinline))
+#else
+#  define HOT_RAMFUNC
+#endif
+
+#endif /* CONF_RAMFUNC_H_INCLUDED */
@@ -43,6 +43,16 @@
 // Define to enable the debug trace to the current standard output (stdio)
 //#define SD_MMC_DEBUG
 
+// Define to keep one multiple block write opened across sequential sector
+// writes (stopped on a non-contiguous write or a flush)
+#define SD_MMC_STREAM_WRITE_ENABLE
+
+// Define to record the histogram of the card busy durations
+//#define SD_MMC_SPI_BUSY_STATS
+
+// Define to report the card selection to sd_mmc_spi_hook_select()
+//#define SD_MMC_SPI_ENERGY_STATS
+
 // Define to memory count
 #define SD_MMC_SPI_MEM_CNT          1
 
@@ -60,6 +70,11 @@
 #define SD_MMC_0_CD_GPIO           (EXT2_PIN_10)
 #define SD_MMC_0_CD_DETECT_VALUE    0
 
+// Define the EIC channel of the card detect pin to watch the card by
+// interrupt during an exclusive access (see sd_mmc_exclusive_open())
+#define SD_MMC_0_CD_EXTINT          15
+#define SD_MMC_0_CD_EXTINT_MUX      MUX_PB15A_EIC_EXTINT15
+
 // Define the SPI clock source
 #define SD_MMC_SPI_SOURCE_CLOCK    GCLK_GENERATOR_0
 
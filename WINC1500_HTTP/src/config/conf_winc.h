@@ -90,6 +90,21 @@ extern "C" {
 #define CONF_WINC_DEBUG					(1)
 #define CONF_WINC_PRINTF				printf
 
+/** Report the sleep of the chip to os_hook_chip_state(), see iot/energy.h. */
+//#define CONF_WINC_ENERGY_STATS
+
+/** Count the transfers and the bytes of the bus, see nm_bus_get_stats(). */
+//#define CONF_WINC_BUS_STATS
+
+/*
+   ---------------------------------
+   ---------- RTOS settings --------
+   ---------------------------------
+*/
+
+/** Run the driver in a FreeRTOS task, see iot/winc_task.h. */
+//#define CONF_WINC_USE_FREERTOS
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,158 @@
+/**
+ * \file
+ *
+ * \brief Download loop of the HTTP File Downloader Example.
+ *
+ * State and services of main21.c, for the glue of the optional features in
+ * the *_app.c files next to their modules.
+ *
+ */
+
+#ifndef DOWNLOAD_H_INCLUDED
+#define DOWNLOAD_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "main.h"
+#include "ff.h"
+#include "common/include/nm_common.h"
+#include "iot/sw_timer.h"
+#include "iot/http/http_client.h"
+#include "iot/pipeline.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Instance of Timer module. */
+extern struct sw_timer_module swt_module_inst;
+/** Instance of HTTP client module. */
+extern struct http_client_module http_client_module_inst;
+#ifndef MAIN_STORAGE_IMAGE_SLOT
+/** File pointer for file download. */
+extern FIL file_object;
+#endif
+/** File name for file download, with drive prefix. */
+extern char save_file_name[];
+/** Http content length. */
+extern uint32_t http_file_size;
+/** Receiving content length. */
+extern uint32_t received_file_size;
+/** Processing of the received content, from the HTTP client to the storage. */
+extern struct pipeline store_pipeline;
+
+/**
+ * \brief Clear state parameter at download processing state.
+ * \param[in] mask Check download_state.
+ */
+void clear_state(download_state mask);
+
+/**
+ * \brief Add state parameter at download processing state.
+ * \param[in] mask Check download_state.
+ */
+void add_state(download_state mask);
+
+/**
+ * \brief File download processing state check.
+ * \param[in] mask Check download_state.
+ * \return true if this state is set, false otherwise.
+ */
+bool is_state_set(download_state mask);
+
+/**
+ * \brief Set the name of the download file from the URL.
+ * \return true if the name is valid, false otherwise.
+ */
+bool set_file_name(void);
+
+/**
+ * \brief Create the download file.
+ * \param[in] name File name, with drive prefix.
+ * \return true if the file is created, false otherwise.
+ */
+bool open_file(const char *name);
+
+/**
+ * \brief Append data to the download file.
+ *
+ * The SD card write transfer is completed once the sink is idle.
+ * \param[in] data Data.
+ * \param[in] length Data length.
+ * \return true if the data is written, false otherwise.
+ */
+bool write_file(const char *data, uint32_t length);
+
+/**
+ * \brief Complete the pending SD card write transfer once the sink is idle.
+ */
+void flush_storage(void);
+
+#ifndef MAIN_STORAGE_IMAGE_SLOT
+/**
+ * \brief Complete the written data of the download file on the card.
+ * \return true if succeeded, false otherwise.
+ */
+bool sync_file(void);
+#endif
+
+/**
+ * \brief Close the download file if it is opened.
+ * \param[in] completed true if the whole file is written.
+ */
+void close_file(bool completed);
+
+#ifdef SD_MMC_SPI_BUSY_STATS
+/**
+ * \brief Print the histogram of the SD card busy durations.
+ */
+void print_busy_stats(void);
+#endif
+
+/**
+ * \brief Complete the processing of the received content and print where the time went.
+ * \return true if succeeded, false otherwise.
+ */
+bool finish_store_pipeline(void);
+
+/**
+ * \brief Store received packet to file.
+ *
+ * The file is created on the first packet and closed once http_file_size
+ * bytes are received.
+ * \param[in] data Packet data.
+ * \param[in] length Packet data length.
+ */
+void store_file_packet(char *data, uint32_t length);
+
+/**
+ * \brief CPU cycle clock of the pipeline counters and the connection time, from the SysTick.
+ */
+uint32_t get_cycles(void);
+
+/**
+ * \brief Millisecond clock, also bounding the time spent handling WINC events.
+ */
+uint32 get_tick_ms(void);
+
+/**
+ * \brief Send the GET request of the image, timing the connection.
+ * \param[in] url URL of the image.
+ */
+void send_download_request(const char *url);
+
+/**
+ * \brief Start file download via HTTP connection.
+ */
+void start_download(void);
+
+/**
+ * \brief Download the image again once the previous download is over.
+ */
+void restart_download(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DOWNLOAD_H_INCLUDED */
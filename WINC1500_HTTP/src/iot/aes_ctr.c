@@ -0,0 +1,234 @@
+/**
+ * \file
+ *
+ * \brief AES-128 in counter mode (NIST SP 800-38A) for streamed data.
+ *
+ */
+
+#include <string.h>
+#include "iot/aes_ctr.h"
+#include "conf_ramfunc.h"
+
+/** S-box, built in SRAM by \ref aes_sbox_init. */
+static uint8_t aes_sbox[256];
+
+#define AES_ROR(x, n)       (((x) >> (n)) | ((x) << (32 - (n))))
+#define AES_ROL8(x, n)      ((uint8_t)(((x) << (n)) | ((x) >> (8 - (n)))))
+
+/**
+ * \brief Build the S-box from the multiplicative inverse in GF(2^8).
+ *
+ * p walks the powers of the generator 3 and q the matching powers of its
+ * inverse, so q is the inverse of p.
+ */
+static void aes_sbox_init(void)
+{
+	uint8_t p = 1, q = 1;
+
+	do {
+		p = p ^ (uint8_t)(p << 1) ^ ((p & 0x80) ? 0x1B : 0);
+		q ^= q << 1;
+		q ^= q << 2;
+		q ^= q << 4;
+		q ^= (q & 0x80) ? 0x09 : 0;
+		aes_sbox[p] = q ^ AES_ROL8(q, 1) ^ AES_ROL8(q, 2) ^ AES_ROL8(q, 3) ^ AES_ROL8(q, 4) ^ 0x63;
+	} while (p != 1);
+	aes_sbox[0] = 0x63;
+}
+
+/**
+ * \brief Multiply the four bytes of a word by x in GF(2^8), without branches.
+ */
+static inline uint32_t aes_xtime(uint32_t x)
+{
+	return ((x & 0x7F7F7F7F) << 1) ^ (((x >> 7) & 0x01010101) * 0x1B);
+}
+
+/**
+ * \brief Substitute the four bytes of a word.
+ */
+static inline uint32_t aes_sub_word(uint32_t x)
+{
+	return (uint32_t)aes_sbox[x & 0xFF] | (uint32_t)aes_sbox[(x >> 8) & 0xFF] << 8
+			| (uint32_t)aes_sbox[(x >> 16) & 0xFF] << 16 | (uint32_t)aes_sbox[x >> 24] << 24;
+}
+
+void aes128_set_key(struct aes128_context *context, const uint8_t *key)
+{
+	uint32_t *w = context->round_key;
+	uint32_t rcon = 1, t;
+	int i;
+
+	if (aes_sbox[0] == 0) {
+		aes_sbox_init();
+	}
+
+	for (i = 0; i < 4; i++) {
+		w[i] = (uint32_t)key[i * 4] | (uint32_t)key[i * 4 + 1] << 8
+				| (uint32_t)key[i * 4 + 2] << 16 | (uint32_t)key[i * 4 + 3] << 24;
+	}
+	for (i = 4; i < 4 * (AES128_ROUNDS + 1); i++) {
+		t = w[i - 1];
+		if ((i & 3) == 0) {
+			t = aes_sub_word(AES_ROR(t, 8)) ^ rcon;
+			rcon = aes_xtime(rcon);
+		}
+		w[i] = w[i - 4] ^ t;
+	}
+}
+
+/**
+ * \brief Encrypt one block held as four columns.
+ *
+ * ShiftRows is applied while substituting: row r of column c comes from
+ * column c + r. MixColumns uses b = 2 (a ^ a') ^ a' ^ a'' ^ a''' where a' is
+ * the column rotated by one byte.
+ */
+static HOT_RAMFUNC void aes128_encrypt_columns(const struct aes128_context *context, uint32_t *s)
+{
+	const uint32_t *k = context->round_key;
+	uint32_t t0, t1, t2, t3, r, x;
+	int round;
+
+	s[0] ^= k[0];
+	s[1] ^= k[1];
+	s[2] ^= k[2];
+	s[3] ^= k[3];
+
+	for (round = 1; round <= AES128_ROUNDS; round++) {
+		k += 4;
+		t0 = (uint32_t)aes_sbox[s[0] & 0xFF] | (uint32_t)aes_sbox[(s[1] >> 8) & 0xFF] << 8
+				| (uint32_t)aes_sbox[(s[2] >> 16) & 0xFF] << 16 | (uint32_t)aes_sbox[s[3] >> 24] << 24;
+		t1 = (uint32_t)aes_sbox[s[1] & 0xFF] | (uint32_t)aes_sbox[(s[2] >> 8) & 0xFF] << 8
+				| (uint32_t)aes_sbox[(s[3] >> 16) & 0xFF] << 16 | (uint32_t)aes_sbox[s[0] >> 24] << 24;
+		t2 = (uint32_t)aes_sbox[s[2] & 0xFF] | (uint32_t)aes_sbox[(s[3] >> 8) & 0xFF] << 8
+				| (uint32_t)aes_sbox[(s[0] >> 16) & 0xFF] << 16 | (uint32_t)aes_sbox[s[1] >> 24] << 24;
+		t3 = (uint32_t)aes_sbox[s[3] & 0xFF] | (uint32_t)aes_sbox[(s[0] >> 8) & 0xFF] << 8
+				| (uint32_t)aes_sbox[(s[1] >> 16) & 0xFF] << 16 | (uint32_t)aes_sbox[s[2] >> 24] << 24;
+
+		if (round < AES128_ROUNDS) {
+			r = AES_ROR(t0, 8);
+			x = t0 ^ r;
+			t0 = aes_xtime(x) ^ r ^ AES_ROR(x, 16);
+			r = AES_ROR(t1, 8);
+			x = t1 ^ r;
+			t1 = aes_xtime(x) ^ r ^ AES_ROR(x, 16);
+			r = AES_ROR(t2, 8);
+			x = t2 ^ r;
+			t2 = aes_xtime(x) ^ r ^ AES_ROR(x, 16);
+			r = AES_ROR(t3, 8);
+			x = t3 ^ r;
+			t3 = aes_xtime(x) ^ r ^ AES_ROR(x, 16);
+		}
+
+		s[0] = t0 ^ k[0];
+		s[1] = t1 ^ k[1];
+		s[2] = t2 ^ k[2];
+		s[3] = t3 ^ k[3];
+	}
+}
+
+void aes128_encrypt(const struct aes128_context *context, const uint8_t *in, uint8_t *out)
+{
+	uint32_t s[4];
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		s[i] = (uint32_t)in[i * 4] | (uint32_t)in[i * 4 + 1] << 8
+				| (uint32_t)in[i * 4 + 2] << 16 | (uint32_t)in[i * 4 + 3] << 24;
+	}
+	aes128_encrypt_columns(context, s);
+	for (i = 0; i < 4; i++) {
+		out[i * 4] = (uint8_t)s[i];
+		out[i * 4 + 1] = (uint8_t)(s[i] >> 8);
+		out[i * 4 + 2] = (uint8_t)(s[i] >> 16);
+		out[i * 4 + 3] = (uint8_t)(s[i] >> 24);
+	}
+}
+
+/**
+ * \brief Compute the keystream of a block into its slot of the ring.
+ */
+static void aes_ctr_block(struct aes_ctr_context *context, uint32_t block)
+{
+	uint8_t counter[AES_BLOCK_SIZE];
+	uint32_t carry = block;
+	int i;
+
+	/* 128-bit big endian addition of the block index. */
+	memcpy(counter, context->iv, AES_BLOCK_SIZE);
+	for (i = AES_BLOCK_SIZE - 1; i >= 0 && carry != 0; i--) {
+		carry += counter[i];
+		counter[i] = (uint8_t)carry;
+		carry >>= 8;
+	}
+	aes128_encrypt(&context->aes, counter,
+			(uint8_t *)context->keystream[block & (AES_CTR_KEYSTREAM_BLOCKS - 1)]);
+}
+
+void aes_ctr_init(struct aes_ctr_context *context, const uint8_t *key, const uint8_t *iv)
+{
+	aes128_set_key(&context->aes, key);
+	memcpy(context->iv, iv, AES_BLOCK_SIZE);
+	context->offset = 0;
+	context->ready_block = 0;
+}
+
+void aes_ctr_seek(struct aes_ctr_context *context, uint32_t offset)
+{
+	uint32_t block = offset / AES_BLOCK_SIZE;
+
+	if (block < context->offset / AES_BLOCK_SIZE || block >= context->ready_block) {
+		/* Keystream computed ahead is lost. */
+		context->ready_block = block;
+	}
+	context->offset = offset;
+}
+
+void aes_ctr_crypt(struct aes_ctr_context *context, uint8_t *data, uint32_t length)
+{
+	uint32_t block, pos, piece;
+	uint8_t *keystream;
+
+	while (length > 0) {
+		block = context->offset / AES_BLOCK_SIZE;
+		pos = context->offset % AES_BLOCK_SIZE;
+		if (block >= context->ready_block) {
+			aes_ctr_block(context, block);
+			context->ready_block = block + 1;
+		}
+		keystream = (uint8_t *)context->keystream[block & (AES_CTR_KEYSTREAM_BLOCKS - 1)] + pos;
+		piece = AES_BLOCK_SIZE - pos;
+		piece = (length < piece) ? length : piece;
+		context->offset += piece;
+		length -= piece;
+
+		if (piece == AES_BLOCK_SIZE && ((uintptr_t)data & 3) == 0) {
+			uint32_t *word = (uint32_t *)(void *)data;
+			const uint32_t *key_word = (const uint32_t *)(void *)keystream;
+
+			word[0] ^= key_word[0];
+			word[1] ^= key_word[1];
+			word[2] ^= key_word[2];
+			word[3] ^= key_word[3];
+			data += AES_BLOCK_SIZE;
+		} else {
+			while (piece-- > 0) {
+				*data++ ^= *keystream++;
+			}
+		}
+	}
+}
+
+uint32_t aes_ctr_precompute(struct aes_ctr_context *context, uint32_t max_blocks)
+{
+	uint32_t end = context->offset / AES_BLOCK_SIZE + AES_CTR_KEYSTREAM_BLOCKS;
+	uint32_t count = 0;
+
+	while (count < max_blocks && context->ready_block < end) {
+		aes_ctr_block(context, context->ready_block++);
+		count++;
+	}
+
+	return count;
+}
@@ -0,0 +1,119 @@
+/**
+ * \file
+ *
+ * \brief AES-128 in counter mode (NIST SP 800-38A) for streamed data.
+ *
+ * The keystream of the blocks following the current offset is computed ahead
+ * into a ring by \ref aes_ctr_precompute, for instance while the network is
+ * idle, so that decrypting a received packet is mostly an XOR.
+ *
+ * The cipher is free of data dependent branches. The S-box is looked up in a
+ * table built in SRAM at the first key setup: on the Cortex-M0+ the SRAM has no
+ * cache and no wait state, so the time of a lookup does not depend on the index,
+ * as it could through the NVM cache for a table left in flash.
+ *
+ */
+
+#ifndef IOT_AES_CTR_H_INCLUDED
+#define IOT_AES_CTR_H_INCLUDED
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Size of an AES block in bytes. */
+#define AES_BLOCK_SIZE                  16
+/** Size of an AES-128 key in bytes. */
+#define AES128_KEY_SIZE                 16
+/** Number of AES-128 rounds. */
+#define AES128_ROUNDS                   10
+
+#ifndef AES_CTR_KEYSTREAM_BLOCKS
+/** Keystream blocks computed ahead, a power of two. */
+#  define AES_CTR_KEYSTREAM_BLOCKS      32
+#endif
+
+/**
+ * \brief AES-128 expanded key.
+ */
+struct aes128_context {
+	/** Round keys, one column per word, first byte of the column in the low byte. */
+	uint32_t round_key[4 * (AES128_ROUNDS + 1)];
+};
+
+/**
+ * \brief AES-128-CTR stream context.
+ */
+struct aes_ctr_context {
+	/** Expanded key. */
+	struct aes128_context aes;
+	/** Initial counter block. */
+	uint8_t iv[AES_BLOCK_SIZE];
+	/** Offset in the stream of the next byte to be processed. */
+	uint32_t offset;
+	/** Index of the block following the computed keystream. */
+	uint32_t ready_block;
+	/** Keystream ring, block n being stored at n modulo AES_CTR_KEYSTREAM_BLOCKS. */
+	uint32_t keystream[AES_CTR_KEYSTREAM_BLOCKS][AES_BLOCK_SIZE / 4];
+};
+
+/**
+ * \brief Expand an AES-128 key.
+ *
+ * \param[out] context         AES-128 context.
+ * \param[in]  key             Key of AES128_KEY_SIZE bytes.
+ */
+void aes128_set_key(struct aes128_context *context, const uint8_t *key);
+
+/**
+ * \brief Encrypt one block.
+ *
+ * \param[in]  context         AES-128 context.
+ * \param[in]  in              Plain block.
+ * \param[out] out             Cipher block. May be in.
+ */
+void aes128_encrypt(const struct aes128_context *context, const uint8_t *in, uint8_t *out);
+
+/**
+ * \brief Start a stream.
+ *
+ * \param[out] context         AES-128-CTR context.
+ * \param[in]  key             Key of AES128_KEY_SIZE bytes.
+ * \param[in]  iv              Initial counter block, incremented as a 128-bit big endian number.
+ */
+void aes_ctr_init(struct aes_ctr_context *context, const uint8_t *key, const uint8_t *iv);
+
+/**
+ * \brief Move to an offset of the stream.
+ *
+ * \param[in]  context         AES-128-CTR context.
+ * \param[in]  offset          Offset of the next byte to be processed.
+ */
+void aes_ctr_seek(struct aes_ctr_context *context, uint32_t offset);
+
+/**
+ * \brief Encrypt or decrypt data in place and move forward in the stream.
+ *
+ * \param[in]  context         AES-128-CTR context.
+ * \param[in]  data            Data.
+ * \param[in]  length          Length of data.
+ */
+void aes_ctr_crypt(struct aes_ctr_context *context, uint8_t *data, uint32_t length);
+
+/**
+ * \brief Compute the keystream ahead of the current offset.
+ *
+ * \param[in]  context         AES-128-CTR context.
+ * \param[in]  max_blocks      Maximum number of blocks computed by this call.
+ *
+ * \return     Number of blocks computed, zero when the ring is full.
+ */
+uint32_t aes_ctr_precompute(struct aes_ctr_context *context, uint32_t max_blocks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOT_AES_CTR_H_INCLUDED */
@@ -0,0 +1,63 @@
+/**
+ * \file
+ *
+ * \brief Decryption of the image of the HTTP File Downloader Example.
+ *
+ */
+
+#include "main.h"
+
+#ifdef MAIN_IMAGE_AES_KEY
+
+#if defined(MAIN_HTTP_SYNC_URL) || defined(MAIN_HTTP_MERKLE_URL)
+#error "MAIN_IMAGE_AES_KEY only decrypts the plain download."
+#endif
+
+#include <string.h>
+#include "iot/aes_ctr_app.h"
+
+/** Stage decrypting the image. */
+struct pipeline_stage decrypt_stage;
+/** Key of the image. */
+static const uint8_t image_aes_key[AES128_KEY_SIZE] = MAIN_IMAGE_AES_KEY;
+/** Decryption of the image. */
+static struct aes_ctr_context image_aes;
+/** Initial counter block, at the beginning of the image. */
+static uint8_t image_iv[AES_BLOCK_SIZE];
+
+/**
+ * \brief Pipeline stage decrypting the image in place.
+ *
+ * The initial counter block at the beginning of the image is not passed on.
+ */
+static int decrypt_stage_process(struct pipeline_stage *stage, uint8_t *data, uint32_t length)
+{
+	/* Bytes of the previous slices. */
+	uint32_t offset = stage->bytes_in;
+	uint32_t iv_length = 0;
+
+	if (offset < AES_BLOCK_SIZE) {
+		iv_length = AES_BLOCK_SIZE - offset;
+		iv_length = (length < iv_length) ? length : iv_length;
+		memcpy(&image_iv[offset], data, iv_length);
+		if (offset + iv_length == AES_BLOCK_SIZE) {
+			aes_ctr_init(&image_aes, image_aes_key, image_iv);
+		}
+	}
+	aes_ctr_crypt(&image_aes, data + iv_length, length - iv_length);
+
+	return pipeline_emit(stage, data + iv_length, length - iv_length);
+}
+
+void configure_decrypt_stage(void)
+{
+	pipeline_stage_init(&decrypt_stage, "decrypt", PIPELINE_STAGE_IN_PLACE | PIPELINE_STAGE_EMITS,
+			decrypt_stage_process, NULL, NULL);
+}
+
+void precompute_decrypt_stage(void)
+{
+	aes_ctr_precompute(&image_aes, MAIN_AES_PRECOMPUTE_BLOCKS);
+}
+
+#endif /* MAIN_IMAGE_AES_KEY */
@@ -0,0 +1,41 @@
+/**
+ * \file
+ *
+ * \brief Decryption of the image of the HTTP File Downloader Example.
+ *
+ * With MAIN_IMAGE_AES_KEY, the image on the server is its initial counter
+ * block followed by the AES-128-CTR ciphertext, and a stage of the store
+ * pipeline decrypts it in place as it is received.
+ *
+ */
+
+#ifndef IOT_AES_CTR_APP_H_INCLUDED
+#define IOT_AES_CTR_APP_H_INCLUDED
+
+#include "iot/aes_ctr.h"
+#include "iot/pipeline.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Stage decrypting the image. */
+extern struct pipeline_stage decrypt_stage;
+
+/**
+ * \brief Initialize the stage decrypting the image, before it is attached.
+ */
+void configure_decrypt_stage(void);
+
+/**
+ * \brief Compute the keystream of the next packets ahead.
+ *
+ * Only once the initial counter block was received.
+ */
+void precompute_decrypt_stage(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOT_AES_CTR_APP_H_INCLUDED */
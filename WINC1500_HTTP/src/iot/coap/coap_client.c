@@ -0,0 +1,882 @@
+/**
+ * \file
+ *
+ * \brief CoAP client service.
+ *
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "iot/coap/coap_client.h"
+
+/** Version of the protocol. */
+#define COAP_VERSION                    1
+
+#define COAP_TYPE_CON                   0
+#define COAP_TYPE_NON                   1
+#define COAP_TYPE_ACK                   2
+#define COAP_TYPE_RST                   3
+
+#define COAP_OPTION_URI_PATH            11
+#define COAP_OPTION_CONTENT_FORMAT      12
+#define COAP_OPTION_URI_QUERY           15
+#define COAP_OPTION_BLOCK2              23
+#define COAP_OPTION_BLOCK1              27
+#define COAP_OPTION_SIZE2               28
+#define COAP_OPTION_SIZE1               60
+
+/** Start of the payload. */
+#define COAP_PAYLOAD_MARKER             0xFF
+
+/** Size exponent of the smallest block, 16 bytes. */
+#define COAP_BLOCK_SZX_MIN              0
+/** Size exponent of the largest block, 1024 bytes. */
+#define COAP_BLOCK_SZX_MAX              6
+/** Size of a block from its exponent. */
+#define COAP_BLOCK_SIZE(szx)            (16U << (szx))
+
+/**
+ * \brief State of the exchange.
+ */
+enum coap_client_state {
+	/** No exchange. */
+	STATE_IDLE,
+	/** Waiting for the host name resolution or the socket to be bound. */
+	STATE_WAIT,
+	/** Request sent, waiting for its acknowledgement or its response. */
+	STATE_EXCHANGE,
+};
+
+/**
+ * \brief Options of a response used by the client.
+ */
+struct coap_client_options {
+	uint8_t has_block1      : 1;
+	uint8_t has_block2      : 1;
+	uint32_t block1;
+	uint32_t block2;
+	uint16_t content_format;
+	uint32_t size2;
+};
+
+static void _coap_client_timer_callback(struct sw_timer_module *const module, int timer_id, void *context, int period);
+
+/**
+ * \brief Reference of the instances from the socket descriptor.
+ */
+static struct coap_client_module *module_ref_inst[MAX_SOCKET] = {NULL,};
+
+/**
+ * \brief Xorshift generator of the message IDs and tokens.
+ */
+static uint32_t _coap_client_rand(struct coap_client_module *const module)
+{
+	uint32_t x = module->rand_state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	module->rand_state = x;
+	return x;
+}
+
+/**
+ * \brief Size exponent of a block size, rounded down.
+ */
+static uint8_t _coap_client_szx(uint32_t size)
+{
+	uint8_t szx = COAP_BLOCK_SZX_MIN;
+
+	while (szx < COAP_BLOCK_SZX_MAX && COAP_BLOCK_SIZE(szx + 1) <= size) {
+		szx++;
+	}
+	return szx;
+}
+
+/**
+ * \brief Content-Format number of a media type, COAP_CONTENT_FORMAT_NONE if not registered here.
+ */
+static uint16_t _coap_client_content_format(const char *type)
+{
+	if (type == NULL) {
+		return COAP_CONTENT_FORMAT_NONE;
+	} else if (!strcmp(type, "text/plain")) {
+		return 0;
+	} else if (!strcmp(type, "application/octet-stream")) {
+		return 42;
+	} else if (!strcmp(type, "application/json")) {
+		return 50;
+	} else if (!strcmp(type, "application/cbor")) {
+		return 60;
+	}
+	return COAP_CONTENT_FORMAT_NONE;
+}
+
+/**
+ * \brief Write an option after the option last.
+ *
+ * \return     End of the option.
+ */
+static uint8_t *_coap_client_put_option(uint8_t *p, uint16_t *last, uint16_t number, const void *value, uint16_t length)
+{
+	uint16_t delta = number - *last;
+	uint8_t *head = p++;
+	uint8_t nibble;
+
+	nibble = (delta < 13) ? delta : (delta < 269) ? 13 : 14;
+	*head = nibble << 4;
+	if (nibble == 13) {
+		*p++ = (uint8_t)(delta - 13);
+	} else if (nibble == 14) {
+		*p++ = (uint8_t)((delta - 269) >> 8);
+		*p++ = (uint8_t)(delta - 269);
+	}
+	nibble = (length < 13) ? length : (length < 269) ? 13 : 14;
+	*head |= nibble;
+	if (nibble == 13) {
+		*p++ = (uint8_t)(length - 13);
+	} else if (nibble == 14) {
+		*p++ = (uint8_t)((length - 269) >> 8);
+		*p++ = (uint8_t)(length - 269);
+	}
+	memcpy(p, value, length);
+	*last = number;
+
+	return p + length;
+}
+
+/**
+ * \brief Write an option holding an unsigned integer in the fewest bytes.
+ */
+static uint8_t *_coap_client_put_uint_option(uint8_t *p, uint16_t *last, uint16_t number, uint32_t value)
+{
+	uint8_t bytes[4];
+	uint16_t length = 0, i;
+
+	while (length < 4 && value >> (8 * length) != 0) {
+		length++;
+	}
+	for (i = 0; i < length; i++) {
+		bytes[i] = (uint8_t)(value >> (8 * (length - 1 - i)));
+	}
+	return _coap_client_put_option(p, last, number, bytes, length);
+}
+
+/**
+ * \brief Read the next option of a message.
+ *
+ * \return     1 if an option was read, 0 at the end of the options, -1 if malformed.
+ */
+static int _coap_client_next_option(const uint8_t **p, const uint8_t *end, uint16_t *number,
+		const uint8_t **value, uint16_t *length)
+{
+	const uint8_t *q = *p;
+	uint16_t field[2];
+	int i;
+
+	if (q >= end || *q == COAP_PAYLOAD_MARKER) {
+		return 0;
+	}
+	field[0] = *q >> 4;
+	field[1] = *q++ & 0x0F;
+	for (i = 0; i < 2; i++) {
+		if (field[i] == 13) {
+			if (q + 1 > end) {
+				return -1;
+			}
+			field[i] = 13 + *q++;
+		} else if (field[i] == 14) {
+			if (q + 2 > end) {
+				return -1;
+			}
+			field[i] = 269 + (q[0] << 8 | q[1]);
+			q += 2;
+		} else if (field[i] == 15) {
+			return -1;
+		}
+	}
+	if (q + field[1] > end) {
+		return -1;
+	}
+	*number += field[0];
+	*value = q;
+	*length = field[1];
+	*p = q + field[1];
+
+	return 1;
+}
+
+/**
+ * \brief Value of an unsigned integer option.
+ */
+static uint32_t _coap_client_get_uint(const uint8_t *value, uint16_t length)
+{
+	uint32_t x = 0;
+
+	while (length-- > 0) {
+		x = x << 8 | *value++;
+	}
+	return x;
+}
+
+/**
+ * \brief Send a message to the server.
+ */
+static void _coap_client_transmit(struct coap_client_module *const module, const uint8_t *msg, uint32_t length)
+{
+	sendto(module->sock, (void *)msg, (uint16_t)length, 0, (struct sockaddr *)&module->addr, sizeof(struct sockaddr_in));
+	module->stats.tx_messages++;
+	module->stats.tx_bytes += length;
+}
+
+/**
+ * \brief Send an empty acknowledgement or reset message.
+ */
+static void _coap_client_send_empty(struct coap_client_module *const module, uint8_t type, uint16_t message_id)
+{
+	uint8_t msg[4];
+
+	msg[0] = COAP_VERSION << 6 | type << 4;
+	msg[1] = 0;
+	msg[2] = (uint8_t)(message_id >> 8);
+	msg[3] = (uint8_t)message_id;
+	_coap_client_transmit(module, msg, sizeof(msg));
+}
+
+/**
+ * \brief End the exchange and report it.
+ */
+static void _coap_client_done(struct coap_client_module *const module, int reason)
+{
+	union coap_client_data data;
+
+	module->state = STATE_IDLE;
+	sw_timer_disable_callback(module->config.timer_inst, module->timer_id);
+	if (module->entity.close) {
+		module->entity.close(module->entity.priv_data);
+	}
+	memset(&module->entity, 0, sizeof(struct http_entity));
+
+	if (module->cb != NULL) {
+		data.done.reason = reason;
+		module->cb(module, COAP_CLIENT_CALLBACK_DONE, &data);
+	}
+}
+
+/**
+ * \brief Build the request of the next block in the send buffer.
+ *
+ * \return     0 if succeeded, -EIO if the entity failed.
+ */
+static int _coap_client_build_request(struct coap_client_module *const module)
+{
+	uint8_t *p = module->send_buffer;
+	uint8_t *payload = module->send_buffer + COAP_MAX_SEND_HEADER_SIZE;
+	const char *segment = module->uri + 1;
+	const char *query = strchr(module->uri, '?');
+	const char *path_end = (query != NULL) ? query : module->uri + strlen(module->uri);
+	const char *next;
+	uint32_t block_size = COAP_BLOCK_SIZE(module->block1_szx);
+	uint32_t offset = module->block1_num * block_size;
+	uint16_t last = 0, format;
+	int length = -1;
+	uint8_t more = 0;
+
+	*p++ = COAP_VERSION << 6 | COAP_TYPE_CON << 4 | COAP_TOKEN_LENGTH;
+	*p++ = module->method;
+	*p++ = (uint8_t)(module->message_id >> 8);
+	*p++ = (uint8_t)module->message_id;
+	memcpy(p, module->token, COAP_TOKEN_LENGTH);
+	p += COAP_TOKEN_LENGTH;
+
+	if (!module->block1_done) {
+		/* Read first, the Block1 option tells whether more follows. */
+		length = module->entity.read(module->entity.priv_data, (char *)payload, block_size, offset);
+		if (length < 0) {
+			return -EIO;
+		}
+		if (module->entity_length >= 0) {
+			more = (offset + length < (uint32_t)module->entity_length);
+		} else {
+			more = ((uint32_t)length == block_size);
+		}
+	}
+
+	/* One Uri-Path option per segment. */
+	while (segment < path_end) {
+		next = memchr(segment, '/', path_end - segment);
+		next = (next != NULL) ? next : path_end;
+		p = _coap_client_put_option(p, &last, COAP_OPTION_URI_PATH, segment, next - segment);
+		segment = next + 1;
+	}
+	if (length >= 0) {
+		format = _coap_client_content_format(module->entity.get_contents_type ?
+				module->entity.get_contents_type(module->entity.priv_data) : NULL);
+		if (format != COAP_CONTENT_FORMAT_NONE) {
+			p = _coap_client_put_uint_option(p, &last, COAP_OPTION_CONTENT_FORMAT, format);
+		}
+	}
+	/* One Uri-Query option per argument. */
+	for (segment = (query != NULL) ? query + 1 : path_end; *segment != '\0'; segment = next + (*next != '\0')) {
+		next = strchr(segment, '&');
+		next = (next != NULL) ? next : segment + strlen(segment);
+		p = _coap_client_put_option(p, &last, COAP_OPTION_URI_QUERY, segment, next - segment);
+	}
+	if (length < 0) {
+		/* Asks for the preferred size from the first block. */
+		p = _coap_client_put_uint_option(p, &last, COAP_OPTION_BLOCK2,
+				module->block2_num << 4 | module->block2_szx);
+		if (module->block2_num == 0) {
+			/* Asks for the size of the resource. */
+			p = _coap_client_put_uint_option(p, &last, COAP_OPTION_SIZE2, 0);
+		}
+	} else {
+		p = _coap_client_put_uint_option(p, &last, COAP_OPTION_BLOCK1,
+				module->block1_num << 4 | more << 3 | module->block1_szx);
+		if (module->block1_num == 0 && module->entity_length >= 0) {
+			p = _coap_client_put_uint_option(p, &last, COAP_OPTION_SIZE1, module->entity_length);
+		}
+		if (length > 0) {
+			*p++ = COAP_PAYLOAD_MARKER;
+			memmove(p, payload, length);
+			p += length;
+		}
+	}
+
+	module->send_length = p - module->send_buffer;
+	return 0;
+}
+
+/**
+ * \brief Send the request of the next block and wait for its acknowledgement.
+ */
+static void _coap_client_start_exchange(struct coap_client_module *const module)
+{
+	uint32_t token = _coap_client_rand(module);
+
+	module->message_id++;
+	/* A new token per block, so late responses of a previous block do not match. */
+	memcpy(module->token, &token, COAP_TOKEN_LENGTH);
+	if (_coap_client_build_request(module) < 0) {
+		_coap_client_done(module, -EIO);
+		return;
+	}
+
+	module->state = STATE_EXCHANGE;
+	module->acked = 0;
+	module->retransmit = 0;
+	module->ack_wait = module->config.ack_timeout + _coap_client_rand(module) % (module->config.ack_timeout / 2 + 1);
+	module->stats.exchanges++;
+	_coap_client_transmit(module, module->send_buffer, module->send_length);
+	sw_timer_enable_callback(module->config.timer_inst, module->timer_id, module->ack_wait);
+}
+
+/**
+ * \brief Start the exchange once the server is resolved and the socket bound.
+ */
+static void _coap_client_try_start(struct coap_client_module *const module)
+{
+	if (module->state == STATE_WAIT && module->bound && module->addr.sin_addr.s_addr != 0) {
+		_coap_client_start_exchange(module);
+	}
+}
+
+/**
+ * \brief Handle a response to the request.
+ */
+static void _coap_client_handle_response(struct coap_client_module *const module, uint8_t code,
+		const uint8_t *p, const uint8_t *end)
+{
+	struct coap_client_options options;
+	union coap_client_data data;
+	const uint8_t *value;
+	uint16_t number = 0, length;
+	uint32_t offset, num;
+	uint8_t szx, more;
+	int ret;
+
+	memset(&options, 0, sizeof(struct coap_client_options));
+	options.content_format = COAP_CONTENT_FORMAT_NONE;
+	while ((ret = _coap_client_next_option(&p, end, &number, &value, &length)) > 0) {
+		switch (number) {
+		case COAP_OPTION_BLOCK1:
+			options.has_block1 = 1;
+			options.block1 = _coap_client_get_uint(value, length);
+			break;
+		case COAP_OPTION_BLOCK2:
+			options.has_block2 = 1;
+			options.block2 = _coap_client_get_uint(value, length);
+			break;
+		case COAP_OPTION_CONTENT_FORMAT:
+			options.content_format = (uint16_t)_coap_client_get_uint(value, length);
+			break;
+		case COAP_OPTION_SIZE2:
+			options.size2 = _coap_client_get_uint(value, length);
+			break;
+		default:
+			break;
+		}
+	}
+	if (ret < 0) {
+		_coap_client_done(module, -EPROTO);
+		return;
+	}
+	if (p < end) {
+		/* Skip the payload marker. */
+		p++;
+	}
+
+	if (!module->block1_done) {
+		szx = options.block1 & 0x07;
+		if (options.has_block1 && szx < module->block1_szx
+				&& (code == COAP_CODE(2, 31) || (code == COAP_CODE(4, 13) && module->block1_num == 0))) {
+			/* The server asks for smaller blocks. */
+			offset = (module->block1_num + (code == COAP_CODE(2, 31))) * COAP_BLOCK_SIZE(module->block1_szx);
+			module->block1_szx = szx;
+			module->block1_num = offset / COAP_BLOCK_SIZE(szx);
+			_coap_client_start_exchange(module);
+			return;
+		}
+		if (code == COAP_CODE(2, 31)) {
+			/* Continue */
+			module->block1_num++;
+			_coap_client_start_exchange(module);
+			return;
+		}
+		module->block1_done = 1;
+	}
+
+	if (!module->responded) {
+		module->responded = 1;
+		if (module->cb != NULL) {
+			data.recv_response.code = code;
+			data.recv_response.content_format = options.content_format;
+			data.recv_response.size = options.size2;
+			module->cb(module, COAP_CLIENT_CALLBACK_RECV_RESPONSE, &data);
+			if (module->state != STATE_EXCHANGE) {
+				/* Aborted by the callback. */
+				return;
+			}
+		}
+	}
+
+	more = 0;
+	if (options.has_block2) {
+		num = options.block2 >> 4;
+		more = (options.block2 >> 3) & 0x01;
+		szx = options.block2 & 0x07;
+		if (num * COAP_BLOCK_SIZE(szx) != module->received || szx > COAP_BLOCK_SZX_MAX) {
+			_coap_client_done(module, -EPROTO);
+			return;
+		}
+		module->block2_num = num + 1;
+		module->block2_szx = szx;
+	}
+
+	if (p < end) {
+		data.recv_data.offset = module->received;
+		data.recv_data.length = end - p;
+		data.recv_data.data = (char *)p;
+		data.recv_data.is_complete = !more;
+		module->received += end - p;
+		if (module->cb != NULL) {
+			module->cb(module, COAP_CLIENT_CALLBACK_RECV_DATA, &data);
+			if (module->state != STATE_EXCHANGE) {
+				/* Aborted by the callback. */
+				return;
+			}
+		}
+	}
+
+	if (more) {
+		_coap_client_start_exchange(module);
+	} else {
+		_coap_client_done(module, 0);
+	}
+}
+
+/**
+ * \brief Handle a received message.
+ */
+static void _coap_client_handle_message(struct coap_client_module *const module, uint32_t length, struct sockaddr_in *from)
+{
+	const uint8_t *msg = (const uint8_t *)module->config.recv_buffer;
+	uint8_t type, token_length, code;
+	uint16_t message_id;
+
+	if (length < 4 || msg[0] >> 6 != COAP_VERSION) {
+		return;
+	}
+	if (from->sin_addr.s_addr != module->addr.sin_addr.s_addr || from->sin_port != module->addr.sin_port) {
+		return;
+	}
+	module->stats.rx_messages++;
+	module->stats.rx_bytes += length;
+
+	type = (msg[0] >> 4) & 0x03;
+	token_length = msg[0] & 0x0F;
+	code = msg[1];
+	message_id = (uint16_t)(msg[2] << 8 | msg[3]);
+	if (token_length > 8 || 4 + token_length > length) {
+		return;
+	}
+
+	if (type == COAP_TYPE_ACK || type == COAP_TYPE_RST) {
+		if (module->state != STATE_EXCHANGE || message_id != module->message_id) {
+			return;
+		}
+		if (type == COAP_TYPE_RST) {
+			_coap_client_done(module, -ECONNRESET);
+			return;
+		}
+		if (code == 0) {
+			/* The response comes in its own message. */
+			module->acked = 1;
+			sw_timer_enable_callback(module->config.timer_inst, module->timer_id, module->config.timeout);
+			return;
+		}
+	} else if (code == 0) {
+		/* Ping. */
+		_coap_client_send_empty(module, COAP_TYPE_RST, message_id);
+		return;
+	} else if (type == COAP_TYPE_CON) {
+		/* Acknowledged even when stale, so that a lost acknowledgement
+		 * does not keep the server retransmitting. */
+		_coap_client_send_empty(module, COAP_TYPE_ACK, message_id);
+	}
+
+	if (module->state != STATE_EXCHANGE || code < COAP_CODE(2, 0)
+			|| token_length != COAP_TOKEN_LENGTH || memcmp(msg + 4, module->token, COAP_TOKEN_LENGTH)) {
+		return;
+	}
+	_coap_client_handle_response(module, code, msg + 4 + token_length, msg + length);
+}
+
+/**
+ * \brief Check whether a host is an IPv4 address.
+ */
+static int _coap_client_is_ip(const char *host)
+{
+	for (; *host != '\0'; host++) {
+		if ((*host < '0' || *host > '9') && *host != '.') {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+void coap_client_get_config_defaults(struct coap_client_config *const config)
+{
+	config->port = COAP_PORT;
+	config->local_port = COAP_PORT;
+	config->timer_inst = NULL;
+	config->ack_timeout = 2000;
+	config->max_retransmit = 4;
+	config->timeout = 20000;
+	config->block_size = 512;
+	config->recv_buffer = NULL;
+	config->recv_buffer_size = 576;
+	config->seed = 0;
+}
+
+int coap_client_init(struct coap_client_module *const module, struct coap_client_config *config)
+{
+	/* Checks the parameters. */
+	if (module == NULL || config == NULL || config->timer_inst == NULL) {
+		return -EINVAL;
+	}
+
+	if (config->block_size < COAP_BLOCK_SIZE(COAP_BLOCK_SZX_MIN) || config->block_size > COAP_BLOCK_SIZE(COAP_BLOCK_SZX_MAX)
+			|| (config->block_size & (config->block_size - 1)) != 0) {
+		return -EINVAL;
+	}
+
+	if (config->recv_buffer_size <= config->block_size || config->ack_timeout == 0) {
+		return -EINVAL;
+	}
+
+	memset(module, 0, sizeof(struct coap_client_module));
+	memcpy(&module->config, config, sizeof(struct coap_client_config));
+	module->sock = -1;
+	module->timer_id = -1;
+	/* Xorshift must not start from zero. */
+	module->rand_state = config->seed ? config->seed : 0x2545F491;
+	module->message_id = (uint16_t)_coap_client_rand(module);
+
+	/* Allocate the buffers in the heap. */
+	if (module->config.recv_buffer == NULL) {
+		module->config.recv_buffer = malloc(config->recv_buffer_size);
+		if (module->config.recv_buffer == NULL) {
+			return -ENOMEM;
+		}
+		module->alloc_buffer = 1;
+	}
+	module->send_buffer = malloc(COAP_MAX_SEND_HEADER_SIZE + config->block_size);
+	if (module->send_buffer == NULL) {
+		coap_client_deinit(module);
+		return -ENOMEM;
+	}
+
+	module->timer_id = sw_timer_register_callback(config->timer_inst, _coap_client_timer_callback, (void *)module, 0);
+	if (module->timer_id < 0) {
+		coap_client_deinit(module);
+		return -ENOSPC;
+	}
+
+	module->state = STATE_IDLE;
+
+	return 0;
+}
+
+int coap_client_deinit(struct coap_client_module *const module)
+{
+	if (module == NULL) {
+		return -EINVAL;
+	}
+
+	coap_client_abort(module);
+	if (module->sock >= 0) {
+		close(module->sock);
+		module_ref_inst[module->sock] = NULL;
+		module->sock = -1;
+	}
+	if (module->timer_id >= 0) {
+		sw_timer_unregister_callback(module->config.timer_inst, module->timer_id);
+		module->timer_id = -1;
+	}
+	if (module->alloc_buffer) {
+		free(module->config.recv_buffer);
+		module->config.recv_buffer = NULL;
+		module->alloc_buffer = 0;
+	}
+	free(module->send_buffer);
+	module->send_buffer = NULL;
+
+	return 0;
+}
+
+int coap_client_register_callback(struct coap_client_module *const module, coap_client_callback_t callback)
+{
+	if (module == NULL) {
+		return -EINVAL;
+	}
+
+	module->cb = callback;
+
+	return 0;
+}
+
+int coap_client_send_request(struct coap_client_module *const module, const char *url,
+		enum coap_method method, struct http_entity *const entity)
+{
+	struct sockaddr_in addr_in;
+	char host[HOSTNAME_MAX_SIZE];
+	uint16_t port;
+	const char *uri;
+	int i = 0, j = 0;
+
+	if (module == NULL || url == NULL || (entity != NULL && entity->read == NULL)) {
+		return -EINVAL;
+	}
+
+	if (module->state != STATE_IDLE) {
+		return -EBUSY;
+	}
+
+	/* Separate host, port and uri. */
+	if (!strncmp(url, "coap://", 7)) {
+		i = 7;
+	}
+	for (; url[i] != '\0' && url[i] != ':' && url[i] != '/' && url[i] != '?'; i++) {
+		if (j >= HOSTNAME_MAX_SIZE - 1) {
+			return -ENAMETOOLONG;
+		}
+		host[j++] = url[i];
+	}
+	host[j] = '\0';
+	port = module->config.port;
+	if (url[i] == ':') {
+		port = (uint16_t)atoi(url + i + 1);
+		while (url[i] != '\0' && url[i] != '/' && url[i] != '?') {
+			i++;
+		}
+	}
+	uri = url + i;
+
+	if (j == 0 || port == 0) {
+		return -EINVAL;
+	}
+
+	if (strlen(uri) + 1 >= COAP_MAX_URI_LENGTH) {
+		return -ENAMETOOLONG;
+	}
+
+	if (module->sock < 0) {
+		module->sock = socket(AF_INET, SOCK_DGRAM, 0);
+		if (module->sock < 0) {
+			module->sock = -1;
+			return -ENOSPC;
+		}
+		module_ref_inst[module->sock] = module;
+		module->bound = 0;
+		module->skip = 0;
+		addr_in.sin_family = AF_INET;
+		addr_in.sin_port = _htons(module->config.local_port);
+		addr_in.sin_addr.s_addr = 0;
+		bind(module->sock, (struct sockaddr *)&addr_in, sizeof(struct sockaddr_in));
+	}
+
+	/* The address of the last server is kept. */
+	if (strcmp(host, module->host)) {
+		strcpy(module->host, host);
+		module->addr.sin_addr.s_addr = 0;
+	}
+	module->addr.sin_family = AF_INET;
+	module->addr.sin_port = _htons(port);
+
+	module->uri[0] = '/';
+	strcpy(module->uri + 1, uri + (uri[0] == '/'));
+	module->method = method;
+	if (entity != NULL) {
+		memcpy(&module->entity, entity, sizeof(struct http_entity));
+		module->entity_length = (entity->is_chunked || entity->get_contents_length == NULL) ? -1
+				: entity->get_contents_length(entity->priv_data);
+	} else {
+		memset(&module->entity, 0, sizeof(struct http_entity));
+		module->entity_length = -1;
+	}
+	module->block1_done = (entity == NULL);
+	module->block1_num = 0;
+	module->block1_szx = _coap_client_szx(module->config.block_size);
+	module->block2_num = 0;
+	module->block2_szx = module->block1_szx;
+	module->received = 0;
+	module->responded = 0;
+	module->state = STATE_WAIT;
+
+	if (module->addr.sin_addr.s_addr == 0) {
+		if (_coap_client_is_ip(host)) {
+			module->addr.sin_addr.s_addr = nmi_inet_addr(host);
+		} else {
+			gethostbyname((uint8 *)module->host);
+			return 0;
+		}
+	}
+	_coap_client_try_start(module);
+
+	return 0;
+}
+
+void coap_client_abort(struct coap_client_module *const module)
+{
+	if (module == NULL || module->state == STATE_IDLE) {
+		return;
+	}
+
+	module->state = STATE_IDLE;
+	sw_timer_disable_callback(module->config.timer_inst, module->timer_id);
+	if (module->entity.close) {
+		module->entity.close(module->entity.priv_data);
+	}
+	memset(&module->entity, 0, sizeof(struct http_entity));
+}
+
+void coap_client_clear_stats(struct coap_client_module *const module)
+{
+	if (module != NULL) {
+		memset(&module->stats, 0, sizeof(struct coap_client_stats));
+	}
+}
+
+void coap_client_socket_event_handler(SOCKET sock, uint8_t msg_type, void *msg_data)
+{
+	tstrSocketBindMsg *msg_bind;
+	tstrSocketRecvMsg *msg_recv;
+
+	/* Find instance using the socket descriptor. */
+	struct coap_client_module *module = module_ref_inst[sock];
+	/* If cannot found reference, This socket is not CoAP client socket. */
+	if (module == NULL) {
+		return;
+	}
+
+	switch (msg_type) {
+	case SOCKET_MSG_BIND:
+		msg_bind = (tstrSocketBindMsg *)msg_data;
+		if (msg_bind->status != 0) {
+			close(sock);
+			module_ref_inst[sock] = NULL;
+			module->sock = -1;
+			if (module->state != STATE_IDLE) {
+				_coap_client_done(module, -EIO);
+			}
+			break;
+		}
+		module->bound = 1;
+		recvfrom(sock, module->config.recv_buffer, module->config.recv_buffer_size, 0);
+		_coap_client_try_start(module);
+		break;
+	case SOCKET_MSG_RECVFROM:
+		msg_recv = (tstrSocketRecvMsg *)msg_data;
+		if (msg_recv->s16BufferSize > 0) {
+			if (msg_recv->u16RemainingSize > 0) {
+				/* The rest of the message comes in the next events. */
+				module->skip = 1;
+				break;
+			} else if (module->skip) {
+				module->skip = 0;
+			} else {
+				_coap_client_handle_message(module, (uint32_t)msg_recv->s16BufferSize, &msg_recv->strRemoteAddr);
+			}
+		}
+		/* Continue to receive, unless closed. */
+		if (module_ref_inst[sock] == module) {
+			recvfrom(sock, module->config.recv_buffer, module->config.recv_buffer_size, 0);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+void coap_client_socket_resolve_handler(uint8_t *domain_name, uint32_t server_ip)
+{
+	struct coap_client_module *module;
+	int i;
+
+	for (i = 0; i < MAX_SOCKET; i++) {
+		module = module_ref_inst[i];
+		if (module == NULL || module->state != STATE_WAIT || module->addr.sin_addr.s_addr != 0
+				|| strcmp((char *)domain_name, module->host)) {
+			continue;
+		}
+		if (server_ip == 0) {
+			/* The next request resolves the host again. */
+			module->host[0] = '\0';
+			_coap_client_done(module, -EHOSTUNREACH);
+			continue;
+		}
+		module->addr.sin_addr.s_addr = server_ip;
+		_coap_client_try_start(module);
+	}
+}
+
+static void _coap_client_timer_callback(struct sw_timer_module *const module, int timer_id, void *context, int period)
+{
+	struct coap_client_module *coap = (struct coap_client_module *)context;
+
+	if (coap->state != STATE_EXCHANGE) {
+		return;
+	}
+
+	if (!coap->acked && coap->retransmit < coap->config.max_retransmit) {
+		coap->retransmit++;
+		coap->ack_wait *= 2;
+		coap->stats.retransmissions++;
+		_coap_client_transmit(coap, coap->send_buffer, coap->send_length);
+		sw_timer_enable_callback(coap->config.timer_inst, coap->timer_id, coap->ack_wait);
+	} else {
+		_coap_client_done(coap, -ETIME);
+	}
+}
@@ -0,0 +1,397 @@
+/**
+ * \file
+ *
+ * \brief CoAP client service.
+ *
+ * Requests are confirmable messages sent over UDP, retransmitted with an
+ * exponential back-off until acknowledged, as described in RFC 7252:
+ * https://tools.ietf.org/html/rfc7252
+ *
+ * Resources bigger than a message are transferred block by block, as described
+ * in RFC 7959: https://tools.ietf.org/html/rfc7959
+ * The payload of a request is read from a \ref http_entity one Block1 at a time
+ * and the payload of the response is delivered one Block2 at a time, with its
+ * offset in the resource, so the same sinks as for the HTTP client apply.
+ *
+ * One exchange is outstanding at a time and the client counts the messages and
+ * the bytes of each transfer to compare its cost with HTTP.
+ *
+ */
+
+#ifndef COAP_CLIENT_H_INCLUDED
+#define COAP_CLIENT_H_INCLUDED
+
+#include <stdint.h>
+#include "socket/include/socket.h"
+#include "iot/sw_timer.h"
+#include "iot/http/http_entity.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Default UDP port of CoAP. */
+#define COAP_PORT                       5683
+/** Maximum length of the path and query of a request. */
+#define COAP_MAX_URI_LENGTH             64
+/** Length of the token of the requests. */
+#define COAP_TOKEN_LENGTH               4
+/** Largest header of a request: fixed header, token and options. */
+#define COAP_MAX_SEND_HEADER_SIZE       (4 + COAP_TOKEN_LENGTH + 2 * COAP_MAX_URI_LENGTH + 24)
+
+/** Make a response code from its class and detail, e.g. COAP_CODE(2, 5) for 2.05 Content. */
+#define COAP_CODE(c, dd)                (((c) << 5) | (dd))
+/** Class of a response code. */
+#define COAP_CODE_CLASS(code)           ((code) >> 5)
+/** Detail of a response code. */
+#define COAP_CODE_DETAIL(code)          ((code) & 0x1F)
+
+/** Content-Format of the payload unknown or not set. */
+#define COAP_CONTENT_FORMAT_NONE        0xFFFF
+
+/**
+ * \brief Method of a CoAP request.
+ */
+enum coap_method {
+	COAP_METHOD_GET = 1,
+	COAP_METHOD_POST = 2,
+	COAP_METHOD_PUT = 3,
+	COAP_METHOD_DELETE = 4,
+};
+
+/**
+ * \brief A type of CoAP client callback.
+ */
+enum coap_client_callback_type {
+	/** Received the first block of the response. */
+	COAP_CLIENT_CALLBACK_RECV_RESPONSE,
+	/** Received a block of the payload of the response. */
+	COAP_CLIENT_CALLBACK_RECV_DATA,
+	/** The exchange ended. */
+	COAP_CLIENT_CALLBACK_DONE,
+};
+
+/**
+ * \brief Structure of the COAP_CLIENT_CALLBACK_RECV_RESPONSE callback.
+ */
+struct coap_client_data_recv_response {
+	/** Response code, e.g. COAP_CODE(2, 5). */
+	uint8_t code;
+	/** Content-Format of the payload, COAP_CONTENT_FORMAT_NONE if not set. */
+	uint16_t content_format;
+	/** Size of the whole payload from the Size2 option, 0 if unknown. */
+	uint32_t size;
+};
+
+/**
+ * \brief Structure of the COAP_CLIENT_CALLBACK_RECV_DATA callback.
+ */
+struct coap_client_data_recv_data {
+	/** Offset of the data in the payload. */
+	uint32_t offset;
+	/** Length of data. */
+	uint32_t length;
+	/** Buffer of data. Only valid during the callback. */
+	char *data;
+	/** A flag for the last block of the payload. */
+	uint8_t is_complete;
+};
+
+/**
+ * \brief Structure of the COAP_CLIENT_CALLBACK_DONE callback.
+ */
+struct coap_client_data_done {
+	/**
+	 * Result of the exchange.
+	 *
+	 * \return     0               Response received, whatever its code.
+	 * \return     -ETIME          No acknowledgement or response in time.
+	 * \return     -ECONNRESET     Request rejected with a reset message.
+	 * \return     -EHOSTUNREACH   Host name not resolved.
+	 * \return     -EPROTO         Unexpected block or malformed response.
+	 * \return     -EIO            Socket or entity error.
+	 */
+	int reason;
+};
+
+/**
+ * \brief Structure of the CoAP client callback.
+ */
+union coap_client_data {
+	struct coap_client_data_recv_response recv_response;
+	struct coap_client_data_recv_data recv_data;
+	struct coap_client_data_done done;
+};
+
+/**
+ * \brief Counters of the messages of the client.
+ *
+ * The bytes are the UDP payloads. Each datagram also takes 28 bytes of IPv4
+ * and UDP headers on the air.
+ */
+struct coap_client_stats {
+	/** Request exchanges, one per block. */
+	uint32_t exchanges;
+	/** Messages sent, retransmissions and acknowledgements included. */
+	uint32_t tx_messages;
+	/** Bytes sent. */
+	uint32_t tx_bytes;
+	/** Messages received. */
+	uint32_t rx_messages;
+	/** Bytes received. */
+	uint32_t rx_bytes;
+	/** Retransmissions of the requests. */
+	uint32_t retransmissions;
+};
+
+/* Before declaring for the callback type. */
+struct coap_client_module;
+/**
+ * \brief Callback interface of CoAP client service.
+ *
+ * \param[in]  module_inst     Module instance of CoAP client module.
+ * \param[in]  type            Type of event.
+ * \param[in]  data            Data structure of the event. \refer coap_client_data
+ */
+typedef void (*coap_client_callback_t)(struct coap_client_module *module_inst, int type, union coap_client_data *data);
+
+/**
+ * \brief CoAP client configuration structure
+ *
+ * Configuration struct for a CoAP client instance. This structure should be
+ * initialized by the \ref coap_client_get_config_defaults function before being
+ * modified by the user application.
+ */
+struct coap_client_config {
+	/**
+	 * UDP port of the server, unless the URL has one.
+	 * Default value is COAP_PORT.
+	 */
+	uint16_t port;
+	/**
+	 * UDP port of the client.
+	 * Default value is COAP_PORT.
+	 */
+	uint16_t local_port;
+	/**
+	 * Timer module for the retransmissions and the response timeout.
+	 * Default value is NULL.
+	 */
+	struct sw_timer_module *timer_inst;
+	/**
+	 * Initial acknowledgement timeout, spread up to 1.5 times and doubled at
+	 * each retransmission (ACK_TIMEOUT).
+	 * Unit is milliseconds.
+	 * Default value is 2000. (2 seconds)
+	 */
+	uint16_t ack_timeout;
+	/**
+	 * Retransmissions of a request before giving up (MAX_RETRANSMIT).
+	 * Default value is 4.
+	 */
+	uint8_t max_retransmit;
+	/**
+	 * Time waiting for a separate response once the request was acknowledged.
+	 * Unit is milliseconds.
+	 * Default value is 20000. (20 seconds)
+	 */
+	uint16_t timeout;
+	/**
+	 * Preferred size of the blocks, a power of two from 16 to 1024. The server
+	 * may choose smaller ones.
+	 * Default value is 512.
+	 */
+	uint16_t block_size;
+	/**
+	 * Rx buffer.
+	 * Default value is NULL.
+	 */
+	char *recv_buffer;
+	/**
+	 * Maximum size of the receive buffer, a response with a whole block.
+	 * It MUST be bigger than block_size.
+	 * Default value is 576.
+	 */
+	uint32_t recv_buffer_size;
+	/**
+	 * Seed of the message IDs and tokens.
+	 * Should come from an entropy source such as m2m_wifi_prng_get_random_bytes.
+	 * Default value is 0.
+	 */
+	uint32_t seed;
+};
+
+/**
+ * \brief Structure of CoAP client instance.
+ */
+struct coap_client_module {
+	/** UDP socket of the client. */
+	SOCKET sock;
+	/** State of the exchange. */
+	uint8_t state;
+	/** Host of the server. */
+	char host[HOSTNAME_MAX_SIZE];
+	/** Address of the server. */
+	struct sockaddr_in addr;
+
+	/** A flag for the socket being bound. */
+	uint8_t bound           : 1;
+	/** A flag for the receive buffer located in the heap. */
+	uint8_t alloc_buffer    : 1;
+	/** A flag for the request acknowledged, the response coming separately. */
+	uint8_t acked           : 1;
+	/** A flag for the response reported by COAP_CLIENT_CALLBACK_RECV_RESPONSE. */
+	uint8_t responded       : 1;
+	/** A flag for the payload of the request sent. */
+	uint8_t block1_done     : 1;
+	/** A flag for dropping the rest of a message bigger than the buffer. */
+	uint8_t skip            : 1;
+
+	/** Method of the request. */
+	uint8_t method;
+	/** Path and query of the request. */
+	char uri[COAP_MAX_URI_LENGTH];
+	/** Payload of the request. */
+	struct http_entity entity;
+	/** Length of the payload of the request, negative if unknown. */
+	int entity_length;
+
+	/** Message ID of the request. */
+	uint16_t message_id;
+	/** Token of the request. */
+	uint8_t token[COAP_TOKEN_LENGTH];
+	/** Block1 sent: number and size exponent. */
+	uint32_t block1_num;
+	uint8_t block1_szx;
+	/** Block2 asked: number and size exponent. */
+	uint32_t block2_num;
+	uint8_t block2_szx;
+	/** Bytes of the response payload delivered. */
+	uint32_t received;
+
+	/** Request kept for the retransmissions. */
+	uint8_t *send_buffer;
+	/** Length of the request. */
+	uint32_t send_length;
+	/** Retransmissions of the request so far. */
+	uint8_t retransmit;
+	/** Current acknowledgement timeout. */
+	uint32_t ack_wait;
+
+	/** State of the generator of the message IDs and tokens. */
+	uint32_t rand_state;
+
+	/** Counters of the messages. */
+	struct coap_client_stats stats;
+
+	/** SW Timer ID. */
+	int timer_id;
+
+	/** Callback interface entry. */
+	coap_client_callback_t cb;
+
+	/** Configuration instance of CoAP client module. That was registered from the \ref coap_client_init*/
+	struct coap_client_config config;
+};
+
+/**
+ * \brief Get default configuration of CoAP client module.
+ *
+ * \param[in]  config          Pointer of configuration structure which will be used in the module.
+ */
+void coap_client_get_config_defaults(struct coap_client_config *const config);
+
+/**
+ * \brief Initialize CoAP client service.
+ *
+ * \param[in]  module          Module instance of CoAP client module.
+ * \param[in]  config          Pointer of configuration structure which will be used in the module.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ * \return     -ENOSPC         No timer left.
+ * \return     -ENOMEM         Out of memory.
+ */
+int coap_client_init(struct coap_client_module *const module, struct coap_client_config *config);
+
+/**
+ * \brief Terminate CoAP client service.
+ *
+ * \param[in]  module          Module instance of CoAP client.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ */
+int coap_client_deinit(struct coap_client_module *const module);
+
+/**
+ * \brief Register and enable the callback.
+ *
+ * \param[in]  module_inst     Instance of CoAP client module.
+ * \param[in]  callback        Callback entry for the CoAP client module.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ */
+int coap_client_register_callback(struct coap_client_module *const module, coap_client_callback_t callback);
+
+/**
+ * \brief Send a request.
+ *
+ * The response is reported by COAP_CLIENT_CALLBACK_RECV_RESPONSE and
+ * COAP_CLIENT_CALLBACK_RECV_DATA, then COAP_CLIENT_CALLBACK_DONE.
+ *
+ * \param[in]  module_inst     Instance of CoAP client module.
+ * \param[in]  url             URL of the resource, coap://host[:port]/path[?query].
+ * \param[in]  method          Method of the request.
+ * \param[in]  entity          Payload of the request, or NULL. It is read block by block.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ * \return     -EBUSY          An exchange is in progress.
+ * \return     -ENOSPC         No socket left.
+ * \return     -ENAMETOOLONG   Host or URI is too long.
+ */
+int coap_client_send_request(struct coap_client_module *const module, const char *url,
+		enum coap_method method, struct http_entity *const entity);
+
+/**
+ * \brief End the exchange in progress without callback.
+ *
+ * \param[in]  module_inst     Instance of CoAP client module.
+ */
+void coap_client_abort(struct coap_client_module *const module);
+
+/**
+ * \brief Clear the counters of the messages.
+ *
+ * \param[in]  module_inst     Instance of CoAP client module.
+ */
+void coap_client_clear_stats(struct coap_client_module *const module);
+
+/**
+ * \brief Event handler of the socket.
+ *
+ * This function must be called from the socket callback registered with registerSocketCallback.
+ *
+ * \param[in]  sock            Socket descriptor.
+ * \param[in]  msg_type        Type of the socket event.
+ * \param[in]  msg_data        Data of the socket event.
+ */
+void coap_client_socket_event_handler(SOCKET sock, uint8_t msg_type, void *msg_data);
+
+/**
+ * \brief Event handler of gethostbyname.
+ *
+ * This function must be called from the resolve callback registered with registerSocketCallback.
+ *
+ * \param[in]  domain_name     Domain name.
+ * \param[in]  server_ip       Server IP address, 0 if not resolved.
+ */
+void coap_client_socket_resolve_handler(uint8_t *domain_name, uint32_t server_ip);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COAP_CLIENT_H_INCLUDED */
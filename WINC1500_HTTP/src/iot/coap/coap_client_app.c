@@ -0,0 +1,132 @@
+/**
+ * \file
+ *
+ * \brief CoAP download of the HTTP File Downloader Example.
+ *
+ */
+
+#include "main.h"
+
+#ifdef MAIN_COAP_FILE_URL
+
+#include <stdio.h>
+#include "asf.h"
+#include "download.h"
+#include "driver/include/m2m_wifi.h"
+#include "iot/coap/coap_client_app.h"
+
+/** Instance of CoAP client module downloading the image. */
+static struct coap_client_module coap_client_inst;
+/** Start of the CoAP download (CPU cycles). */
+static uint32_t coap_start_cycles = 0;
+
+/**
+ * \brief Print the cost of the CoAP transfer, to compare with the HTTP download.
+ */
+static void print_coap_stats(void)
+{
+	const struct coap_client_stats *stats = &coap_client_inst.stats;
+	uint32_t ms = (get_cycles() - coap_start_cycles) / (system_cpu_clock_get_hz() / 1000);
+
+	printf("print_coap_stats: %lu exchanges in %lu ms (%lu ms each), %lu retransmissions\r\n",
+			(unsigned long)stats->exchanges, (unsigned long)ms,
+			(unsigned long)(stats->exchanges ? ms / stats->exchanges : 0),
+			(unsigned long)stats->retransmissions);
+	/* Each datagram also takes 28 bytes of IPv4 and UDP headers. */
+	printf("print_coap_stats: sent %lu messages (%lu bytes), received %lu messages (%lu bytes), %lu bytes on the air\r\n",
+			(unsigned long)stats->tx_messages, (unsigned long)stats->tx_bytes,
+			(unsigned long)stats->rx_messages, (unsigned long)stats->rx_bytes,
+			(unsigned long)(stats->tx_bytes + stats->rx_bytes + 28 * (stats->tx_messages + stats->rx_messages)));
+}
+
+/**
+ * \brief Callback of the CoAP client.
+ *
+ * \param[in]  module_inst     Module instance of CoAP client module.
+ * \param[in]  type            Type of event.
+ * \param[in]  data            Data structure of the event. \refer coap_client_data
+ */
+static void coap_client_callback(struct coap_client_module *module_inst, int type, union coap_client_data *data)
+{
+	switch (type) {
+	case COAP_CLIENT_CALLBACK_RECV_RESPONSE:
+		printf("coap_client_callback: received response %u.%02u data size %lu\r\n",
+				(unsigned int)COAP_CODE_CLASS(data->recv_response.code),
+				(unsigned int)COAP_CODE_DETAIL(data->recv_response.code),
+				(unsigned long)data->recv_response.size);
+		if (data->recv_response.code != COAP_CODE(2, 5)) {
+			add_state(CANCELED);
+			break;
+		}
+		/* Without Size2, the last block ends the download. */
+		http_file_size = (data->recv_response.size != 0) ? data->recv_response.size : (uint32_t)-1;
+		received_file_size = 0;
+		break;
+
+	case COAP_CLIENT_CALLBACK_RECV_DATA:
+		if (is_state_set(CANCELED) || is_state_set(COMPLETED)) {
+			break;
+		}
+		store_file_packet(data->recv_data.data, data->recv_data.length);
+		if (is_state_set(CANCELED)) {
+			/* No use fetching the blocks left. */
+			coap_client_abort(module_inst);
+			break;
+		}
+		if (data->recv_data.is_complete && is_state_set(DOWNLOADING) && !is_state_set(COMPLETED)) {
+			printf("Download Completed (COAP_CLIENT_CALLBACK_RECV_DATA)\r\n");
+			finish_store_pipeline();
+			close_file(true);
+			add_state(COMPLETED);
+		}
+		break;
+
+	case COAP_CLIENT_CALLBACK_DONE:
+		printf("coap_client_callback: exchange done (%d)\r\n", data->done.reason);
+		print_coap_stats();
+		if (!is_state_set(COMPLETED)) {
+			/* Retried at the next poll. */
+			add_state(CANCELED);
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+void configure_coap_client(void)
+{
+	struct coap_client_config coap_conf;
+	uint8_t mac[6];
+	int ret;
+
+	coap_client_get_config_defaults(&coap_conf);
+	coap_conf.timer_inst = &swt_module_inst;
+	/* Room for a whole block and the options of the response. */
+	coap_conf.recv_buffer_size = MAIN_BUFFER_MAX_SIZE;
+	/* The message IDs and tokens only have to differ between devices and restarts. */
+	m2m_wifi_get_mac_address(mac);
+	coap_conf.seed = ((uint32_t)mac[2] << 24 | (uint32_t)mac[3] << 16 | (uint32_t)mac[4] << 8 | mac[5]) ^ get_tick_ms();
+
+	ret = coap_client_init(&coap_client_inst, &coap_conf);
+	if (ret < 0) {
+		printf("configure_coap_client: CoAP client initialization failed! (res %d)\r\n", ret);
+		while (1) {
+		} /* Loop forever. */
+	}
+
+	coap_client_register_callback(&coap_client_inst, coap_client_callback);
+}
+
+void start_coap_download(void)
+{
+	printf("start_coap_download: sending CoAP request to %s...\r\n", MAIN_COAP_FILE_URL);
+	coap_start_cycles = get_cycles();
+	coap_client_clear_stats(&coap_client_inst);
+	if (coap_client_send_request(&coap_client_inst, MAIN_COAP_FILE_URL, COAP_METHOD_GET, NULL) == 0) {
+		add_state(GET_REQUESTED);
+	}
+}
+
+#endif /* MAIN_COAP_FILE_URL */
@@ -0,0 +1,35 @@
+/**
+ * \file
+ *
+ * \brief CoAP download of the HTTP File Downloader Example.
+ *
+ * With MAIN_COAP_FILE_URL, the image is downloaded block by block with the
+ * CoAP client instead of the HTTP client, see iot/coap/coap_client.h. The cost
+ * of the transfer is printed at the end, to compare with the HTTP download.
+ *
+ */
+
+#ifndef COAP_CLIENT_APP_H_INCLUDED
+#define COAP_CLIENT_APP_H_INCLUDED
+
+#include "iot/coap/coap_client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Configure the CoAP client downloading the image.
+ */
+void configure_coap_client(void);
+
+/**
+ * \brief Send the CoAP request of the image.
+ */
+void start_coap_download(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COAP_CLIENT_APP_H_INCLUDED */
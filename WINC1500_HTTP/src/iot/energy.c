@@ -0,0 +1,117 @@
+/**
+ * \file
+ *
+ * \brief Energy accounting from the residency of the power states.
+ *
+ */
+
+#include <errno.h>
+#include <string.h>
+#include "iot/energy.h"
+
+/** Seconds per hour, to turn the charge into ampere-hours. */
+#define ENERGY_SECONDS_PER_HOUR         3600
+
+/**
+ * \brief Get the current drawn in the present states.
+ */
+static uint32_t _energy_get_current(const struct energy_meter *meter)
+{
+	uint32_t current = meter->base_current;
+	uint8_t i;
+
+	for (i = 0; i < meter->source_count; i++) {
+		current += meter->sources[i].on ? meter->sources[i].on_current : meter->sources[i].off_current;
+	}
+	return current;
+}
+
+void energy_init(struct energy_meter *meter, energy_clock_t clock, uint32_t clock_hz, uint32_t base_current)
+{
+	memset(meter, 0, sizeof(struct energy_meter));
+	meter->clock = clock;
+	meter->clock_hz = clock_hz;
+	meter->base_current = base_current;
+	meter->since = clock();
+}
+
+int energy_add_source(struct energy_meter *meter, const char *name, uint32_t on_current, uint32_t off_current, bool on)
+{
+	struct energy_source *source;
+
+	if (meter->source_count >= ENERGY_SOURCE_MAX) {
+		return -ENOSPC;
+	}
+
+	/* The time so far is counted with the former sources. */
+	energy_update(meter);
+	source = &meter->sources[meter->source_count];
+	source->name = name;
+	source->on_current = on_current;
+	source->off_current = off_current;
+	source->on = on;
+	return meter->source_count++;
+}
+
+void energy_set_state(struct energy_meter *meter, uint8_t index, bool on)
+{
+	if (index >= meter->source_count || meter->sources[index].on == on) {
+		return;
+	}
+
+	energy_update(meter);
+	meter->sources[index].on = on;
+	if (on) {
+		meter->counters.turn_ons[index]++;
+	}
+}
+
+void energy_update(struct energy_meter *meter)
+{
+	uint32_t now = meter->clock();
+	uint32_t elapsed = now - meter->since;
+	uint8_t i;
+
+	meter->since = now;
+	meter->counters.ticks += elapsed;
+	meter->counters.charge += (uint64_t)elapsed * _energy_get_current(meter);
+	for (i = 0; i < meter->source_count; i++) {
+		if (meter->sources[i].on) {
+			meter->counters.on_ticks[i] += elapsed;
+		}
+	}
+}
+
+void energy_clear(struct energy_meter *meter)
+{
+	memset(&meter->counters, 0, sizeof(struct energy_snapshot));
+	meter->since = meter->clock();
+}
+
+void energy_get_snapshot(struct energy_meter *meter, struct energy_snapshot *snapshot)
+{
+	energy_update(meter);
+	memcpy(snapshot, &meter->counters, sizeof(struct energy_snapshot));
+}
+
+uint32_t energy_get_charge(const struct energy_meter *meter, const struct energy_snapshot *from,
+		const struct energy_snapshot *to)
+{
+	return (uint32_t)((to->charge - from->charge) / ((uint64_t)meter->clock_hz * ENERGY_SECONDS_PER_HOUR));
+}
+
+uint32_t energy_get_average_current(const struct energy_snapshot *from, const struct energy_snapshot *to)
+{
+	uint64_t ticks = to->ticks - from->ticks;
+
+	if (ticks == 0) {
+		return 0;
+	}
+	return (uint32_t)((to->charge - from->charge) / ticks);
+}
+
+uint32_t energy_get_time(const struct energy_meter *meter, const struct energy_snapshot *from,
+		const struct energy_snapshot *to)
+{
+	return (uint32_t)((to->ticks - from->ticks) * 1000 / meter->clock_hz);
+}
@@ -0,0 +1,183 @@
+/**
+ * \file
+ *
+ * \brief Energy accounting from the residency of the power states.
+ *
+ * The meter integrates the supply current over time: a base current drawn all
+ * the time (the MCU running, the board), plus for each source, e.g. the WINC
+ * or the SD card, its current when on or when off. The firmware reports every
+ * transition of a source with \ref energy_set_state, timestamped with a fast
+ * clock such as the CPU cycles, and compares snapshots of the meter to get the
+ * charge of a download or the average current while idle.
+ *
+ * The currents are figures of the datasheets or of a measurement, so the
+ * result is as good as them: it compares strategies and power profiles rather
+ * than replacing a current probe.
+ *
+ * The functions are not reentrant. When sources are reported by several
+ * tasks or by interrupts, the caller serializes the calls.
+ *
+ */
+
+#ifndef IOT_ENERGY_H_INCLUDED
+#define IOT_ENERGY_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Maximum number of sources of a meter. */
+#define ENERGY_SOURCE_MAX               4
+
+/**
+ * \brief Monotonic clock of the meter, wrapping at 2^32 ticks.
+ */
+typedef uint32_t (*energy_clock_t)(void);
+
+/**
+ * \brief Structure of a source of the meter.
+ */
+struct energy_source {
+	/** Name of the source. */
+	const char *name;
+	/** Current when on, in microamperes. */
+	uint32_t on_current;
+	/** Current when off, in microamperes. */
+	uint32_t off_current;
+	/** The source is on. */
+	bool on;
+};
+
+/**
+ * \brief Counters of a meter at a point in time.
+ */
+struct energy_snapshot {
+	/** Clock ticks. */
+	uint64_t ticks;
+	/** Charge, in microamperes times clock ticks. */
+	uint64_t charge;
+	/** Clock ticks spent on, per source. */
+	uint64_t on_ticks[ENERGY_SOURCE_MAX];
+	/** Number of times turned on, per source. */
+	uint32_t turn_ons[ENERGY_SOURCE_MAX];
+};
+
+/**
+ * \brief Structure of a meter.
+ */
+struct energy_meter {
+	/** Clock of the transitions. */
+	energy_clock_t clock;
+	/** Frequency of the clock, in hertz. */
+	uint32_t clock_hz;
+	/** Current drawn all the time, in microamperes. */
+	uint32_t base_current;
+	/** Sources. */
+	struct energy_source sources[ENERGY_SOURCE_MAX];
+	/** Number of sources. */
+	uint8_t source_count;
+	/** Clock at the last update of the counters. */
+	uint32_t since;
+	/** Counters since \ref energy_clear. */
+	struct energy_snapshot counters;
+};
+
+/**
+ * \brief Initialize a meter without source.
+ *
+ * \param[in]  meter           Meter.
+ * \param[in]  clock           Clock of the transitions.
+ * \param[in]  clock_hz        Frequency of the clock.
+ * \param[in]  base_current    Current drawn all the time, in microamperes.
+ */
+void energy_init(struct energy_meter *meter, energy_clock_t clock, uint32_t clock_hz, uint32_t base_current);
+
+/**
+ * \brief Add a source to a meter.
+ *
+ * \param[in]  meter           Meter.
+ * \param[in]  name            Name of the source.
+ * \param[in]  on_current      Current when on, in microamperes.
+ * \param[in]  off_current     Current when off, in microamperes.
+ * \param[in]  on              Initial state.
+ *
+ * \return     Index of the source, or -ENOSPC if the meter has ENERGY_SOURCE_MAX sources.
+ */
+int energy_add_source(struct energy_meter *meter, const char *name, uint32_t on_current, uint32_t off_current, bool on);
+
+/**
+ * \brief Report the state of a source. Only a change of state is counted.
+ *
+ * \param[in]  meter           Meter.
+ * \param[in]  index           Index of the source.
+ * \param[in]  on              The source is on.
+ */
+void energy_set_state(struct energy_meter *meter, uint8_t index, bool on);
+
+/**
+ * \brief Update the counters with the time elapsed in the current states.
+ *
+ * Must be called at least once per wrap of the clock, e.g. every 89 seconds
+ * for the cycles of a 48MHz CPU.
+ *
+ * \param[in]  meter           Meter.
+ */
+void energy_update(struct energy_meter *meter);
+
+/**
+ * \brief Clear the counters, keeping the states of the sources.
+ *
+ * \param[in]  meter           Meter.
+ */
+void energy_clear(struct energy_meter *meter);
+
+/**
+ * \brief Get the counters of a meter, updated.
+ *
+ * \param[in]  meter           Meter.
+ * \param[out] snapshot        Counters.
+ */
+void energy_get_snapshot(struct energy_meter *meter, struct energy_snapshot *snapshot);
+
+/**
+ * \brief Get the charge drawn between two snapshots.
+ *
+ * \param[in]  meter           Meter of the snapshots.
+ * \param[in]  from            Earlier snapshot.
+ * \param[in]  to              Later snapshot.
+ *
+ * \return     Charge in microampere-hours.
+ */
+uint32_t energy_get_charge(const struct energy_meter *meter, const struct energy_snapshot *from,
+		const struct energy_snapshot *to);
+
+/**
+ * \brief Get the average current between two snapshots, which is also the charge per hour.
+ *
+ * \param[in]  from            Earlier snapshot.
+ * \param[in]  to              Later snapshot.
+ *
+ * \return     Current in microamperes, 0 if no time elapsed.
+ */
+uint32_t energy_get_average_current(const struct energy_snapshot *from, const struct energy_snapshot *to);
+
+/**
+ * \brief Get the time between two snapshots.
+ *
+ * \param[in]  meter           Meter of the snapshots.
+ * \param[in]  from            Earlier snapshot.
+ * \param[in]  to              Later snapshot.
+ *
+ * \return     Time in milliseconds.
+ */
+uint32_t energy_get_time(const struct energy_meter *meter, const struct energy_snapshot *from,
+		const struct energy_snapshot *to);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOT_ENERGY_H_INCLUDED */
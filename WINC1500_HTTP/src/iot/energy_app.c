@@ -0,0 +1,126 @@
+/**
+ * \file
+ *
+ * \brief Energy accounting of the HTTP File Downloader Example.
+ *
+ */
+
+#include "main.h"
+
+#ifdef MAIN_ENERGY_STATS
+
+#include <stdio.h>
+#include "asf.h"
+#include "conf_winc.h"
+#include "sd_mmc_spi.h"
+#include "download.h"
+#include "iot/energy_app.h"
+
+#if !defined(CONF_WINC_ENERGY_STATS) || !defined(SD_MMC_SPI_ENERGY_STATS)
+#error "MAIN_ENERGY_STATS needs CONF_WINC_ENERGY_STATS and SD_MMC_SPI_ENERGY_STATS."
+#endif
+
+/** Energy meter of the WINC and of the SD card. */
+static struct energy_meter energy_inst;
+/** Sources of the meter. */
+static int energy_winc_source;
+static int energy_sd_source;
+/** Counters at the start or at the end of the last download. */
+static struct energy_snapshot energy_mark;
+/** A download is running since energy_mark. */
+static bool energy_busy = false;
+
+/* Hook of the HIF layer, see m2m_hif.c. */
+void os_hook_chip_state(uint8 u8Awake);
+
+/**
+ * \brief Account the WINC awake or let asleep by the driver.
+ */
+void os_hook_chip_state(uint8 u8Awake)
+{
+	/* Also reported by the storage task with CONF_WINC_USE_FREERTOS. */
+	irqflags_t flags = cpu_irq_save();
+	energy_set_state(&energy_inst, energy_winc_source, u8Awake != 0);
+	cpu_irq_restore(flags);
+}
+
+/**
+ * \brief Account the SD card selected or released.
+ */
+void sd_mmc_spi_hook_select(bool selected)
+{
+	irqflags_t flags = cpu_irq_save();
+	energy_set_state(&energy_inst, energy_sd_source, selected);
+	cpu_irq_restore(flags);
+}
+
+/**
+ * \brief Print a charge in microampere-hours as milliampere-hours.
+ */
+static void print_mah(const char *label, uint64_t uah)
+{
+	printf("%s %lu.%03lu mAh", label, (unsigned long)(uah / 1000), (unsigned long)(uah % 1000));
+}
+
+void energy_poll(void)
+{
+	bool busy = is_state_set(GET_REQUESTED) && !is_state_set(COMPLETED) && !is_state_set(CANCELED);
+	struct energy_snapshot now;
+	uint32_t charge;
+	uint64_t ticks;
+	irqflags_t flags;
+	int i;
+
+	flags = cpu_irq_save();
+	if (busy == energy_busy) {
+		/* Counts the states before the clock wraps. */
+		energy_update(&energy_inst);
+		cpu_irq_restore(flags);
+		return;
+	}
+	energy_get_snapshot(&energy_inst, &now);
+	cpu_irq_restore(flags);
+
+	charge = energy_get_charge(&energy_inst, &energy_mark, &now);
+	if (busy) {
+		printf("energy_poll: idle for %lu ms, %lu uA average,",
+				(unsigned long)energy_get_time(&energy_inst, &energy_mark, &now),
+				(unsigned long)energy_get_average_current(&energy_mark, &now));
+		print_mah("", energy_get_average_current(&energy_mark, &now));
+		printf(" per idle hour\r\n");
+	} else {
+		printf("energy_poll: download %s in %lu ms,", is_state_set(COMPLETED) ? "completed" : "failed",
+				(unsigned long)energy_get_time(&energy_inst, &energy_mark, &now));
+		print_mah("", charge);
+		if (received_file_size > 0) {
+			print_mah(",", (uint64_t)charge * 1048576 / received_file_size);
+			printf(" per MB");
+		}
+		printf("\r\n");
+		ticks = now.ticks - energy_mark.ticks;
+		for (i = 0; (i < energy_inst.source_count) && (ticks > 0); i++) {
+			printf("energy_poll:   %-4s on %3lu%% of the time, %lu times\r\n", energy_inst.sources[i].name,
+					(unsigned long)((now.on_ticks[i] - energy_mark.on_ticks[i]) * 100 / ticks),
+					(unsigned long)(now.turn_ons[i] - energy_mark.turn_ons[i]));
+		}
+	}
+	energy_mark = now;
+	energy_busy = busy;
+}
+
+void configure_energy(void)
+{
+	energy_init(&energy_inst, get_cycles, system_cpu_clock_get_hz(), MAIN_ENERGY_BASE_UA);
+	/* Awake until the driver lets it sleep, which it does not with M2M_NO_PS. */
+	energy_winc_source = energy_add_source(&energy_inst, "winc",
+			MAIN_ENERGY_WINC_AWAKE_UA, MAIN_ENERGY_WINC_SLEEP_UA, true);
+	energy_sd_source = energy_add_source(&energy_inst, "sd",
+			MAIN_ENERGY_SD_ACTIVE_UA, MAIN_ENERGY_SD_IDLE_UA, false);
+}
+
+void clear_energy(void)
+{
+	energy_clear(&energy_inst);
+}
+
+#endif /* MAIN_ENERGY_STATS */
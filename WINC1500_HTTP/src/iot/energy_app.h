@@ -0,0 +1,42 @@
+/**
+ * \file
+ *
+ * \brief Energy accounting of the HTTP File Downloader Example.
+ *
+ * With MAIN_ENERGY_STATS, the awake time of the WINC and the selected time of
+ * the SD card are metered, see iot/energy.h. The charge of each download and
+ * the average current between the downloads are printed.
+ *
+ */
+
+#ifndef IOT_ENERGY_APP_H_INCLUDED
+#define IOT_ENERGY_APP_H_INCLUDED
+
+#include "iot/energy.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Configure the energy meter, before the WINC and the SD card report their states.
+ */
+void configure_energy(void);
+
+/**
+ * \brief Start counting from zero, once the clock runs.
+ */
+void clear_energy(void);
+
+/**
+ * \brief Report the charge of each download and the average current between the downloads.
+ *
+ * The average current while idle is also the charge per idle hour.
+ */
+void energy_poll(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOT_ENERGY_APP_H_INCLUDED */
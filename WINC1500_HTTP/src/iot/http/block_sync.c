@@ -0,0 +1,714 @@
+/**
+ * \file
+ *
+ * \brief Block synchronization of an image over HTTP (zsync-like).
+ *
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "iot/http/block_sync.h"
+
+/** End of a hash bucket chain. */
+#define BLOCK_SYNC_NO_BLOCK             0xFFFF
+
+enum block_sync_state {
+	/** Not running. */
+	STATE_IDLE = 0,
+	/** Receiving the control file. */
+	STATE_CONTROL,
+	/** Searching the current image for the blocks. */
+	STATE_SEARCH,
+	/** Assembling the new image from the current image and the range responses. */
+	STATE_FETCH,
+};
+
+/**
+ * \brief Report the end of the synchronization and release the tables.
+ *
+ * The HTTP connection is closed by the next \ref block_sync_task, not from
+ * inside an HTTP client callback.
+ *
+ * \param[in]  module          Module instance of block synchronization.
+ * \param[in]  reason          Result of the synchronization.
+ */
+static void _block_sync_complete(struct block_sync_module *const module, int reason)
+{
+	union block_sync_data data;
+
+	if (module->tables != NULL) {
+		free(module->tables);
+		module->tables = NULL;
+	}
+	if (module->window != NULL) {
+		free(module->window);
+		module->window = NULL;
+	}
+	module->state = STATE_IDLE;
+	module->requesting = 0;
+	module->close_pending = 1;
+
+	data.completed.reason = reason;
+	if (module->cb) {
+		module->cb(module, BLOCK_SYNC_CALLBACK_COMPLETED, &data);
+	}
+}
+
+/**
+ * \brief Mask of the rolling checksum bytes kept in the control file.
+ */
+static inline uint32_t _block_sync_weak_mask(struct block_sync_module *const module)
+{
+	return (module->header.weak_length >= 4) ? 0xFFFFFFFF : ((uint32_t)1 << (module->header.weak_length * 8)) - 1;
+}
+
+/**
+ * \brief Hash bucket of a rolling checksum.
+ */
+static inline uint16_t _block_sync_bucket(struct block_sync_module *const module, uint32_t weak)
+{
+	return (uint16_t)((weak ^ (weak >> 11) ^ (weak >> 21)) & module->bucket_mask);
+}
+
+/**
+ * \brief Check the control file header and allocate the block tables.
+ *
+ * \return     0               Function succeeded
+ * \return     -EPROTO         Invalid or unsupported header.
+ * \return     -EFBIG          Too many blocks.
+ * \return     -ENOMEM         Out of memory.
+ */
+static int _block_sync_alloc(struct block_sync_module *const module)
+{
+	struct block_sync_header *header = &module->header;
+	uint32_t buckets;
+	uint8_t *ptr;
+
+	if (header->magic != BLOCK_SYNC_MAGIC || header->version != BLOCK_SYNC_VERSION
+			|| header->block_shift < BLOCK_SYNC_MIN_BLOCK_SHIFT || header->block_shift > BLOCK_SYNC_MAX_BLOCK_SHIFT
+			|| header->weak_length < 2 || header->weak_length > 4
+			|| header->strong_length < 4 || header->strong_length > SHA256_DIGEST_LENGTH
+			|| header->size == 0) {
+		return -EPROTO;
+	}
+
+	module->nb_block = ((header->size - 1) >> header->block_shift) + 1;
+	if (module->nb_block > module->config.max_block) {
+		return -EFBIG;
+	}
+
+	for (buckets = 16; buckets < module->nb_block; buckets <<= 1);
+	module->bucket_mask = (uint16_t)(buckets - 1);
+
+	/* 32-bit tables first to keep them aligned. */
+	module->tables = malloc(module->nb_block * (4 + 4 + 2 + header->strong_length) + buckets * 2);
+	module->window = malloc((uint32_t)1 << header->block_shift);
+	if (module->tables == NULL || module->window == NULL) {
+		return -ENOMEM;
+	}
+	ptr = module->tables;
+	module->weak = (uint32_t *)ptr;
+	ptr += module->nb_block * 4;
+	module->source = (uint32_t *)ptr;
+	ptr += module->nb_block * 4;
+	module->next = (uint16_t *)ptr;
+	ptr += module->nb_block * 2;
+	module->bucket = (uint16_t *)ptr;
+	ptr += buckets * 2;
+	module->strong = ptr;
+
+	memset(module->weak, 0, module->nb_block * 4);
+	memset(module->bucket, 0xFF, buckets * 2);
+
+	return 0;
+}
+
+/**
+ * \brief Parse a piece of the control file.
+ *
+ * \return     0               Function succeeded
+ * \return     otherwise       Error of \ref _block_sync_alloc, or -EPROTO on extra data.
+ */
+static int _block_sync_control_data(struct block_sync_module *const module, const uint8_t *data, uint32_t length)
+{
+	uint32_t entry_length, index, pos;
+	int ret;
+
+	for (; length > 0; data++, length--) {
+		if (module->control_length < sizeof(struct block_sync_header)) {
+			((uint8_t *)&module->header)[module->control_length++] = *data;
+			if (module->control_length == sizeof(struct block_sync_header)) {
+				ret = _block_sync_alloc(module);
+				if (ret < 0) {
+					return ret;
+				}
+			}
+			continue;
+		}
+
+		entry_length = module->header.weak_length + module->header.strong_length;
+		index = (module->control_length - sizeof(struct block_sync_header)) / entry_length;
+		pos = (module->control_length - sizeof(struct block_sync_header)) % entry_length;
+		if (index >= module->nb_block) {
+			return -EPROTO;
+		}
+		if (pos < module->header.weak_length) {
+			module->weak[index] = (module->weak[index] << 8) | *data;
+		} else {
+			module->strong[index * module->header.strong_length + pos - module->header.weak_length] = *data;
+		}
+		module->control_length++;
+	}
+
+	return 0;
+}
+
+/**
+ * \brief Index the blocks of the control file and start the search.
+ *
+ * \return     0               Function succeeded
+ * \return     -EPROTO         Control file is truncated.
+ */
+static int _block_sync_control_done(struct block_sync_module *const module)
+{
+	uint32_t i;
+	uint16_t bucket;
+
+	if (module->tables == NULL || module->control_length != sizeof(struct block_sync_header)
+			+ module->nb_block * (module->header.weak_length + module->header.strong_length)) {
+		return -EPROTO;
+	}
+
+	/* Chain in reverse so that each bucket lists its blocks in order. */
+	for (i = module->nb_block; i-- > 0;) {
+		bucket = _block_sync_bucket(module, module->weak[i]);
+		module->next[i] = module->bucket[bucket];
+		module->bucket[bucket] = (uint16_t)i;
+		module->source[i] = BLOCK_SYNC_FETCH;
+	}
+
+	module->search_offset = 0;
+	module->refill = 1;
+	module->state = STATE_SEARCH;
+
+	return 0;
+}
+
+/**
+ * \brief Read the current image, padded with zeros.
+ *
+ * \return     0               Function succeeded
+ * \return     -EIO            Read error.
+ */
+static int _block_sync_read(struct block_sync_module *const module, uint32_t offset, uint8_t *buffer, uint32_t length)
+{
+	int size = 0;
+
+	if (offset < module->old_size) {
+		size = module->config.read(module->config.priv_data, offset, buffer, length);
+		if (size < 0) {
+			return -EIO;
+		}
+	}
+	memset(buffer + size, 0, length - size);
+
+	return 0;
+}
+
+/**
+ * \brief Load the search window at search_offset and compute its checksum.
+ *
+ * The window is a ring: the byte at offset o is stored at o modulo the block size.
+ *
+ * \return     0               Function succeeded
+ * \return     -EIO            Read error.
+ */
+static int _block_sync_fill(struct block_sync_module *const module)
+{
+	uint32_t block_size = (uint32_t)1 << module->header.block_shift;
+	uint32_t start = module->search_offset & (block_size - 1);
+	uint16_t a = 0, b = 0;
+	uint32_t i;
+
+	if (_block_sync_read(module, module->search_offset, module->window + start, block_size - start) < 0
+			|| _block_sync_read(module, module->search_offset + block_size - start, module->window, start) < 0) {
+		return -EIO;
+	}
+
+	for (i = 0; i < block_size; i++) {
+		a += module->window[(start + i) & (block_size - 1)];
+		b += a;
+	}
+	module->sum_a = a;
+	module->sum_b = b;
+	module->ahead_offset = module->search_offset + block_size;
+	module->ahead_length = 0;
+	module->ahead_pos = 0;
+
+	return 0;
+}
+
+/**
+ * \brief Look the window up in the block tables.
+ *
+ * \return     Non zero if the window is the content of a block not found yet.
+ */
+static int _block_sync_match(struct block_sync_module *const module)
+{
+	uint32_t block_size = (uint32_t)1 << module->header.block_shift;
+	uint32_t start = module->search_offset & (block_size - 1);
+	uint32_t weak = (((uint32_t)module->sum_a << 16) | module->sum_b) & _block_sync_weak_mask(module);
+	uint8_t digest[SHA256_DIGEST_LENGTH];
+	struct sha256_context context;
+	int hashed = 0, matched = 0;
+	uint16_t i;
+
+	for (i = module->bucket[_block_sync_bucket(module, weak)]; i != BLOCK_SYNC_NO_BLOCK; i = module->next[i]) {
+		if (module->weak[i] != weak || module->source[i] != BLOCK_SYNC_FETCH) {
+			continue;
+		}
+		if (!hashed) {
+			/* Only hash the window on a checksum hit. */
+			sha256_init(&context);
+			sha256_update(&context, module->window + start, block_size - start);
+			sha256_update(&context, module->window, start);
+			sha256_final(&context, digest);
+			hashed = 1;
+		}
+		if (!memcmp(digest, module->strong + i * module->header.strong_length, module->header.strong_length)) {
+			/* Every block with this content can be copied from here. */
+			module->source[i] = module->search_offset;
+			matched = 1;
+		}
+	}
+
+	return matched;
+}
+
+/**
+ * \brief Report the result of the search and start fetching.
+ */
+static void _block_sync_search_done(struct block_sync_module *const module)
+{
+	uint32_t block_size = (uint32_t)1 << module->header.block_shift;
+	union block_sync_data data;
+	uint32_t i, length;
+
+	data.matched.size = module->header.size;
+	data.matched.nb_block = module->nb_block;
+	data.matched.nb_reused = 0;
+	data.matched.fetch_length = 0;
+	data.matched.unchanged = (module->old_size == module->header.size);
+	for (i = 0; i < module->nb_block; i++) {
+		if (module->source[i] != BLOCK_SYNC_FETCH) {
+			data.matched.nb_reused++;
+		} else {
+			length = module->header.size - i * block_size;
+			data.matched.fetch_length += (length < block_size) ? length : block_size;
+		}
+		if (module->source[i] != i * block_size) {
+			data.matched.unchanged = 0;
+		}
+	}
+
+	module->state = STATE_FETCH;
+	module->fetch_block = 0;
+	module->written = 0;
+	sha256_init(&module->digest);
+
+	if (module->cb) {
+		module->cb(module, BLOCK_SYNC_CALLBACK_MATCHED, &data);
+	}
+}
+
+/**
+ * \brief Search a part of the current image for the blocks of the new image.
+ *
+ * A rolling checksum is kept over a window of one block moved one byte at a
+ * time. Once a block is found, the window jumps over it.
+ */
+static void _block_sync_search(struct block_sync_module *const module)
+{
+	uint32_t block_size = (uint32_t)1 << module->header.block_shift;
+	uint32_t budget = module->config.search_budget;
+	uint8_t *slot;
+	uint8_t in, out;
+
+	while (module->search_offset < module->old_size) {
+		if (module->refill) {
+			if (_block_sync_fill(module) < 0) {
+				_block_sync_complete(module, -EIO);
+				return;
+			}
+			module->refill = 0;
+			budget = (budget > block_size) ? budget - block_size : 0;
+		}
+
+		if (_block_sync_match(module)) {
+			module->search_offset += block_size;
+			module->refill = 1;
+		} else {
+			/* Slide the window. The bytes after it are read ahead in small pieces. */
+			if (module->ahead_pos >= module->ahead_length) {
+				if (_block_sync_read(module, module->ahead_offset, module->ahead, sizeof(module->ahead)) < 0) {
+					_block_sync_complete(module, -EIO);
+					return;
+				}
+				module->ahead_offset += sizeof(module->ahead);
+				module->ahead_length = sizeof(module->ahead);
+				module->ahead_pos = 0;
+			}
+			in = module->ahead[module->ahead_pos++];
+			slot = module->window + (module->search_offset & (block_size - 1));
+			out = *slot;
+			*slot = in;
+			module->sum_a += in - out;
+			module->sum_b += module->sum_a - (uint16_t)(block_size * out);
+			module->search_offset++;
+		}
+
+		if (budget-- == 0) {
+			/* Let the network events be handled. */
+			return;
+		}
+	}
+
+	_block_sync_search_done(module);
+}
+
+/**
+ * \brief Write a piece of the new image.
+ *
+ * \return     0               Function succeeded
+ * \return     -EIO            Write error.
+ */
+static int _block_sync_write(struct block_sync_module *const module, const void *data, uint32_t length)
+{
+	if (module->config.write(module->config.priv_data, data, length) < 0) {
+		return -EIO;
+	}
+	sha256_update(&module->digest, data, length);
+	module->written += length;
+
+	return 0;
+}
+
+/**
+ * \brief Write the new image up to an offset from the blocks found in the current image.
+ *
+ * \return     0               Function succeeded
+ * \return     -EBADMSG        A block to be fetched was skipped.
+ * \return     -EIO            Read or write error.
+ */
+static int _block_sync_copy(struct block_sync_module *const module, uint32_t end)
+{
+	uint32_t block_size = (uint32_t)1 << module->header.block_shift;
+	uint32_t block, length;
+
+	while (module->written < end) {
+		block = module->written >> module->header.block_shift;
+		if (module->source[block] == BLOCK_SYNC_FETCH) {
+			return -EBADMSG;
+		}
+		length = (block + 1) * block_size;
+		length = ((length < end) ? length : end) - module->written;
+		if (_block_sync_read(module, module->source[block] + (module->written & (block_size - 1)),
+				module->window, length) < 0) {
+			return -EIO;
+		}
+		if (_block_sync_write(module, module->window, length) < 0) {
+			return -EIO;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * \brief Write a piece of a range response in the new image.
+ *
+ * \return     0               Function succeeded
+ * \return     otherwise       Error of \ref _block_sync_copy, or -EBADMSG for a piece out of the image.
+ */
+static int _block_sync_part(struct block_sync_module *const module, struct http_client_data_recv_part *part)
+{
+	uint32_t skip;
+
+	if (part->offset + part->length <= module->written) {
+		/* Already written. */
+		return 0;
+	}
+	if (part->offset + part->length > module->header.size) {
+		return -EBADMSG;
+	}
+	if (part->offset < module->written) {
+		/* Ranges were merged by the server. */
+		skip = module->written - part->offset;
+		return _block_sync_write(module, part->data + skip, part->length - skip);
+	}
+	if (part->offset > module->written) {
+		int ret = _block_sync_copy(module, part->offset);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	return _block_sync_write(module, part->data, part->length);
+}
+
+/**
+ * \brief Request the next ranges, or complete the image when none is left.
+ */
+static void _block_sync_request(struct block_sync_module *const module)
+{
+	uint32_t block_size = (uint32_t)1 << module->header.block_shift;
+	struct http_client_range ranges[HTTP_MAX_RANGES];
+	uint8_t digest[SHA256_DIGEST_LENGTH];
+	uint32_t block = module->fetch_block, start;
+	int count = 0, ret;
+
+	while (block < module->nb_block && count < HTTP_MAX_RANGES) {
+		if (module->source[block] != BLOCK_SYNC_FETCH) {
+			block++;
+			continue;
+		}
+		/* Consecutive missing blocks make one range. */
+		for (start = block; block < module->nb_block && module->source[block] == BLOCK_SYNC_FETCH; block++);
+		ranges[count].offset = start * block_size;
+		ranges[count].length = ((block == module->nb_block) ? module->header.size : block * block_size)
+				- ranges[count].offset;
+		count++;
+	}
+
+	if (count == 0 || module->written >= module->header.size) {
+		/* Nothing left to download. */
+		ret = _block_sync_copy(module, module->header.size);
+		if (ret < 0) {
+			_block_sync_complete(module, ret);
+			return;
+		}
+		sha256_final(&module->digest, digest);
+		_block_sync_complete(module, memcmp(digest, module->header.digest, SHA256_DIGEST_LENGTH) ? -EBADMSG : 0);
+		return;
+	}
+
+	ret = http_client_send_ranges(&module->http, module->url, ranges, count, NULL);
+	if (ret == -EAGAIN || ret == -EBUSY) {
+		/* Previous response is still being received. Try again later. */
+		return;
+	}
+	if (ret < 0) {
+		_block_sync_complete(module, ret);
+		return;
+	}
+	module->fetch_block = block;
+	module->requesting = 1;
+}
+
+/**
+ * \brief Callback of the HTTP client fetching the control file and the blocks.
+ */
+static void _block_sync_http_callback(struct http_client_module *module_inst, int type, union http_client_data *data)
+{
+	/* HTTP client is the first member of the module. */
+	struct block_sync_module *const module = (struct block_sync_module *)module_inst;
+	int ret = 0;
+
+	if (module->state == STATE_IDLE) {
+		return;
+	}
+
+	switch (type) {
+	case HTTP_CLIENT_CALLBACK_RECV_RESPONSE:
+		if (module->state == STATE_CONTROL) {
+			if (data->recv_response.response_code != 200) {
+				ret = -ENOENT;
+			} else if (data->recv_response.content != NULL) {
+				/* Whole control file in the receive buffer. */
+				module->requesting = 0;
+				ret = _block_sync_control_data(module, (uint8_t *)data->recv_response.content,
+						data->recv_response.content_length);
+				if (ret == 0) {
+					ret = _block_sync_control_done(module);
+				}
+			}
+		} else if (data->recv_response.response_code != 206 && data->recv_response.response_code != 200) {
+			ret = -ENOENT;
+		}
+		break;
+
+	case HTTP_CLIENT_CALLBACK_RECV_CHUNKED_DATA:
+		if (module->state == STATE_CONTROL) {
+			ret = _block_sync_control_data(module, (uint8_t *)data->recv_chunked_data.data,
+					data->recv_chunked_data.length);
+			if (ret == 0 && data->recv_chunked_data.is_complete) {
+				module->requesting = 0;
+				ret = _block_sync_control_done(module);
+			}
+		}
+		break;
+
+	case HTTP_CLIENT_CALLBACK_RECV_PART:
+		if (module->state == STATE_FETCH) {
+			if (data->recv_part.is_complete) {
+				/* Next ranges are requested from the main loop. */
+				module->requesting = 0;
+			} else {
+				ret = _block_sync_part(module, &data->recv_part);
+			}
+		}
+		break;
+
+	case HTTP_CLIENT_CALLBACK_DISCONNECTED:
+		if (module->requesting) {
+			ret = (data->disconnected.reason < 0) ? data->disconnected.reason : -ECONNRESET;
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	if (ret < 0) {
+		_block_sync_complete(module, ret);
+	}
+}
+
+void block_sync_get_config_defaults(struct block_sync_config *const config)
+{
+	config->port = 80;
+	config->tls = 0;
+	config->timer_inst = NULL;
+	config->recv_buffer = NULL;
+	config->recv_buffer_size = 1446;
+	config->max_block = 512;
+	config->search_budget = 2048;
+	config->read = NULL;
+	config->write = NULL;
+	config->priv_data = NULL;
+}
+
+int block_sync_init(struct block_sync_module *const module, struct block_sync_config *config)
+{
+	struct http_client_config httpc_conf;
+	int ret;
+
+	if (module == NULL || config == NULL) {
+		return -EINVAL;
+	}
+
+	if (config->read == NULL || config->write == NULL || config->max_block == 0
+			|| config->max_block >= BLOCK_SYNC_NO_BLOCK || config->search_budget == 0) {
+		return -EINVAL;
+	}
+
+	memset(module, 0, sizeof(struct block_sync_module));
+	memcpy(&module->config, config, sizeof(struct block_sync_config));
+
+	http_client_get_config_defaults(&httpc_conf);
+	httpc_conf.port = config->port;
+	httpc_conf.tls = config->tls;
+	httpc_conf.timer_inst = config->timer_inst;
+	httpc_conf.recv_buffer = config->recv_buffer;
+	httpc_conf.recv_buffer_size = config->recv_buffer_size;
+	ret = http_client_init(&module->http, &httpc_conf);
+	if (ret < 0) {
+		return ret;
+	}
+	http_client_register_callback(&module->http, _block_sync_http_callback);
+
+	module->state = STATE_IDLE;
+
+	return 0;
+}
+
+int block_sync_deinit(struct block_sync_module *const module)
+{
+	if (module == NULL) {
+		return -EINVAL;
+	}
+
+	if (module->tables != NULL) {
+		free(module->tables);
+	}
+	if (module->window != NULL) {
+		free(module->window);
+	}
+	http_client_unregister_callback(&module->http);
+	http_client_close(&module->http);
+	http_client_deinit(&module->http);
+
+	memset(module, 0, sizeof(struct block_sync_module));
+
+	return 0;
+}
+
+int block_sync_register_callback(struct block_sync_module *const module, block_sync_callback_t callback)
+{
+	if (module == NULL) {
+		return -EINVAL;
+	}
+
+	module->cb = callback;
+
+	return 0;
+}
+
+int block_sync_start(struct block_sync_module *const module, const char *url, const char *control_url, uint32_t old_size)
+{
+	int ret;
+
+	if (module == NULL || url == NULL || control_url == NULL) {
+		return -EINVAL;
+	}
+
+	if (module->state != STATE_IDLE) {
+		return -EBUSY;
+	}
+
+	module->url = url;
+	module->old_size = old_size;
+	module->control_length = 0;
+	module->nb_block = 0;
+
+	ret = http_client_send_request(&module->http, control_url, HTTP_METHOD_GET, NULL, NULL);
+	if (ret < 0) {
+		return ret;
+	}
+	module->close_pending = 0;
+	module->requesting = 1;
+	module->state = STATE_CONTROL;
+
+	return 0;
+}
+
+void block_sync_abort(struct block_sync_module *const module)
+{
+	if (module != NULL && module->state != STATE_IDLE) {
+		_block_sync_complete(module, -ECANCELED);
+	}
+}
+
+void block_sync_task(struct block_sync_module *const module)
+{
+	if (module->close_pending) {
+		module->close_pending = 0;
+		http_client_close(&module->http);
+	}
+
+	switch (module->state) {
+	case STATE_SEARCH:
+		_block_sync_search(module);
+		break;
+
+	case STATE_FETCH:
+		if (!module->requesting) {
+			_block_sync_request(module);
+		}
+		break;
+
+	default:
+		break;
+	}
+}
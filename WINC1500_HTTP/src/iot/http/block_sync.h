@@ -0,0 +1,355 @@
+/**
+ * \file
+ *
+ * \brief Block synchronization of an image over HTTP (zsync-like).
+ *
+ * The server publishes, next to the image, a small control file holding a
+ * rolling checksum and a truncated SHA-256 of every block of the image.
+ * The client searches the image it already has for these blocks at any byte
+ * offset, then fetches the blocks it did not find with HTTP range requests.
+ * The new image is assembled from both sources in one sequential pass and
+ * checked against the SHA-256 of the whole image.
+ *
+ * Control file layout, multi-byte values in little endian:
+ * - struct block_sync_header.
+ * - For every block of the image, the last block padded with zeros:
+ *   - weak_length bytes of the rolling checksum, most significant byte first,
+ *     keeping the low bytes of ((a << 16) | b) where a is the sum of the bytes
+ *     of the block and b the sum of the bytes weighted by block_size - index,
+ *     both modulo 2^16 (rsync checksum).
+ *   - strong_length first bytes of the SHA-256 of the block.
+ *
+ */
+
+#ifndef BLOCK_SYNC_H_INCLUDED
+#define BLOCK_SYNC_H_INCLUDED
+
+#include <stdint.h>
+#include <compiler.h>
+#include "iot/http/http_client.h"
+#include "iot/sha256.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Magic of the control file ("BSYN"). */
+#define BLOCK_SYNC_MAGIC                0x4E595342
+/** Format version of the control file. */
+#define BLOCK_SYNC_VERSION              1
+/** Smallest block size (log2). */
+#define BLOCK_SYNC_MIN_BLOCK_SHIFT      8
+/** Largest block size (log2). */
+#define BLOCK_SYNC_MAX_BLOCK_SHIFT      12
+/** Source of a block that was not found in the current image. */
+#define BLOCK_SYNC_FETCH                0xFFFFFFFF
+/** Bytes of the current image read at once while the search window slides. */
+#define BLOCK_SYNC_READ_AHEAD           64
+
+/**
+ * \brief Header of the control file.
+ */
+COMPILER_PACK_SET(1)
+struct block_sync_header {
+	/** Shall be \ref BLOCK_SYNC_MAGIC. */
+	uint32_t magic;
+	/** Shall be \ref BLOCK_SYNC_VERSION. */
+	uint8_t version;
+	/** Size of a block (log2), from BLOCK_SYNC_MIN_BLOCK_SHIFT to BLOCK_SYNC_MAX_BLOCK_SHIFT. */
+	uint8_t block_shift;
+	/** Bytes of rolling checksum per block, from 2 to 4. */
+	uint8_t weak_length;
+	/** Bytes of SHA-256 per block, from 4 to 32. */
+	uint8_t strong_length;
+	/** Size of the image in bytes. */
+	uint32_t size;
+	/** SHA-256 of the whole image. */
+	uint8_t digest[SHA256_DIGEST_LENGTH];
+};
+COMPILER_PACK_RESET()
+
+/**
+ * \brief A type of block synchronization callback.
+ */
+enum block_sync_callback_type {
+	/**
+	 * The current image was searched. Reports what will be downloaded.
+	 * \ref block_sync_abort may be called from this callback.
+	 */
+	BLOCK_SYNC_CALLBACK_MATCHED,
+	/** The synchronization is over. */
+	BLOCK_SYNC_CALLBACK_COMPLETED,
+};
+
+/**
+ * \brief Structure of the BLOCK_SYNC_CALLBACK_MATCHED callback.
+ */
+struct block_sync_data_matched {
+	/** Size of the new image. */
+	uint32_t size;
+	/** Number of blocks of the new image. */
+	uint32_t nb_block;
+	/** Number of blocks found in the current image. */
+	uint32_t nb_reused;
+	/** Number of bytes to be downloaded. */
+	uint32_t fetch_length;
+	/** A flag for every block was found at its own place in an image of the same size. */
+	uint8_t unchanged;
+};
+
+/**
+ * \brief Structure of the BLOCK_SYNC_CALLBACK_COMPLETED callback.
+ */
+struct block_sync_data_completed {
+	/**
+	 * Result of the synchronization.
+	 *
+	 * \return     0               The new image was written and verified.
+	 * \return     -ECANCELED      Aborted by \ref block_sync_abort.
+	 * \return     -EPROTO         Control file is invalid or unsupported.
+	 * \return     -EFBIG          Image has more blocks than max_block.
+	 * \return     -ENOMEM         Out of memory.
+	 * \return     -EIO            Reading or writing an image failed.
+	 * \return     -EBADMSG        Response does not match the ranges, or digest mismatch.
+	 * \return     -ENOENT         Server did not answer 200 or 206.
+	 * \return     otherwise       Disconnect reason of the HTTP client.
+	 */
+	int reason;
+};
+
+/**
+ * \brief Structure of the block synchronization callback.
+ */
+union block_sync_data {
+	struct block_sync_data_matched matched;
+	struct block_sync_data_completed completed;
+};
+
+/* Before declaring for the callback type. */
+struct block_sync_module;
+/**
+ * \brief Callback interface of block synchronization.
+ *
+ * \param[in]  module_inst     Module instance of block synchronization.
+ * \param[in]  type            Type of event.
+ * \param[in]  data            Data structure of the event. \refer block_sync_data
+ */
+typedef void (*block_sync_callback_t)(struct block_sync_module *module_inst, int type, union block_sync_data *data);
+
+/**
+ * \brief Block synchronization configuration structure
+ *
+ * Configuration struct for a block synchronization instance. This structure should be
+ * initialized by the \ref block_sync_get_config_defaults function before being
+ * modified by the user application.
+ */
+struct block_sync_config {
+	/**
+	 * TCP port number of the server.
+	 * Default value is 80.
+	 */
+	uint16_t port;
+	/**
+	 * A flag for the whether using the TLS socket or not.
+	 * Default value is 0.
+	 */
+	uint8_t tls;
+	/**
+	 * Timer module for the request timeout.
+	 * Default value is NULL.
+	 */
+	struct sw_timer_module *timer_inst;
+	/**
+	 * Rx buffer of the HTTP client.
+	 * Default value is NULL.
+	 */
+	char *recv_buffer;
+	/**
+	 * Maximum size of the receive buffer.
+	 * Default value is 1446.
+	 */
+	uint32_t recv_buffer_size;
+	/**
+	 * Largest number of blocks of an image. The block tables take about
+	 * 12 bytes plus strong_length per block in the heap, and the search
+	 * window one block.
+	 * Default value is 512.
+	 */
+	uint16_t max_block;
+	/**
+	 * Bytes of the current image searched by one call of \ref block_sync_task.
+	 * Default value is 2048.
+	 */
+	uint32_t search_budget;
+	/**
+	 * Read the current image. The image is followed by zeros.
+	 *
+	 * \return Number of bytes read, less than length at the end of the image. Negative on error.
+	 */
+	int (*read)(void *priv_data, uint32_t offset, void *buffer, uint32_t length);
+	/**
+	 * Append data to the new image.
+	 *
+	 * \return 0 if succeeded, negative on error.
+	 */
+	int (*write)(void *priv_data, const void *data, uint32_t length);
+	/**
+	 * Private data of the read and write functions.
+	 * Default value is NULL.
+	 */
+	void *priv_data;
+};
+
+/**
+ * \brief Structure of block synchronization instance.
+ */
+struct block_sync_module {
+	/** HTTP client fetching the control file and the blocks. */
+	struct http_client_module http;
+
+	/** State of the synchronization. */
+	uint8_t state;
+	/** A flag for a request in progress. */
+	uint8_t requesting      : 1;
+	/** A flag for the search window to be loaded again. */
+	uint8_t refill          : 1;
+	/** A flag for the HTTP connection to be closed by \ref block_sync_task. */
+	uint8_t close_pending   : 1;
+
+	/** URL of the image. It must stay valid until the synchronization completes. */
+	const char *url;
+	/** Size of the current image. */
+	uint32_t old_size;
+
+	/** Header of the control file. */
+	struct block_sync_header header;
+	/** Number of blocks of the new image. */
+	uint32_t nb_block;
+	/** Bytes of the control file received. */
+	uint32_t control_length;
+
+	/** Rolling checksum of the window, a and b sums. */
+	uint16_t sum_a, sum_b;
+	/** Offset of the window in the current image. */
+	uint32_t search_offset;
+	/** Bytes following the window. */
+	uint8_t ahead[BLOCK_SYNC_READ_AHEAD];
+	/** Offset in the current image of the next read ahead. */
+	uint32_t ahead_offset;
+	/** Bytes read ahead, and bytes already moved in the window. */
+	uint16_t ahead_length, ahead_pos;
+
+	/** Block tables, allocated in one piece. */
+	uint8_t *tables;
+	/** Rolling checksum of each block, masked. */
+	uint32_t *weak;
+	/** Offset in the current image of each block, or BLOCK_SYNC_FETCH. */
+	uint32_t *source;
+	/** Next block of the same hash bucket. */
+	uint16_t *next;
+	/** First block of each hash bucket. */
+	uint16_t *bucket;
+	/** Truncated SHA-256 of each block. */
+	uint8_t *strong;
+	/** Number of hash buckets minus one. */
+	uint16_t bucket_mask;
+
+	/** Window of the search, then copy buffer. One block. */
+	uint8_t *window;
+
+	/** Next block to be requested. */
+	uint32_t fetch_block;
+	/** Bytes of the new image written. */
+	uint32_t written;
+	/** SHA-256 of the new image. */
+	struct sha256_context digest;
+
+	/** Callback interface entry. */
+	block_sync_callback_t cb;
+
+	/** Configuration instance of block synchronization. That was registered from the \ref block_sync_init*/
+	struct block_sync_config config;
+};
+
+/**
+ * \brief Get default configuration of block synchronization.
+ *
+ * \param[in]  config          Pointer of configuration structure which will be used in the module.
+ */
+void block_sync_get_config_defaults(struct block_sync_config *const config);
+
+/**
+ * \brief Initialize block synchronization.
+ *
+ * \param[in]  module          Module instance of block synchronization.
+ * \param[in]  config          Pointer of configuration structure which will be used in the module.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ * \return     -ENOSPC         No timer left.
+ * \return     -ENOMEM         Out of memory.
+ */
+int block_sync_init(struct block_sync_module *const module, struct block_sync_config *config);
+
+/**
+ * \brief Terminate block synchronization.
+ *
+ * \param[in]  module          Module instance of block synchronization.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ */
+int block_sync_deinit(struct block_sync_module *const module);
+
+/**
+ * \brief Register and enable the callback.
+ *
+ * \param[in]  module          Module instance of block synchronization.
+ * \param[in]  callback        Callback entry for block synchronization.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ */
+int block_sync_register_callback(struct block_sync_module *const module, block_sync_callback_t callback);
+
+/**
+ * \brief Start synchronizing the current image with the image on the server.
+ *
+ * The new image is written from its first byte with the write function,
+ * which must not alter the current image. The result is reported by
+ * BLOCK_SYNC_CALLBACK_COMPLETED.
+ *
+ * \param[in]  module          Module instance of block synchronization.
+ * \param[in]  url             URL of the new image. It must stay valid until completion.
+ * \param[in]  control_url     URL of the control file.
+ * \param[in]  old_size        Size of the current image.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ * \return     -EBUSY          Synchronization already running.
+ * \return     otherwise       Error of \ref http_client_send_request.
+ */
+int block_sync_start(struct block_sync_module *const module, const char *url, const char *control_url, uint32_t old_size);
+
+/**
+ * \brief Stop the synchronization. BLOCK_SYNC_CALLBACK_COMPLETED reports -ECANCELED.
+ *
+ * \param[in]  module          Module instance of block synchronization.
+ */
+void block_sync_abort(struct block_sync_module *const module);
+
+/**
+ * \brief Run the search of the current image and send the range requests.
+ *
+ * Must be called from the main loop. Each call searches at most search_budget
+ * bytes so that network events keep being handled.
+ *
+ * \param[in]  module          Module instance of block synchronization.
+ */
+void block_sync_task(struct block_sync_module *const module);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BLOCK_SYNC_H_INCLUDED */
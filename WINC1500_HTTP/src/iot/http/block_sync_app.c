@@ -0,0 +1,184 @@
+/**
+ * \file
+ *
+ * \brief Block synchronization of the image of the HTTP File Downloader Example.
+ *
+ */
+
+#include "main.h"
+
+#ifdef MAIN_HTTP_SYNC_URL
+
+#ifdef MAIN_STORAGE_IMAGE_SLOT
+#error "MAIN_HTTP_SYNC_URL needs the previous image in a FAT file."
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include "asf.h"
+#include "download.h"
+#include "iot/http/block_sync_app.h"
+
+/** Instance of block synchronization updating the image on the card. */
+struct block_sync_module block_sync_inst;
+/** Previous image, read by the block synchronization. */
+static FIL sync_file_object;
+/** Temporary file of the image being assembled. */
+static char sync_file_name[] = "0:" MAIN_SYNC_FILE_NAME;
+/** The image on the card is the same as on the server. */
+static bool sync_up_to_date = false;
+/** The last synchronization failed, download the whole image. */
+static bool sync_failed = false;
+
+/**
+ * \brief Read the previous image for the block synchronization.
+ */
+static int sync_read(void *priv_data, uint32_t offset, void *buffer, uint32_t length)
+{
+	UINT rsize = 0;
+
+	UNUSED(priv_data);
+	if (f_lseek(&sync_file_object, offset) != FR_OK
+			|| f_read(&sync_file_object, buffer, length, &rsize) != FR_OK) {
+		return -EIO;
+	}
+	return (int)rsize;
+}
+
+/**
+ * \brief Append to the image assembled by the block synchronization.
+ */
+static int sync_write(void *priv_data, const void *data, uint32_t length)
+{
+	UNUSED(priv_data);
+	if (!write_file(data, length)) {
+		return -EIO;
+	}
+	return 0;
+}
+
+/**
+ * \brief Update the image on the card with the blocks that changed.
+ * \return true if the synchronization is started, false if the whole image must be downloaded.
+ */
+static bool begin_sync(void)
+{
+	int ret;
+
+	if (!set_file_name() || f_open(&sync_file_object, save_file_name, FA_READ) != FR_OK) {
+		/* No previous image. */
+		return false;
+	}
+	if (f_size(&sync_file_object) == 0) {
+		f_close(&sync_file_object);
+		return false;
+	}
+
+	sync_file_name[0] = LUN_ID_SD_MMC_0_MEM + '0';
+	if (f_open(&file_object, sync_file_name, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) {
+		printf("begin_sync: file creation error!\r\n");
+		f_close(&sync_file_object);
+		return false;
+	}
+
+	printf("begin_sync: updating [%s], %lu bytes.\r\n", save_file_name, (unsigned long)f_size(&sync_file_object));
+	sync_up_to_date = false;
+	ret = block_sync_start(&block_sync_inst, MAIN_HTTP_FILE_URL, MAIN_HTTP_SYNC_URL, f_size(&sync_file_object));
+	if (ret < 0) {
+		printf("begin_sync: block synchronization error! (res %d)\r\n", ret);
+		f_close(&file_object);
+		f_close(&sync_file_object);
+		return false;
+	}
+	add_state(SYNCING);
+	return true;
+}
+
+/**
+ * \brief Callback of the block synchronization.
+ *
+ * \param[in]  module_inst     Module instance of block synchronization.
+ * \param[in]  type            Type of event.
+ * \param[in]  data            Data structure of the event. \refer block_sync_data
+ */
+static void block_sync_callback(struct block_sync_module *module_inst, int type, union block_sync_data *data)
+{
+	switch (type) {
+	case BLOCK_SYNC_CALLBACK_MATCHED:
+		printf("block_sync_callback: %lu of %lu blocks reused, downloading %lu bytes.\r\n",
+				(unsigned long)data->matched.nb_reused, (unsigned long)data->matched.nb_block,
+				(unsigned long)data->matched.fetch_length);
+		if (data->matched.unchanged) {
+			/* Do not rewrite the same image. */
+			sync_up_to_date = true;
+			block_sync_abort(module_inst);
+		}
+		break;
+
+	case BLOCK_SYNC_CALLBACK_COMPLETED:
+		clear_state(SYNCING);
+		f_close(&sync_file_object);
+		close_file(data->completed.reason == 0);
+		if (data->completed.reason == 0) {
+			/* Replace the previous image. */
+			f_unlink(save_file_name);
+			if (f_rename(sync_file_name, &save_file_name[2]) != FR_OK) {
+				printf("block_sync_callback: file rename error!\r\n");
+				add_state(CANCELED);
+				break;
+			}
+			printf("block_sync_callback: image updated successfully.\r\n");
+			add_state(COMPLETED);
+		} else {
+			f_unlink(sync_file_name);
+			if (sync_up_to_date) {
+				printf("block_sync_callback: image is up to date.\r\n");
+				add_state(COMPLETED);
+			} else if (data->completed.reason != -ECANCELED) {
+				printf("block_sync_callback: failed (%d), downloading the whole image.\r\n", data->completed.reason);
+				sync_failed = true;
+				start_download();
+			}
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+void configure_block_sync(void)
+{
+	struct block_sync_config sync_conf;
+	int ret;
+
+	block_sync_get_config_defaults(&sync_conf);
+	sync_conf.timer_inst = &swt_module_inst;
+	sync_conf.recv_buffer_size = MAIN_BUFFER_MAX_SIZE;
+	sync_conf.read = sync_read;
+	sync_conf.write = sync_write;
+
+	ret = block_sync_init(&block_sync_inst, &sync_conf);
+	if (ret < 0) {
+		printf("configure_block_sync: block synchronization initialization failed! (res %d)\r\n", ret);
+		while (1) {
+		} /* Loop forever. */
+	}
+
+	block_sync_register_callback(&block_sync_inst, block_sync_callback);
+}
+
+bool start_sync(void)
+{
+	if (is_state_set(SYNCING)) {
+		printf("start_sync: running block synchronization already.\r\n");
+		return true;
+	}
+	if (!sync_failed && begin_sync()) {
+		return true;
+	}
+	sync_failed = false;
+	return false;
+}
+
+#endif /* MAIN_HTTP_SYNC_URL */
@@ -0,0 +1,43 @@
+/**
+ * \file
+ *
+ * \brief Block synchronization of the image of the HTTP File Downloader Example.
+ *
+ * With MAIN_HTTP_SYNC_URL, the image on the card is updated with the blocks
+ * that changed only, see iot/http/block_sync.h. The new image is assembled in
+ * MAIN_SYNC_FILE_NAME and replaces the previous one once complete.
+ *
+ */
+
+#ifndef BLOCK_SYNC_APP_H_INCLUDED
+#define BLOCK_SYNC_APP_H_INCLUDED
+
+#include <stdbool.h>
+#include "iot/http/block_sync.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Instance of block synchronization updating the image on the card. */
+extern struct block_sync_module block_sync_inst;
+
+/**
+ * \brief Configure the block synchronization.
+ */
+void configure_block_sync(void);
+
+/**
+ * \brief Update the image on the card with the blocks that changed.
+ *
+ * After a failed synchronization, the next call lets the whole image be
+ * downloaded.
+ * \return true if the synchronization is running, false if the whole image must be downloaded.
+ */
+bool start_sync(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BLOCK_SYNC_APP_H_INCLUDED */
@@ -37,6 +37,9 @@
 #include "iot/stream_writer.h"
 #include <stdio.h>
 #include <errno.h>
+#include <stdlib.h>
+#include <strings.h>
+#include "conf_ramfunc.h"
 
 #define DEFAULT_USER_AGENT "atmel/1.0.2"
 
@@ -55,6 +58,49 @@ enum http_client_resp_state {
 	STATE_PARSE_ENTITY,
 };
 
+/** Longest boundary allowed by RFC 2046. */
+#define HTTP_MAX_BOUNDARY_LENGTH 70
+/** Longest line kept by the multipart parser. The delimiter line always fits. */
+#define HTTP_MULTIPART_LINE_SIZE 80
+/** Length of a range of a 200 response without Content-Length. */
+#define HTTP_PART_UNKNOWN_LENGTH 0xFFFFFFFF
+/** Values of read_length in chunked transfer coding, besides the data left in the chunk. */
+#define HTTP_CHUNK_SIZE_LINE     (-1)
+/** The new line closing the data of a chunk is awaited. */
+#define HTTP_CHUNK_DATA_END      (-2)
+/** The trailer after the last chunk is skipped, up to an empty line. */
+#define HTTP_CHUNK_TRAILER       (-3)
+
+enum http_client_multipart_state {
+	/** Looking for the next delimiter line. */
+	STATE_MULTIPART_DELIMITER,
+	/** Reading the header of a part. */
+	STATE_MULTIPART_HEADER,
+	/** Delivering the body of a part. */
+	STATE_MULTIPART_BODY,
+	/** Close delimiter was found. */
+	STATE_MULTIPART_EPILOGUE,
+};
+
+/**
+ * \brief State of the multipart/byteranges parser.
+ * Allocated with the boundary when the response announces it.
+ */
+struct http_client_multipart {
+	/** State of the parser. */
+	uint8_t state;
+	/** Length of the line being received. */
+	uint8_t line_len;
+	/** Length of the boundary. */
+	uint8_t boundary_len;
+	/** A flag for the part header had a Content-Range field. */
+	uint8_t has_range;
+	/** Line being received, without the new line characters. */
+	char line[HTTP_MULTIPART_LINE_SIZE];
+	/** Boundary of the parts. */
+	char boundary[];
+};
+
 /**
  * \brief Sending the packet in blocking mode.
  *
@@ -122,6 +168,52 @@ int _http_client_handle_entity(struct http_client_module *const module);
  */
 void _http_client_move_buffer(struct http_client_module *const module, char *base);
 
+/**
+ * \brief Give the socket away after a 101 response to an upgrade request.
+ *
+ * \param[in]  module          Module instance of HTTP.
+ */
+void _http_client_upgraded(struct http_client_module *const module);
+
+/**
+ * \brief Deliver a piece of entity of the current response.
+ *
+ * \param[in]  module          Module instance of HTTP.
+ * \param[in]  data            Piece of entity.
+ * \param[in]  length          Length of the piece.
+ * \param[in]  is_complete     A flag for the last piece of the entity.
+ *
+ * \return     0               Function success.
+ * \return     otherwise       The entity is invalid. Connection must be cleared.
+ */
+static int _http_client_entity_data(struct http_client_module *const module, char *data, uint32_t length, int is_complete);
+
+/**
+ * \brief Split a ranged entity into HTTP_CLIENT_CALLBACK_RECV_PART callbacks.
+ *
+ * \param[in]  module          Module instance of HTTP.
+ * \param[in]  data            Piece of entity.
+ * \param[in]  length          Length of the piece.
+ * \param[in]  is_complete     A flag for the last piece of the entity.
+ *
+ * \return     0               Function success.
+ * \return     -EBADMSG        Entity does not match the response header.
+ */
+static int _http_client_read_ranges(struct http_client_module *const module, char *data, uint32_t length, int is_complete);
+
+/**
+ * \brief Release the multipart parser of the response.
+ *
+ * \param[in]  module          Module instance of HTTP.
+ */
+static void _http_client_free_multipart(struct http_client_module *const module);
+
+/**
+ * \brief Send the request with an optional Upgrade header.
+ */
+static int _http_client_send_request(struct http_client_module *const module, const char *url,
+	enum http_method method, struct http_entity *const entity, const char *ext_header, const char *upgrade);
+
 /**
  * \brief Timer callback entry of HTTP client.
  *
@@ -148,6 +240,8 @@ void http_client_get_config_defaults(struct http_client_config *const config)
 	config->recv_buffer_size = 256;
 	config->send_buffer_size = MIN_SEND_BUFFER_SIZE;
 	config->user_agent = DEFAULT_USER_AGENT;
+	config->recv_min_delivery = 0;
+	config->recv_delivery_timeout = 100;
 }
 
 int http_client_init(struct http_client_module *const module, struct http_client_config *config)
@@ -169,6 +263,10 @@ int http_client_init(struct http_client_module *const module, struct http_client
 		return -EINVAL;
 	}
 
+	if (config->recv_min_delivery > config->recv_buffer_size) {
+		return -EINVAL;
+	}
+
 	memset(module, 0, sizeof(struct http_client_module));
 	memcpy(&module->config, config, sizeof(struct http_client_config));
 
@@ -181,7 +279,7 @@ int http_client_init(struct http_client_module *const module, struct http_client
 		module->alloc_buffer = 1;
 	}
 
-	if (config->timeout > 0) {
+	if (config->timeout > 0 || (config->recv_min_delivery > 1 && config->recv_delivery_timeout > 0)) {
 		/* Enable the timer. */
 		module->timer_id = sw_timer_register_callback(config->timer_inst, http_client_timer_callback, (void *)module, 0);
 
@@ -211,6 +309,8 @@ int http_client_deinit(struct http_client_module *const module)
 		free(module->req.ext_header);
 	}
 
+	_http_client_free_multipart(module);
+
 	memset(module, 0, sizeof(struct http_client_module));
 
 	return 0;
@@ -240,6 +340,45 @@ int http_client_unregister_callback(struct http_client_module *const module)
 	return 0;
 }
 
+int http_client_pause_recv(struct http_client_module *const module)
+{
+	/* Checks the parameters. */
+	if (module == NULL) {
+		return -EINVAL;
+	}
+
+	module->recv_paused = 1;
+
+	return 0;
+}
+
+int http_client_resume_recv(struct http_client_module *const module)
+{
+	/* Checks the parameters. */
+	if (module == NULL) {
+		return -EINVAL;
+	}
+
+	if (module->recv_paused == 0) {
+		return 0;
+	}
+	module->recv_paused = 0;
+
+	if (module->req.state < STATE_SOCK_CONNECTED || module_ref_inst[module->sock] != module) {
+		/* Nothing to resume. */
+		return 0;
+	}
+
+	/* First deliver what was held in the receive buffer. */
+	if (module->recved_size > 0) {
+		while(module->recv_paused == 0 && _http_client_handle_response(module) != 0);
+	}
+	if (module->recv_paused == 0 && module_ref_inst[module->sock] == module) {
+		_http_client_recv_packet(module);
+	}
+
+	return 0;
+}
 
 /**
  * \brief change HW error type to standard error.
@@ -315,6 +454,11 @@ void http_client_socket_event_handler(SOCKET sock, uint8_t msg_type, void *msg_d
     	break;
 	case SOCKET_MSG_RECV:
     	msg_recv = (tstrSocketRecvMsg*)msg_data;
+		/* The socket drops its pending receive with the packet; a recv() given
+		 * before its last piece only moves the buffer for the rest of it. */
+		module->receiving = 0;
+		/* The rest of the packet goes to the buffer given by the next recv(), or else by the last one. */
+		module->recv_remain = (msg_recv->s16BufferSize > 0) ? msg_recv->u16RemainingSize : 0;
     	/* Start post processing. */
     	if (msg_recv->s16BufferSize > 0) {
     		_http_client_recved_packet(module, msg_recv->s16BufferSize);
@@ -322,8 +466,10 @@ void http_client_socket_event_handler(SOCKET sock, uint8_t msg_type, void *msg_d
 			/* Socket was occurred errors. Close this session. */
 			_http_client_clear_conn(module, _hwerr_to_stderr(msg_recv->s16BufferSize));
 		}
-		/* COntinue to receive the packet. */
-		_http_client_recv_packet(module);
+		/* COntinue to receive the packet, unless the socket was closed or given away or the reception paused. */
+		if (module_ref_inst[sock] == module) {
+			_http_client_recv_packet(module);
+		}
 		break;
 	case SOCKET_MSG_SEND:
 		send_ret = *(int16_t*)msg_data;
@@ -376,6 +522,19 @@ void http_client_timer_callback(struct sw_timer_module *const module, int timer_
 		return;
 	}
 
+	if (module_inst->recv_held) {
+		/* The stream stalled: deliver the data gathered for recv_min_delivery. */
+		module_inst->recv_held = 0;
+		module_inst->recv_flush = 1;
+		while(module_inst->recv_paused == 0 && _http_client_handle_response(module_inst) != 0);
+		module_inst->recv_flush = 0;
+		if (module_inst->receiving && module_ref_inst[module_inst->sock] == module_inst) {
+			/* The data left moved to the front, the pending receive must write after it. */
+			_http_client_recv_packet(module_inst);
+		}
+		return;
+	}
+
 	_http_client_clear_conn(module_inst, -ETIME);
 }
 
@@ -401,6 +560,66 @@ static int _is_ip(const char *host)
 
 int http_client_send_request(struct http_client_module *const module, const char *url,
 	enum http_method method, struct http_entity *const entity, const char *ext_header)
+{
+	return _http_client_send_request(module, url, method, entity, ext_header, NULL);
+}
+
+int http_client_send_upgrade(struct http_client_module *const module, const char *url,
+	const char *protocol, const char *ext_header)
+{
+	if (protocol == NULL) {
+		return -EINVAL;
+	}
+
+	return _http_client_send_request(module, url, HTTP_METHOD_GET, NULL, ext_header, protocol);
+}
+
+int http_client_send_ranges(struct http_client_module *const module, const char *url,
+	const struct http_client_range *ranges, int count, const char *ext_header)
+{
+	char *header, *ptr;
+	int i, result;
+	/* "Range: bytes=" + "{first}-{last}," per range + "\r\n" */
+	size_t size = strlen("Range: bytes=") + count * 22 + 3;
+
+	if (module == NULL || ranges == NULL || count <= 0 || count > HTTP_MAX_RANGES) {
+		return -EINVAL;
+	}
+
+	if (ext_header != NULL) {
+		size += strlen(ext_header);
+	}
+	header = malloc(size);
+	if (header == NULL) {
+		return -ENOMEM;
+	}
+
+	ptr = header + sprintf(header, "Range: bytes=");
+	for (i = 0; i < count; i++) {
+		if (ranges[i].length == 0) {
+			ptr += sprintf(ptr, "%lu-,", (unsigned long)ranges[i].offset);
+		} else {
+			ptr += sprintf(ptr, "%lu-%lu,", (unsigned long)ranges[i].offset,
+				(unsigned long)(ranges[i].offset + ranges[i].length - 1));
+		}
+	}
+	/* Replace the last comma. */
+	strcpy(ptr - 1, "\r\n");
+	if (ext_header != NULL) {
+		strcat(ptr, ext_header);
+	}
+
+	result = _http_client_send_request(module, url, HTTP_METHOD_GET, NULL, header, NULL);
+	free(header);
+	if (result == 0) {
+		module->ranges = 1;
+	}
+
+	return result;
+}
+
+static int _http_client_send_request(struct http_client_module *const module, const char *url,
+	enum http_method method, struct http_entity *const entity, const char *ext_header, const char *upgrade)
 {
 	uint8_t flag = 0;
 	struct sockaddr_in addr_in;
@@ -452,6 +671,10 @@ int http_client_send_request(struct http_client_module *const module, const char
 
 	module->sending = 0;
 	module->recved_size = 0;
+	if (module->receiving) {
+		/* The pending receive must write at the start of the buffer. */
+		_http_client_recv_packet(module);
+	}
 	if (uri[0] == '/') {
 		strcpy(module->req.uri, uri);
 		} else {
@@ -468,6 +691,8 @@ int http_client_send_request(struct http_client_module *const module, const char
 	}
 
 	module->req.method = method;
+	module->upgrade = upgrade;
+	module->ranges = 0;
 	
 	switch (module->req.state) {
 	case STATE_TRY_SOCK_CONNECT:
@@ -545,6 +770,7 @@ void _http_client_clear_conn(struct http_client_module *const module, int reason
 	}
 
 	module_ref_inst[module->sock] = NULL;
+	_http_client_free_multipart(module);
 	memset(&module->req, 0, sizeof(struct http_client_req));
 	memset(&module->resp, 0, sizeof(struct http_client_resp));
 	module->req.state = STATE_INIT;
@@ -552,6 +778,10 @@ void _http_client_clear_conn(struct http_client_module *const module, int reason
 
 	module->sending = 0;
 	module->permanent = 0;
+	module->recv_paused = 0;
+	module->receiving = 0;
+	module->recv_remain = 0;
+	module->recv_held = 0;
 	data.disconnected.reason = reason;
 	if (module->cb) {
 		module->cb(module, HTTP_CLIENT_CALLBACK_DISCONNECTED, &data);
@@ -636,8 +866,16 @@ void _http_client_request(struct http_client_module *const module)
 		stream_writer_send_buffer(&writer, "Host: ", strlen("Host: "));
 		stream_writer_send_buffer(&writer, module->host, strlen(module->host));
 		stream_writer_send_buffer(&writer, "\r\n", strlen("\r\n"));
-		/* It supported persistent connection. */
-		stream_writer_send_buffer(&writer, "Connection: Keep-Alive\r\n", strlen("Connection: Keep-Alive\r\n"));
+		if (module->upgrade != NULL) {
+			/* Ask the server to switch protocols on this connection. */
+			stream_writer_send_buffer(&writer, "Connection: Upgrade\r\n", strlen("Connection: Upgrade\r\n"));
+			stream_writer_send_buffer(&writer, "Upgrade: ", strlen("Upgrade: "));
+			stream_writer_send_buffer(&writer, (char *)module->upgrade, strlen(module->upgrade));
+			stream_writer_send_buffer(&writer, "\r\n", strlen("\r\n"));
+		} else {
+			/* It supported persistent connection. */
+			stream_writer_send_buffer(&writer, "Connection: Keep-Alive\r\n", strlen("Connection: Keep-Alive\r\n"));
+		}
 		/* Notify supported encoding type and character set. */
 		stream_writer_send_buffer(&writer, "Accept-Encoding: \r\n", strlen("Accept-Encoding: \r\n"));
 		stream_writer_send_buffer(&writer, "Accept-Charset: utf-8\r\n", strlen("Accept-Charset: utf-8\r\n"));
@@ -765,38 +1003,63 @@ void _http_client_request(struct http_client_module *const module)
 	}
 }
 
+/**
+ * \brief Check whether the received data may be handled.
+ *
+ * The pause holds the data, but for data still to come from the socket that
+ * would not fit in the receive buffer.
+ */
+static inline int _http_client_may_deliver(struct http_client_module *const module)
+{
+	return module->recv_paused == 0
+			|| ((module->recv_remain > 0 || module->receiving)
+				&& module->recved_size >= module->config.recv_buffer_size);
+}
+
 void _http_client_recv_packet(struct http_client_module *const module)
 {
 	if (module == NULL) {
 		return;
 	}
 	
+	if (module->recv_paused && module->receiving == 0 && module->recv_remain == 0) {
+		/* The application holds the sender, from the end of the packet. */
+		return;
+	}
+
 	if (module->recved_size >= module->config.recv_buffer_size) {
 		/* Has not enough memory. */
 		_http_client_clear_conn(module, -EOVERFLOW);
 		return;
 	}
-	
+
 	/* Executing read until receiving operation is started. */
 	/*
 	while (recv(module->sock,
 		module->config.recv_buffer + module->recved_size,
 		module->config.recv_buffer_size - module->recved_size, 0) != 0);
 	*/
-	recv(module->sock,
+	/* The socket writes the next data after the data left in the buffer. When
+	 * a receive is pending already, this only moves its buffer, so it must be
+	 * called again each time the data left is moved. */
+	if (recv(module->sock,
 		module->config.recv_buffer + module->recved_size,
-		module->config.recv_buffer_size - module->recved_size, 0);
+		module->config.recv_buffer_size - module->recved_size, 0) == SOCK_ERR_NO_ERROR
+			&& module->recv_remain == 0) {
+		module->receiving = 1;
+	}
 }
 
 void _http_client_recved_packet(struct http_client_module *const module, int read_len)
 {
 	module->recved_size += read_len;
-	if (module->config.timeout > 0) {
+	if (module->config.timeout > 0 || module->recv_held) {
 		sw_timer_disable_callback(module->config.timer_inst, module->timer_id);
+		module->recv_held = 0;
 	}
 
 	/* Recursive function call can be occurred overflow. */
-	while(_http_client_handle_response(module) != 0);
+	while(_http_client_may_deliver(module) && _http_client_handle_response(module) != 0);
 }
 
 int _http_client_handle_response(struct http_client_module *const module)
@@ -810,19 +1073,126 @@ int _http_client_handle_response(struct http_client_module *const module)
 	return 0;
 }
 
+/**
+ * \brief Parse the value of a Content-Range field: "bytes {first}-{last}/{total}".
+ *
+ * \return     0               Function success.
+ * \return     -EBADMSG        Malformed or unsatisfied range.
+ */
+static int _http_client_parse_content_range(const char *value, uint32_t *offset, uint32_t *length, uint32_t *total)
+{
+	char *end;
+	uint32_t first, last;
+
+	for (; *value == ' '; value++);
+	if (strncasecmp(value, "bytes ", strlen("bytes "))) {
+		return -EBADMSG;
+	}
+	value += strlen("bytes ");
+	first = strtoul(value, &end, 10);
+	if (end == value || *end != '-') {
+		return -EBADMSG;
+	}
+	value = end + 1;
+	last = strtoul(value, &end, 10);
+	if (end == value || last < first) {
+		return -EBADMSG;
+	}
+	*offset = first;
+	*length = last - first + 1;
+	/* Complete length is "*" if unknown. */
+	*total = (*end == '/') ? strtoul(end + 1, NULL, 10) : 0;
+
+	return 0;
+}
+
+/**
+ * \brief Allocate the multipart parser from the value of a Content-Type field.
+ * Other media types are ignored.
+ *
+ * \return     0               Function success.
+ * \return     -EBADMSG        Boundary is missing or too long.
+ * \return     -ENOMEM         Out of memory.
+ */
+static int _http_client_parse_content_type(struct http_client_module *const module, const char *value, const char *end)
+{
+	const char *boundary;
+	size_t length;
+	struct http_client_multipart *multipart;
+
+	for (; *value == ' '; value++);
+	if (strncasecmp(value, "multipart/byteranges", strlen("multipart/byteranges"))) {
+		return 0;
+	}
+
+	for (boundary = value; boundary < end; boundary++) {
+		if (!strncasecmp(boundary, "boundary=", strlen("boundary="))) {
+			break;
+		}
+	}
+	if (boundary >= end) {
+		return -EBADMSG;
+	}
+	boundary += strlen("boundary=");
+	if (*boundary == '"') {
+		boundary++;
+	}
+	for (length = 0; boundary + length < end; length++) {
+		if (boundary[length] == '"' || boundary[length] == ';') {
+			break;
+		}
+	}
+	for (; length > 0 && boundary[length - 1] == ' '; length--);
+	if (length == 0 || length > HTTP_MAX_BOUNDARY_LENGTH) {
+		return -EBADMSG;
+	}
+
+	_http_client_free_multipart(module);
+	multipart = malloc(sizeof(struct http_client_multipart) + length + 1);
+	if (multipart == NULL) {
+		return -ENOMEM;
+	}
+	multipart->state = STATE_MULTIPART_DELIMITER;
+	multipart->line_len = 0;
+	multipart->has_range = 0;
+	multipart->boundary_len = (uint8_t)length;
+	memcpy(multipart->boundary, boundary, length);
+	multipart->boundary[length] = '\0';
+	module->resp.multipart = multipart;
+
+	return 0;
+}
+
+/**
+ * \brief Find the new line ending a line of the header, within the received data.
+ * The receive buffer is not terminated, so strstr() could pass its end.
+ *
+ * \return     Start of the new line, or NULL if not received yet.
+ */
+static char *_http_client_find_new_line(char *ptr, char *end)
+{
+	for (; ptr + 1 < end; ptr++) {
+		if (ptr[0] == '\r' && ptr[1] == '\n') {
+			return ptr;
+		}
+	}
+	return NULL;
+}
+
 int _http_client_handle_header(struct http_client_module *const module)
 {
 	char *ptr_line_end, *ptr;
 	union http_client_data data;
+	int result;
 	/* New line character only used in this function. So variable registered in the code region. */
 	static const char *new_line = "\r\n";
 
 	//TODO : header filter
 
 	for (ptr = module->config.recv_buffer ; ; ) {
-		ptr_line_end = strstr(ptr, new_line);
-		if (ptr_line_end == NULL || ptr_line_end >= module->config.recv_buffer + module->recved_size) {
-			/* not enough buffer. */
+		ptr_line_end = _http_client_find_new_line(ptr, module->config.recv_buffer + module->recved_size);
+		if (ptr_line_end == NULL || ptr_line_end + strlen(new_line) > module->config.recv_buffer + module->recved_size) {
+			/* not enough buffer. The '\n' may not be received yet. */
 			_http_client_move_buffer(module, ptr);
 			return 0;
 		}
@@ -830,14 +1200,56 @@ int _http_client_handle_header(struct http_client_module *const module)
 		if (!strncmp(ptr, new_line, strlen(new_line))) {
 			/* Move remain data to forward part of buffer. */
 			_http_client_move_buffer(module, ptr + strlen(new_line));
+			module->resp.chunk_held = 0;
 
+			if (module->upgrade != NULL && module->resp.response_code == 101) {
+				/* Everything after this header belongs to the new protocol. */
+				_http_client_upgraded(module);
+				return 0;
+			}
+
+			if (module->ranges && module->resp.response_code == 206) {
+				/* Either every part carries its range, or the header carried the only one. */
+				if (module->resp.multipart == NULL && module->resp.part_remain == 0) {
+					_http_client_clear_conn(module, -EBADMSG);
+					return 0;
+				}
+				module->resp.ranged = 1;
+			} else if (module->ranges && module->resp.response_code == 200) {
+				/* Server ignored the Range header. Whole resource is one range. */
+				_http_client_free_multipart(module);
+				module->resp.part_offset = 0;
+				module->resp.part_remain = (module->resp.content_length < 0) ?
+					HTTP_PART_UNKNOWN_LENGTH : (uint32_t)module->resp.content_length;
+				module->resp.total_length = (module->resp.content_length < 0) ? 0 : (uint32_t)module->resp.content_length;
+				module->resp.ranged = 1;
+			} else {
+				_http_client_free_multipart(module);
+			}
+
+			if (module->resp.ranged) {
+				/* Pieces are sent with their offsets. Only announce the response. */
+				module->resp.read_length = (module->resp.content_length < 0) ? HTTP_CHUNK_SIZE_LINE : 0;
+				if (module->cb) {
+					data.recv_response.response_code = module->resp.response_code;
+					data.recv_response.is_chunked = (module->resp.content_length < 0);
+					data.recv_response.content_length = module->resp.content_length;
+					data.recv_response.content = NULL;
+					module->cb(module, HTTP_CLIENT_CALLBACK_RECV_RESPONSE, &data);
+				}
+				module->resp.state = STATE_PARSE_ENTITY;
+				return 1;
+			}
+
+			if (module->resp.content_length < 0) {
+				module->resp.read_length = HTTP_CHUNK_SIZE_LINE;
+			}
 			/* Check validation first. */
 			if (module->cb && module->resp.response_code) {
 				/* Chunked transfer */
 				if (module->resp.content_length < 0) {
 					data.recv_response.response_code = module->resp.response_code;
 					data.recv_response.is_chunked = 1;
-					module->resp.read_length = 0;
 					data.recv_response.content = NULL;
 					module->cb(module, HTTP_CLIENT_CALLBACK_RECV_RESPONSE, &data);
 				} else if (module->resp.content_length > (int)module->config.recv_buffer_size) {
@@ -862,7 +1274,7 @@ int _http_client_handle_header(struct http_client_module *const module)
 					continue;
 				} else if (*type_ptr == 'C' || *type_ptr == 'c') {
 					/* Chunked transfer */
-					module->req.content_length = -1;
+					module->resp.content_length = -1;
 				} else {
 					_http_client_clear_conn(module, -ENOTSUP);
 					return 0;
@@ -881,10 +1293,27 @@ int _http_client_handle_header(struct http_client_module *const module)
 				}
 				break;
 			}
+		} else if (module->ranges && !strncasecmp(ptr, "Content-Type:", strlen("Content-Type:"))) {
+			result = _http_client_parse_content_type(module, ptr + strlen("Content-Type:"), ptr_line_end);
+			if (result < 0) {
+				_http_client_clear_conn(module, result);
+				return 0;
+			}
+		} else if (module->ranges && !strncasecmp(ptr, "Content-Range:", strlen("Content-Range:"))) {
+			if (_http_client_parse_content_range(ptr + strlen("Content-Range:"), &module->resp.part_offset,
+					&module->resp.part_remain, &module->resp.total_length) < 0) {
+				_http_client_clear_conn(module, -EBADMSG);
+				return 0;
+			}
 		} else if (!strncmp(ptr, "HTTP/", 5)) {
 			module->resp.response_code = atoi(ptr + 9); /* HTTP/{Ver} {Code} {Desc} : HTTP/1.1 200 OK */
 			/* Initializing the variables */
 			module->resp.content_length = 0;
+			module->resp.ranged = 0;
+			module->resp.part_offset = 0;
+			module->resp.part_remain = 0;
+			module->resp.total_length = 0;
+			_http_client_free_multipart(module);
 			/* persistent connection is turn on in the HTTP 1.1 or above version of protocols. */  
 			if (ptr [5] > '1' || ptr[7] > '0') {
 				module->permanent = 1;
@@ -893,87 +1322,159 @@ int _http_client_handle_header(struct http_client_module *const module)
 			}
 		}
 
+		if (module->cb && module->resp.response_code && strncmp(ptr, "HTTP/", 5)) {
+			/* Hand every header field to the application as "name" and "value" strings. */
+			char *colon = memchr(ptr, ':', ptr_line_end - ptr);
+			if (colon != NULL) {
+				*colon = '\0';
+				*ptr_line_end = '\0';
+				data.recv_header.name = ptr;
+				for (data.recv_header.value = colon + 1; *data.recv_header.value == ' '; data.recv_header.value++);
+				module->cb(module, HTTP_CLIENT_CALLBACK_RECV_HEADER, &data);
+				*colon = ':';
+				*ptr_line_end = '\r';
+			}
+		}
+
 		ptr = ptr_line_end + strlen(new_line);
 	}
 }
 
-static void _http_client_read_chuked_entity(struct http_client_module *const module)
+/**
+ * \brief Keep the received part of the entity until a delivery unit is complete or the stream stalls.
+ */
+static void _http_client_hold_entity(struct http_client_module *const module)
 {
-	/* In chunked mode, read_length variable is means to remain data in the chunk. */
-	union http_client_data data;
-	int length = (int)module->recved_size;
-	int extension = 0;
-	char *buffer= module->config.recv_buffer;
+	if (module->config.recv_delivery_timeout > 0 && module->recv_held == 0) {
+		module->recv_held = 1;
+		sw_timer_enable_callback(module->config.timer_inst, module->timer_id, module->config.recv_delivery_timeout);
+	}
+}
 
-	do {
-		if (module->resp.read_length >= 0) {
+/**
+ * \brief Parse the chunks in the receive buffer and deliver their data.
+ *
+ * The chunk lines are removed from the buffer, so the data of consecutive
+ * chunks is gathered at its start and delivered as with a Content-Length:
+ * in multiples of recv_min_delivery, but the end of the entity.
+ *
+ * \return     Size of the next response in the buffer, or 0 to receive more.
+ */
+static HOT_RAMFUNC int _http_client_read_chuked_entity(struct http_client_module *const module)
+{
+	/* In chunked mode, read_length is the data left in the chunk, or one of HTTP_CHUNK_*. */
+	char *buffer = module->config.recv_buffer;
+	char *data, *line_end;
+	uint32_t length, held;
+	int size, digit, complete = 0;
+
+	for (;;) {
+		data = buffer + module->resp.chunk_held;
+		length = module->recved_size - module->resp.chunk_held;
+		if (length == 0) {
+			break;
+		}
+		if (module->resp.read_length > 0) {
+			/* Data of the chunk, already in place after the data gathered. */
+			if (length > (uint32_t)module->resp.read_length) {
+				length = (uint32_t)module->resp.read_length;
+			}
+			module->resp.chunk_held += length;
+			module->resp.read_length -= (int)length;
 			if (module->resp.read_length == 0) {
-				/* Complete to receive the buffer. */
-				module->resp.state = STATE_PARSE_HEADER;
-				module->resp.response_code = 0;
-				data.recv_chunked_data.is_complete = 1;
-				data.recv_chunked_data.length = 0;
-				data.recv_chunked_data.data = NULL;
-				if (module->cb) {
-					module->cb(module, HTTP_CLIENT_CALLBACK_RECV_CHUNKED_DATA, &data);
-				}
-				if (module->permanent == 0) {
-					/* This server was not supported keep alive. */
-					_http_client_clear_conn(module, 0);
-					return;
-				}
-				_http_client_move_buffer(module, buffer + 2);
-			} else if (module->resp.read_length <= length) {
-				data.recv_chunked_data.length = module->resp.read_length;
-				data.recv_chunked_data.data = buffer;
-				data.recv_chunked_data.is_complete = 0;
+				module->resp.read_length = HTTP_CHUNK_DATA_END;
+			}
+			continue;
+		}
 
-				if (module->cb) {
-					module->cb(module, HTTP_CLIENT_CALLBACK_RECV_CHUNKED_DATA, &data);
-				}
-				/* Last two character in the chunk is '\r\n'. */
-				_http_client_move_buffer(module, buffer + module->resp.read_length + 2 /* sizeof newline character */);
-				length = (int)module->recved_size;
-				buffer = module->config.recv_buffer;
-				module->resp.read_length = -1;
+		line_end = memchr(data, '\n', length);
+		if (line_end == NULL) {
+			if (module->recved_size >= module->config.recv_buffer_size && module->resp.chunk_held == 0) {
+				/* Chunk line longer than the buffer. */
+				_http_client_clear_conn(module, -EOVERFLOW);
+				return 0;
 			}
-		} else {
-			/* Read chunked length. */
-			module->resp.read_length = 0;
-			for (; length > 0; buffer++, length--) {
-				if (*buffer == '\n') {
-					buffer++;
-					length--;
+			/* currently not received packet yet. */
+			break;
+		}
+		if (module->resp.read_length == HTTP_CHUNK_SIZE_LINE) {
+			/* Chunk size in hexadecimal, then the extensions after ';'. */
+			size = 0;
+			for (; data < line_end; data++) {
+				if (*data >= '0' && *data <= '9') {
+					digit = *data - '0';
+				} else if (*data >= 'a' && *data <= 'f') {
+					digit = *data - 'a' + 10;
+				} else if (*data >= 'A' && *data <= 'F') {
+					digit = *data - 'A' + 10;
+				} else {
 					break;
 				}
-				if (extension != 0) {
-					continue;
-				}
-				if (*buffer >= '0' && *buffer <= '9') {
-					module->resp.read_length = module->resp.read_length * 0x10 + *buffer - '0';
-				} else if (*buffer >= 'a' && *buffer <= 'f') {
-					module->resp.read_length = module->resp.read_length * 0x10 + *buffer - 'a';
-				} else if (*buffer >= 'A' && *buffer <= 'F') {
-					module->resp.read_length = module->resp.read_length * 0x10 + *buffer - 'A';
-				} else if (*buffer == ';') {
-					extension = 1;
+				if (size > (0x7FFFFFFF >> 4)) {
+					_http_client_clear_conn(module, -EOVERFLOW);
+					return 0;
 				}
+				size = size * 0x10 + digit;
 			}
-
-			if (module->resp.read_length > (int)module->config.recv_buffer_size) {
-				/* Chunked size is too big. */
-				/* Through exception. */
-				_http_client_clear_conn(module, -EOVERFLOW);
-				return;
+			if (data == buffer + module->resp.chunk_held) {
+				/* No chunk size. */
+				_http_client_clear_conn(module, -EBADMSG);
+				return 0;
 			}
+			module->resp.read_length = (size > 0) ? size : HTTP_CHUNK_TRAILER;
+		} else if (module->resp.read_length == HTTP_CHUNK_DATA_END) {
+			module->resp.read_length = HTTP_CHUNK_SIZE_LINE;
+		} else if (line_end == buffer + module->resp.chunk_held
+				|| (line_end == buffer + module->resp.chunk_held + 1 && line_end[-1] == '\r')) {
+			/* Empty line closing the trailer: end of the entity. */
+			complete = 1;
+		}
+		/* The line is dropped, the data after it follows the data gathered. */
+		data = buffer + module->resp.chunk_held;
+		memmove(data, line_end + 1, buffer + module->recved_size - (line_end + 1));
+		module->recved_size -= (uint32_t)(line_end + 1 - data);
+		if (complete) {
+			break;
+		}
+	}
 
-			if (length  == 0) {
-				/* currently not received packet yet. */
-				module->resp.read_length = -1;
-				return;
-			}
+	held = module->resp.chunk_held;
+	if (!complete && module->resp.ranged == 0 && module->config.recv_min_delivery > 1 && module->recv_flush == 0) {
+		/* Deliver whole units, but the end of the entity. Less if a chunk line fills the rest of the buffer. */
+		held -= held % module->config.recv_min_delivery;
+		if (held == 0 && module->recved_size >= module->config.recv_buffer_size) {
+			held = module->resp.chunk_held;
+		}
+	}
+	if (held == 0 && !complete) {
+		if (module->resp.chunk_held > 0) {
+			_http_client_hold_entity(module);
 		}
-	} while(module->recved_size > 0);
+		return 0;
+	}
+
+	if (complete) {
+		module->resp.state = STATE_PARSE_HEADER;
+		module->resp.response_code = 0;
+	}
+	module->resp.chunk_held -= held;
+	if (_http_client_entity_data(module, buffer, held, complete) < 0) {
+		_http_client_clear_conn(module, -EBADMSG);
+		return 0;
+	}
+	if (complete && module->permanent == 0) {
+		/* This server was not supported keep alive. */
+		_http_client_clear_conn(module, 0);
+		return 0;
+	}
+	_http_client_move_buffer(module, buffer + held);
+	if (complete) {
+		return module->recved_size;
+	}
+	if (module->resp.chunk_held > 0) {
+		_http_client_hold_entity(module);
+	}
+	return 0;
 }
 
 int _http_client_handle_entity(struct http_client_module *const module)
@@ -981,6 +1482,31 @@ int _http_client_handle_entity(struct http_client_module *const module)
 	union http_client_data data;
 	char *buffer = module->config.recv_buffer;
 
+	if (module->resp.ranged && module->resp.content_length >= 0) {
+		/* Never pass the end of the entity: the next response may follow on this connection. */
+		uint32_t length = module->recved_size;
+		if (length > (uint32_t)(module->resp.content_length - module->resp.read_length)) {
+			length = (uint32_t)(module->resp.content_length - module->resp.read_length);
+		}
+		module->resp.read_length += (int)length;
+		if (module->resp.read_length >= module->resp.content_length) {
+			module->resp.state = STATE_PARSE_HEADER;
+			module->resp.response_code = 0;
+		}
+		if (_http_client_entity_data(module, buffer, length,
+				module->resp.state == STATE_PARSE_HEADER) < 0) {
+			_http_client_clear_conn(module, -EBADMSG);
+			return 0;
+		}
+		if (module->resp.state == STATE_PARSE_HEADER && module->permanent == 0) {
+			/* This server was not supported keep alive. */
+			_http_client_clear_conn(module, 0);
+			return 0;
+		}
+		_http_client_move_buffer(module, buffer + length);
+		return (module->resp.state == STATE_PARSE_HEADER) ? module->recved_size : 0;
+	}
+
 	/* If data size is lesser than buffer size, read all buffer and retransmission it to application. */
 	if (module->resp.content_length >= 0 && module->resp.content_length <= (int)module->config.recv_buffer_size) {
 		if ((int)module->recved_size >= module->resp.content_length) {
@@ -1005,9 +1531,20 @@ int _http_client_handle_entity(struct http_client_module *const module)
 		/* else, buffer was not received enough size yet. */
 	} else {
 		if (module->resp.content_length >= 0) {
-			data.recv_chunked_data.length = module->recved_size;
+			uint32_t length = module->recved_size;
+
+			if (module->config.recv_min_delivery > 1 && module->recv_flush == 0
+					&& module->resp.read_length + (int)length < module->resp.content_length) {
+				/* Deliver whole units, but the end of the entity. */
+				length -= length % module->config.recv_min_delivery;
+				if (length == 0) {
+					_http_client_hold_entity(module);
+					return 0;
+				}
+			}
+			data.recv_chunked_data.length = length;
 			data.recv_chunked_data.data = buffer;
-			module->resp.read_length += (int)module->recved_size;
+			module->resp.read_length += (int)length;
 			if (module->resp.content_length <= module->resp.read_length) {
 				/* Complete to receive the buffer. */
 				module->resp.state = STATE_PARSE_HEADER;
@@ -1029,15 +1566,209 @@ int _http_client_handle_entity(struct http_client_module *const module)
 					return 0;
 				}
 			}
-			_http_client_move_buffer(module, buffer + module->recved_size);
+			_http_client_move_buffer(module, buffer + length);
+			if (module->recved_size > 0 && module->resp.state == STATE_PARSE_ENTITY) {
+				_http_client_hold_entity(module);
+			}
 		} else {
-			_http_client_read_chuked_entity(module);
+			return _http_client_read_chuked_entity(module);
+		}
+	}
+
+	return 0;
+}
+
+static int _http_client_entity_data(struct http_client_module *const module, char *data, uint32_t length, int is_complete)
+{
+	union http_client_data cb_data;
+
+	if (module->resp.ranged) {
+		return _http_client_read_ranges(module, data, length, is_complete);
+	}
+
+	cb_data.recv_chunked_data.length = length;
+	cb_data.recv_chunked_data.data = data;
+	cb_data.recv_chunked_data.is_complete = is_complete;
+	if (module->cb) {
+		module->cb(module, HTTP_CLIENT_CALLBACK_RECV_CHUNKED_DATA, &cb_data);
+	}
+
+	return 0;
+}
+
+/**
+ * \brief Handle a complete line outside the body of a part.
+ *
+ * \return     0               Function success.
+ * \return     -EBADMSG        Part does not carry its range.
+ */
+static int _http_client_multipart_line(struct http_client_module *const module)
+{
+	struct http_client_multipart *multipart = module->resp.multipart;
+	char *line = multipart->line;
+	int i;
+
+	switch (multipart->state) {
+	case STATE_MULTIPART_DELIMITER:
+		/* Preamble and the new line closing the previous part are skipped. */
+		if (line[0] != '-' || line[1] != '-' ||
+				strncmp(line + 2, multipart->boundary, multipart->boundary_len)) {
+			break;
+		}
+		line += 2 + multipart->boundary_len;
+		if (line[0] == '-' && line[1] == '-') {
+			multipart->state = STATE_MULTIPART_EPILOGUE;
+			break;
+		}
+		/* Transport padding. */
+		for (i = 0; line[i] == ' ' || line[i] == '\t'; i++);
+		if (line[i] == '\0') {
+			multipart->state = STATE_MULTIPART_HEADER;
+			multipart->has_range = 0;
+		}
+		break;
+	case STATE_MULTIPART_HEADER:
+		if (line[0] == '\0') {
+			if (!multipart->has_range) {
+				return -EBADMSG;
+			}
+			multipart->state = STATE_MULTIPART_BODY;
+		} else if (!strncasecmp(line, "Content-Range:", strlen("Content-Range:"))) {
+			if (_http_client_parse_content_range(line + strlen("Content-Range:"), &module->resp.part_offset,
+					&module->resp.part_remain, &module->resp.total_length) < 0) {
+				return -EBADMSG;
+			}
+			multipart->has_range = 1;
+		}
+		break;
+	default:
+		/* STATE_MULTIPART_EPILOGUE */
+		break;
+	}
+
+	return 0;
+}
+
+static int _http_client_read_ranges(struct http_client_module *const module, char *data, uint32_t length, int is_complete)
+{
+	struct http_client_multipart *multipart = module->resp.multipart;
+	union http_client_data cb_data;
+	uint32_t size;
+	char ch;
+
+	cb_data.recv_part.is_complete = 0;
+	while (length > 0) {
+		if (multipart == NULL || multipart->state == STATE_MULTIPART_BODY) {
+			if (module->resp.part_remain == 0) {
+				/* Bytes beyond the single range. */
+				return -EBADMSG;
+			}
+			size = (length < module->resp.part_remain) ? length : module->resp.part_remain;
+			if (module->resp.part_remain != HTTP_PART_UNKNOWN_LENGTH) {
+				module->resp.part_remain -= size;
+			}
+			cb_data.recv_part.offset = module->resp.part_offset;
+			cb_data.recv_part.length = size;
+			cb_data.recv_part.data = data;
+			cb_data.recv_part.total_length = module->resp.total_length;
+			cb_data.recv_part.is_part_end = (module->resp.part_remain == 0);
+			if (module->cb) {
+				module->cb(module, HTTP_CLIENT_CALLBACK_RECV_PART, &cb_data);
+			}
+			module->resp.part_offset += size;
+			data += size;
+			length -= size;
+			if (multipart != NULL && module->resp.part_remain == 0) {
+				multipart->state = STATE_MULTIPART_DELIMITER;
+			}
+			continue;
+		}
+
+		/* Delimiters and part headers are parsed line by line. */
+		ch = *data++;
+		length--;
+		if (ch == '\n') {
+			if (multipart->line_len > 0 && multipart->line[multipart->line_len - 1] == '\r') {
+				multipart->line_len--;
+			}
+			multipart->line[multipart->line_len] = '\0';
+			multipart->line_len = 0;
+			if (_http_client_multipart_line(module) < 0) {
+				return -EBADMSG;
+			}
+		} else if (multipart->line_len < HTTP_MULTIPART_LINE_SIZE - 1) {
+			/* Longer lines are neither delimiters nor Content-Range. Truncate them. */
+			multipart->line[multipart->line_len++] = ch;
 		}
 	}
 
+	if (!is_complete) {
+		return 0;
+	}
+
+	/* Whole entity was received. Every range must be complete. */
+	if (multipart != NULL) {
+		if (multipart->state != STATE_MULTIPART_EPILOGUE) {
+			return -EBADMSG;
+		}
+	} else if (module->resp.part_remain != 0 && module->resp.part_remain != HTTP_PART_UNKNOWN_LENGTH) {
+		return -EBADMSG;
+	}
+	_http_client_free_multipart(module);
+	module->resp.ranged = 0;
+
+	cb_data.recv_part.offset = module->resp.part_offset;
+	cb_data.recv_part.length = 0;
+	cb_data.recv_part.data = NULL;
+	cb_data.recv_part.total_length = module->resp.total_length;
+	cb_data.recv_part.is_part_end = 0;
+	cb_data.recv_part.is_complete = 1;
+	if (module->cb) {
+		module->cb(module, HTTP_CLIENT_CALLBACK_RECV_PART, &cb_data);
+	}
+
 	return 0;
 }
 
+static void _http_client_free_multipart(struct http_client_module *const module)
+{
+	if (module->resp.multipart != NULL) {
+		free(module->resp.multipart);
+		module->resp.multipart = NULL;
+	}
+}
+
+void _http_client_upgraded(struct http_client_module *const module)
+{
+	union http_client_data data;
+
+	if (module->config.timeout > 0) {
+		sw_timer_disable_callback(module->config.timer_inst, module->timer_id);
+	}
+
+	/* Forget the session without closing the socket. */
+	module_ref_inst[module->sock] = NULL;
+	_http_client_free_multipart(module);
+	memset(&module->req, 0, sizeof(struct http_client_req));
+	memset(&module->resp, 0, sizeof(struct http_client_resp));
+	module->req.state = STATE_INIT;
+	module->resp.state = STATE_PARSE_HEADER;
+	module->sending = 0;
+	module->permanent = 0;
+	module->recv_paused = 0;
+	module->receiving = 0;
+	module->recv_held = 0;
+	module->upgrade = NULL;
+
+	data.upgraded.sock = module->sock;
+	data.upgraded.data = module->config.recv_buffer;
+	data.upgraded.length = module->recved_size;
+	module->recved_size = 0;
+	if (module->cb) {
+		module->cb(module, HTTP_CLIENT_CALLBACK_UPGRADED, &data);
+	}
+}
+
 void _http_client_move_buffer(struct http_client_module *const module, char *base)
 {
 	char *buffer = module->config.recv_buffer;
@@ -63,6 +63,8 @@ extern "C" {
 #define HTTP_PROTO_NAME               "HTTP/1.1"
 /** Max size of URI. */
 #define HTTP_MAX_URI_LENGTH           64
+/** Max number of ranges in one request of \ref http_client_send_ranges. */
+#define HTTP_MAX_RANGES               16
 
 /**
  * \brief A type of HTTP method.
@@ -99,6 +101,18 @@ enum http_client_callback_type {
 	HTTP_CLIENT_CALLBACK_RECV_CHUNKED_DATA,
 	/** The session was closed. */
 	HTTP_CLIENT_CALLBACK_DISCONNECTED,
+	/** Received a response header field. */
+	HTTP_CLIENT_CALLBACK_RECV_HEADER,
+	/**
+	 * The server switched protocols (101) in reply to \ref http_client_send_upgrade.
+	 * The socket now belongs to the receiver of this event.
+	 */
+	HTTP_CLIENT_CALLBACK_UPGRADED,
+	/**
+	 * Received a piece of a range asked by \ref http_client_send_ranges.
+	 * The response ends with a piece of zero length with is_complete set.
+	 */
+	HTTP_CLIENT_CALLBACK_RECV_PART,
 };
 
 /**
@@ -193,6 +207,47 @@ struct http_client_data_disconnected {
 	int reason;
 };
 
+/**
+ * \brief Structure of the HTTP_CLIENT_CALLBACK_RECV_HEADER callback.
+ * Both strings are only valid during the callback.
+ */
+struct http_client_data_recv_header {
+	/** Name of the header field. */
+	char *name;
+	/** Value of the header field, without the leading white space. */
+	char *value;
+};
+
+/**
+ * \brief Structure of the HTTP_CLIENT_CALLBACK_UPGRADED callback.
+ */
+struct http_client_data_upgraded {
+	/** Socket of the session. HTTP client does not use it anymore. */
+	SOCKET sock;
+	/** Data received after the response header, in the receive buffer. */
+	char *data;
+	/** Length of the data received after the response header. */
+	uint32_t length;
+};
+
+/**
+ * \brief Structure of the HTTP_CLIENT_CALLBACK_RECV_PART callback.
+ */
+struct http_client_data_recv_part {
+	/** Offset of data in the resource. */
+	uint32_t offset;
+	/** Length of data. */
+	uint32_t length;
+	/** Buffer of data. Only valid during the callback. */
+	char *data;
+	/** Complete length of the resource. Zero if the server did not tell. */
+	uint32_t total_length;
+	/** A flag for the last piece of a range. */
+	uint8_t is_part_end;
+	/** A flag for the end of the response. */
+	uint8_t is_complete;
+};
+
 /**
  * \brief Structure of the HTTP client callback.
  */
@@ -202,6 +257,9 @@ union http_client_data {
 	struct http_client_data_recv_response recv_response;
 	struct http_client_data_recv_chunked_data recv_chunked_data;
 	struct http_client_data_disconnected disconnected;
+	struct http_client_data_recv_header recv_header;
+	struct http_client_data_upgraded upgraded;
+	struct http_client_data_recv_part recv_part;
 };
 
 /* Before declaring for the callback type. */
@@ -269,8 +327,37 @@ struct http_client_config {
 	 * Default value is Atmel/{version}
 	 */
 	const char *user_agent;
+	/**
+	 * Minimum size of the data passed to HTTP_CLIENT_CALLBACK_RECV_CHUNKED_DATA.
+	 * The received packets are gathered in the receive buffer and delivered in
+	 * multiples of this size, such as a storage block, but the end of the entity.
+	 * Applies to an entity with a Content-Length bigger than the receive buffer,
+	 * and to the data of the chunks of an entity in chunked transfer coding.
+	 * MUST not be bigger than recv_buffer_size.
+	 * Default value is 0. (Each received packet is delivered)
+	 */
+	uint32_t recv_min_delivery;
+	/**
+	 * Time without a received packet after which the gathered data is delivered anyway.
+	 * Unit is milliseconds. Zero waits for a whole unit.
+	 * Default value is 100.
+	 */
+	uint16_t recv_delivery_timeout;
+};
+
+/**
+ * \brief A range of bytes in the resource.
+ */
+struct http_client_range {
+	/** Offset of the first byte. */
+	uint32_t offset;
+	/** Number of bytes. Zero means up to the end of the resource. */
+	uint32_t length;
 };
 
+/* State of the multipart/byteranges parser, private to the HTTP client. */
+struct http_client_multipart;
+
 
 /**
  * \brief HTTP client request instance.
@@ -303,10 +390,22 @@ struct http_client_resp {
 	uint32_t state;
 	/** Content-Length of this response. */
 	int content_length;
-	/** The size of the data received. */
+	/** The size of the data received. In chunked transfer coding, the data left in the chunk. */
 	int read_length;
+	/** Data of the chunks gathered at the start of the receive buffer, not delivered yet. */
+	uint32_t chunk_held;
 	/** Response code of this response. */
 	uint16_t response_code;
+	/** A flag for the entity being delivered through HTTP_CLIENT_CALLBACK_RECV_PART. */
+	uint8_t ranged;
+	/** Offset in the resource of the next byte of the current range. */
+	uint32_t part_offset;
+	/** Bytes of the current range not delivered yet. */
+	uint32_t part_remain;
+	/** Complete length of the resource from Content-Range. */
+	uint32_t total_length;
+	/** Parser of a multipart/byteranges entity. NULL for a single range. */
+	struct http_client_multipart *multipart;
 };
 
 /**
@@ -324,9 +423,24 @@ struct http_client_module {
 	uint8_t permanent       : 1;
 	/** A flag for the receive buffer located in the heap. */
 	uint8_t alloc_buffer    : 1;
+	/** A flag for the current request was sent by \ref http_client_send_ranges. */
+	uint8_t ranges          : 1;
+	/** A flag for the reception paused by \ref http_client_pause_recv. */
+	uint8_t recv_paused     : 1;
+	/** A flag for a receive pending in the socket, whose buffer recv() moves. */
+	uint8_t receiving       : 1;
+	/** A flag for the entity data held for recv_min_delivery, the timer being enabled. */
+	uint8_t recv_held       : 1;
+	/** A flag for the entity data delivered whatever its size. */
+	uint8_t recv_flush      : 1;
 
 	/** Size that received. */
 	uint32_t recved_size;
+	/** Bytes of the current packet of the WINC not read yet, written to the buffer given by the last recv(). */
+	uint16_t recv_remain;
+
+	/** Protocol requested in the Upgrade header of the current request. NULL if none. */
+	const char *upgrade;
 
 	/** SW Timer ID for the request time out. */
 	int timer_id;
@@ -499,6 +613,58 @@ void http_client_socket_resolve_handler(uint8_t *doamin_name, uint32_t server_ip
 int http_client_send_request(struct http_client_module *const module, const char *url,
 	enum http_method method, struct http_entity *const entity, const char *ext_header);
 
+/**
+ * \brief Send a GET request asking the server to switch to another protocol.
+ *
+ * The request carries "Connection: Upgrade" and "Upgrade: {protocol}".
+ * If the server answers 101 Switching Protocols, the HTTP client gives the socket
+ * away through the HTTP_CLIENT_CALLBACK_UPGRADED callback and goes back to the
+ * initial state without closing it. Any other response is delivered as usual.
+ *
+ * \param[in]  module_inst     Instance of HTTP client module.
+ * \param[in]  url             URL of request.
+ * \param[in]  protocol        Protocol token of the Upgrade header. It must stay valid until the request completes.
+ * \param[in]  ext_header      Extension header of the request.It must ends with new line character(\r\n).
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ * \return     -ENOSPC         No space left on device.
+ * \return     -EAGAIN         Try again.
+ * \return     -EBUSY          Device or resource busy.
+ * \return     -ENAMETOOLONG   URI is too long.
+ * \return     -ENOMEM         Out of memory.
+ */
+int http_client_send_upgrade(struct http_client_module *const module, const char *url,
+	const char *protocol, const char *ext_header);
+
+/**
+ * \brief Send a GET request for several ranges of the resource at once.
+ *
+ * The request carries a "Range: bytes=..." header listing every range.
+ * Whether the server answers with a multipart/byteranges entity (several ranges),
+ * a single Content-Range (one range) or the whole resource (200), the entity is
+ * delivered through HTTP_CLIENT_CALLBACK_RECV_PART with the offset of each piece
+ * in the resource, so it can be written straight to its place.
+ * HTTP_CLIENT_CALLBACK_RECV_RESPONSE is still sent first, with a NULL content.
+ * Other responses are delivered as usual.
+ *
+ * \param[in]  module_inst     Instance of HTTP client module.
+ * \param[in]  url             URL of request.
+ * \param[in]  ranges          Ranges to fetch, in any order.
+ * \param[in]  count           Number of ranges, up to HTTP_MAX_RANGES.
+ * \param[in]  ext_header      Extension header of the request.It must ends with new line character(\r\n).
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ * \return     -ENOSPC         No space left on device.
+ * \return     -EAGAIN         Try again.
+ * \return     -EBUSY          Device or resource busy.
+ * \return     -ENAMETOOLONG   URI is too long.
+ * \return     -ENOMEM         Out of memory.
+ */
+int http_client_send_ranges(struct http_client_module *const module, const char *url,
+	const struct http_client_range *ranges, int count, const char *ext_header);
+
 /**
  * \brief Force close HTTP connection.
  *
@@ -524,6 +690,40 @@ int http_client_send_request(struct http_client_module *const module, const char
  */
 int http_client_close(struct http_client_module *const module);
 
+/**
+ * \brief Stop receiving until \ref http_client_resume_recv is called.
+ *
+ * Lets a slow sink hold the sender: the receive buffer is not given back to the
+ * socket, so the WINC keeps the next packets and the TCP window closes.
+ * When called from the data callback, the data of this call is consumed and
+ * the rest of the received data stays in the receive buffer.
+ *
+ * The pause takes effect at the end of a packet of the WINC that fits in the
+ * free part of the receive buffer. A bigger packet is read in pieces, and
+ * giving the buffer for the next piece asks the WINC for the next packet too:
+ * the rest of the packet being read and the next packets are still read into
+ * the receive buffer and held, and the part that does not fit is delivered to
+ * the data callback despite the pause.
+ *
+ * \param[in]  module_inst     Instance of HTTP client module.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ */
+int http_client_pause_recv(struct http_client_module *const module);
+
+/**
+ * \brief Deliver the data held by \ref http_client_pause_recv and receive again.
+ *
+ * Not to be called from the callback of the module.
+ *
+ * \param[in]  module_inst     Instance of HTTP client module.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ */
+int http_client_resume_recv(struct http_client_module *const module);
+
 
 #ifdef __cplusplus
 }
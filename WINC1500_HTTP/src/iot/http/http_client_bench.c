@@ -0,0 +1,348 @@
+/**
+ * \file
+ *
+ * \brief Benchmark suite of the HTTP File Downloader Example.
+ *
+ */
+
+#include "main.h"
+#include "conf_winc.h"
+
+#ifdef MAIN_BENCH_URL
+
+#if defined(MAIN_HTTP_SYNC_URL) || defined(MAIN_HTTP_MERKLE_URL) || defined(MAIN_COAP_FILE_URL) \
+		|| defined(MAIN_MDNS_HOST_NAME) || defined(MAIN_DIRECT_SSID) || defined(MAIN_WS_NOTIFY_URL) \
+		|| defined(CONF_WINC_USE_FREERTOS)
+#error "MAIN_BENCH_URL measures the plain HTTP download of the superloop."
+#endif
+#ifndef CONF_WINC_BUS_STATS
+#error "MAIN_BENCH_URL needs CONF_WINC_BUS_STATS."
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <malloc.h>
+#include "asf.h"
+#include "bus_wrapper/include/nm_bus_wrapper.h"
+#include "download.h"
+#include "iot/http/http_client_bench.h"
+
+/** Scenarios of the benchmark suite. */
+typedef enum {
+	/** Content-Length body larger than the receive buffer. */
+	BENCH_LARGE = 0,
+	/** Same body in big chunks. */
+	BENCH_CHUNKED,
+	/** Requests one after the other on one connection. */
+	BENCH_KEEP_ALIVE,
+	/** Second half of the body, from a range request. */
+	BENCH_RESUME,
+	/** Reader pausing the reception after each packet, which closes the TCP window. */
+	BENCH_SLOW,
+	BENCH_COUNT
+} bench_scenario_t;
+/** Names of the scenarios in the results. */
+static const char *const bench_names[BENCH_COUNT] = {"large", "chunked", "keep-alive", "resume", "slow"};
+/** Suite running. */
+static bool bench_running = false;
+/** Current scenario. */
+static bench_scenario_t bench_scenario;
+/** Current run of the scenario. */
+static uint8_t bench_run;
+/** Requests completed in the run. */
+static uint8_t bench_requests;
+/** Request sent and not completed. */
+static bool bench_pending = false;
+/** Request to send from the main loop. */
+static bool bench_next = false;
+/** All the requests of the run succeeded. */
+static bool bench_ok;
+/** Length of the body, learnt by the first scenario for the resume. */
+static uint32_t bench_entity_length = 0;
+/** Bytes received in the run. */
+static uint32_t bench_bytes;
+/** CPU cycles spent handling the events of the WINC, see main(). */
+static uint64_t bench_busy_cycles = 0;
+/** Counters at the start of the run. */
+static uint32_t bench_start_ms;
+static uint64_t bench_start_busy;
+static tstrNmBusStats bench_start_bus;
+/** Reception paused by the slow reader. */
+static bool bench_paused = false;
+/** End of the pause of the slow reader. */
+static Timer bench_pause_timer;
+/** RAM regions of the linker script. */
+extern uint32_t _srelocate, _ebss, _sstack, _estack;
+
+/** Pattern of the unused stack. */
+#define BENCH_STACK_PATTERN 0xC5C5C5C5
+
+/**
+ * \brief Fill the unused stack with a pattern, to find the peak use of the run.
+ */
+static void bench_paint_stack(void)
+{
+	/* Leaves the frame of this function and a margin. */
+	uint32_t *top = (uint32_t *)__get_MSP() - 16;
+	uint32_t *p;
+
+	for (p = &_sstack; p < top; p++) {
+		*p = BENCH_STACK_PATTERN;
+	}
+}
+
+/**
+ * \brief Get the peak use of the stack since \ref bench_paint_stack.
+ */
+static uint32_t bench_get_stack_peak(void)
+{
+	uint32_t *p = &_sstack;
+
+	while (p < &_estack && *p == BENCH_STACK_PATTERN) {
+		p++;
+	}
+	return (uint32_t)((uint8_t *)&_estack - (uint8_t *)p);
+}
+
+/**
+ * \brief Print the header of the results.
+ */
+static void bench_print_header(void)
+{
+	printf("bench,tag,scenario,run,status,bytes,ms,kB/s,cpu_ms_per_MB,spi_transfers_per_MB,"
+			"spi_bytes_per_MB,ram_static,ram_heap,ram_stack\r\n");
+}
+
+/**
+ * \brief Print the results of the run, one CSV line to compare the builds.
+ */
+static void bench_print_result(void)
+{
+	const tstrNmBusStats *bus = nm_bus_get_stats();
+	uint32_t ms = get_tick_ms() - bench_start_ms;
+	uint64_t busy = bench_busy_cycles - bench_start_busy;
+	uint32_t mb_bytes = (bench_bytes > 0) ? bench_bytes : 1;
+
+	printf("bench,%s,%s,%u,%s,%lu,%lu,%lu,", MAIN_BENCH_TAG, bench_names[bench_scenario],
+			(unsigned int)bench_run, bench_ok ? "ok" : "failed", (unsigned long)bench_bytes,
+			(unsigned long)ms, (unsigned long)(ms ? bench_bytes / ms : 0));
+	printf("%lu,%lu,%lu,",
+			(unsigned long)(busy * 1048576 / (system_cpu_clock_get_hz() / 1000) / mb_bytes),
+			(unsigned long)((uint64_t)(bus->u32Transfers - bench_start_bus.u32Transfers) * 1048576 / mb_bytes),
+			(unsigned long)((uint64_t)(bus->u32Bytes - bench_start_bus.u32Bytes) * 1048576 / mb_bytes));
+	printf("%lu,%lu,%lu\r\n", (unsigned long)((uint8_t *)&_ebss - (uint8_t *)&_srelocate),
+			(unsigned long)mallinfo().arena, (unsigned long)bench_get_stack_peak());
+}
+
+/**
+ * \brief Complete a request, and print the results at the end of the run.
+ * \param[in] ok true if the whole body was received and stored.
+ */
+static void bench_request_done(bool ok)
+{
+	if (!bench_pending) {
+		return;
+	}
+	bench_pending = false;
+	if (ok && !finish_store_pipeline()) {
+		ok = false;
+	}
+	bench_ok = bench_ok && ok;
+	bench_requests++;
+	bench_next = true;
+	if (bench_ok && bench_scenario == BENCH_KEEP_ALIVE && bench_requests < MAIN_BENCH_KEEP_ALIVE_REQUESTS) {
+		/* Next request on the same connection. */
+		return;
+	}
+
+	close_file(bench_ok);
+	bench_print_result();
+	bench_requests = 0;
+	bench_run++;
+}
+
+/**
+ * \brief Send the next request of the run.
+ */
+static void bench_send(void)
+{
+	const char *url = MAIN_BENCH_URL;
+	int ret;
+
+	if (bench_requests == 0) {
+		/* Each run starts on a new connection. */
+		http_client_close(&http_client_module_inst);
+		close_file(false);
+		/* The size is unknown to the image slot. */
+		http_file_size = (uint32_t)-1;
+		if (!open_file("0:bench.bin")) {
+			printf("bench_send: suite stopped.\r\n");
+			bench_running = false;
+			add_state(CANCELED);
+			return;
+		}
+		bench_ok = true;
+		bench_bytes = 0;
+		bench_paint_stack();
+		bench_start_ms = get_tick_ms();
+		bench_start_busy = bench_busy_cycles;
+		memcpy(&bench_start_bus, nm_bus_get_stats(), sizeof(tstrNmBusStats));
+	}
+	pipeline_reset(&store_pipeline);
+	bench_paused = false;
+#ifdef MAIN_BENCH_CHUNKED_URL
+	if (bench_scenario == BENCH_CHUNKED) {
+		url = MAIN_BENCH_CHUNKED_URL;
+	}
+#endif
+	http_client_module_inst.config.tls = (strncmp(url, "https://", 8) == 0);
+	http_client_module_inst.config.port = http_client_module_inst.config.tls ? 443 : 80;
+
+	if (bench_scenario == BENCH_RESUME) {
+		struct http_client_range range = {bench_entity_length / 2, 0};
+
+		ret = http_client_send_ranges(&http_client_module_inst, url, &range, 1, NULL);
+	} else {
+		ret = http_client_send_request(&http_client_module_inst, url, HTTP_METHOD_GET, NULL, NULL);
+	}
+	if (ret < 0) {
+		printf("bench_send: request error %d\r\n", ret);
+		bench_pending = true;
+		bench_request_done(false);
+		return;
+	}
+	bench_pending = true;
+}
+
+/**
+ * \brief Pass the received data to the storage.
+ */
+static void bench_sink(struct http_client_module *module_inst, char *data, uint32_t length, bool is_complete)
+{
+	if (length > 0 && pipeline_push(&store_pipeline, (uint8_t *)data, length) < 0) {
+		printf("bench_sink: write error.\r\n");
+		bench_request_done(false);
+		http_client_close(module_inst);
+		return;
+	}
+	bench_bytes += length;
+
+	if (is_complete) {
+		bench_request_done(true);
+	} else if (bench_scenario == BENCH_SLOW && !bench_paused) {
+		/* Resumed by bench_poll(), the WINC keeps the next packets meanwhile. */
+		http_client_pause_recv(module_inst);
+		bench_paused = true;
+		TimerCountdownMS(&bench_pause_timer, MAIN_BENCH_SLOW_PAUSE_MS);
+	}
+}
+
+void bench_http_callback(struct http_client_module *module_inst, int type, union http_client_data *data)
+{
+	switch (type) {
+	case HTTP_CLIENT_CALLBACK_RECV_RESPONSE:
+		if (data->recv_response.response_code != 200 && data->recv_response.response_code != 206) {
+			printf("bench_http_callback: response %u\r\n", (unsigned int)data->recv_response.response_code);
+			bench_request_done(false);
+			http_client_close(module_inst);
+			break;
+		}
+		if (bench_scenario == BENCH_LARGE && !data->recv_response.is_chunked) {
+			bench_entity_length = data->recv_response.content_length;
+		}
+		if (data->recv_response.content != NULL) {
+			/* Small body, received with the header. */
+			bench_sink(module_inst, data->recv_response.content, data->recv_response.content_length, true);
+		}
+		break;
+
+	case HTTP_CLIENT_CALLBACK_RECV_CHUNKED_DATA:
+		bench_sink(module_inst, data->recv_chunked_data.data, data->recv_chunked_data.length,
+				data->recv_chunked_data.is_complete);
+		break;
+
+	case HTTP_CLIENT_CALLBACK_RECV_PART:
+		bench_sink(module_inst, data->recv_part.data, data->recv_part.length, data->recv_part.is_complete);
+		break;
+
+	case HTTP_CLIENT_CALLBACK_DISCONNECTED:
+		if (bench_pending) {
+			printf("bench_http_callback: disconnected %d\r\n", data->disconnected.reason);
+			bench_request_done(false);
+		}
+		break;
+	}
+}
+
+void bench_poll(void)
+{
+	if (!bench_running) {
+		return;
+	}
+
+	if (!is_state_set(WIFI_CONNECTED)) {
+		/* Starts over once connected again. */
+		printf("bench_poll: Wi-Fi disconnected, suite stopped.\r\n");
+		close_file(false);
+		bench_running = false;
+		bench_pending = false;
+		return;
+	}
+
+	if (bench_paused && TimerIsExpired(&bench_pause_timer)) {
+		bench_paused = false;
+		http_client_resume_recv(&http_client_module_inst);
+	}
+
+	if (!bench_next) {
+		return;
+	}
+	bench_next = false;
+
+	if (bench_run >= MAIN_BENCH_RUNS) {
+		bench_run = 0;
+		bench_scenario++;
+	}
+#ifndef MAIN_BENCH_CHUNKED_URL
+	if (bench_scenario == BENCH_CHUNKED) {
+		bench_scenario++;
+	}
+#endif
+	if (bench_scenario == BENCH_RESUME && bench_entity_length < 2) {
+		/* The length is unknown without the first scenario. */
+		bench_scenario++;
+	}
+	if (bench_scenario >= BENCH_COUNT) {
+		printf("bench_poll: suite completed.\r\n");
+		http_client_close(&http_client_module_inst);
+		bench_running = false;
+		add_state(COMPLETED);
+		return;
+	}
+	bench_send();
+}
+
+void bench_start(void)
+{
+	printf("bench_start: running the benchmark suite on %s...\r\n", MAIN_BENCH_URL);
+	bench_print_header();
+	bench_scenario = BENCH_LARGE;
+	bench_run = 0;
+	bench_requests = 0;
+	bench_pending = false;
+	bench_running = true;
+	bench_next = true;
+	add_state(GET_REQUESTED);
+}
+
+bool is_bench_running(void)
+{
+	return bench_running;
+}
+
+void bench_add_busy_cycles(uint32_t cycles)
+{
+	bench_busy_cycles += cycles;
+}
+
+#endif /* MAIN_BENCH_URL */
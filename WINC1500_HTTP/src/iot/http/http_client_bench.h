@@ -0,0 +1,59 @@
+/**
+ * \file
+ *
+ * \brief Benchmark suite of the HTTP File Downloader Example.
+ *
+ * With MAIN_BENCH_URL, the download is replaced by a suite of scenarios of the
+ * HTTP client: a large body, chunks, keep-alive requests, a range request and a
+ * slow reader. Each run prints one CSV line (throughput, CPU time and SPI
+ * traffic per MB, RAM use) to compare the builds.
+ *
+ */
+
+#ifndef HTTP_CLIENT_BENCH_H_INCLUDED
+#define HTTP_CLIENT_BENCH_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "iot/http/http_client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Start the benchmark suite, from the first scenario.
+ */
+void bench_start(void);
+
+/**
+ * \brief The benchmark suite is running.
+ * \return true if the HTTP client events go to \ref bench_http_callback, false otherwise.
+ */
+bool is_bench_running(void);
+
+/**
+ * \brief Callback of the HTTP client while the suite runs.
+ *
+ * \param[in]  module_inst     Module instance of HTTP client module.
+ * \param[in]  type            Type of event.
+ * \param[in]  data            Data structure of the event. \refer http_client_data
+ */
+void bench_http_callback(struct http_client_module *module_inst, int type, union http_client_data *data);
+
+/**
+ * \brief Send the requests of the suite and resume the slow reader.
+ */
+void bench_poll(void);
+
+/**
+ * \brief Account the CPU cycles of a main loop turn handling the events of the WINC.
+ * \param[in] cycles CPU cycles of the turn.
+ */
+void bench_add_busy_cycles(uint32_t cycles);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTP_CLIENT_BENCH_H_INCLUDED */
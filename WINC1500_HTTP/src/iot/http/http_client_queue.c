@@ -0,0 +1,102 @@
+/**
+ * \file
+ *
+ * \brief Storage queue of the HTTP File Downloader Example.
+ *
+ */
+
+#include "main.h"
+
+#ifdef MAIN_STORAGE_QUEUE_SIZE
+
+#if (MAIN_STORAGE_QUEUE_SIZE < 2 * MAIN_BUFFER_MAX_SIZE) || (MAIN_STORAGE_QUEUE_SIZE % MAIN_STORAGE_WRITE_SIZE)
+#error "MAIN_STORAGE_QUEUE_SIZE must hold two packets in whole writes."
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include "download.h"
+#include "iot/http/http_client_queue.h"
+
+/** Image received but not written to the storage yet. */
+static uint8_t storage_queue[MAIN_STORAGE_QUEUE_SIZE];
+/** Offset in the queue of the first byte to be written. */
+static uint32_t storage_queue_start = 0;
+/** Bytes in the queue. */
+static uint32_t storage_queue_length = 0;
+
+/**
+ * \brief Write the head of the storage queue to the download file.
+ * \param[in] max_length Maximum number of bytes written.
+ * \return true if succeeded, false otherwise.
+ */
+static bool drain_storage_queue(uint32_t max_length)
+{
+	uint32_t piece;
+
+	while ((storage_queue_length > 0) && (max_length > 0)) {
+		piece = MAIN_STORAGE_QUEUE_SIZE - storage_queue_start;
+		piece = (storage_queue_length < piece) ? storage_queue_length : piece;
+		piece = (max_length < piece) ? max_length : piece;
+		if (!write_file((const char *)&storage_queue[storage_queue_start], piece)) {
+			return false;
+		}
+		storage_queue_start = (storage_queue_start + piece) % MAIN_STORAGE_QUEUE_SIZE;
+		storage_queue_length -= piece;
+		max_length -= piece;
+	}
+	return true;
+}
+
+bool queue_storage(const uint8_t *data, uint32_t length)
+{
+	uint32_t end, piece;
+
+	if (length > MAIN_STORAGE_QUEUE_SIZE - storage_queue_length) {
+		/* Data received before the pause took effect. */
+		if (!drain_storage_queue(length - (MAIN_STORAGE_QUEUE_SIZE - storage_queue_length))) {
+			return false;
+		}
+	}
+	while (length > 0) {
+		end = (storage_queue_start + storage_queue_length) % MAIN_STORAGE_QUEUE_SIZE;
+		piece = MAIN_STORAGE_QUEUE_SIZE - end;
+		piece = (length < piece) ? length : piece;
+		memcpy(&storage_queue[end], data, piece);
+		storage_queue_length += piece;
+		data += piece;
+		length -= piece;
+	}
+	if (MAIN_STORAGE_QUEUE_SIZE - storage_queue_length < MAIN_BUFFER_MAX_SIZE) {
+		http_client_pause_recv(&http_client_module_inst);
+	}
+	return true;
+}
+
+bool close_storage_queue(bool completed)
+{
+	bool ok = !completed || drain_storage_queue(storage_queue_length);
+
+	storage_queue_start = 0;
+	storage_queue_length = 0;
+	return ok;
+}
+
+void storage_task(void)
+{
+	if (storage_queue_length < MAIN_STORAGE_WRITE_SIZE) {
+		return;
+	}
+	if (!drain_storage_queue(MAIN_STORAGE_WRITE_SIZE)) {
+		printf("storage_task: file write error, download canceled.\r\n");
+		close_file(false);
+		http_client_close(&http_client_module_inst);
+		add_state(CANCELED);
+		return;
+	}
+	if (storage_queue_length <= MAIN_STORAGE_QUEUE_SIZE / 2) {
+		http_client_resume_recv(&http_client_module_inst);
+	}
+}
+
+#endif /* MAIN_STORAGE_QUEUE_SIZE */
@@ -0,0 +1,53 @@
+/**
+ * \file
+ *
+ * \brief Storage queue of the HTTP File Downloader Example.
+ *
+ * With MAIN_STORAGE_QUEUE_SIZE, the received image is queued and written to
+ * the storage in pieces of MAIN_STORAGE_WRITE_SIZE from the main loop. The
+ * HTTP reception is paused while the next packet may not fit, so that the WINC
+ * and the TCP window hold the sender until the queue is written.
+ *
+ */
+
+#ifndef HTTP_CLIENT_QUEUE_H_INCLUDED
+#define HTTP_CLIENT_QUEUE_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Append data to the storage queue.
+ *
+ * The reception is paused when the next packet may not fit.
+ * \param[in] data Data.
+ * \param[in] length Data length, at most MAIN_BUFFER_MAX_SIZE.
+ * \return true if succeeded, false otherwise.
+ */
+bool queue_storage(const uint8_t *data, uint32_t length);
+
+/**
+ * \brief Empty the storage queue when the download file is closed.
+ * \param[in] completed true to write the queued data first.
+ * \return true if succeeded, false if the queued data could not be written.
+ */
+bool close_storage_queue(bool completed);
+
+/**
+ * \brief Write the storage queue in whole pieces and resume the reception once it is half empty.
+ *
+ * Pieces of MAIN_STORAGE_WRITE_SIZE keep the file writes sector aligned, the
+ * rest is written when the file is closed. Cancels the download on a write
+ * error.
+ */
+void storage_task(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTP_CLIENT_QUEUE_H_INCLUDED */
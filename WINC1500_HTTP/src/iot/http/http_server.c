@@ -0,0 +1,428 @@
+/**
+ * \file
+ *
+ * \brief HTTP server service.
+ *
+ */
+
+#include "iot/http/http_server.h"
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+
+enum http_server_state {
+	/** No connection. */
+	STATE_IDLE = 0,
+	/** Receiving the request header. */
+	STATE_RECV_REQUEST,
+	/** Sending the response. */
+	STATE_SEND_RESPONSE,
+};
+
+/**
+ * \brief Global reference of HTTP server instance.
+ * Socket callback interface has not user private data.
+ * So it needed reference to HTTP server module instance.
+ */
+static struct http_server_module *module_ref_inst[TCP_SOCK_MAX] = {NULL,};
+
+/**
+ * \brief Timer callback entry of HTTP server.
+ */
+static void _http_server_timer_callback(struct sw_timer_module *const module, int timer_id, void *context, int period);
+
+/**
+ * \brief Close the connection and report the response.
+ *
+ * \param[in]  module          Module instance of HTTP server.
+ * \param[in]  reason          0 if the whole response was sent, a negative error otherwise.
+ */
+static void _http_server_close_conn(struct http_server_module *const module, int reason)
+{
+	union http_server_data data;
+	uint16_t response_code = module->response_code;
+
+	if (module->sock < 0) {
+		return;
+	}
+
+	close(module->sock);
+	module_ref_inst[module->sock] = NULL;
+	module->sock = -1;
+	module->state = STATE_IDLE;
+	sw_timer_disable_callback(module->config.timer_inst, module->timer_id);
+	if (module->entity.close) {
+		module->entity.close(module->entity.priv_data);
+	}
+	memset(&module->entity, 0, sizeof(struct http_entity));
+	module->response_code = 0;
+
+	/* Connections closed before a request are not reported. */
+	if (response_code != 0 && module->cb) {
+		data.sent.response_code = response_code;
+		data.sent.length = module->sent_length;
+		data.sent.reason = reason;
+		module->cb(module, HTTP_SERVER_CALLBACK_SENT, &data);
+	}
+}
+
+/**
+ * \brief Send the next segment of the body, or close the connection after the last one.
+ *
+ * \param[in]  module          Module instance of HTTP server.
+ * \param[in]  offset          Bytes of the buffer already filled by the header.
+ */
+static void _http_server_send_body(struct http_server_module *const module, uint32_t offset)
+{
+	uint32_t size = module->config.buffer_size - offset;
+	int length = 0;
+
+	if (!module->head_only && module->sent_length < module->length) {
+		if (size > module->length - module->sent_length) {
+			size = module->length - module->sent_length;
+		}
+		length = module->entity.read(module->entity.priv_data, module->config.buffer + offset, size,
+				module->sent_length);
+		if (length <= 0) {
+			_http_server_close_conn(module, -EIO);
+			return;
+		}
+		module->sent_length += length;
+	}
+
+	if (offset + length == 0) {
+		/* The whole response was sent. */
+		_http_server_close_conn(module, 0);
+		return;
+	}
+
+	if (send(module->sock, module->config.buffer, offset + length, 0) < 0) {
+		_http_server_close_conn(module, -EIO);
+		return;
+	}
+	sw_timer_enable_callback(module->config.timer_inst, module->timer_id, module->config.timeout);
+}
+
+/**
+ * \brief Start the response with its header.
+ *
+ * \param[in]  module          Module instance of HTTP server.
+ * \param[in]  response_code   Status code of the response.
+ * \param[in]  reason          Reason phrase of the status code.
+ */
+static void _http_server_send_response(struct http_server_module *const module, uint16_t response_code,
+		const char *reason)
+{
+	char *buffer = module->config.buffer;
+	uint32_t offset;
+
+	module->response_code = response_code;
+	module->sent_length = 0;
+	if (response_code != 200) {
+		/* Errors have no body. */
+		module->length = 0;
+	}
+
+	offset = sprintf(buffer, "HTTP/1.1 %u %s\r\n" "Content-Length: %lu\r\n",
+			(unsigned int)response_code, reason, (unsigned long)module->length);
+	if (response_code == 405) {
+		offset += sprintf(buffer + offset, "Allow: GET, HEAD\r\n");
+	}
+	if (response_code == 200 && module->entity.get_contents_type) {
+		offset += sprintf(buffer + offset, "Content-Type: %s\r\n",
+				module->entity.get_contents_type(module->entity.priv_data));
+	}
+	offset += sprintf(buffer + offset, "Connection: close\r\n\r\n");
+
+	module->state = STATE_SEND_RESPONSE;
+	/* The first segment also carries the beginning of the body. */
+	_http_server_send_body(module, offset);
+}
+
+/**
+ * \brief Answer the request once its header is received.
+ *
+ * \param[in]  module          Module instance of HTTP server.
+ */
+static void _http_server_handle_request(struct http_server_module *const module)
+{
+	union http_server_data data;
+	char *method = module->config.buffer;
+	char *uri, *uri_end;
+	int length;
+
+	uri = strchr(method, ' ');
+	uri_end = (uri != NULL) ? strchr(uri + 1, ' ') : NULL;
+	if (uri_end == NULL || strncmp(uri_end + 1, "HTTP/1.", 7)) {
+		_http_server_send_response(module, 400, "Bad Request");
+		return;
+	}
+	*uri++ = '\0';
+	*uri_end = '\0';
+
+	if (!strcmp(method, "GET")) {
+		data.request.method = HTTP_METHOD_GET;
+	} else if (!strcmp(method, "HEAD")) {
+		data.request.method = HTTP_METHOD_HEAD;
+	} else {
+		_http_server_send_response(module, 405, "Method Not Allowed");
+		return;
+	}
+	module->head_only = (data.request.method == HTTP_METHOD_HEAD);
+
+	if (uri_end - uri >= HTTP_SERVER_MAX_URI_LENGTH) {
+		_http_server_send_response(module, 414, "URI Too Long");
+		return;
+	}
+
+	memset(&module->entity, 0, sizeof(struct http_entity));
+	data.request.uri = uri;
+	data.request.addr = module->addr;
+	data.request.entity = &module->entity;
+	if (module->cb) {
+		module->cb(module, HTTP_SERVER_CALLBACK_REQUEST, &data);
+	}
+	if (module->sock < 0) {
+		/* Stopped by the callback. */
+		return;
+	}
+
+	if (module->entity.read == NULL) {
+		_http_server_send_response(module, 404, "Not Found");
+		return;
+	}
+
+	/* The body is sent with its length only. */
+	length = (module->entity.is_chunked || module->entity.get_contents_length == NULL) ? -1
+			: module->entity.get_contents_length(module->entity.priv_data);
+	if (length < 0) {
+		_http_server_send_response(module, 500, "Internal Server Error");
+		return;
+	}
+	module->length = (uint32_t)length;
+	_http_server_send_response(module, 200, "OK");
+}
+
+static void _http_server_timer_callback(struct sw_timer_module *const module, int timer_id, void *context, int period)
+{
+	struct http_server_module *module_inst = (struct http_server_module *)context;
+
+	/* Checks invalid arguments. */
+	if (module_inst == NULL) {
+		return;
+	}
+
+	/* No request, or the client stopped reading. */
+	_http_server_close_conn(module_inst, -ETIME);
+}
+
+void http_server_get_config_defaults(struct http_server_config *const config)
+{
+	config->port = 80;
+	config->timer_inst = NULL;
+	config->timeout = 10000;
+	config->buffer = NULL;
+	config->buffer_size = SOCKET_BUFFER_MAX_LENGTH;
+}
+
+int http_server_init(struct http_server_module *const module, struct http_server_config *config)
+{
+	/* Checks the parameters. */
+	if (module == NULL || config == NULL || config->timer_inst == NULL) {
+		return -EINVAL;
+	}
+
+	/* Room for the header of the response. */
+	if (config->buffer_size < 256 || config->buffer_size > SOCKET_BUFFER_MAX_LENGTH) {
+		return -EINVAL;
+	}
+
+	memset(module, 0, sizeof(struct http_server_module));
+	memcpy(&module->config, config, sizeof(struct http_server_config));
+	module->listen_sock = -1;
+	module->sock = -1;
+
+	if (config->buffer == NULL) {
+		module->config.buffer = malloc(config->buffer_size);
+		if (module->config.buffer == NULL) {
+			return -ENOMEM;
+		}
+		module->alloc_buffer = 1;
+	}
+
+	module->timer_id = sw_timer_register_callback(config->timer_inst, _http_server_timer_callback, (void *)module, 0);
+	if (module->timer_id < 0) {
+		if (module->alloc_buffer) {
+			free(module->config.buffer);
+		}
+		return -ENOSPC;
+	}
+
+	return 0;
+}
+
+int http_server_deinit(struct http_server_module *const module)
+{
+	if (module == NULL) {
+		return -EINVAL;
+	}
+
+	http_server_stop(module);
+	sw_timer_unregister_callback(module->config.timer_inst, module->timer_id);
+	if (module->alloc_buffer) {
+		free(module->config.buffer);
+	}
+	memset(module, 0, sizeof(struct http_server_module));
+	module->listen_sock = -1;
+	module->sock = -1;
+
+	return 0;
+}
+
+int http_server_register_callback(struct http_server_module *const module, http_server_callback_t callback)
+{
+	if (module == NULL) {
+		return -EINVAL;
+	}
+
+	module->cb = callback;
+
+	return 0;
+}
+
+int http_server_start(struct http_server_module *const module)
+{
+	struct sockaddr_in addr_in;
+
+	if (module == NULL) {
+		return -EINVAL;
+	}
+
+	if (module->listen_sock >= 0) {
+		return -EALREADY;
+	}
+
+	module->listen_sock = socket(AF_INET, SOCK_STREAM, 0);
+	if (module->listen_sock < 0) {
+		module->listen_sock = -1;
+		return -ENOSPC;
+	}
+	module_ref_inst[module->listen_sock] = module;
+
+	/* Listens once bound. */
+	addr_in.sin_family = AF_INET;
+	addr_in.sin_port = _htons(module->config.port);
+	addr_in.sin_addr.s_addr = 0;
+	bind(module->listen_sock, (struct sockaddr *)&addr_in, sizeof(struct sockaddr_in));
+
+	return 0;
+}
+
+void http_server_stop(struct http_server_module *const module)
+{
+	if (module == NULL) {
+		return;
+	}
+
+	/* No report of the response cut. */
+	module->response_code = 0;
+	_http_server_close_conn(module, -ECONNABORTED);
+	if (module->listen_sock >= 0) {
+		close(module->listen_sock);
+		module_ref_inst[module->listen_sock] = NULL;
+		module->listen_sock = -1;
+	}
+}
+
+void http_server_socket_event_handler(SOCKET sock, uint8_t msg_type, void *msg_data)
+{
+	tstrSocketBindMsg *msg_bind;
+	tstrSocketListenMsg *msg_listen;
+	tstrSocketAcceptMsg *msg_accept;
+	tstrSocketRecvMsg *msg_recv;
+	char *buffer;
+
+	/* Find instance using the socket descriptor. */
+	struct http_server_module *module;
+	if (sock < 0 || sock >= TCP_SOCK_MAX) {
+		return;
+	}
+	module = module_ref_inst[sock];
+	/* If cannot found reference, This socket is not HTTP server socket. */
+	if (module == NULL) {
+		return;
+	}
+
+	switch (msg_type) {
+	case SOCKET_MSG_BIND:
+		msg_bind = (tstrSocketBindMsg *)msg_data;
+		if (msg_bind->status != 0) {
+			http_server_stop(module);
+			break;
+		}
+		listen(sock, 0);
+		break;
+	case SOCKET_MSG_LISTEN:
+		msg_listen = (tstrSocketListenMsg *)msg_data;
+		if (msg_listen->status != 0) {
+			http_server_stop(module);
+		}
+		break;
+	case SOCKET_MSG_ACCEPT:
+		msg_accept = (tstrSocketAcceptMsg *)msg_data;
+		if (msg_accept->sock < 0) {
+			break;
+		}
+		if (module->sock >= 0) {
+			/* One connection at a time. */
+			close(msg_accept->sock);
+			break;
+		}
+		module->sock = msg_accept->sock;
+		module_ref_inst[module->sock] = module;
+		module->addr = msg_accept->strAddr.sin_addr.s_addr;
+		module->state = STATE_RECV_REQUEST;
+		module->recved_size = 0;
+		module->response_code = 0;
+		/* Leaves room for the terminating null. */
+		recv(module->sock, module->config.buffer, module->config.buffer_size - 1, 0);
+		sw_timer_enable_callback(module->config.timer_inst, module->timer_id, module->config.timeout);
+		break;
+	case SOCKET_MSG_RECV:
+		msg_recv = (tstrSocketRecvMsg *)msg_data;
+		if (module->state != STATE_RECV_REQUEST) {
+			break;
+		}
+		if (msg_recv->s16BufferSize <= 0) {
+			_http_server_close_conn(module, -ECONNRESET);
+			break;
+		}
+		module->recved_size += msg_recv->s16BufferSize;
+		buffer = module->config.buffer;
+		buffer[module->recved_size] = '\0';
+		if (strstr(buffer, "\r\n\r\n") != NULL) {
+			/* Only the request line is used. */
+			*strchr(buffer, '\r') = '\0';
+			_http_server_handle_request(module);
+		} else if (module->recved_size >= module->config.buffer_size - 1) {
+			_http_server_send_response(module, 431, "Request Header Fields Too Large");
+		} else {
+			recv(sock, buffer + module->recved_size, module->config.buffer_size - 1 - module->recved_size, 0);
+		}
+		break;
+	case SOCKET_MSG_SEND:
+		if (module->state != STATE_SEND_RESPONSE) {
+			break;
+		}
+		if (*(int16_t *)msg_data < 0) {
+			_http_server_close_conn(module, -EIO);
+			break;
+		}
+		_http_server_send_body(module, 0);
+		break;
+	default:
+		break;
+	}
+}
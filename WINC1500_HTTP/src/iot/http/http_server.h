@@ -0,0 +1,241 @@
+/**
+ * \file
+ *
+ * \brief HTTP server service.
+ *
+ * A minimal HTTP/1.1 server answering GET and HEAD requests, one connection at
+ * a time. The application gives the body of each resource as an
+ * \ref http_entity, so the same sources as for the requests of the HTTP client
+ * apply. Each response closes the connection.
+ *
+ */
+
+#ifndef HTTP_SERVER_H_INCLUDED
+#define HTTP_SERVER_H_INCLUDED
+
+#include <stdint.h>
+#include "socket/include/socket.h"
+#include "iot/sw_timer.h"
+#include "iot/http/http_client.h"
+#include "iot/http/http_entity.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Maximum length of the path of a request. Longer requests are answered with 414. */
+#define HTTP_SERVER_MAX_URI_LENGTH      64
+
+/**
+ * \brief A type of HTTP server callback.
+ */
+enum http_server_callback_type {
+	/** A request was received. The application gives the entity of the resource. */
+	HTTP_SERVER_CALLBACK_REQUEST,
+	/** A response was sent. */
+	HTTP_SERVER_CALLBACK_SENT,
+};
+
+/**
+ * \brief Structure of the HTTP_SERVER_CALLBACK_REQUEST callback.
+ *
+ * The entity is copied after the callback. It is left empty for a resource that
+ * does not exist, which is answered with 404.
+ */
+struct http_server_data_request {
+	/** Method of the request, HTTP_METHOD_GET or HTTP_METHOD_HEAD. */
+	enum http_method method;
+	/** Path of the request. Only valid during the callback. */
+	const char *uri;
+	/** IPv4 address of the client in network byte order. */
+	uint32_t addr;
+	/** Entity of the resource, to be filled by the application. */
+	struct http_entity *entity;
+};
+
+/**
+ * \brief Structure of the HTTP_SERVER_CALLBACK_SENT callback.
+ */
+struct http_server_data_sent {
+	/** Status code of the response. */
+	uint16_t response_code;
+	/** Bytes of the body sent. */
+	uint32_t length;
+	/** 0 if the whole response was sent, a negative error otherwise. */
+	int reason;
+};
+
+/**
+ * \brief Structure of the HTTP server callback.
+ */
+union http_server_data {
+	struct http_server_data_request request;
+	struct http_server_data_sent sent;
+};
+
+/* Before declaring for the callback type. */
+struct http_server_module;
+/**
+ * \brief Callback interface of HTTP server service.
+ *
+ * \param[in]  module_inst     Module instance of HTTP server module.
+ * \param[in]  type            Type of event.
+ * \param[in]  data            Data structure of the event. \refer http_server_data
+ */
+typedef void (*http_server_callback_t)(struct http_server_module *module_inst, int type, union http_server_data *data);
+
+/**
+ * \brief HTTP server configuration structure
+ *
+ * Configuration struct for a HTTP server instance. This structure should be
+ * initialized by the \ref http_server_get_config_defaults function before being
+ * modified by the user application.
+ */
+struct http_server_config {
+	/**
+	 * TCP port listened to.
+	 * Default value is 80.
+	 */
+	uint16_t port;
+	/**
+	 * Timer module for the connection timeout.
+	 * Default value is NULL.
+	 */
+	struct sw_timer_module *timer_inst;
+	/**
+	 * Time a connection may stay without receiving the request or without
+	 * completing a send, before it is closed.
+	 * Unit is milliseconds.
+	 * Default value is 10000. (10 seconds)
+	 */
+	uint32_t timeout;
+	/**
+	 * Buffer the request is received in and the response built in.
+	 * If this value is NULL, The buffer is allocated from the heap.
+	 * Default value is NULL.
+	 */
+	char *buffer;
+	/**
+	 * Size of the buffer, also the largest segment sent.
+	 * Default value is SOCKET_BUFFER_MAX_LENGTH.
+	 */
+	uint32_t buffer_size;
+};
+
+/**
+ * \brief Structure of HTTP server instance.
+ */
+struct http_server_module {
+	/** Listening socket. */
+	SOCKET listen_sock;
+	/** Socket of the connection, -1 if none. */
+	SOCKET sock;
+	/** IPv4 address of the client in network byte order. */
+	uint32_t addr;
+
+	/** A flag that the buffer was allocated from the heap. */
+	uint8_t alloc_buffer    : 1;
+	/** A flag for the request being a HEAD request. */
+	uint8_t head_only       : 1;
+
+	/** State of the connection. */
+	uint8_t state;
+	/** Status code of the response being sent. */
+	uint16_t response_code;
+	/** Bytes of the request received. */
+	uint32_t recved_size;
+	/** Length of the body of the response. */
+	uint32_t length;
+	/** Bytes of the body sent. */
+	uint32_t sent_length;
+	/** Entity of the body of the response. */
+	struct http_entity entity;
+
+	/** SW Timer ID. */
+	int timer_id;
+
+	/** Callback interface entry. */
+	http_server_callback_t cb;
+
+	/** Configuration instance of HTTP server module. That was registered from the \ref http_server_init*/
+	struct http_server_config config;
+};
+
+/**
+ * \brief Get default configuration of HTTP server module.
+ *
+ * \param[in]  config          Pointer of configuration structure which will be used in the module.
+ */
+void http_server_get_config_defaults(struct http_server_config *const config);
+
+/**
+ * \brief Initialize HTTP server service.
+ *
+ * \param[in]  module          Module instance of HTTP server module.
+ * \param[in]  config          Pointer of configuration structure which will be used in the module.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ * \return     -ENOMEM         Buffer allocation failed.
+ * \return     -ENOSPC         No timer left.
+ */
+int http_server_init(struct http_server_module *const module, struct http_server_config *config);
+
+/**
+ * \brief Terminate HTTP server service.
+ *
+ * \param[in]  module          Module instance of HTTP server module.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ */
+int http_server_deinit(struct http_server_module *const module);
+
+/**
+ * \brief Register and enable the callback.
+ *
+ * \param[in]  module_inst     Instance of HTTP server module.
+ * \param[in]  callback        Callback entry for the HTTP server module.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ */
+int http_server_register_callback(struct http_server_module *const module, http_server_callback_t callback);
+
+/**
+ * \brief Listen for the connections, once the IP address is known.
+ *
+ * \param[in]  module          Instance of HTTP server module.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ * \return     -EALREADY       Already started.
+ * \return     -ENOSPC         No socket left.
+ */
+int http_server_start(struct http_server_module *const module);
+
+/**
+ * \brief Close the connection and the listening socket.
+ *
+ * A response being sent ends without callback.
+ *
+ * \param[in]  module          Instance of HTTP server module.
+ */
+void http_server_stop(struct http_server_module *const module);
+
+/**
+ * \brief Event handler of the socket.
+ *
+ * This function must be called from the socket callback registered with registerSocketCallback.
+ *
+ * \param[in]  sock            Socket descriptor.
+ * \param[in]  msg_type        Type of the socket event.
+ * \param[in]  msg_data        Data of the socket event.
+ */
+void http_server_socket_event_handler(SOCKET sock, uint8_t msg_type, void *msg_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTP_SERVER_H_INCLUDED */
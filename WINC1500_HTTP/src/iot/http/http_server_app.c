@@ -0,0 +1,301 @@
+/**
+ * \file
+ *
+ * \brief Direct link of the HTTP File Downloader Example.
+ *
+ */
+
+#include "main.h"
+
+#ifdef MAIN_DIRECT_SSID
+
+#ifdef MAIN_STORAGE_IMAGE_SLOT
+#error "MAIN_DIRECT_SSID serves the image from a FAT file."
+#endif
+#ifdef MAIN_IMAGE_AES_KEY
+#error "MAIN_DIRECT_SSID would serve the decrypted image."
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include "asf.h"
+#include "driver/include/m2m_wifi.h"
+#include "download.h"
+#include "iot/http/http_server_app.h"
+
+/** Role of the device on the direct link. */
+typedef enum {
+	DIRECT_NONE = 0, /*!< On the access point of MAIN_WLAN_SSID. */
+	DIRECT_SERVE, /*!< Serving the image on its own access point. */
+	DIRECT_JOIN /*!< Downloading from the access point of a neighbour. */
+} direct_mode_t;
+static direct_mode_t direct_mode = DIRECT_NONE;
+/** The access point of the direct link is open. */
+static bool direct_ap_open = false;
+/** Failed connections to MAIN_WLAN_SSID in a row. */
+static uint8_t direct_failures = 0;
+/** Copies of the image served on the access point. */
+static uint32_t direct_copies = 0;
+/** End of the serving. */
+static Timer direct_serve_timer;
+/** Image being served. */
+static FIL direct_file_object;
+/** URL of the image on the neighbour. */
+static char direct_url[sizeof("http://255.255.255.255/") + MAIN_MAX_FILE_NAME_LENGTH];
+/** Instance of HTTP server module serving the image. */
+static struct http_server_module http_server_inst;
+
+/**
+ * \brief Read the image served to a neighbour.
+ */
+static int direct_entity_read(void *priv_data, char *buffer, uint32_t size, uint32_t written)
+{
+	UINT rsize = 0;
+
+	UNUSED(priv_data);
+	if (f_lseek(&direct_file_object, written) != FR_OK
+			|| f_read(&direct_file_object, buffer, size, &rsize) != FR_OK) {
+		return -EIO;
+	}
+	return (int)rsize;
+}
+
+/**
+ * \brief Length of the image served to a neighbour.
+ */
+static int direct_entity_get_length(void *priv_data)
+{
+	UNUSED(priv_data);
+	return (int)f_size(&direct_file_object);
+}
+
+/**
+ * \brief Type of the image served to a neighbour.
+ */
+static const char *direct_entity_get_type(void *priv_data)
+{
+	UNUSED(priv_data);
+	return "application/octet-stream";
+}
+
+/**
+ * \brief Close the image once served.
+ */
+static void direct_entity_close(void *priv_data)
+{
+	UNUSED(priv_data);
+	f_close(&direct_file_object);
+}
+
+/**
+ * \brief Callback of the HTTP server serving the image to the neighbours.
+ *
+ * \param[in]  module_inst     Module instance of HTTP server module.
+ * \param[in]  type            Type of event.
+ * \param[in]  data            Data structure of the event. \refer http_server_data
+ */
+static void http_server_callback(struct http_server_module *module_inst, int type, union http_server_data *data)
+{
+	UNUSED(module_inst);
+
+	switch (type) {
+	case HTTP_SERVER_CALLBACK_REQUEST:
+		printf("http_server_callback: %s requested by %d.%d.%d.%d\r\n", data->request.uri,
+				(int)IPV4_BYTE(data->request.addr, 0), (int)IPV4_BYTE(data->request.addr, 1),
+				(int)IPV4_BYTE(data->request.addr, 2), (int)IPV4_BYTE(data->request.addr, 3));
+		/* Only the image is served, under the same name as on the card. */
+		if (set_file_name() && data->request.uri[0] == '/' && !strcmp(data->request.uri + 1, &save_file_name[2])
+				&& f_open(&direct_file_object, save_file_name, FA_READ) == FR_OK) {
+			data->request.entity->read = direct_entity_read;
+			data->request.entity->get_contents_length = direct_entity_get_length;
+			data->request.entity->get_contents_type = direct_entity_get_type;
+			data->request.entity->close = direct_entity_close;
+		}
+		break;
+
+	case HTTP_SERVER_CALLBACK_SENT:
+		if (data->sent.response_code == 200 && data->sent.reason == 0) {
+			direct_copies++;
+		}
+		printf("http_server_callback: response %u, %lu bytes sent (%d), %lu copies served\r\n",
+				(unsigned int)data->sent.response_code, (unsigned long)data->sent.length,
+				data->sent.reason, (unsigned long)direct_copies);
+		break;
+
+	default:
+		break;
+	}
+}
+
+void configure_direct(void)
+{
+	struct http_server_config server_conf;
+	int ret;
+
+	http_server_get_config_defaults(&server_conf);
+	server_conf.timer_inst = &swt_module_inst;
+
+	ret = http_server_init(&http_server_inst, &server_conf);
+	if (ret < 0) {
+		printf("configure_direct: HTTP server initialization failed! (res %d)\r\n", ret);
+		while (1) {
+		} /* Loop forever. */
+	}
+
+	http_server_register_callback(&http_server_inst, http_server_callback);
+	m2m_wifi_set_sleep_mode(MAIN_DIRECT_IDLE_SLEEP_MODE, 1);
+}
+
+/**
+ * \brief Restore the port of the HTTP client after a download from a neighbour.
+ */
+static void leave_direct_join(void)
+{
+	bool tls = (strncmp(MAIN_HTTP_FILE_URL, "https://", 8) == 0);
+
+	http_client_module_inst.config.tls = tls;
+	http_client_module_inst.config.port = tls ? 443 : 80;
+	m2m_wifi_set_sleep_mode(MAIN_DIRECT_IDLE_SLEEP_MODE, 1);
+}
+
+/**
+ * \brief Open the access point of the direct link and serve the image.
+ */
+static void open_direct_ap(void)
+{
+	tstrM2MAPConfig ap_conf;
+	uint8_t addr[4] = MAIN_DIRECT_ADDR;
+
+	memset(&ap_conf, 0, sizeof(tstrM2MAPConfig));
+	strcpy((char *)ap_conf.au8SSID, MAIN_DIRECT_SSID);
+	ap_conf.u8ListenChannel = MAIN_DIRECT_CHANNEL;
+	ap_conf.u8SecType = M2M_WIFI_SEC_WPA_PSK;
+	ap_conf.u8KeySz = strlen(MAIN_DIRECT_PSK);
+	strcpy((char *)ap_conf.au8Key, MAIN_DIRECT_PSK);
+	memcpy(ap_conf.au8DHCPServerIP, addr, sizeof(addr));
+
+	/* Full throughput for the duration of the link. */
+	m2m_wifi_set_sleep_mode(M2M_NO_PS, 1);
+	if (m2m_wifi_enable_ap(&ap_conf) != M2M_SUCCESS || http_server_start(&http_server_inst) < 0) {
+		printf("open_direct_ap: access point failed!\r\n");
+		m2m_wifi_disable_ap();
+		direct_mode = DIRECT_NONE;
+		m2m_wifi_set_sleep_mode(MAIN_DIRECT_IDLE_SLEEP_MODE, 1);
+		m2m_wifi_connect((char *)MAIN_WLAN_SSID, sizeof(MAIN_WLAN_SSID), MAIN_WLAN_AUTH, (char *)MAIN_WLAN_PSK, M2M_WIFI_CH_ALL);
+		return;
+	}
+	direct_ap_open = true;
+	direct_copies = 0;
+	TimerCountdown(&direct_serve_timer, MAIN_DIRECT_SERVE_TIME);
+	printf("open_direct_ap: serving the image on %s for %u s.\r\n", MAIN_DIRECT_SSID, MAIN_DIRECT_SERVE_TIME);
+}
+
+/**
+ * \brief Leave the station link once the image is downloaded, to serve it.
+ */
+static void start_direct_serve(void)
+{
+	bool connected = is_state_set(WIFI_CONNECTED);
+
+	if (direct_mode == DIRECT_JOIN) {
+		leave_direct_join();
+	}
+	/* The next download starts after the serving. */
+	clear_state((download_state)~STORAGE_READY);
+	direct_mode = DIRECT_SERVE;
+	if (connected) {
+		/* Opened on the disconnection. */
+		m2m_wifi_disconnect();
+	} else {
+		open_direct_ap();
+	}
+}
+
+/**
+ * \brief Close the access point of the direct link and connect to MAIN_WLAN_SSID again.
+ */
+static void stop_direct_serve(void)
+{
+	printf("stop_direct_serve: %lu copies served.\r\n", (unsigned long)direct_copies);
+	http_server_stop(&http_server_inst);
+	m2m_wifi_disable_ap();
+	direct_ap_open = false;
+	direct_mode = DIRECT_NONE;
+	direct_failures = 0;
+	m2m_wifi_set_sleep_mode(MAIN_DIRECT_IDLE_SLEEP_MODE, 1);
+	m2m_wifi_connect((char *)MAIN_WLAN_SSID, sizeof(MAIN_WLAN_SSID), MAIN_WLAN_AUTH, (char *)MAIN_WLAN_PSK, M2M_WIFI_CH_ALL);
+}
+
+bool start_direct_link(bool was_connected)
+{
+	switch (direct_mode) {
+	case DIRECT_SERVE:
+		open_direct_ap();
+		return true;
+
+	case DIRECT_JOIN:
+		/* The neighbour left or was not found. */
+		leave_direct_join();
+		direct_mode = DIRECT_NONE;
+		direct_failures = 0;
+		return false;
+
+	default:
+		if (was_connected) {
+			direct_failures = 0;
+			return false;
+		}
+		if (++direct_failures < MAIN_DIRECT_JOIN_AFTER) {
+			return false;
+		}
+		printf("start_direct_link: %s not reachable, joining %s...\r\n", (char *)MAIN_WLAN_SSID, MAIN_DIRECT_SSID);
+		direct_mode = DIRECT_JOIN;
+		m2m_wifi_set_sleep_mode(M2M_NO_PS, 1);
+		m2m_wifi_connect((char *)MAIN_DIRECT_SSID, sizeof(MAIN_DIRECT_SSID), M2M_WIFI_SEC_WPA_PSK,
+				(char *)MAIN_DIRECT_PSK, MAIN_DIRECT_CHANNEL);
+		return true;
+	}
+}
+
+bool is_direct_ap_open(void)
+{
+	return direct_ap_open;
+}
+
+bool is_direct_serving(void)
+{
+	return direct_mode == DIRECT_SERVE;
+}
+
+bool start_direct_download(void)
+{
+	uint8_t addr[4] = MAIN_DIRECT_ADDR;
+
+	if (direct_mode != DIRECT_JOIN) {
+		return false;
+	}
+	if (!set_file_name()) {
+		printf("start_direct_download: file name is invalid.\r\n");
+		return true;
+	}
+	/* The neighbour serves plain HTTP. */
+	snprintf(direct_url, sizeof(direct_url), "http://%u.%u.%u.%u/%s",
+			addr[0], addr[1], addr[2], addr[3], &save_file_name[2]);
+	http_client_module_inst.config.tls = 0;
+	http_client_module_inst.config.port = 80;
+	printf("start_direct_download: sending HTTP request to the neighbour %s...\r\n", direct_url);
+	send_download_request(direct_url);
+	return true;
+}
+
+void direct_link_task(void)
+{
+	if (direct_mode != DIRECT_SERVE && is_state_set(COMPLETED)) {
+		start_direct_serve();
+	} else if (direct_ap_open && TimerIsExpired(&direct_serve_timer)) {
+		stop_direct_serve();
+	}
+}
+
+#endif /* MAIN_DIRECT_SSID */
@@ -0,0 +1,62 @@
+/**
+ * \file
+ *
+ * \brief Direct link of the HTTP File Downloader Example.
+ *
+ * With MAIN_DIRECT_SSID, the image is served over HTTP on an access point of
+ * the device for MAIN_DIRECT_SERVE_TIME after each download. A device failing
+ * MAIN_DIRECT_JOIN_AFTER times in a row to connect to MAIN_WLAN_SSID joins the
+ * access point of a neighbour and downloads the image from it instead.
+ *
+ */
+
+#ifndef HTTP_SERVER_APP_H_INCLUDED
+#define HTTP_SERVER_APP_H_INCLUDED
+
+#include <stdbool.h>
+#include "iot/http/http_server.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Configure the HTTP server of the direct link.
+ */
+void configure_direct(void);
+
+/**
+ * \brief Choose the next link after a disconnection.
+ * \param[in] was_connected The station had an IP address.
+ * \return true if the next link was started, false to connect to MAIN_WLAN_SSID.
+ */
+bool start_direct_link(bool was_connected);
+
+/**
+ * \brief The access point of the direct link is open.
+ * \return true if the Wi-Fi events come from the neighbours, false otherwise.
+ */
+bool is_direct_ap_open(void);
+
+/**
+ * \brief The image is being served, the next download starts after.
+ * \return true if serving, false otherwise.
+ */
+bool is_direct_serving(void);
+
+/**
+ * \brief Download the image from the neighbour, while joined to its access point.
+ * \return true if the download was handled, false to download from the server.
+ */
+bool start_direct_download(void);
+
+/**
+ * \brief Serve the image once downloaded, and stop serving after MAIN_DIRECT_SERVE_TIME.
+ */
+void direct_link_task(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTP_SERVER_APP_H_INCLUDED */
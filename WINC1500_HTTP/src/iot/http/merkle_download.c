@@ -0,0 +1,688 @@
+/**
+ * \file
+ *
+ * \brief Verified and resumable download of an image over HTTP.
+ *
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "iot/http/merkle_download.h"
+
+/** No block being hashed. */
+#define MERKLE_DOWNLOAD_NO_BLOCK        0xFFFFFFFF
+/** Height of the tree of the largest image, plus one. */
+#define MERKLE_DOWNLOAD_MAX_DEPTH       17
+
+enum merkle_download_state {
+	/** Not running. */
+	STATE_IDLE = 0,
+	/** Receiving the sidecar file. */
+	STATE_TREE,
+	/** Re-hashing the blocks written by the previous download. */
+	STATE_VERIFY,
+	/** Fetching the blocks left. */
+	STATE_FETCH,
+};
+
+/**
+ * \brief Report the end of the download and release the tables.
+ *
+ * The HTTP connection is closed by the next \ref merkle_download_task, not from
+ * inside an HTTP client callback.
+ *
+ * \param[in]  module          Module instance of Merkle download.
+ * \param[in]  reason          Result of the download.
+ */
+static void _merkle_download_complete(struct merkle_download_module *const module, int reason)
+{
+	union merkle_download_data data;
+
+	if (module->leaves != NULL) {
+		free(module->leaves);
+		module->leaves = NULL;
+		module->pending = NULL;
+	}
+	module->state = STATE_IDLE;
+	module->requesting = 0;
+	module->close_pending = 1;
+
+	data.completed.reason = reason;
+	data.completed.size = module->header.size;
+	data.completed.nb_block = module->nb_block;
+	data.completed.nb_resumed = module->nb_resumed;
+	data.completed.nb_failed = module->nb_failed;
+	if (module->cb) {
+		module->cb(module, MERKLE_DOWNLOAD_CALLBACK_COMPLETED, &data);
+	}
+}
+
+/**
+ * \brief Check if a block is still to be fetched.
+ */
+static inline int _merkle_download_is_pending(struct merkle_download_module *const module, uint32_t block)
+{
+	return module->pending[block >> 3] & (1 << (block & 7));
+}
+
+/**
+ * \brief Length of a block, the last one being shorter.
+ */
+static inline uint32_t _merkle_download_block_length(struct merkle_download_module *const module, uint32_t block)
+{
+	uint32_t length = module->header.size - (block << module->header.block_shift);
+	uint32_t block_size = (uint32_t)1 << module->header.block_shift;
+
+	return (length < block_size) ? length : block_size;
+}
+
+/**
+ * \brief Hash of an inner node of the tree. out may be left.
+ */
+static void _merkle_download_node(const uint8_t *left, const uint8_t *right, uint8_t *out)
+{
+	static const uint8_t prefix = 0x01;
+	struct sha256_context context;
+
+	sha256_init(&context);
+	sha256_update(&context, &prefix, 1);
+	sha256_update(&context, left, SHA256_DIGEST_LENGTH);
+	sha256_update(&context, right, SHA256_DIGEST_LENGTH);
+	sha256_final(&context, out);
+}
+
+/**
+ * \brief Compute the root from the leaf hashes.
+ *
+ * Leaves are merged as soon as they make a complete subtree, the subtrees left
+ * at the end from right to left, which gives the RFC 6962 tree hash.
+ */
+static void _merkle_download_root(struct merkle_download_module *const module, uint8_t *root)
+{
+	uint8_t stack[MERKLE_DOWNLOAD_MAX_DEPTH][SHA256_DIGEST_LENGTH];
+	uint32_t i, count;
+	int top = 0;
+
+	for (i = 0; i < module->nb_block; i++) {
+		memcpy(stack[top++], module->leaves + i * SHA256_DIGEST_LENGTH, SHA256_DIGEST_LENGTH);
+		for (count = i + 1; (count & 1) == 0; count >>= 1) {
+			top--;
+			_merkle_download_node(stack[top - 1], stack[top], stack[top - 1]);
+		}
+	}
+	while (top > 1) {
+		top--;
+		_merkle_download_node(stack[top - 1], stack[top], stack[top - 1]);
+	}
+	memcpy(root, stack[0], SHA256_DIGEST_LENGTH);
+}
+
+/**
+ * \brief Start hashing a block.
+ */
+static void _merkle_download_hash_start(struct merkle_download_module *const module, uint32_t block)
+{
+	static const uint8_t prefix = 0x00;
+
+	sha256_init(&module->digest);
+	sha256_update(&module->digest, &prefix, 1);
+	module->hash_block = block;
+	module->hash_length = 0;
+}
+
+/**
+ * \brief Compare the hash of a block with its leaf and mark it verified.
+ *
+ * \return     Non zero if the block is verified.
+ */
+static int _merkle_download_hash_done(struct merkle_download_module *const module)
+{
+	uint8_t digest[SHA256_DIGEST_LENGTH];
+	uint32_t block = module->hash_block;
+
+	module->hash_block = MERKLE_DOWNLOAD_NO_BLOCK;
+	sha256_final(&module->digest, digest);
+	if (memcmp(digest, module->leaves + block * SHA256_DIGEST_LENGTH, SHA256_DIGEST_LENGTH)) {
+		return 0;
+	}
+	module->pending[block >> 3] &= ~(1 << (block & 7));
+
+	return 1;
+}
+
+/**
+ * \brief Report the verified prefix of the image when it grew enough.
+ *
+ * \param[in]  module          Module instance of Merkle download.
+ * \param[in]  force           Report any progress.
+ */
+static void _merkle_download_checkpoint(struct merkle_download_module *const module, int force)
+{
+	union merkle_download_data data;
+	uint32_t verified = module->resume.verified;
+
+	while (verified < module->nb_block && !_merkle_download_is_pending(module, verified)) {
+		verified++;
+	}
+	if (verified == module->resume.verified
+			|| (!force && verified - module->resume.verified < module->config.checkpoint_interval)) {
+		return;
+	}
+
+	module->resume.verified = verified;
+	data.checkpoint.resume = &module->resume;
+	if (module->cb) {
+		module->cb(module, MERKLE_DOWNLOAD_CALLBACK_CHECKPOINT, &data);
+	}
+}
+
+/**
+ * \brief Check the sidecar header and allocate the leaves.
+ *
+ * \return     0               Function succeeded
+ * \return     -EPROTO         Invalid or unsupported header.
+ * \return     -EFBIG          Too many blocks.
+ * \return     -ENOMEM         Out of memory.
+ */
+static int _merkle_download_alloc(struct merkle_download_module *const module)
+{
+	struct merkle_download_header *header = &module->header;
+	uint32_t bitmap_length;
+
+	if (header->magic != MERKLE_DOWNLOAD_MAGIC || header->version != MERKLE_DOWNLOAD_VERSION
+			|| header->block_shift < MERKLE_DOWNLOAD_MIN_BLOCK_SHIFT
+			|| header->block_shift > MERKLE_DOWNLOAD_MAX_BLOCK_SHIFT || header->size == 0) {
+		return -EPROTO;
+	}
+
+	module->nb_block = ((header->size - 1) >> header->block_shift) + 1;
+	if (module->nb_block > module->config.max_block) {
+		return -EFBIG;
+	}
+
+	bitmap_length = (module->nb_block + 7) >> 3;
+	module->leaves = malloc(module->nb_block * SHA256_DIGEST_LENGTH + bitmap_length);
+	if (module->leaves == NULL) {
+		return -ENOMEM;
+	}
+	module->pending = module->leaves + module->nb_block * SHA256_DIGEST_LENGTH;
+
+	return 0;
+}
+
+/**
+ * \brief Parse a piece of the sidecar file.
+ *
+ * \return     0               Function succeeded
+ * \return     otherwise       Error of \ref _merkle_download_alloc, or -EPROTO on extra data.
+ */
+static int _merkle_download_tree_data(struct merkle_download_module *const module, const uint8_t *data, uint32_t length)
+{
+	uint32_t copy;
+	int ret;
+
+	if (module->tree_length < sizeof(struct merkle_download_header)) {
+		copy = sizeof(struct merkle_download_header) - module->tree_length;
+		copy = (length < copy) ? length : copy;
+		memcpy((uint8_t *)&module->header + module->tree_length, data, copy);
+		module->tree_length += copy;
+		data += copy;
+		length -= copy;
+		if (module->tree_length < sizeof(struct merkle_download_header)) {
+			return 0;
+		}
+		if (module->leaves == NULL) {
+			ret = _merkle_download_alloc(module);
+			if (ret < 0) {
+				return ret;
+			}
+		}
+	}
+
+	if (module->tree_length + length > sizeof(struct merkle_download_header) + module->nb_block * SHA256_DIGEST_LENGTH) {
+		return -EPROTO;
+	}
+	memcpy(module->leaves + module->tree_length - sizeof(struct merkle_download_header), data, length);
+	module->tree_length += length;
+
+	return 0;
+}
+
+/**
+ * \brief Authenticate the leaves and select the blocks to be re-hashed and fetched.
+ *
+ * \return     0               Function succeeded
+ * \return     -EPROTO         Sidecar file is truncated.
+ * \return     -EACCES         Root mismatch.
+ */
+static int _merkle_download_tree_done(struct merkle_download_module *const module)
+{
+	uint8_t root[SHA256_DIGEST_LENGTH];
+	uint32_t i;
+
+	if (module->leaves == NULL || module->tree_length != sizeof(struct merkle_download_header)
+			+ module->nb_block * SHA256_DIGEST_LENGTH) {
+		return -EPROTO;
+	}
+
+	_merkle_download_root(module, root);
+	if (memcmp(root, module->header.root, SHA256_DIGEST_LENGTH)
+			|| (module->config.root != NULL && memcmp(root, module->config.root, SHA256_DIGEST_LENGTH))) {
+		return -EACCES;
+	}
+
+	if (module->resume.size != module->header.size
+			|| memcmp(module->resume.root, root, SHA256_DIGEST_LENGTH)
+			|| module->resume.verified > module->nb_block) {
+		/* Another image. Record it before the first block is overwritten. */
+		memcpy(module->resume.root, root, SHA256_DIGEST_LENGTH);
+		module->resume.size = module->header.size;
+		module->resume.verified = 0;
+		module->written = 0;
+		if (module->cb) {
+			union merkle_download_data data;
+
+			data.checkpoint.resume = &module->resume;
+			module->cb(module, MERKLE_DOWNLOAD_CALLBACK_CHECKPOINT, &data);
+			if (module->state == STATE_IDLE) {
+				/* Aborted by the callback. */
+				return 0;
+			}
+		}
+	}
+
+	/* Verified blocks are kept. The blocks written after them are re-hashed. */
+	memset(module->pending, 0, (module->nb_block + 7) >> 3);
+	for (i = module->resume.verified; i < module->nb_block; i++) {
+		module->pending[i >> 3] |= 1 << (i & 7);
+	}
+	module->nb_resumed = module->resume.verified;
+	module->verify_block = module->resume.verified;
+	module->verify_end = (module->written >= module->header.size) ? module->nb_block
+			: module->written >> module->header.block_shift;
+	module->hash_block = MERKLE_DOWNLOAD_NO_BLOCK;
+	module->state = STATE_VERIFY;
+
+	return 0;
+}
+
+/**
+ * \brief Re-hash a part of the blocks written by the previous download.
+ */
+static void _merkle_download_verify(struct merkle_download_module *const module)
+{
+	uint8_t buffer[MERKLE_DOWNLOAD_READ_SIZE];
+	uint32_t budget = module->config.verify_budget;
+	uint32_t offset, length;
+
+	while (module->verify_block < module->verify_end) {
+		if (module->hash_block != module->verify_block) {
+			_merkle_download_hash_start(module, module->verify_block);
+		}
+		length = _merkle_download_block_length(module, module->verify_block) - module->hash_length;
+		length = (length < sizeof(buffer)) ? length : sizeof(buffer);
+		offset = (module->verify_block << module->header.block_shift) + module->hash_length;
+		if (module->config.read(module->config.priv_data, offset, buffer, length) != (int)length) {
+			_merkle_download_complete(module, -EIO);
+			return;
+		}
+		sha256_update(&module->digest, buffer, length);
+		module->hash_length += length;
+
+		if (module->hash_length == _merkle_download_block_length(module, module->verify_block)) {
+			module->verify_block++;
+			if (_merkle_download_hash_done(module)) {
+				module->nb_resumed++;
+				_merkle_download_checkpoint(module, 0);
+				if (module->state == STATE_IDLE) {
+					return;
+				}
+			}
+		}
+
+		if (budget <= length) {
+			/* Let the network events be handled. */
+			return;
+		}
+		budget -= length;
+	}
+
+	_merkle_download_checkpoint(module, 1);
+	if (module->state == STATE_IDLE) {
+		return;
+	}
+	module->fetch_block = 0;
+	module->round = 0;
+	module->state = STATE_FETCH;
+}
+
+/**
+ * \brief Write and hash a piece of a range response.
+ *
+ * Bytes of blocks already verified, or of a block whose beginning was not
+ * received, are skipped.
+ *
+ * \return     0               Function succeeded
+ * \return     -EBADMSG        Piece out of the image.
+ * \return     -EIO            Write error.
+ */
+static int _merkle_download_part(struct merkle_download_module *const module, struct http_client_data_recv_part *part)
+{
+	uint32_t offset = part->offset, length = part->length;
+	const uint8_t *data = (const uint8_t *)part->data;
+	uint32_t block, pos, piece;
+
+	if (offset + length > module->header.size) {
+		return -EBADMSG;
+	}
+
+	while (length > 0) {
+		block = offset >> module->header.block_shift;
+		pos = offset & (((uint32_t)1 << module->header.block_shift) - 1);
+		piece = _merkle_download_block_length(module, block) - pos;
+		piece = (length < piece) ? length : piece;
+
+		if (_merkle_download_is_pending(module, block)) {
+			if (pos == 0) {
+				_merkle_download_hash_start(module, block);
+			}
+			if (module->hash_block == block && module->hash_length == pos) {
+				if (module->config.write(module->config.priv_data, offset, data, piece) < 0) {
+					return -EIO;
+				}
+				sha256_update(&module->digest, data, piece);
+				module->hash_length += piece;
+				if (module->hash_length == _merkle_download_block_length(module, block)) {
+					if (_merkle_download_hash_done(module)) {
+						_merkle_download_checkpoint(module, 0);
+						if (module->state == STATE_IDLE) {
+							return 0;
+						}
+					} else {
+						/* Left pending, fetched again by the next round. */
+						module->nb_failed++;
+					}
+				}
+			}
+		}
+
+		offset += piece;
+		data += piece;
+		length -= piece;
+	}
+
+	return 0;
+}
+
+/**
+ * \brief Request the next blocks, or complete the download when none is left.
+ */
+static void _merkle_download_request(struct merkle_download_module *const module)
+{
+	struct http_client_range ranges[HTTP_MAX_RANGES];
+	uint32_t block = module->fetch_block, start;
+	int count = 0, ret;
+
+	for (;;) {
+		while (block < module->nb_block && count < HTTP_MAX_RANGES) {
+			if (!_merkle_download_is_pending(module, block)) {
+				block++;
+				continue;
+			}
+			/* Consecutive pending blocks make one range. */
+			for (start = block; block < module->nb_block && _merkle_download_is_pending(module, block); block++);
+			ranges[count].offset = start << module->header.block_shift;
+			ranges[count].length = ((block == module->nb_block) ? module->header.size
+					: block << module->header.block_shift) - ranges[count].offset;
+			count++;
+		}
+		if (count > 0 || module->fetch_block == 0) {
+			break;
+		}
+		/* End of the image, fetch the blocks which failed again. */
+		if (++module->round >= module->config.max_retry) {
+			_merkle_download_complete(module, -EBADMSG);
+			return;
+		}
+		block = module->fetch_block = 0;
+	}
+
+	if (count == 0) {
+		/* Every block is verified. */
+		_merkle_download_checkpoint(module, 1);
+		if (module->state != STATE_IDLE) {
+			_merkle_download_complete(module, 0);
+		}
+		return;
+	}
+
+	ret = http_client_send_ranges(&module->http, module->url, ranges, count, NULL);
+	if (ret == -EAGAIN || ret == -EBUSY) {
+		/* Previous response is still being received. Try again later. */
+		return;
+	}
+	if (ret < 0) {
+		_merkle_download_complete(module, ret);
+		return;
+	}
+	module->fetch_block = block;
+	module->hash_block = MERKLE_DOWNLOAD_NO_BLOCK;
+	module->requesting = 1;
+}
+
+/**
+ * \brief Callback of the HTTP client fetching the sidecar file and the blocks.
+ */
+static void _merkle_download_http_callback(struct http_client_module *module_inst, int type, union http_client_data *data)
+{
+	/* HTTP client is the first member of the module. */
+	struct merkle_download_module *const module = (struct merkle_download_module *)module_inst;
+	int ret = 0;
+
+	if (module->state == STATE_IDLE) {
+		return;
+	}
+
+	switch (type) {
+	case HTTP_CLIENT_CALLBACK_RECV_RESPONSE:
+		if (module->state == STATE_TREE) {
+			if (data->recv_response.response_code != 200) {
+				ret = -ENOENT;
+			} else if (data->recv_response.content != NULL) {
+				/* Whole sidecar file in the receive buffer. */
+				module->requesting = 0;
+				ret = _merkle_download_tree_data(module, (uint8_t *)data->recv_response.content,
+						data->recv_response.content_length);
+				if (ret == 0) {
+					ret = _merkle_download_tree_done(module);
+				}
+			}
+		} else if (data->recv_response.response_code != 206 && data->recv_response.response_code != 200) {
+			ret = -ENOENT;
+		}
+		break;
+
+	case HTTP_CLIENT_CALLBACK_RECV_CHUNKED_DATA:
+		if (module->state == STATE_TREE) {
+			ret = _merkle_download_tree_data(module, (uint8_t *)data->recv_chunked_data.data,
+					data->recv_chunked_data.length);
+			if (ret == 0 && data->recv_chunked_data.is_complete) {
+				module->requesting = 0;
+				ret = _merkle_download_tree_done(module);
+			}
+		}
+		break;
+
+	case HTTP_CLIENT_CALLBACK_RECV_PART:
+		if (module->state == STATE_FETCH) {
+			if (data->recv_part.is_complete) {
+				/* Next blocks are requested from the main loop. */
+				module->requesting = 0;
+			} else {
+				ret = _merkle_download_part(module, &data->recv_part);
+			}
+		}
+		break;
+
+	case HTTP_CLIENT_CALLBACK_DISCONNECTED:
+		if (module->requesting) {
+			ret = (data->disconnected.reason < 0) ? data->disconnected.reason : -ECONNRESET;
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	if (ret < 0) {
+		_merkle_download_complete(module, ret);
+	}
+}
+
+void merkle_download_get_config_defaults(struct merkle_download_config *const config)
+{
+	config->port = 80;
+	config->tls = 0;
+	config->timer_inst = NULL;
+	config->recv_buffer = NULL;
+	config->recv_buffer_size = 1446;
+	config->max_block = 128;
+	config->verify_budget = 4096;
+	config->max_retry = 3;
+	config->checkpoint_interval = 16;
+	config->root = NULL;
+	config->read = NULL;
+	config->write = NULL;
+	config->priv_data = NULL;
+}
+
+int merkle_download_init(struct merkle_download_module *const module, struct merkle_download_config *config)
+{
+	struct http_client_config httpc_conf;
+	int ret;
+
+	if (module == NULL || config == NULL) {
+		return -EINVAL;
+	}
+
+	if (config->read == NULL || config->write == NULL || config->max_block == 0
+			|| config->verify_budget == 0 || config->max_retry == 0 || config->checkpoint_interval == 0) {
+		return -EINVAL;
+	}
+
+	memset(module, 0, sizeof(struct merkle_download_module));
+	memcpy(&module->config, config, sizeof(struct merkle_download_config));
+
+	http_client_get_config_defaults(&httpc_conf);
+	httpc_conf.port = config->port;
+	httpc_conf.tls = config->tls;
+	httpc_conf.timer_inst = config->timer_inst;
+	httpc_conf.recv_buffer = config->recv_buffer;
+	httpc_conf.recv_buffer_size = config->recv_buffer_size;
+	ret = http_client_init(&module->http, &httpc_conf);
+	if (ret < 0) {
+		return ret;
+	}
+	http_client_register_callback(&module->http, _merkle_download_http_callback);
+
+	module->state = STATE_IDLE;
+
+	return 0;
+}
+
+int merkle_download_deinit(struct merkle_download_module *const module)
+{
+	if (module == NULL) {
+		return -EINVAL;
+	}
+
+	if (module->leaves != NULL) {
+		free(module->leaves);
+	}
+	http_client_unregister_callback(&module->http);
+	http_client_close(&module->http);
+	http_client_deinit(&module->http);
+
+	memset(module, 0, sizeof(struct merkle_download_module));
+
+	return 0;
+}
+
+int merkle_download_register_callback(struct merkle_download_module *const module, merkle_download_callback_t callback)
+{
+	if (module == NULL) {
+		return -EINVAL;
+	}
+
+	module->cb = callback;
+
+	return 0;
+}
+
+int merkle_download_start(struct merkle_download_module *const module, const char *url, const char *tree_url,
+		const struct merkle_download_resume *resume, uint32_t written)
+{
+	int ret;
+
+	if (module == NULL || url == NULL || tree_url == NULL) {
+		return -EINVAL;
+	}
+
+	if (module->state != STATE_IDLE) {
+		return -EBUSY;
+	}
+
+	module->url = url;
+	module->written = written;
+	if (resume != NULL) {
+		memcpy(&module->resume, resume, sizeof(struct merkle_download_resume));
+	} else {
+		memset(&module->resume, 0, sizeof(struct merkle_download_resume));
+	}
+	memset(&module->header, 0, sizeof(struct merkle_download_header));
+	module->tree_length = 0;
+	module->nb_block = 0;
+	module->nb_resumed = 0;
+	module->nb_failed = 0;
+
+	ret = http_client_send_request(&module->http, tree_url, HTTP_METHOD_GET, NULL, NULL);
+	if (ret < 0) {
+		return ret;
+	}
+	module->close_pending = 0;
+	module->requesting = 1;
+	module->state = STATE_TREE;
+
+	return 0;
+}
+
+void merkle_download_abort(struct merkle_download_module *const module)
+{
+	if (module != NULL && module->state != STATE_IDLE) {
+		_merkle_download_complete(module, -ECANCELED);
+	}
+}
+
+void merkle_download_task(struct merkle_download_module *const module)
+{
+	if (module->close_pending) {
+		module->close_pending = 0;
+		http_client_close(&module->http);
+	}
+
+	switch (module->state) {
+	case STATE_VERIFY:
+		_merkle_download_verify(module);
+		break;
+
+	case STATE_FETCH:
+		if (!module->requesting) {
+			_merkle_download_request(module);
+		}
+		break;
+
+	default:
+		break;
+	}
+}
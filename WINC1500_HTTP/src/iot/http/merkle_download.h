@@ -0,0 +1,369 @@
+/**
+ * \file
+ *
+ * \brief Verified and resumable download of an image over HTTP.
+ *
+ * The image is split in blocks, each one hashed in a Merkle tree published in a
+ * small sidecar file. Every block is checked against its leaf hash once it is
+ * written; a block that does not match is fetched again with a range request,
+ * not the whole image. The verified prefix of the image is reported as a
+ * checkpoint, so that a download interrupted by a reboot only re-hashes the
+ * blocks written after the last checkpoint.
+ *
+ * Sidecar file layout, multi-byte values in little endian:
+ * - struct merkle_download_header.
+ * - For every block of the image, its leaf hash: SHA-256 of the byte 0x00
+ *   followed by the block (the last block is not padded).
+ *
+ * The root is the Merkle tree hash of RFC 6962: a node is the SHA-256 of the
+ * byte 0x01 followed by its two children, and n leaves are split at the largest
+ * power of two smaller than n.
+ *
+ */
+
+#ifndef MERKLE_DOWNLOAD_H_INCLUDED
+#define MERKLE_DOWNLOAD_H_INCLUDED
+
+#include <stdint.h>
+#include <compiler.h>
+#include "iot/http/http_client.h"
+#include "iot/sha256.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Magic of the sidecar file ("MRKL"). */
+#define MERKLE_DOWNLOAD_MAGIC           0x4C4B524D
+/** Format version of the sidecar file. */
+#define MERKLE_DOWNLOAD_VERSION         1
+/** Smallest block size (log2). */
+#define MERKLE_DOWNLOAD_MIN_BLOCK_SHIFT 9
+/** Largest block size (log2). */
+#define MERKLE_DOWNLOAD_MAX_BLOCK_SHIFT 16
+/** Bytes of the image read at once while re-hashing. */
+#define MERKLE_DOWNLOAD_READ_SIZE       64
+
+/**
+ * \brief Header of the sidecar file.
+ */
+COMPILER_PACK_SET(1)
+struct merkle_download_header {
+	/** Shall be \ref MERKLE_DOWNLOAD_MAGIC. */
+	uint32_t magic;
+	/** Shall be \ref MERKLE_DOWNLOAD_VERSION. */
+	uint8_t version;
+	/** Size of a block (log2), from MERKLE_DOWNLOAD_MIN_BLOCK_SHIFT to MERKLE_DOWNLOAD_MAX_BLOCK_SHIFT. */
+	uint8_t block_shift;
+	/** Shall be zero. */
+	uint8_t reserved[2];
+	/** Size of the image in bytes. */
+	uint32_t size;
+	/** Root of the Merkle tree. */
+	uint8_t root[SHA256_DIGEST_LENGTH];
+};
+COMPILER_PACK_RESET()
+
+/**
+ * \brief Progress of a download, kept by the application across reboots.
+ */
+struct merkle_download_resume {
+	/** Root of the Merkle tree of the image being downloaded. */
+	uint8_t root[SHA256_DIGEST_LENGTH];
+	/** Size of the image. */
+	uint32_t size;
+	/** Number of leading blocks written and verified. */
+	uint32_t verified;
+};
+
+/**
+ * \brief A type of Merkle download callback.
+ */
+enum merkle_download_callback_type {
+	/**
+	 * More blocks were verified. The application should make the written data
+	 * durable, then save the progress for \ref merkle_download_start.
+	 * \ref merkle_download_abort may be called from this callback.
+	 */
+	MERKLE_DOWNLOAD_CALLBACK_CHECKPOINT,
+	/** The download is over. */
+	MERKLE_DOWNLOAD_CALLBACK_COMPLETED,
+};
+
+/**
+ * \brief Structure of the MERKLE_DOWNLOAD_CALLBACK_CHECKPOINT callback.
+ */
+struct merkle_download_data_checkpoint {
+	/** Progress to be saved. Only valid during the callback. */
+	const struct merkle_download_resume *resume;
+};
+
+/**
+ * \brief Structure of the MERKLE_DOWNLOAD_CALLBACK_COMPLETED callback.
+ */
+struct merkle_download_data_completed {
+	/**
+	 * Result of the download.
+	 *
+	 * \return     0               The whole image was written and verified.
+	 * \return     -ECANCELED      Aborted by \ref merkle_download_abort.
+	 * \return     -EPROTO         Sidecar file is invalid or unsupported.
+	 * \return     -EACCES         Root does not match the sidecar or the expected root.
+	 * \return     -EFBIG          Image has more blocks than max_block.
+	 * \return     -ENOMEM         Out of memory.
+	 * \return     -EIO            Reading or writing the image failed.
+	 * \return     -EBADMSG        Blocks still failed after max_retry requests, or data out of the image.
+	 * \return     -ENOENT         Server did not answer 200 or 206.
+	 * \return     otherwise       Disconnect reason of the HTTP client.
+	 */
+	int reason;
+	/** Size of the image, zero if the sidecar was not received. */
+	uint32_t size;
+	/** Number of blocks of the image. */
+	uint32_t nb_block;
+	/** Number of blocks kept from a previous download. */
+	uint32_t nb_resumed;
+	/** Number of received blocks which failed verification. */
+	uint32_t nb_failed;
+};
+
+/**
+ * \brief Structure of the Merkle download callback.
+ */
+union merkle_download_data {
+	struct merkle_download_data_checkpoint checkpoint;
+	struct merkle_download_data_completed completed;
+};
+
+/* Before declaring for the callback type. */
+struct merkle_download_module;
+/**
+ * \brief Callback interface of Merkle download.
+ *
+ * \param[in]  module_inst     Module instance of Merkle download.
+ * \param[in]  type            Type of event.
+ * \param[in]  data            Data structure of the event. \refer merkle_download_data
+ */
+typedef void (*merkle_download_callback_t)(struct merkle_download_module *module_inst, int type, union merkle_download_data *data);
+
+/**
+ * \brief Merkle download configuration structure
+ *
+ * Configuration struct for a Merkle download instance. This structure should be
+ * initialized by the \ref merkle_download_get_config_defaults function before being
+ * modified by the user application.
+ */
+struct merkle_download_config {
+	/**
+	 * TCP port number of the server.
+	 * Default value is 80.
+	 */
+	uint16_t port;
+	/**
+	 * A flag for the whether using the TLS socket or not.
+	 * Default value is 0.
+	 */
+	uint8_t tls;
+	/**
+	 * Timer module for the request timeout.
+	 * Default value is NULL.
+	 */
+	struct sw_timer_module *timer_inst;
+	/**
+	 * Rx buffer of the HTTP client.
+	 * Default value is NULL.
+	 */
+	char *recv_buffer;
+	/**
+	 * Maximum size of the receive buffer.
+	 * Default value is 1446.
+	 */
+	uint32_t recv_buffer_size;
+	/**
+	 * Largest number of blocks of an image. The leaf hashes take 32 bytes per
+	 * block in the heap.
+	 * Default value is 128.
+	 */
+	uint16_t max_block;
+	/**
+	 * Bytes of the image re-hashed by one call of \ref merkle_download_task.
+	 * Default value is 4096.
+	 */
+	uint32_t verify_budget;
+	/**
+	 * Number of requests in which a block may fail verification before the
+	 * download is given up.
+	 * Default value is 3.
+	 */
+	uint8_t max_retry;
+	/**
+	 * Number of newly verified blocks between two checkpoints.
+	 * Default value is 16.
+	 */
+	uint16_t checkpoint_interval;
+	/**
+	 * Expected root of the Merkle tree, or NULL to trust the sidecar file.
+	 * This value is must located in the Heap or code region.
+	 * Default value is NULL.
+	 */
+	const uint8_t *root;
+	/**
+	 * Read the image written so far.
+	 *
+	 * \return Number of bytes read, negative on error.
+	 */
+	int (*read)(void *priv_data, uint32_t offset, void *buffer, uint32_t length);
+	/**
+	 * Write data of the image at an offset. Writes are sequential except when
+	 * a block is fetched again.
+	 *
+	 * \return 0 if succeeded, negative on error.
+	 */
+	int (*write)(void *priv_data, uint32_t offset, const void *data, uint32_t length);
+	/**
+	 * Private data of the read and write functions.
+	 * Default value is NULL.
+	 */
+	void *priv_data;
+};
+
+/**
+ * \brief Structure of Merkle download instance.
+ */
+struct merkle_download_module {
+	/** HTTP client fetching the sidecar file and the blocks. */
+	struct http_client_module http;
+
+	/** State of the download. */
+	uint8_t state;
+	/** A flag for a request in progress. */
+	uint8_t requesting      : 1;
+	/** A flag for the HTTP connection to be closed by \ref merkle_download_task. */
+	uint8_t close_pending   : 1;
+	/** Number of times the blocks were requested from the first one. */
+	uint8_t round;
+
+	/** URL of the image. It must stay valid until the download completes. */
+	const char *url;
+	/** Size of the image already on the storage. */
+	uint32_t written;
+
+	/** Header of the sidecar file. */
+	struct merkle_download_header header;
+	/** Number of blocks of the image. */
+	uint32_t nb_block;
+	/** Bytes of the sidecar file received. */
+	uint32_t tree_length;
+
+	/** Leaf hashes, followed by the bitmap of the blocks to be fetched. */
+	uint8_t *leaves;
+	/** Bitmap of the blocks to be fetched. */
+	uint8_t *pending;
+
+	/** Progress reported at the last checkpoint. */
+	struct merkle_download_resume resume;
+
+	/** Next block to be re-hashed, and end of the blocks to be re-hashed. */
+	uint32_t verify_block, verify_end;
+	/** Next block to be requested. */
+	uint32_t fetch_block;
+	/** Block being hashed, and bytes of it hashed. */
+	uint32_t hash_block, hash_length;
+	/** Leaf hash of the block being hashed. */
+	struct sha256_context digest;
+
+	/** Statistics reported on completion. */
+	uint32_t nb_resumed, nb_failed;
+
+	/** Callback interface entry. */
+	merkle_download_callback_t cb;
+
+	/** Configuration instance of Merkle download. That was registered from the \ref merkle_download_init*/
+	struct merkle_download_config config;
+};
+
+/**
+ * \brief Get default configuration of Merkle download.
+ *
+ * \param[in]  config          Pointer of configuration structure which will be used in the module.
+ */
+void merkle_download_get_config_defaults(struct merkle_download_config *const config);
+
+/**
+ * \brief Initialize Merkle download.
+ *
+ * \param[in]  module          Module instance of Merkle download.
+ * \param[in]  config          Pointer of configuration structure which will be used in the module.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ * \return     -ENOSPC         No timer left.
+ * \return     -ENOMEM         Out of memory.
+ */
+int merkle_download_init(struct merkle_download_module *const module, struct merkle_download_config *config);
+
+/**
+ * \brief Terminate Merkle download.
+ *
+ * \param[in]  module          Module instance of Merkle download.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ */
+int merkle_download_deinit(struct merkle_download_module *const module);
+
+/**
+ * \brief Register and enable the callback.
+ *
+ * \param[in]  module          Module instance of Merkle download.
+ * \param[in]  callback        Callback entry for Merkle download.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ */
+int merkle_download_register_callback(struct merkle_download_module *const module, merkle_download_callback_t callback);
+
+/**
+ * \brief Start downloading the image.
+ *
+ * When resume describes the same image as the sidecar file, its verified blocks
+ * are kept and the blocks written after them are re-hashed. Otherwise the
+ * image is downloaded from its first block. The result is reported by
+ * MERKLE_DOWNLOAD_CALLBACK_COMPLETED.
+ *
+ * \param[in]  module          Module instance of Merkle download.
+ * \param[in]  url             URL of the image. It must stay valid until completion.
+ * \param[in]  tree_url        URL of the sidecar file.
+ * \param[in]  resume          Progress saved at the last checkpoint, or NULL.
+ * \param[in]  written         Size of the image already on the storage.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ * \return     -EBUSY          Download already running.
+ * \return     otherwise       Error of \ref http_client_send_request.
+ */
+int merkle_download_start(struct merkle_download_module *const module, const char *url, const char *tree_url,
+		const struct merkle_download_resume *resume, uint32_t written);
+
+/**
+ * \brief Stop the download. MERKLE_DOWNLOAD_CALLBACK_COMPLETED reports -ECANCELED.
+ *
+ * \param[in]  module          Module instance of Merkle download.
+ */
+void merkle_download_abort(struct merkle_download_module *const module);
+
+/**
+ * \brief Re-hash the resumed blocks and send the range requests.
+ *
+ * Must be called from the main loop. Each call re-hashes at most verify_budget
+ * bytes so that network events keep being handled.
+ *
+ * \param[in]  module          Module instance of Merkle download.
+ */
+void merkle_download_task(struct merkle_download_module *const module);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MERKLE_DOWNLOAD_H_INCLUDED */
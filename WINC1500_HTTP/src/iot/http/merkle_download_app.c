@@ -0,0 +1,222 @@
+/**
+ * \file
+ *
+ * \brief Merkle download of the image of the HTTP File Downloader Example.
+ *
+ */
+
+#include "main.h"
+
+#ifdef MAIN_HTTP_MERKLE_URL
+
+#ifdef MAIN_STORAGE_IMAGE_SLOT
+#error "MAIN_HTTP_MERKLE_URL needs the image in a FAT file."
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include "asf.h"
+#include "download.h"
+#include "iot/http/merkle_download_app.h"
+#ifdef SD_MMC_SPI_BUSY_STATS
+#include "sd_mmc_spi.h"
+#endif
+
+/** Instance of Merkle download verifying the image block by block. */
+struct merkle_download_module merkle_download_inst;
+/** File of the download progress. */
+static FIL merkle_state_file;
+/** Name of the file of the download progress. */
+static char merkle_state_file_name[] = "0:" MAIN_MERKLE_STATE_FILE_NAME;
+/** The server has no Merkle tree of the image, download it without. */
+static bool merkle_failed = false;
+
+/**
+ * \brief Read the image written so far for the Merkle download.
+ */
+static int merkle_read(void *priv_data, uint32_t offset, void *buffer, uint32_t length)
+{
+	UINT rsize = 0;
+
+	UNUSED(priv_data);
+	if (f_lseek(&file_object, offset) != FR_OK
+			|| f_read(&file_object, buffer, length, &rsize) != FR_OK) {
+		return -EIO;
+	}
+	return (int)rsize;
+}
+
+/**
+ * \brief Write the image for the Merkle download.
+ */
+static int merkle_write(void *priv_data, uint32_t offset, const void *data, uint32_t length)
+{
+	UNUSED(priv_data);
+	/* Only a block fetched again moves the file pointer back. */
+	if (f_tell(&file_object) != offset && f_lseek(&file_object, offset) != FR_OK) {
+		return -EIO;
+	}
+	if (!write_file(data, length)) {
+		return -EIO;
+	}
+	return 0;
+}
+
+/**
+ * \brief Load the progress of the previous Merkle download.
+ * \param[out] resume Progress.
+ * \return true if the progress is loaded, false otherwise.
+ */
+static bool load_merkle_state(struct merkle_download_resume *resume)
+{
+	UINT rsize = 0;
+
+	merkle_state_file_name[0] = LUN_ID_SD_MMC_0_MEM + '0';
+	if (f_open(&merkle_state_file, merkle_state_file_name, FA_READ) != FR_OK) {
+		return false;
+	}
+	f_read(&merkle_state_file, resume, sizeof(struct merkle_download_resume), &rsize);
+	f_close(&merkle_state_file);
+	return (rsize == sizeof(struct merkle_download_resume));
+}
+
+/**
+ * \brief Save the progress of the Merkle download.
+ * \param[in] resume Progress.
+ * \return true if the progress is saved, false otherwise.
+ */
+static bool save_merkle_state(const struct merkle_download_resume *resume)
+{
+	UINT wsize = 0;
+	bool ok;
+
+	merkle_state_file_name[0] = LUN_ID_SD_MMC_0_MEM + '0';
+	if (f_open(&merkle_state_file, merkle_state_file_name, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) {
+		return false;
+	}
+	ok = (f_write(&merkle_state_file, resume, sizeof(struct merkle_download_resume), &wsize) == FR_OK)
+			&& (wsize == sizeof(struct merkle_download_resume));
+	return (f_close(&merkle_state_file) == FR_OK) && ok;
+}
+
+/**
+ * \brief Download the image verifying each block, resuming the previous download.
+ * \return true if the download is started, false if it must be done without the Merkle tree.
+ */
+static bool begin_merkle_download(void)
+{
+	struct merkle_download_resume resume;
+	bool resumed;
+	int ret;
+
+	if (!set_file_name()) {
+		return false;
+	}
+	/* Keep what the previous download wrote. */
+	close_file(false);
+	if (f_open(&file_object, save_file_name, FA_OPEN_ALWAYS | FA_READ | FA_WRITE) != FR_OK) {
+		printf("begin_merkle_download: file open error!\r\n");
+		return false;
+	}
+
+	resumed = load_merkle_state(&resume);
+	printf("begin_merkle_download: [%s], %lu bytes on the card.\r\n", save_file_name,
+			(unsigned long)f_size(&file_object));
+	ret = merkle_download_start(&merkle_download_inst, MAIN_HTTP_FILE_URL, MAIN_HTTP_MERKLE_URL,
+			resumed ? &resume : NULL, f_size(&file_object));
+	if (ret < 0) {
+		printf("begin_merkle_download: Merkle download error! (res %d)\r\n", ret);
+		close_file(false);
+		return false;
+	}
+	add_state(DOWNLOADING);
+#ifdef SD_MMC_SPI_BUSY_STATS
+	sd_mmc_spi_clear_busy_stats();
+#endif
+	return true;
+}
+
+/**
+ * \brief Callback of the Merkle download.
+ *
+ * \param[in]  module_inst     Module instance of Merkle download.
+ * \param[in]  type            Type of event.
+ * \param[in]  data            Data structure of the event. \refer merkle_download_data
+ */
+static void merkle_download_callback(struct merkle_download_module *module_inst, int type, union merkle_download_data *data)
+{
+	UNUSED(module_inst);
+
+	switch (type) {
+	case MERKLE_DOWNLOAD_CALLBACK_CHECKPOINT:
+		/* The blocks must be on the card before they are recorded as verified. */
+		if (!sync_file() || !save_merkle_state(data->checkpoint.resume)) {
+			printf("merkle_download_callback: progress not saved!\r\n");
+		}
+		break;
+
+	case MERKLE_DOWNLOAD_CALLBACK_COMPLETED:
+		clear_state(DOWNLOADING);
+		if (data->completed.reason == 0) {
+			/* The previous image may have been longer. */
+			if (f_lseek(&file_object, data->completed.size) != FR_OK || f_truncate(&file_object) != FR_OK) {
+				printf("merkle_download_callback: file truncation error!\r\n");
+			}
+			close_file(true);
+			printf("merkle_download_callback: %lu blocks verified, %lu resumed, %lu fetched again.\r\n",
+					(unsigned long)data->completed.nb_block, (unsigned long)data->completed.nb_resumed,
+					(unsigned long)data->completed.nb_failed);
+#ifdef SD_MMC_SPI_BUSY_STATS
+			print_busy_stats();
+#endif
+			add_state(COMPLETED);
+		} else {
+			close_file(false);
+			printf("merkle_download_callback: failed (%d).\r\n", data->completed.reason);
+			if (data->completed.reason == -ENOENT && data->completed.size == 0) {
+				/* No Merkle tree on the server. */
+				merkle_failed = true;
+				start_download();
+			} else if (data->completed.reason != -ECANCELED) {
+				/* Resumed by the next retry. */
+				add_state(CANCELED);
+			}
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+void configure_merkle_download(void)
+{
+	struct merkle_download_config merkle_conf;
+	int ret;
+
+	merkle_download_get_config_defaults(&merkle_conf);
+	merkle_conf.timer_inst = &swt_module_inst;
+	merkle_conf.recv_buffer_size = MAIN_BUFFER_MAX_SIZE;
+	merkle_conf.read = merkle_read;
+	merkle_conf.write = merkle_write;
+
+	ret = merkle_download_init(&merkle_download_inst, &merkle_conf);
+	if (ret < 0) {
+		printf("configure_merkle_download: Merkle download initialization failed! (res %d)\r\n", ret);
+		while (1) {
+		} /* Loop forever. */
+	}
+
+	merkle_download_register_callback(&merkle_download_inst, merkle_download_callback);
+}
+
+bool start_merkle_download(void)
+{
+	if (!merkle_failed && begin_merkle_download()) {
+		return true;
+	}
+	merkle_failed = false;
+	return false;
+}
+
+#endif /* MAIN_HTTP_MERKLE_URL */
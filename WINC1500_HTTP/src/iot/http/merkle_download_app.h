@@ -0,0 +1,44 @@
+/**
+ * \file
+ *
+ * \brief Merkle download of the image of the HTTP File Downloader Example.
+ *
+ * With MAIN_HTTP_MERKLE_URL, every block of the image is verified once written
+ * and a block that fails is fetched again alone, see
+ * iot/http/merkle_download.h. The progress is saved in
+ * MAIN_MERKLE_STATE_FILE_NAME, so that an interrupted download resumes.
+ *
+ */
+
+#ifndef MERKLE_DOWNLOAD_APP_H_INCLUDED
+#define MERKLE_DOWNLOAD_APP_H_INCLUDED
+
+#include <stdbool.h>
+#include "iot/http/merkle_download.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Instance of Merkle download verifying the image block by block. */
+extern struct merkle_download_module merkle_download_inst;
+
+/**
+ * \brief Configure the Merkle download.
+ */
+void configure_merkle_download(void);
+
+/**
+ * \brief Download the image verifying each block, resuming the previous download.
+ *
+ * When the server has no Merkle tree, the next call lets the image be
+ * downloaded without.
+ * \return true if the download is started, false if it must be done without the Merkle tree.
+ */
+bool start_merkle_download(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MERKLE_DOWNLOAD_APP_H_INCLUDED */
@@ -0,0 +1,776 @@
+/**
+ * \file
+ *
+ * \brief WebSocket client service.
+ *
+ */
+
+#include "iot/http/websocket_client.h"
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <errno.h>
+
+/** GUID appended to the key to compute Sec-WebSocket-Accept (RFC 6455 section 1.3). */
+#define WEBSOCKET_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+/** Length of the handshake key before encoding. */
+#define WEBSOCKET_KEY_SIZE 16
+/** Size of the buffer the HTTP client builds the handshake request in. */
+#define WEBSOCKET_HANDSHAKE_SEND_BUFFER_SIZE 256
+
+#define FRAME_FIN           0x80
+#define FRAME_RSV           0x70
+#define FRAME_OPCODE        0x0F
+#define FRAME_MASK          0x80
+#define FRAME_LENGTH        0x7F
+#define FRAME_LENGTH_16     126
+#define FRAME_LENGTH_64     127
+#define FRAME_CONTROL_MAX   125
+
+enum websocket_client_state {
+	STATE_INIT = 0,
+	STATE_HANDSHAKE,
+	STATE_OPEN,
+	STATE_CLOSING,
+};
+
+/**
+ * \brief Callback of the HTTP client doing the opening handshake.
+ */
+static void _websocket_client_http_callback(struct http_client_module *module_inst, int type, union http_client_data *data);
+
+/**
+ * \brief Timer callback entry of WebSocket client.
+ */
+static void _websocket_client_timer_callback(struct sw_timer_module *const module, int timer_id, void *context, int period);
+
+/**
+ * \brief Close the socket and notify the application.
+ *
+ * \param[in]  module          Module instance of WebSocket.
+ * \param[in]  reason          Reason given to the application.
+ * \param[in]  close_code      Status code of the received close frame.
+ */
+static void _websocket_client_clear_conn(struct websocket_client_module *const module, int reason, uint16_t close_code);
+
+/**
+ * \brief Parse and deliver the frames in the receive buffer.
+ *
+ * \param[in]  module          Module instance of WebSocket.
+ */
+static void _websocket_client_handle_frames(struct websocket_client_module *const module);
+
+/**
+ * \brief Global reference of WebSocket client instance.
+ * Socket callback interface has not user private data.
+ * So it needed reference to WebSocket client module instance.
+ */
+static struct websocket_client_module *module_ref_inst[TCP_SOCK_MAX] = {NULL,};
+
+/**
+ * \brief Xorshift generator of the handshake key and the masking keys.
+ */
+static uint32_t _websocket_client_rand(struct websocket_client_module *const module)
+{
+	uint32_t x = module->rand_state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	module->rand_state = x;
+	return x;
+}
+
+/**
+ * \brief SHA-1 of a short message (RFC 3174), only used for the handshake.
+ *
+ * \param[in]  msg             Message, at most 119 bytes.
+ * \param[in]  len             Length of the message.
+ * \param[out] digest          20 bytes digest.
+ */
+static void _websocket_client_sha1(const uint8_t *msg, uint32_t len, uint8_t *digest)
+{
+	uint8_t block[128];
+	uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+	uint32_t w[16];
+	uint32_t blocks = (len + 8) / 64 + 1;
+	uint32_t a, b, c, d, e, f, k, t, i, n;
+
+	memset(block, 0, sizeof(block));
+	memcpy(block, msg, len);
+	block[len] = 0x80;
+	block[blocks * 64 - 2] = (uint8_t)((len * 8) >> 8);
+	block[blocks * 64 - 1] = (uint8_t)(len * 8);
+
+	for (n = 0; n < blocks; n++) {
+		a = h[0]; b = h[1]; c = h[2]; d = h[3]; e = h[4];
+		for (i = 0; i < 80; i++) {
+			if (i < 16) {
+				const uint8_t *p = block + n * 64 + i * 4;
+				w[i] = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+			} else {
+				t = w[(i + 13) & 15] ^ w[(i + 8) & 15] ^ w[(i + 2) & 15] ^ w[i & 15];
+				w[i & 15] = (t << 1) | (t >> 31);
+			}
+			if (i < 20) {
+				f = (b & c) | (~b & d);
+				k = 0x5A827999;
+			} else if (i < 40) {
+				f = b ^ c ^ d;
+				k = 0x6ED9EBA1;
+			} else if (i < 60) {
+				f = (b & c) | (b & d) | (c & d);
+				k = 0x8F1BBCDC;
+			} else {
+				f = b ^ c ^ d;
+				k = 0xCA62C1D6;
+			}
+			t = ((a << 5) | (a >> 27)) + f + e + k + w[i & 15];
+			e = d;
+			d = c;
+			c = (b << 30) | (b >> 2);
+			b = a;
+			a = t;
+		}
+		h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+	}
+
+	for (i = 0; i < 20; i++) {
+		digest[i] = (uint8_t)(h[i / 4] >> (24 - (i % 4) * 8));
+	}
+}
+
+/**
+ * \brief Base64 encoding, out must hold ((len + 2) / 3) * 4 + 1 characters.
+ */
+static void _websocket_client_base64(const uint8_t *in, uint32_t len, char *out)
+{
+	static const char lut[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	uint32_t i, v;
+
+	for (i = 0; i < len; i += 3) {
+		v = (uint32_t)in[i] << 16;
+		if (i + 1 < len) {
+			v |= (uint32_t)in[i + 1] << 8;
+		}
+		if (i + 2 < len) {
+			v |= in[i + 2];
+		}
+		*out++ = lut[(v >> 18) & 0x3F];
+		*out++ = lut[(v >> 12) & 0x3F];
+		*out++ = (i + 1 < len) ? lut[(v >> 6) & 0x3F] : '=';
+		*out++ = (i + 2 < len) ? lut[v & 0x3F] : '=';
+	}
+	*out = '\0';
+}
+
+void websocket_client_get_config_defaults(struct websocket_client_config *const config)
+{
+	config->port = 80;
+	config->tls = 0;
+	config->timer_inst = NULL;
+	config->timeout = 20000;
+	config->ping_interval = 30000;
+	config->recv_buffer = NULL;
+	config->recv_buffer_size = 256;
+	config->send_buffer_size = 128;
+	config->protocol = NULL;
+	config->seed = 0;
+}
+
+int websocket_client_init(struct websocket_client_module *const module, struct websocket_client_config *config)
+{
+	struct http_client_config httpc_conf;
+	int ret;
+
+	/* Checks the parameters. */
+	if (module == NULL || config == NULL) {
+		return -EINVAL;
+	}
+
+	if (config->recv_buffer_size < WEBSOCKET_MIN_RECV_BUFFER_SIZE) {
+		return -EINVAL;
+	}
+
+	if (config->send_buffer_size <= WEBSOCKET_MAX_SEND_HEADER_SIZE) {
+		return -EINVAL;
+	}
+
+	if (config->timer_inst == NULL) {
+		return -EINVAL;
+	}
+
+	memset(module, 0, sizeof(struct websocket_client_module));
+	memcpy(&module->config, config, sizeof(struct websocket_client_config));
+	module->sock = -1;
+	module->timer_id = -1;
+	/* Xorshift must not start from zero. */
+	module->rand_state = config->seed ? config->seed : 0x2545F491;
+
+	/* Allocate the buffer in the heap. */
+	if (module->config.recv_buffer == NULL) {
+		module->config.recv_buffer = malloc(config->recv_buffer_size);
+		if (module->config.recv_buffer == NULL) {
+			return -ENOMEM;
+		}
+		module->alloc_buffer = 1;
+	}
+
+	/* The HTTP client receives the handshake in the same buffer, so the
+	 * frames that follow the response header are already in place. */
+	http_client_get_config_defaults(&httpc_conf);
+	httpc_conf.port = config->port;
+	httpc_conf.tls = config->tls;
+	httpc_conf.timer_inst = config->timer_inst;
+	httpc_conf.timeout = config->timeout;
+	httpc_conf.recv_buffer = module->config.recv_buffer;
+	httpc_conf.recv_buffer_size = config->recv_buffer_size;
+	httpc_conf.send_buffer_size = WEBSOCKET_HANDSHAKE_SEND_BUFFER_SIZE;
+	ret = http_client_init(&module->http, &httpc_conf);
+	if (ret < 0) {
+		websocket_client_deinit(module);
+		return ret;
+	}
+	http_client_register_callback(&module->http, _websocket_client_http_callback);
+
+	if (config->ping_interval > 0) {
+		module->timer_id = sw_timer_register_callback(config->timer_inst, _websocket_client_timer_callback,
+				(void *)module, config->ping_interval);
+		if (module->timer_id < 0) {
+			websocket_client_deinit(module);
+			return -ENOSPC;
+		}
+	}
+
+	module->state = STATE_INIT;
+
+	return 0;
+}
+
+int websocket_client_deinit(struct websocket_client_module *const module)
+{
+	/* Checks the parameters. */
+	if (module == NULL) {
+		return -EINVAL;
+	}
+
+	if (module->sock >= 0) {
+		close(module->sock);
+		module_ref_inst[module->sock] = NULL;
+	}
+
+	if (module->timer_id >= 0 && module->config.timer_inst != NULL) {
+		sw_timer_unregister_callback(module->config.timer_inst, module->timer_id);
+	}
+
+	http_client_close(&module->http);
+	http_client_deinit(&module->http);
+
+	if (module->alloc_buffer != 0) {
+		free(module->config.recv_buffer);
+	}
+
+	memset(module, 0, sizeof(struct websocket_client_module));
+	module->sock = -1;
+
+	return 0;
+}
+
+int websocket_client_register_callback(struct websocket_client_module *const module, websocket_client_callback_t callback)
+{
+	/* Checks the parameters. */
+	if (module == NULL) {
+		return -EINVAL;
+	}
+
+	module->cb = callback;
+
+	return 0;
+}
+
+int websocket_client_connect(struct websocket_client_module *const module, const char *url)
+{
+	uint8_t nonce[WEBSOCKET_KEY_SIZE];
+	char key[((WEBSOCKET_KEY_SIZE + 2) / 3) * 4 + 1];
+	char accept_src[sizeof(key) - 1 + sizeof(WEBSOCKET_GUID) - 1];
+	uint8_t digest[20];
+	char ext_header[160];
+	uint32_t value = 0;
+	int i, ret;
+
+	if (module == NULL || url == NULL) {
+		return -EINVAL;
+	}
+
+	if (module->state != STATE_INIT) {
+		return -EALREADY;
+	}
+
+	/* The HTTP client takes the host without a scheme. */
+	if (!strncmp(url, "ws://", 5)) {
+		url += 5;
+	} else if (!strncmp(url, "wss://", 6)) {
+		url += 6;
+	}
+
+	/* Sec-WebSocket-Key is a random nonce, the server proves it read the
+	 * request by returning SHA-1(key + GUID) in Sec-WebSocket-Accept. */
+	for (i = 0; i < WEBSOCKET_KEY_SIZE; i++) {
+		if ((i & 3) == 0) {
+			value = _websocket_client_rand(module);
+		}
+		nonce[i] = (uint8_t)(value >> ((i & 3) * 8));
+	}
+	_websocket_client_base64(nonce, WEBSOCKET_KEY_SIZE, key);
+	memcpy(accept_src, key, sizeof(key) - 1);
+	memcpy(accept_src + sizeof(key) - 1, WEBSOCKET_GUID, sizeof(WEBSOCKET_GUID) - 1);
+	_websocket_client_sha1((uint8_t *)accept_src, sizeof(accept_src), digest);
+	_websocket_client_base64(digest, sizeof(digest), module->accept);
+
+	strcpy(ext_header, "Sec-WebSocket-Key: ");
+	strcat(ext_header, key);
+	strcat(ext_header, "\r\nSec-WebSocket-Version: 13\r\n");
+	if (module->config.protocol != NULL) {
+		if (strlen(ext_header) + strlen(module->config.protocol) + 27 > sizeof(ext_header)) {
+			return -EINVAL;
+		}
+		strcat(ext_header, "Sec-WebSocket-Protocol: ");
+		strcat(ext_header, module->config.protocol);
+		strcat(ext_header, "\r\n");
+	}
+
+	module->accepted = 0;
+	module->state = STATE_HANDSHAKE;
+	ret = http_client_send_upgrade(&module->http, url, "websocket", ext_header);
+	if (ret < 0) {
+		module->state = STATE_INIT;
+	}
+
+	return ret;
+}
+
+/**
+ * \brief Build a masked frame and send it.
+ */
+static int _websocket_client_send_frame(struct websocket_client_module *const module, uint8_t opcode,
+	const uint8_t *data, uint32_t length)
+{
+	char buffer[module->config.send_buffer_size];
+	uint8_t *mask;
+	uint32_t hdr_len = 2, i, key;
+	sint16 ret;
+
+	if (length > 0xFFFF || length + WEBSOCKET_MAX_SEND_HEADER_SIZE > module->config.send_buffer_size) {
+		return -EMSGSIZE;
+	}
+
+	buffer[0] = FRAME_FIN | opcode;
+	if (length < FRAME_LENGTH_16) {
+		buffer[1] = FRAME_MASK | length;
+	} else {
+		buffer[1] = FRAME_MASK | FRAME_LENGTH_16;
+		buffer[2] = (char)(length >> 8);
+		buffer[3] = (char)length;
+		hdr_len = 4;
+	}
+
+	/* Client frames are always masked (RFC 6455 section 5.3). */
+	key = _websocket_client_rand(module);
+	mask = (uint8_t *)buffer + hdr_len;
+	memcpy(mask, &key, 4);
+	hdr_len += 4;
+	for (i = 0; i < length; i++) {
+		buffer[hdr_len + i] = data[i] ^ mask[i & 3];
+	}
+
+	ret = send(module->sock, buffer, (uint16)(hdr_len + length), 0);
+	if (ret == SOCK_ERR_BUFFER_FULL) {
+		return -EBUSY;
+	} else if (ret < 0) {
+		return -EIO;
+	}
+
+	return 0;
+}
+
+int websocket_client_send(struct websocket_client_module *const module, uint8_t opcode, const char *data, uint32_t length)
+{
+	if (module == NULL || (data == NULL && length > 0)) {
+		return -EINVAL;
+	}
+
+	if (opcode != WEBSOCKET_OPCODE_TEXT && opcode != WEBSOCKET_OPCODE_BINARY) {
+		return -EINVAL;
+	}
+
+	if (module->state != STATE_OPEN) {
+		return -ENOTCONN;
+	}
+
+	return _websocket_client_send_frame(module, opcode, (const uint8_t *)data, length);
+}
+
+int websocket_client_close(struct websocket_client_module *const module, uint16_t code)
+{
+	uint8_t payload[2];
+
+	if (module == NULL) {
+		return -EINVAL;
+	}
+
+	switch (module->state) {
+	case STATE_HANDSHAKE:
+		/* Reported through the HTTP client disconnect event. */
+		http_client_close(&module->http);
+		break;
+	case STATE_OPEN:
+		payload[0] = (uint8_t)(code >> 8);
+		payload[1] = (uint8_t)code;
+		if (_websocket_client_send_frame(module, WEBSOCKET_OPCODE_CLOSE, payload, sizeof(payload)) < 0
+				|| module->timer_id < 0) {
+			/* No way to wait for the answer of the server. */
+			_websocket_client_clear_conn(module, 0, WEBSOCKET_CLOSE_NO_STATUS);
+		} else {
+			/* The server answers with a close frame, or the timer gives up. */
+			module->state = STATE_CLOSING;
+		}
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+void websocket_client_socket_event_handler(SOCKET sock, uint8_t msg_type, void *msg_data)
+{
+	tstrSocketRecvMsg *msg_recv;
+	int16_t send_ret;
+
+	/* Find instance using the socket descriptor. */
+	struct websocket_client_module *module = module_ref_inst[sock];
+	/* If cannot found reference, This socket is not WebSocket client socket. */
+	if (module == NULL) {
+		return;
+	}
+
+	switch (msg_type) {
+	case SOCKET_MSG_RECV:
+		msg_recv = (tstrSocketRecvMsg *)msg_data;
+		if (msg_recv->s16BufferSize > 0) {
+			module->recved_size += msg_recv->s16BufferSize;
+			_websocket_client_handle_frames(module);
+		} else {
+			_websocket_client_clear_conn(module, -ECONNRESET, WEBSOCKET_CLOSE_NO_STATUS);
+		}
+		/* Continue to receive, unless the connection was closed. */
+		if (module_ref_inst[sock] == module) {
+			recv(sock, module->config.recv_buffer + module->recved_size,
+				module->config.recv_buffer_size - module->recved_size, 0);
+		}
+		break;
+	case SOCKET_MSG_SEND:
+		send_ret = *(int16_t *)msg_data;
+		if (send_ret < 0) {
+			_websocket_client_clear_conn(module, -EIO, WEBSOCKET_CLOSE_NO_STATUS);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+static void _websocket_client_http_callback(struct http_client_module *module_inst, int type, union http_client_data *data)
+{
+	struct websocket_client_module *module = (struct websocket_client_module *)module_inst;
+	union websocket_client_data ws_data;
+
+	if (module->state != STATE_HANDSHAKE) {
+		return;
+	}
+
+	switch (type) {
+	case HTTP_CLIENT_CALLBACK_RECV_HEADER:
+		if (!strcasecmp(data->recv_header.name, "Sec-WebSocket-Accept")) {
+			module->accepted = !strcmp(data->recv_header.value, module->accept);
+		}
+		break;
+	case HTTP_CLIENT_CALLBACK_UPGRADED:
+		module->sock = data->upgraded.sock;
+		module_ref_inst[module->sock] = module;
+		if (!module->accepted) {
+			_websocket_client_clear_conn(module, -EPROTO, WEBSOCKET_CLOSE_NO_STATUS);
+			break;
+		}
+		/* Frames sent right after the response header are already in the buffer. */
+		if (data->upgraded.data != module->config.recv_buffer) {
+			memmove(module->config.recv_buffer, data->upgraded.data, data->upgraded.length);
+		}
+		module->recved_size = data->upgraded.length;
+		module->in_frame = 0;
+		module->in_message = 0;
+		module->ping_pending = 0;
+		module->state = STATE_OPEN;
+		if (module->timer_id >= 0) {
+			sw_timer_enable_callback(module->config.timer_inst, module->timer_id, module->config.ping_interval);
+		}
+		if (module->cb) {
+			module->cb(module, WEBSOCKET_CLIENT_CALLBACK_CONNECTED, &ws_data);
+		}
+		_websocket_client_handle_frames(module);
+		/* The socket event handler of the HTTP client does not receive anymore. */
+		if (module->state >= STATE_OPEN) {
+			recv(module->sock, module->config.recv_buffer + module->recved_size,
+				module->config.recv_buffer_size - module->recved_size, 0);
+		}
+		break;
+	case HTTP_CLIENT_CALLBACK_RECV_RESPONSE:
+		/* Server did not switch protocols. */
+		module->state = STATE_INIT;
+		http_client_close(module_inst);
+		ws_data.disconnected.reason = -ECONNREFUSED;
+		ws_data.disconnected.close_code = WEBSOCKET_CLOSE_NO_STATUS;
+		if (module->cb) {
+			module->cb(module, WEBSOCKET_CLIENT_CALLBACK_DISCONNECTED, &ws_data);
+		}
+		break;
+	case HTTP_CLIENT_CALLBACK_DISCONNECTED:
+		module->state = STATE_INIT;
+		ws_data.disconnected.reason = data->disconnected.reason ? data->disconnected.reason : -ECONNRESET;
+		ws_data.disconnected.close_code = WEBSOCKET_CLOSE_NO_STATUS;
+		if (module->cb) {
+			module->cb(module, WEBSOCKET_CLIENT_CALLBACK_DISCONNECTED, &ws_data);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+static void _websocket_client_timer_callback(struct sw_timer_module *const module, int timer_id, void *context, int period)
+{
+	struct websocket_client_module *module_inst = (struct websocket_client_module *)context;
+
+	/* Checks invalid arguments. */
+	if (module_inst == NULL) {
+		return;
+	}
+
+	switch (module_inst->state) {
+	case STATE_OPEN:
+		if (module_inst->ping_pending) {
+			/* Nothing received during a whole interval after the ping. */
+			_websocket_client_clear_conn(module_inst, -ETIME, WEBSOCKET_CLOSE_NO_STATUS);
+		} else if (_websocket_client_send_frame(module_inst, WEBSOCKET_OPCODE_PING, NULL, 0) == 0) {
+			module_inst->ping_pending = 1;
+		}
+		break;
+	case STATE_CLOSING:
+		/* Server did not answer the close frame. */
+		_websocket_client_clear_conn(module_inst, 0, WEBSOCKET_CLOSE_NO_STATUS);
+		break;
+	default:
+		break;
+	}
+}
+
+static void _websocket_client_clear_conn(struct websocket_client_module *const module, int reason, uint16_t close_code)
+{
+	union websocket_client_data data;
+
+	if (module->timer_id >= 0) {
+		sw_timer_disable_callback(module->config.timer_inst, module->timer_id);
+	}
+
+	if (module->sock >= 0) {
+		close(module->sock);
+		module_ref_inst[module->sock] = NULL;
+		module->sock = -1;
+	}
+
+	module->state = STATE_INIT;
+	module->recved_size = 0;
+	module->in_frame = 0;
+	module->in_message = 0;
+	module->ping_pending = 0;
+
+	data.disconnected.reason = reason;
+	data.disconnected.close_code = close_code;
+	if (module->cb) {
+		module->cb(module, WEBSOCKET_CLIENT_CALLBACK_DISCONNECTED, &data);
+	}
+}
+
+/**
+ * \brief Drop the first bytes of the receive buffer.
+ */
+static void _websocket_client_consume(struct websocket_client_module *const module, uint32_t length)
+{
+	if (length < module->recved_size) {
+		memmove(module->config.recv_buffer, module->config.recv_buffer + length, module->recved_size - length);
+		module->recved_size -= length;
+	} else {
+		module->recved_size = 0;
+	}
+}
+
+/**
+ * \brief Parse the header of the next frame.
+ *
+ * \return     1               Header parsed and consumed.
+ * \return     0               Not enough data received yet.
+ * \return     -1              Protocol error, connection closed.
+ */
+static int _websocket_client_parse_header(struct websocket_client_module *const module)
+{
+	uint8_t *buffer = (uint8_t *)module->config.recv_buffer;
+	uint32_t hdr_len = 2, length;
+	uint8_t opcode;
+	uint16_t error = 0;
+
+	if (module->recved_size < 2) {
+		return 0;
+	}
+
+	length = buffer[1] & FRAME_LENGTH;
+	if (length == FRAME_LENGTH_16) {
+		hdr_len = 4;
+	} else if (length == FRAME_LENGTH_64) {
+		hdr_len = 10;
+	}
+	if (module->recved_size < hdr_len) {
+		return 0;
+	}
+
+	if (length == FRAME_LENGTH_16) {
+		length = ((uint32_t)buffer[2] << 8) | buffer[3];
+	} else if (length == FRAME_LENGTH_64) {
+		if (buffer[2] | buffer[3] | buffer[4] | buffer[5]) {
+			error = WEBSOCKET_CLOSE_TOO_BIG;
+		}
+		length = ((uint32_t)buffer[6] << 24) | ((uint32_t)buffer[7] << 16) | ((uint32_t)buffer[8] << 8) | buffer[9];
+	}
+
+	opcode = buffer[0] & FRAME_OPCODE;
+	if ((buffer[0] & FRAME_RSV) || (buffer[1] & FRAME_MASK)) {
+		/* No extension was negotiated, and servers never mask. */
+		error = WEBSOCKET_CLOSE_PROTOCOL_ERROR;
+	} else if (opcode & 0x8) {
+		if (!(buffer[0] & FRAME_FIN) || length > FRAME_CONTROL_MAX) {
+			error = WEBSOCKET_CLOSE_PROTOCOL_ERROR;
+		}
+	} else if (opcode == WEBSOCKET_OPCODE_CONTINUATION) {
+		if (!module->in_message) {
+			error = WEBSOCKET_CLOSE_PROTOCOL_ERROR;
+		}
+	} else if (module->in_message || opcode > WEBSOCKET_OPCODE_BINARY) {
+		error = WEBSOCKET_CLOSE_PROTOCOL_ERROR;
+	} else {
+		module->msg_opcode = opcode;
+		module->in_message = 1;
+	}
+
+	if (error) {
+		uint8_t payload[2] = {(uint8_t)(error >> 8), (uint8_t)error};
+		_websocket_client_send_frame(module, WEBSOCKET_OPCODE_CLOSE, payload, sizeof(payload));
+		_websocket_client_clear_conn(module, -EPROTO, error);
+		return -1;
+	}
+
+	module->frame_opcode = opcode;
+	module->frame_fin = (buffer[0] & FRAME_FIN) ? 1 : 0;
+	module->frame_remaining = length;
+	module->in_frame = 1;
+	_websocket_client_consume(module, hdr_len);
+
+	return 1;
+}
+
+/**
+ * \brief Handle a whole control frame at the start of the receive buffer.
+ */
+static void _websocket_client_handle_control(struct websocket_client_module *const module)
+{
+	uint8_t *payload = (uint8_t *)module->config.recv_buffer;
+	uint32_t length = module->frame_remaining;
+	uint16_t code = WEBSOCKET_CLOSE_NO_STATUS;
+
+	switch (module->frame_opcode) {
+	case WEBSOCKET_OPCODE_PING:
+		_websocket_client_send_frame(module, WEBSOCKET_OPCODE_PONG, payload, length);
+		break;
+	case WEBSOCKET_OPCODE_CLOSE:
+		if (length >= 2) {
+			code = ((uint16_t)payload[0] << 8) | payload[1];
+		}
+		if (module->state == STATE_OPEN) {
+			/* Echo the status code to complete the closing handshake. */
+			_websocket_client_send_frame(module, WEBSOCKET_OPCODE_CLOSE, payload, length >= 2 ? 2 : 0);
+		}
+		_websocket_client_clear_conn(module, 0, code);
+		return;
+	default:
+		/* Pong: receiving anything already proves the connection is alive. */
+		break;
+	}
+
+	module->in_frame = 0;
+	_websocket_client_consume(module, length);
+}
+
+static void _websocket_client_handle_frames(struct websocket_client_module *const module)
+{
+	union websocket_client_data data;
+	uint32_t length;
+
+	/* Any frame from the server answers the pending ping. */
+	module->ping_pending = 0;
+
+	while (module->state >= STATE_OPEN) {
+		if (!module->in_frame) {
+			if (_websocket_client_parse_header(module) <= 0) {
+				return;
+			}
+		}
+
+		if (module->frame_opcode & 0x8) {
+			/* Control frames are small and handled in one piece. */
+			if (module->recved_size < module->frame_remaining) {
+				return;
+			}
+			_websocket_client_handle_control(module);
+			continue;
+		}
+
+		/* Wait for the whole payload when it fits in the buffer, deliver
+		 * bigger ones as they arrive. */
+		length = module->frame_remaining;
+		if (length > module->recved_size) {
+			if (length <= module->config.recv_buffer_size || module->recved_size == 0) {
+				return;
+			}
+			length = module->recved_size;
+		}
+
+		module->frame_remaining -= length;
+		if (module->frame_remaining == 0) {
+			module->in_frame = 0;
+			if (module->frame_fin) {
+				module->in_message = 0;
+			}
+		}
+
+		data.recv_message.opcode = module->msg_opcode;
+		data.recv_message.is_final = (module->frame_remaining == 0 && module->frame_fin);
+		data.recv_message.length = length;
+		data.recv_message.data = module->config.recv_buffer;
+		if (module->cb) {
+			module->cb(module, WEBSOCKET_CLIENT_CALLBACK_RECV_MESSAGE, &data);
+		}
+		if (module->state < STATE_OPEN) {
+			/* Closed from the callback. */
+			return;
+		}
+		_websocket_client_consume(module, length);
+	}
+}
@@ -0,0 +1,346 @@
+/**
+ * \file
+ *
+ * \brief WebSocket client service.
+ *
+ * The opening handshake is an HTTP/1.1 Upgrade request sent through the HTTP
+ * client. Once the server answers 101 Switching Protocols, the WebSocket client
+ * takes the socket over and exchanges frames as described in RFC 6455:
+ * http://tools.ietf.org/html/rfc6455
+ *
+ * One connection is kept opened and checked with periodic ping frames, so the
+ * server can push a message at any time.
+ *
+ */
+
+#ifndef WEBSOCKET_CLIENT_H_INCLUDED
+#define WEBSOCKET_CLIENT_H_INCLUDED
+
+#include "iot/http/http_client.h"
+#include "iot/sw_timer.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Smallest receive buffer: a whole control frame (125 bytes) and its header. */
+#define WEBSOCKET_MIN_RECV_BUFFER_SIZE    128
+/** Largest frame header sent by the client (16-bit length and masking key). */
+#define WEBSOCKET_MAX_SEND_HEADER_SIZE    8
+
+/**
+ * \brief Opcode of a WebSocket frame.
+ */
+enum websocket_opcode {
+	WEBSOCKET_OPCODE_CONTINUATION = 0x0,
+	WEBSOCKET_OPCODE_TEXT = 0x1,
+	WEBSOCKET_OPCODE_BINARY = 0x2,
+	WEBSOCKET_OPCODE_CLOSE = 0x8,
+	WEBSOCKET_OPCODE_PING = 0x9,
+	WEBSOCKET_OPCODE_PONG = 0xA,
+};
+
+/**
+ * \brief Status code of a close frame.
+ */
+enum websocket_close_code {
+	WEBSOCKET_CLOSE_NORMAL = 1000,
+	WEBSOCKET_CLOSE_GOING_AWAY = 1001,
+	WEBSOCKET_CLOSE_PROTOCOL_ERROR = 1002,
+	WEBSOCKET_CLOSE_NO_STATUS = 1005,
+	WEBSOCKET_CLOSE_TOO_BIG = 1009,
+};
+
+/**
+ * \brief A type of WebSocket client callback.
+ */
+enum websocket_client_callback_type {
+	/** The opening handshake completed. Messages can be sent. */
+	WEBSOCKET_CLIENT_CALLBACK_CONNECTED,
+	/** Received a part or the whole of a message. */
+	WEBSOCKET_CLIENT_CALLBACK_RECV_MESSAGE,
+	/** The connection was closed. */
+	WEBSOCKET_CLIENT_CALLBACK_DISCONNECTED,
+};
+
+/**
+ * \brief Structure of the WEBSOCKET_CLIENT_CALLBACK_RECV_MESSAGE callback.
+ *
+ * A message that fits in the receive buffer is delivered in one piece.
+ * A bigger one is delivered as it arrives, is_final being set on the last piece.
+ */
+struct websocket_client_data_recv_message {
+	/** WEBSOCKET_OPCODE_TEXT or WEBSOCKET_OPCODE_BINARY. */
+	uint8_t opcode;
+	/** A flag for the last piece of the message. */
+	uint8_t is_final;
+	/** Length of data. */
+	uint32_t length;
+	/** Buffer of data. Only valid during the callback. */
+	char *data;
+};
+
+/**
+ * \brief Structure of the WEBSOCKET_CLIENT_CALLBACK_DISCONNECTED callback.
+ */
+struct websocket_client_data_disconnected {
+	/**
+	 * Reason of disconnecting.
+	 *
+	 * \return     0               Closed by a close frame.
+	 * \return     -ECONNREFUSED   Server did not switch protocols.
+	 * \return     -EPROTO         Handshake or framing error.
+	 * \return     -ETIME          Handshake or ping timed out.
+	 * \return     -ECONNRESET     Connection reset by peer.
+	 * \return     -EIO            Socket error.
+	 */
+	int reason;
+	/** Status code of the close frame, WEBSOCKET_CLOSE_NO_STATUS if none. */
+	uint16_t close_code;
+};
+
+/**
+ * \brief Structure of the WebSocket client callback.
+ */
+union websocket_client_data {
+	struct websocket_client_data_recv_message recv_message;
+	struct websocket_client_data_disconnected disconnected;
+};
+
+/* Before declaring for the callback type. */
+struct websocket_client_module;
+/**
+ * \brief Callback interface of WebSocket client service.
+ *
+ * \param[in]  module_inst     Module instance of WebSocket client module.
+ * \param[in]  type            Type of event.
+ * \param[in]  data            Data structure of the event. \refer websocket_client_data
+ */
+typedef void (*websocket_client_callback_t)(struct websocket_client_module *module_inst, int type, union websocket_client_data *data);
+
+/**
+ * \brief WebSocket client configuration structure
+ *
+ * Configuration struct for a WebSocket client instance. This structure should be
+ * initialized by the \ref websocket_client_get_config_defaults function before being
+ * modified by the user application.
+ */
+struct websocket_client_config {
+	/**
+	 * TCP port number of the server.
+	 * Default value is 80.
+	 */
+	uint16_t port;
+	/**
+	 * A flag for the whether using the TLS socket or not (wss://).
+	 * Default value is 0.
+	 */
+	uint8_t tls;
+	/**
+	 * Timer module for the handshake timeout and the ping frames.
+	 * Default value is NULL.
+	 */
+	struct sw_timer_module *timer_inst;
+	/**
+	 * Time value for the opening handshake time out.
+	 * Unit is milliseconds.
+	 * Default value is 20000. (20 seconds)
+	 */
+	uint16_t timeout;
+	/**
+	 * Interval of the ping frames sent on an idle connection. The connection is
+	 * closed if nothing was received from the server during one interval after
+	 * a ping. Zero disables the ping frames.
+	 * Unit is milliseconds.
+	 * Default value is 30000. (30 seconds)
+	 */
+	uint32_t ping_interval;
+	/**
+	 * Rx buffer, shared with the HTTP client during the handshake.
+	 * Default value is NULL.
+	 */
+	char *recv_buffer;
+	/**
+	 * Maximum size of the receive buffer.
+	 * It MUST be at least WEBSOCKET_MIN_RECV_BUFFER_SIZE.
+	 * Default value is 256.
+	 */
+	uint32_t recv_buffer_size;
+	/**
+	 * Size of the buffer in which frames are built, header included.
+	 * This buffer is located in the stack and limits the size of a sent message.
+	 * Default value is 128.
+	 */
+	uint32_t send_buffer_size;
+	/**
+	 * Subprotocol asked in the Sec-WebSocket-Protocol header.
+	 * This value is must located in the Heap or code region.
+	 * Default value is NULL. (none)
+	 */
+	const char *protocol;
+	/**
+	 * Seed of the generator of the handshake key and masking keys.
+	 * Should come from an entropy source such as m2m_wifi_prng_get_random_bytes.
+	 * Default value is 0.
+	 */
+	uint32_t seed;
+};
+
+/**
+ * \brief Structure of WebSocket client connection instance.
+ */
+struct websocket_client_module {
+	/** HTTP client used for the opening handshake. */
+	struct http_client_module http;
+
+	/** Socket instance of the connection, once the handshake completed. */
+	SOCKET sock;
+	/** State of the connection. */
+	uint8_t state;
+
+	/** A flag for the receive buffer located in the heap. */
+	uint8_t alloc_buffer    : 1;
+	/** A flag for the server sent the expected Sec-WebSocket-Accept. */
+	uint8_t accepted        : 1;
+	/** A flag for the ping sent and nothing received since. */
+	uint8_t ping_pending    : 1;
+	/** A flag for a fragmented message being received. */
+	uint8_t in_message      : 1;
+	/** A flag for the header of the current frame was parsed. */
+	uint8_t in_frame        : 1;
+	/** A flag for the FIN bit of the current frame. */
+	uint8_t frame_fin       : 1;
+
+	/** Opcode of the current frame. */
+	uint8_t frame_opcode;
+	/** Opcode of the message being received. */
+	uint8_t msg_opcode;
+	/** Payload of the current frame not delivered yet. */
+	uint32_t frame_remaining;
+
+	/** Size that received. */
+	uint32_t recved_size;
+
+	/** Expected value of the Sec-WebSocket-Accept header. */
+	char accept[29];
+
+	/** State of the key generator. */
+	uint32_t rand_state;
+
+	/** SW Timer ID for the ping frames. */
+	int timer_id;
+
+	/** Callback interface entry. */
+	websocket_client_callback_t cb;
+
+	/** Configuration instance of WebSocket client module. That was registered from the \ref websocket_client_init*/
+	struct websocket_client_config config;
+};
+
+/**
+ * \brief Get default configuration of WebSocket client module.
+ *
+ * \param[in]  config          Pointer of configuration structure which will be used in the module.
+ */
+void websocket_client_get_config_defaults(struct websocket_client_config *const config);
+
+/**
+ * \brief Initialize WebSocket client service.
+ *
+ * \param[in]  module          Module instance of WebSocket client module.
+ * \param[in]  config          Pointer of configuration structure which will be used in the module.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ * \return     -ENOSPC         No timer left.
+ * \return     -ENOMEM         Out of memory.
+ */
+int websocket_client_init(struct websocket_client_module *const module, struct websocket_client_config *config);
+
+/**
+ * \brief Terminate WebSocket client service.
+ *
+ * \param[in]  module          Module instance of WebSocket client.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ */
+int websocket_client_deinit(struct websocket_client_module *const module);
+
+/**
+ * \brief Register and enable the callback.
+ *
+ * \param[in]  module_inst     Instance of WebSocket client module.
+ * \param[in]  callback        Callback entry for the WebSocket client module.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ */
+int websocket_client_register_callback(struct websocket_client_module *const module, websocket_client_callback_t callback);
+
+/**
+ * \brief Open the connection.
+ *
+ * The result is reported by WEBSOCKET_CLIENT_CALLBACK_CONNECTED or
+ * WEBSOCKET_CLIENT_CALLBACK_DISCONNECTED.
+ *
+ * \param[in]  module_inst     Instance of WebSocket client module.
+ * \param[in]  url             URL of the server, with or without the ws:// or wss:// prefix.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ * \return     -EALREADY       Connection is opened or being opened.
+ * \return     -ENOSPC         No socket left.
+ * \return     -ENAMETOOLONG   URI is too long.
+ * \return     -ENOMEM         Out of memory.
+ */
+int websocket_client_connect(struct websocket_client_module *const module, const char *url);
+
+/**
+ * \brief Send a message in one frame.
+ *
+ * \param[in]  module_inst     Instance of WebSocket client module.
+ * \param[in]  opcode          WEBSOCKET_OPCODE_TEXT or WEBSOCKET_OPCODE_BINARY.
+ * \param[in]  data            Payload of the message.
+ * \param[in]  length          Length of the payload.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ * \return     -ENOTCONN       Connection is not opened.
+ * \return     -EMSGSIZE       Frame does not fit in the send buffer.
+ * \return     -EBUSY          Socket buffer is full. Try again.
+ * \return     -EIO            Socket error.
+ */
+int websocket_client_send(struct websocket_client_module *const module, uint8_t opcode, const char *data, uint32_t length);
+
+/**
+ * \brief Start the closing handshake.
+ *
+ * The connection is closed when the server answers, or after one ping interval.
+ *
+ * \param[in]  module_inst     Instance of WebSocket client module.
+ * \param[in]  code            Status code of the close frame.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ */
+int websocket_client_close(struct websocket_client_module *const module, uint16_t code);
+
+/**
+ * \brief Event handler of socket event.
+ *
+ * Must be called from the socket callback together with \ref http_client_socket_event_handler.
+ * DNS replies are handled by \ref http_client_socket_resolve_handler.
+ *
+ * \param[in]  sock            Socket descriptor.
+ * \param[in]  msg_type        Event type.
+ * \param[in]  msg_data        Structure of socket event.
+ */
+void websocket_client_socket_event_handler(SOCKET sock, uint8_t msg_type, void *msg_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WEBSOCKET_CLIENT_H_INCLUDED */
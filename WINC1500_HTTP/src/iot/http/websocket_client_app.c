@@ -0,0 +1,89 @@
+/**
+ * \file
+ *
+ * \brief Update notifications of the HTTP File Downloader Example.
+ *
+ */
+
+#include "main.h"
+
+#ifdef MAIN_WS_NOTIFY_URL
+
+#include <stdio.h>
+#include <string.h>
+#include "download.h"
+#include "driver/include/m2m_wifi.h"
+#include "iot/http/websocket_client_app.h"
+
+/** Instance of WebSocket client module receiving the update notifications. */
+struct websocket_client_module ws_client_module_inst;
+/** Update notifications are being received. */
+static bool ws_connected = false;
+
+/**
+ * \brief Callback of the WebSocket client receiving the update notifications.
+ *
+ * \param[in]  module_inst     Module instance of WebSocket client module.
+ * \param[in]  type            Type of event.
+ * \param[in]  data            Data structure of the event. \refer websocket_client_data
+ */
+static void ws_client_callback(struct websocket_client_module *module_inst, int type, union websocket_client_data *data)
+{
+	switch (type) {
+	case WEBSOCKET_CLIENT_CALLBACK_CONNECTED:
+		printf("ws_client_callback: waiting for update notifications.\r\n");
+		ws_connected = true;
+		break;
+
+	case WEBSOCKET_CLIENT_CALLBACK_RECV_MESSAGE:
+		if (data->recv_message.is_final && data->recv_message.length == strlen(MAIN_WS_UPDATE_MESSAGE)
+				&& !memcmp(data->recv_message.data, MAIN_WS_UPDATE_MESSAGE, data->recv_message.length)) {
+			printf("ws_client_callback: update available.\r\n");
+			restart_download();
+		}
+		break;
+
+	case WEBSOCKET_CLIENT_CALLBACK_DISCONNECTED:
+		printf("ws_client_callback: disconnected (%d, %u), polling again.\r\n",
+				data->disconnected.reason, (unsigned int)data->disconnected.close_code);
+		ws_connected = false;
+		break;
+
+	default:
+		break;
+	}
+}
+
+void configure_ws_client(void)
+{
+	struct websocket_client_config ws_conf;
+	uint8_t mac[6];
+	int ret;
+
+	websocket_client_get_config_defaults(&ws_conf);
+	ws_conf.timer_inst = &swt_module_inst;
+	/* The handshake key only has to differ between devices and connections. */
+	m2m_wifi_get_mac_address(mac);
+	ws_conf.seed = ((uint32_t)mac[2] << 24 | (uint32_t)mac[3] << 16 | (uint32_t)mac[4] << 8 | mac[5]) ^ get_tick_ms();
+
+	ret = websocket_client_init(&ws_client_module_inst, &ws_conf);
+	if (ret < 0) {
+		printf("configure_ws_client: WebSocket client initialization failed! (res %d)\r\n", ret);
+		while (1) {
+		} /* Loop forever. */
+	}
+
+	websocket_client_register_callback(&ws_client_module_inst, ws_client_callback);
+}
+
+void connect_ws_client(void)
+{
+	websocket_client_connect(&ws_client_module_inst, MAIN_WS_NOTIFY_URL);
+}
+
+bool is_ws_client_connected(void)
+{
+	return ws_connected;
+}
+
+#endif /* MAIN_WS_NOTIFY_URL */
@@ -0,0 +1,45 @@
+/**
+ * \file
+ *
+ * \brief Update notifications of the HTTP File Downloader Example.
+ *
+ * With MAIN_WS_NOTIFY_URL, a WebSocket connection to the update server tells
+ * when a new image is available, instead of the download every
+ * MAIN_POLL_INTERVAL seconds. Polling only resumes while the connection is down.
+ *
+ */
+
+#ifndef WEBSOCKET_CLIENT_APP_H_INCLUDED
+#define WEBSOCKET_CLIENT_APP_H_INCLUDED
+
+#include <stdbool.h>
+#include "iot/http/websocket_client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Instance of WebSocket client module receiving the update notifications. */
+extern struct websocket_client_module ws_client_module_inst;
+
+/**
+ * \brief Configure the WebSocket client receiving the update notifications.
+ */
+void configure_ws_client(void);
+
+/**
+ * \brief Connect to MAIN_WS_NOTIFY_URL, once the Wi-Fi is connected.
+ */
+void connect_ws_client(void);
+
+/**
+ * \brief Update notifications are being received.
+ * \return true if the server tells when a new image is available, false to poll.
+ */
+bool is_ws_client_connected(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WEBSOCKET_CLIENT_APP_H_INCLUDED */
@@ -0,0 +1,388 @@
+/**
+ * \file
+ *
+ * \brief Raw image slot on the SD/MMC card.
+ *
+ */
+
+#include <asf.h>
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+#include "iot/image_slot.h"
+
+/** Offset of the partition table in the master boot record. */
+#define IMAGE_SLOT_MBR_PART_TABLE       446
+/** Size of a partition table entry. */
+#define IMAGE_SLOT_MBR_PART_SIZE        16
+/** Offset of the boot signature in the first block. */
+#define IMAGE_SLOT_BOOT_SIGNATURE       510
+
+/**
+ * \brief Read a little endian 32 bits value.
+ *
+ * \param[in] ptr Pointer of the value.
+ *
+ * \return The value.
+ */
+static uint32_t image_slot_get_le32(const uint8_t *ptr)
+{
+	return ((uint32_t)ptr[3] << 24) | ((uint32_t)ptr[2] << 16)
+			| ((uint32_t)ptr[1] << 8) | (uint32_t)ptr[0];
+}
+
+/**
+ * \brief Compute the checksum of a slot header.
+ *
+ * \param[in] header Slot header.
+ *
+ * \return Two's complement of the sum of the words preceding the checksum.
+ */
+static uint32_t image_slot_checksum(const struct image_slot_header *header)
+{
+	const uint8_t *ptr = (const uint8_t *)header;
+	uint32_t sum = 0;
+	uint32_t i;
+
+	for (i = 0; i < offsetof(struct image_slot_header, checksum); i += 4) {
+		sum += image_slot_get_le32(&ptr[i]);
+	}
+	return ~sum + 1;
+}
+
+/**
+ * \brief Read one block of the card in the slot buffer.
+ *
+ * \param[in] module_inst Pointer of image slot.
+ * \param[in] block       Block number.
+ *
+ * \return 0 if succeeded, -EIO on card error.
+ */
+static int image_slot_read_block(struct image_slot_module *const module_inst, uint32_t block)
+{
+	if (sd_mmc_init_read_blocks(module_inst->config.sd_mmc_slot, block, 1) != SD_MMC_OK) {
+		return -EIO;
+	}
+	if (sd_mmc_start_read_blocks(module_inst->buffer, 1) != SD_MMC_OK) {
+		return -EIO;
+	}
+	if (sd_mmc_wait_end_of_read_blocks(false) != SD_MMC_OK) {
+		return -EIO;
+	}
+	return 0;
+}
+
+/**
+ * \brief Write the slot header of the image being written.
+ *
+ * The header is written with a single block transfer, which also stops
+ * the streaming write session of the image data. The slot buffer is used,
+ * thus it must not hold pending image data.
+ *
+ * \param[in] module_inst Pointer of image slot.
+ *
+ * \return 0 if succeeded, -EIO on card error.
+ */
+static int image_slot_write_header(struct image_slot_module *const module_inst)
+{
+	struct image_slot_header *header = &module_inst->header;
+	uint8_t *block = module_inst->buffer;
+
+	header->checksum = image_slot_checksum(header);
+	memset(block, 0xFF, SD_MMC_BLOCK_SIZE);
+	memcpy(block, header, sizeof(struct image_slot_header));
+
+	if (sd_mmc_init_write_blocks(module_inst->config.sd_mmc_slot,
+			module_inst->config.start_block, 1) != SD_MMC_OK) {
+		return -EIO;
+	}
+	if (sd_mmc_start_write_blocks(block, 1) != SD_MMC_OK) {
+		sd_mmc_wait_end_of_write_blocks(true);
+		return -EIO;
+	}
+	if (sd_mmc_wait_end_of_write_blocks(false) != SD_MMC_OK) {
+		return -EIO;
+	}
+	return 0;
+}
+
+/**
+ * \brief Write blocks of image data at the current position.
+ *
+ * \param[in] module_inst Pointer of image slot.
+ * \param[in] src         Data of the blocks.
+ * \param[in] nb_block    Number of blocks.
+ *
+ * \return 0 if succeeded, -EIO on card error.
+ */
+static int image_slot_write_blocks(struct image_slot_module *const module_inst,
+		const uint8_t *src, uint16_t nb_block)
+{
+	if (sd_mmc_stream_write_blocks(module_inst->config.sd_mmc_slot,
+			module_inst->next_block, src, nb_block) != SD_MMC_OK) {
+		return -EIO;
+	}
+	module_inst->next_block += nb_block;
+	return 0;
+}
+
+/**
+ * \brief Check if two block ranges overlap.
+ *
+ * \return true if the ranges overlap.
+ */
+static bool image_slot_overlap(uint32_t start, uint32_t nb_block,
+		uint32_t vol_start, uint32_t vol_nb_block)
+{
+	return (vol_nb_block != 0) && (start < vol_start + vol_nb_block)
+			&& (vol_start < start + nb_block);
+}
+
+/**
+ * \brief Check the slot range against the volumes of the card.
+ *
+ * \param[in] module_inst Pointer of image slot.
+ *
+ * \return 0 if the slot lies outside of the volumes, -EINVAL if it overlaps
+ *         one of them, -EIO on card error.
+ */
+static int image_slot_check_volumes(struct image_slot_module *const module_inst)
+{
+	const uint8_t *block = module_inst->buffer;
+	uint32_t start = module_inst->config.start_block;
+	uint32_t nb_block = module_inst->config.nb_block;
+	uint32_t vol_nb_block;
+	int ret;
+
+	ret = image_slot_read_block(module_inst, 0);
+	if (ret < 0) {
+		return ret;
+	}
+	if ((block[IMAGE_SLOT_BOOT_SIGNATURE] != 0x55)
+			|| (block[IMAGE_SLOT_BOOT_SIGNATURE + 1] != 0xAA)) {
+		/* Blank card, no volume. */
+		return 0;
+	}
+
+	if (!memcmp(&block[54], "FAT", 3) || !memcmp(&block[82], "FAT", 3)) {
+		/* FAT boot sector, the volume starts at block 0. */
+		vol_nb_block = block[19] | ((uint32_t)block[20] << 8);
+		if (vol_nb_block == 0) {
+			vol_nb_block = image_slot_get_le32(&block[32]);
+		}
+		return image_slot_overlap(start, nb_block, 0, vol_nb_block) ? -EINVAL : 0;
+	}
+
+	/* Master boot record. */
+	for (uint8_t i = 0; i < 4; i++) {
+		const uint8_t *part = &block[IMAGE_SLOT_MBR_PART_TABLE + i * IMAGE_SLOT_MBR_PART_SIZE];
+		if (part[4] == 0) {
+			continue;
+		}
+		if (image_slot_overlap(start, nb_block,
+				image_slot_get_le32(&part[8]), image_slot_get_le32(&part[12]))) {
+			return -EINVAL;
+		}
+	}
+	return 0;
+}
+
+void image_slot_get_config_defaults(struct image_slot_config *const config)
+{
+	Assert(config);
+
+	config->sd_mmc_slot = CONF_IMAGE_SLOT_SD_MMC_SLOT;
+	config->start_block = CONF_IMAGE_SLOT_START_BLOCK;
+	config->nb_block = CONF_IMAGE_SLOT_NB_BLOCK;
+}
+
+int image_slot_init(struct image_slot_module *const module_inst, struct image_slot_config *const config)
+{
+	uint32_t card_nb_block;
+
+	Assert(module_inst);
+	Assert(config);
+
+	memset(module_inst, 0, sizeof(struct image_slot_module));
+	memcpy(&module_inst->config, config, sizeof(struct image_slot_config));
+
+	if (sd_mmc_check(config->sd_mmc_slot) != SD_MMC_OK) {
+		return -ENODEV;
+	}
+
+	/* Header plus at least one block, no wrap around, and sizes in bytes fit in 32 bits. */
+	card_nb_block = sd_mmc_get_capacity(config->sd_mmc_slot) * (1024 / SD_MMC_BLOCK_SIZE);
+	if ((config->start_block == 0) || (config->nb_block < 2)
+			|| (config->nb_block > (UINT32_MAX / SD_MMC_BLOCK_SIZE))
+			|| (config->start_block >= card_nb_block)
+			|| (config->nb_block > card_nb_block - config->start_block)) {
+		return -EINVAL;
+	}
+
+	return image_slot_check_volumes(module_inst);
+}
+
+int image_slot_open(struct image_slot_module *const module_inst, uint32_t size, const char *name)
+{
+	struct image_slot_header *header = &module_inst->header;
+	uint32_t nb_block = module_inst->config.nb_block - 1;
+	int ret;
+
+	Assert(module_inst);
+
+	if (module_inst->opened) {
+		return -EBUSY;
+	}
+	if (size > nb_block * SD_MMC_BLOCK_SIZE) {
+		return -ENOSPC;
+	}
+
+	/* Invalidate the previous image first. */
+	memset(header, 0, sizeof(struct image_slot_header));
+	header->magic = IMAGE_SLOT_MAGIC;
+	header->version = IMAGE_SLOT_VERSION;
+	header->state = IMAGE_SLOT_STATE_WRITING;
+	header->size = size;
+	header->nb_block = nb_block;
+	if (name != NULL) {
+		strncpy(header->name, name, IMAGE_SLOT_NAME_LENGTH - 1);
+	}
+	ret = image_slot_write_header(module_inst);
+	if (ret < 0) {
+		return ret;
+	}
+
+	module_inst->next_block = image_slot_get_data_block(module_inst);
+	if (size != 0) {
+		/* Blocks are owned by the slot, let the card erase them ahead. */
+		sd_mmc_set_pre_erase(module_inst->config.sd_mmc_slot, module_inst->next_block,
+				(size + SD_MMC_BLOCK_SIZE - 1) / SD_MMC_BLOCK_SIZE);
+	}
+	module_inst->written = 0;
+	module_inst->buffered = 0;
+	module_inst->opened = true;
+	return 0;
+}
+
+int image_slot_write(struct image_slot_module *const module_inst, const void *data, uint32_t length)
+{
+	const uint8_t *src = (const uint8_t *)data;
+	uint32_t room;
+	uint32_t size;
+	uint16_t nb_block;
+	int ret;
+
+	Assert(module_inst);
+
+	if (!module_inst->opened) {
+		return -ENOENT;
+	}
+	room = (image_slot_get_data_block(module_inst) + module_inst->header.nb_block
+			- module_inst->next_block) * SD_MMC_BLOCK_SIZE - module_inst->buffered;
+	if (length > room) {
+		return -ENOSPC;
+	}
+	module_inst->written += length;
+
+	/* Complete the buffered block. */
+	if (module_inst->buffered != 0) {
+		size = min(length, (uint32_t)(SD_MMC_BLOCK_SIZE - module_inst->buffered));
+		memcpy(&module_inst->buffer[module_inst->buffered], src, size);
+		module_inst->buffered += size;
+		src += size;
+		length -= size;
+		if (module_inst->buffered < SD_MMC_BLOCK_SIZE) {
+			return 0;
+		}
+		module_inst->buffered = 0;
+		ret = image_slot_write_blocks(module_inst, module_inst->buffer, 1);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	/* Write the full blocks without copy. */
+	while (length >= SD_MMC_BLOCK_SIZE) {
+		nb_block = min(length / SD_MMC_BLOCK_SIZE, (uint32_t)SD_MMC_STREAM_NB_BLOCK_MAX);
+		ret = image_slot_write_blocks(module_inst, src, nb_block);
+		if (ret < 0) {
+			return ret;
+		}
+		src += (uint32_t)nb_block * SD_MMC_BLOCK_SIZE;
+		length -= (uint32_t)nb_block * SD_MMC_BLOCK_SIZE;
+	}
+
+	/* Keep the remaining bytes for the next block. */
+	memcpy(module_inst->buffer, src, length);
+	module_inst->buffered = length;
+	return 0;
+}
+
+int image_slot_close(struct image_slot_module *const module_inst)
+{
+	int ret;
+
+	Assert(module_inst);
+
+	if (!module_inst->opened) {
+		return -ENOENT;
+	}
+	module_inst->opened = false;
+
+	if (module_inst->buffered != 0) {
+		memset(&module_inst->buffer[module_inst->buffered], 0xFF,
+				SD_MMC_BLOCK_SIZE - module_inst->buffered);
+		module_inst->buffered = 0;
+		ret = image_slot_write_blocks(module_inst, module_inst->buffer, 1);
+		if (ret < 0) {
+			sd_mmc_stream_flush();
+			return ret;
+		}
+	}
+	if (sd_mmc_stream_flush() != SD_MMC_OK) {
+		return -EIO;
+	}
+
+	module_inst->header.state = IMAGE_SLOT_STATE_VALID;
+	module_inst->header.size = module_inst->written;
+	return image_slot_write_header(module_inst);
+}
+
+void image_slot_abort(struct image_slot_module *const module_inst)
+{
+	Assert(module_inst);
+
+	if (!module_inst->opened) {
+		return;
+	}
+	module_inst->opened = false;
+	module_inst->buffered = 0;
+	/* The header stays in writing state. */
+	sd_mmc_stream_flush();
+	sd_mmc_set_pre_erase(module_inst->config.sd_mmc_slot, 0, 0);
+}
+
+int image_slot_read_header(struct image_slot_module *const module_inst, struct image_slot_header *header)
+{
+	int ret;
+
+	Assert(module_inst);
+	Assert(header);
+
+	if (module_inst->opened) {
+		return -EBUSY;
+	}
+	ret = image_slot_read_block(module_inst, module_inst->config.start_block);
+	if (ret < 0) {
+		return ret;
+	}
+	memcpy(header, module_inst->buffer, sizeof(struct image_slot_header));
+
+	if ((header->magic != IMAGE_SLOT_MAGIC)
+			|| (header->version != IMAGE_SLOT_VERSION)
+			|| (header->checksum != image_slot_checksum(header))
+			|| (header->state != IMAGE_SLOT_STATE_VALID)) {
+		return -ENOENT;
+	}
+	return 0;
+}
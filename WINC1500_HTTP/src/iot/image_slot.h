@@ -0,0 +1,204 @@
+/**
+ * \file
+ *
+ * \brief Raw image slot on the SD/MMC card.
+ *
+ * An image slot is a range of blocks reserved on the card outside of any
+ * FAT volume. The first block holds the slot header and the image is stored
+ * in the following blocks, written with one multiple block transfer.
+ * FatFS stays available for the rest of the card.
+ *
+ */
+
+#ifndef IOT_IMAGE_SLOT_H_INCLUDED
+#define IOT_IMAGE_SLOT_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <compiler.h>
+#include "sd_mmc.h"
+#include "conf_image_slot.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Magic of the slot header ("SLOT"). */
+#define IMAGE_SLOT_MAGIC                0x544F4C53
+/** Format version of the slot header. */
+#define IMAGE_SLOT_VERSION              1
+/** Maximum length of the image name, including the terminating null. */
+#define IMAGE_SLOT_NAME_LENGTH          64
+
+/**
+ * \brief State of the image stored in the slot.
+ */
+enum image_slot_state {
+	/** No image stored. */
+	IMAGE_SLOT_STATE_EMPTY = 0,
+	/** Image being written, its content is not usable. */
+	IMAGE_SLOT_STATE_WRITING = 1,
+	/** Image completely written. */
+	IMAGE_SLOT_STATE_VALID = 2,
+};
+
+/**
+ * \brief Slot header stored in the first block of the slot.
+ *
+ * All fields are little endian. The rest of the block is filled with 0xFF.
+ */
+COMPILER_PACK_SET(1)
+struct image_slot_header {
+	/** Shall be \ref IMAGE_SLOT_MAGIC. */
+	uint32_t magic;
+	/** Shall be \ref IMAGE_SLOT_VERSION. */
+	uint32_t version;
+	/** State of the image, see \ref image_slot_state. */
+	uint32_t state;
+	/** Size of the image in bytes. */
+	uint32_t size;
+	/** Number of blocks reserved for the image (slot size minus header). */
+	uint32_t nb_block;
+	/** Image name, null terminated. */
+	char name[IMAGE_SLOT_NAME_LENGTH];
+	/** Two's complement of the sum of the previous 32 bits words. */
+	uint32_t checksum;
+};
+COMPILER_PACK_RESET()
+
+/**
+ * \brief Image slot configuration structure
+ *
+ * Configuration struct for an image slot instance. This structure should be
+ * initialized by the \ref image_slot_get_config_defaults function before being
+ * modified by the user application.
+ */
+struct image_slot_config {
+	/** SD/MMC slot of the card. */
+	uint8_t sd_mmc_slot;
+	/** First block of the slot (header block). */
+	uint32_t start_block;
+	/** Number of blocks of the slot, including the header block. */
+	uint32_t nb_block;
+};
+
+/**
+ * \brief Image slot module structure
+ */
+struct image_slot_module {
+	/** Configuration of the slot. */
+	struct image_slot_config config;
+	/** A flag that an image is being written. */
+	bool opened;
+	/** Header of the image being written. */
+	struct image_slot_header header;
+	/** Next block to be written. */
+	uint32_t next_block;
+	/** Number of bytes received for the image. */
+	uint32_t written;
+	/** Number of bytes pending in the block buffer. */
+	uint16_t buffered;
+	/** Buffer of the incomplete block. */
+	COMPILER_WORD_ALIGNED
+	uint8_t buffer[SD_MMC_BLOCK_SIZE];
+};
+
+/**
+ * \brief Get default configuration of image slot.
+ *
+ * \param[in]  config          Pointer of configuration structure which will be used in the slot.
+ */
+void image_slot_get_config_defaults(struct image_slot_config *const config);
+
+/**
+ * \brief Initialize the image slot module.
+ *
+ * The card must be ready. The slot range is checked against the card
+ * capacity and against the volumes found in the first block of the card
+ * (partition table or FAT boot sector).
+ *
+ * \param[in]  module_inst     Pointer of image slot.
+ * \param[in]  config          Pointer of configuration structure which will be used in the slot.
+ *
+ * \return 0 if initialization succeeded, -ENODEV if the card is not ready,
+ *         -EINVAL if the slot does not fit on the card or overlaps a volume,
+ *         -EIO on card error.
+ */
+int image_slot_init(struct image_slot_module *const module_inst, struct image_slot_config *const config);
+
+/**
+ * \brief Start writing an image in the slot.
+ *
+ * The previous image is invalidated. When the size is known, the blocks of
+ * the image are announced to the card to be pre-erased.
+ *
+ * \param[in]  module_inst     Pointer of image slot.
+ * \param[in]  size            Size of the image in bytes, 0 if unknown.
+ * \param[in]  name            Name of the image, can be NULL.
+ *
+ * \return 0 if succeeded, -EBUSY if an image is already being written,
+ *         -ENOSPC if the image does not fit in the slot, -EIO on card error.
+ */
+int image_slot_open(struct image_slot_module *const module_inst, uint32_t size, const char *name);
+
+/**
+ * \brief Append data to the image being written.
+ *
+ * The full blocks are written directly from \p data, only an incomplete
+ * block is copied in the slot buffer.
+ *
+ * \param[in]  module_inst     Pointer of image slot.
+ * \param[in]  data            Data to be written.
+ * \param[in]  length          Size of the data.
+ *
+ * \return 0 if succeeded, -ENOENT if no image is being written,
+ *         -ENOSPC if the slot is full, -EIO on card error.
+ */
+int image_slot_write(struct image_slot_module *const module_inst, const void *data, uint32_t length);
+
+/**
+ * \brief Complete the image and mark it valid in the slot header.
+ *
+ * \param[in]  module_inst     Pointer of image slot.
+ *
+ * \return 0 if succeeded, -ENOENT if no image is being written,
+ *         -EIO on card error.
+ */
+int image_slot_close(struct image_slot_module *const module_inst);
+
+/**
+ * \brief Stop writing the image and leave it invalid.
+ *
+ * \param[in]  module_inst     Pointer of image slot.
+ */
+void image_slot_abort(struct image_slot_module *const module_inst);
+
+/**
+ * \brief Read and check the slot header.
+ *
+ * \param[in]  module_inst     Pointer of image slot.
+ * \param[out] header          Header read from the card.
+ *
+ * \return 0 if the slot holds a valid image, -ENOENT if the slot is not
+ *         formatted or holds no valid image, -EBUSY if an image is being
+ *         written, -EIO on card error.
+ */
+int image_slot_read_header(struct image_slot_module *const module_inst, struct image_slot_header *header);
+
+/**
+ * \brief Get the first block of the image data.
+ *
+ * \param[in]  module_inst     Pointer of image slot.
+ *
+ * \return Block number of the first image block on the card.
+ */
+static inline uint32_t image_slot_get_data_block(struct image_slot_module *const module_inst)
+{
+	return module_inst->config.start_block + 1;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOT_IMAGE_SLOT_H_INCLUDED */
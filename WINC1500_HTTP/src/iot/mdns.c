@@ -0,0 +1,950 @@
+/**
+ * \file
+ *
+ * \brief Multicast DNS responder and resolver with DNS service discovery.
+ *
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include "iot/mdns.h"
+
+/** Period of the timer while announcing or querying. */
+#define MDNS_TICK_MS                    250
+/** Ticks between the announcements and between the queries. */
+#define MDNS_REPEAT_TICKS               (1000 / MDNS_TICK_MS)
+/** Number of announcements when started. */
+#define MDNS_ANNOUNCE_COUNT             2
+/** Most compression pointers followed in a name, against loops. */
+#define MDNS_MAX_POINTERS               16
+/** Size of the message header. */
+#define MDNS_HEADER_SIZE                12
+/** Largest TTL of the records of a legacy unicast response (s). */
+#define MDNS_LEGACY_TTL                 10
+
+#define MDNS_TYPE_A                     1
+#define MDNS_TYPE_PTR                   12
+#define MDNS_TYPE_TXT                   16
+#define MDNS_TYPE_SRV                   33
+#define MDNS_TYPE_ANY                   255
+#define MDNS_CLASS_IN                   1
+/** Cache flush bit of a record, unicast response bit of a question. */
+#define MDNS_CLASS_FLUSH                0x8000
+#define MDNS_FLAG_RESPONSE              0x8000
+#define MDNS_FLAG_AUTHORITATIVE         0x0400
+/** Opcode and response code, zero in mDNS. */
+#define MDNS_FLAG_CODES                 0x780F
+
+/** Name of the service type enumeration. */
+#define MDNS_SERVICES_NAME              "_services._dns-sd._udp.local"
+
+/* Records of the responder. */
+#define MDNS_RECORD_A                   0x01
+#define MDNS_RECORD_PTR                 0x02
+#define MDNS_RECORD_SRV                 0x04
+#define MDNS_RECORD_TXT                 0x08
+#define MDNS_RECORD_ENUM                0x10
+
+/** Query type of no query pending. */
+#define MDNS_QUERY_NONE                 (-1)
+
+/**
+ * \brief Message being built.
+ */
+struct mdns_writer {
+	uint8_t *buf;
+	uint16_t length;
+	/** Set when the message did not fit in the buffer. */
+	uint8_t overflow;
+};
+
+/**
+ * \brief Resource record being read.
+ */
+struct mdns_record {
+	char name[MDNS_MAX_NAME_LENGTH];
+	uint16_t type;
+	uint16_t rclass;
+	uint32_t ttl;
+	/** Offset of the data in the message. */
+	uint16_t rdata;
+	uint16_t rdlength;
+};
+
+static void _mdns_timer_callback(struct sw_timer_module *const module, int timer_id, void *context, int period);
+
+/**
+ * \brief Reference of the instances from the socket descriptor.
+ */
+static struct mdns_module *module_ref_inst[MAX_SOCKET] = {NULL,};
+
+static inline uint16_t _mdns_get_u16(const uint8_t *p)
+{
+	return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static inline uint32_t _mdns_get_u32(const uint8_t *p)
+{
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static void _mdns_put(struct mdns_writer *w, const void *data, uint16_t length)
+{
+	if (w->overflow || w->length + length > MDNS_PACKET_SIZE) {
+		w->overflow = 1;
+		return;
+	}
+	memcpy(w->buf + w->length, data, length);
+	w->length += length;
+}
+
+static void _mdns_put_u16(struct mdns_writer *w, uint16_t value)
+{
+	uint8_t bytes[2] = {(uint8_t)(value >> 8), (uint8_t)value};
+
+	_mdns_put(w, bytes, 2);
+}
+
+static void _mdns_put_u32(struct mdns_writer *w, uint32_t value)
+{
+	_mdns_put_u16(w, (uint16_t)(value >> 16));
+	_mdns_put_u16(w, (uint16_t)value);
+}
+
+/**
+ * \brief Write a dotted name as labels, without compression.
+ */
+static void _mdns_put_name(struct mdns_writer *w, const char *name)
+{
+	const char *dot;
+	uint8_t label;
+
+	while (*name != '\0') {
+		dot = strchr(name, '.');
+		label = (uint8_t)((dot != NULL) ? dot - name : strlen(name));
+		_mdns_put(w, &label, 1);
+		_mdns_put(w, name, label);
+		name += label + (dot != NULL);
+	}
+	label = 0;
+	_mdns_put(w, &label, 1);
+}
+
+/**
+ * \brief Write the header of a record. The data length is left to \ref _mdns_end_rdata.
+ *
+ * \return     Offset of the data length.
+ */
+static uint16_t _mdns_put_record(struct mdns_writer *w, const char *name, uint16_t type, uint16_t rclass, uint32_t ttl)
+{
+	_mdns_put_name(w, name);
+	_mdns_put_u16(w, type);
+	_mdns_put_u16(w, rclass);
+	_mdns_put_u32(w, ttl);
+	_mdns_put_u16(w, 0);
+	return w->length - 2;
+}
+
+static void _mdns_end_rdata(struct mdns_writer *w, uint16_t offset)
+{
+	uint16_t length = w->length - offset - 2;
+
+	if (!w->overflow) {
+		w->buf[offset] = (uint8_t)(length >> 8);
+		w->buf[offset + 1] = (uint8_t)length;
+	}
+}
+
+static void _mdns_host_name(struct mdns_module *const module, char *name)
+{
+	sprintf(name, "%s.local", module->config.host_name);
+}
+
+static void _mdns_service_name(struct mdns_module *const module, char *name)
+{
+	sprintf(name, "%s.local", module->config.service_type);
+}
+
+static void _mdns_instance_name(struct mdns_module *const module, char *name)
+{
+	sprintf(name, "%s.%s.local", module->config.instance_name, module->config.service_type);
+}
+
+/**
+ * \brief Write the records of the responder, flush being the cache flush bit of the unique ones.
+ *
+ * \return     Number of records written.
+ */
+static uint16_t _mdns_put_records(struct mdns_module *const module, struct mdns_writer *w, uint8_t records, uint32_t ttl,
+		uint16_t flush)
+{
+	char name[MDNS_MAX_NAME_LENGTH];
+	char target[MDNS_MAX_NAME_LENGTH];
+	const char *txt, *comma;
+	uint16_t count = 0, rdata;
+	uint8_t length;
+
+	if (records & MDNS_RECORD_A) {
+		_mdns_host_name(module, name);
+		rdata = _mdns_put_record(w, name, MDNS_TYPE_A, MDNS_CLASS_IN | flush, ttl);
+		/* Already in network byte order. */
+		_mdns_put(w, &module->addr, 4);
+		_mdns_end_rdata(w, rdata);
+		count++;
+	}
+	if (records & MDNS_RECORD_ENUM) {
+		_mdns_service_name(module, target);
+		rdata = _mdns_put_record(w, MDNS_SERVICES_NAME, MDNS_TYPE_PTR, MDNS_CLASS_IN, ttl);
+		_mdns_put_name(w, target);
+		_mdns_end_rdata(w, rdata);
+		count++;
+	}
+	if (records & MDNS_RECORD_PTR) {
+		_mdns_service_name(module, name);
+		_mdns_instance_name(module, target);
+		/* Shared record: several hosts answer it. */
+		rdata = _mdns_put_record(w, name, MDNS_TYPE_PTR, MDNS_CLASS_IN, ttl);
+		_mdns_put_name(w, target);
+		_mdns_end_rdata(w, rdata);
+		count++;
+	}
+	if (records & MDNS_RECORD_SRV) {
+		_mdns_instance_name(module, name);
+		_mdns_host_name(module, target);
+		rdata = _mdns_put_record(w, name, MDNS_TYPE_SRV, MDNS_CLASS_IN | flush, ttl);
+		/* Priority and weight. */
+		_mdns_put_u32(w, 0);
+		_mdns_put_u16(w, module->config.service_port);
+		_mdns_put_name(w, target);
+		_mdns_end_rdata(w, rdata);
+		count++;
+	}
+	if (records & MDNS_RECORD_TXT) {
+		_mdns_instance_name(module, name);
+		rdata = _mdns_put_record(w, name, MDNS_TYPE_TXT, MDNS_CLASS_IN | flush, ttl);
+		txt = module->config.service_txt;
+		if (txt == NULL || *txt == '\0') {
+			/* An empty TXT record holds one empty string. */
+			length = 0;
+			_mdns_put(w, &length, 1);
+		}
+		while (txt != NULL && *txt != '\0') {
+			comma = strchr(txt, ',');
+			length = (uint8_t)((comma != NULL) ? comma - txt : strlen(txt));
+			_mdns_put(w, &length, 1);
+			_mdns_put(w, txt, length);
+			txt += length + (comma != NULL);
+		}
+		_mdns_end_rdata(w, rdata);
+		count++;
+	}
+
+	return count;
+}
+
+/**
+ * \brief Records the responder owns.
+ */
+static uint8_t _mdns_own_records(struct mdns_module *const module)
+{
+	uint8_t records = 0;
+
+	if (module->config.host_name != NULL) {
+		records |= MDNS_RECORD_A;
+	}
+	if (module->config.instance_name != NULL) {
+		records |= MDNS_RECORD_ENUM | MDNS_RECORD_PTR | MDNS_RECORD_SRV | MDNS_RECORD_TXT;
+	}
+	return records;
+}
+
+/**
+ * \brief Send a message to a peer, or to the group if addr is NULL.
+ */
+static void _mdns_send(struct mdns_module *const module, struct mdns_writer *w, struct sockaddr_in *addr)
+{
+	struct sockaddr_in group;
+
+	if (w->overflow) {
+		return;
+	}
+	if (addr == NULL) {
+		group.sin_family = AF_INET;
+		group.sin_port = _htons(MDNS_PORT);
+		group.sin_addr.s_addr = _htonl(MDNS_GROUP_ADDR);
+		addr = &group;
+	}
+	sendto(module->sock, w->buf, w->length, 0, (struct sockaddr *)addr, sizeof(struct sockaddr_in));
+}
+
+/**
+ * \brief Send a response holding some records and the records that complete them.
+ *
+ * A legacy unicast response answers the query in the receive buffer, whose
+ * questions take legacy bytes after the header: it has the ID and a copy of
+ * the questions of the query, short TTLs and no cache flush bit, as described
+ * in RFC 6762 section 6.7. legacy is 0 for any other response.
+ */
+static void _mdns_send_response(struct mdns_module *const module, uint16_t legacy, uint8_t answers, uint32_t ttl,
+		struct sockaddr_in *addr)
+{
+	struct mdns_writer w = {module->send_buffer, MDNS_HEADER_SIZE, 0};
+	uint8_t additionals = 0;
+	uint16_t count, flush = MDNS_CLASS_FLUSH;
+
+	/* The SRV, TXT and A records save the queries that would follow. */
+	if (answers & MDNS_RECORD_PTR) {
+		additionals |= MDNS_RECORD_SRV | MDNS_RECORD_TXT | MDNS_RECORD_A;
+	}
+	if (answers & MDNS_RECORD_SRV) {
+		additionals |= MDNS_RECORD_A;
+	}
+	additionals &= ~answers;
+
+	memset(w.buf, 0, MDNS_HEADER_SIZE);
+	if (legacy != 0) {
+		/* The ID and the question count, then the questions: their compression pointers stay valid. */
+		memcpy(w.buf, module->recv_buffer, 2);
+		memcpy(w.buf + 4, module->recv_buffer + 4, 2);
+		_mdns_put(&w, module->recv_buffer + MDNS_HEADER_SIZE, legacy);
+		if (ttl > MDNS_LEGACY_TTL) {
+			ttl = MDNS_LEGACY_TTL;
+		}
+		flush = 0;
+	}
+	w.buf[2] = (MDNS_FLAG_RESPONSE | MDNS_FLAG_AUTHORITATIVE) >> 8;
+	count = _mdns_put_records(module, &w, answers, ttl, flush);
+	w.buf[7] = (uint8_t)count;
+	count = _mdns_put_records(module, &w, additionals, ttl, flush);
+	w.buf[11] = (uint8_t)count;
+	_mdns_send(module, &w, addr);
+}
+
+/**
+ * \brief Send the question of the pending query.
+ */
+static void _mdns_send_query(struct mdns_module *const module)
+{
+	struct mdns_writer w = {module->send_buffer, MDNS_HEADER_SIZE, 0};
+
+	memset(w.buf, 0, MDNS_HEADER_SIZE);
+	w.buf[5] = 1;
+	_mdns_put_name(&w, module->query_name);
+	_mdns_put_u16(&w, (module->query_type == MDNS_CALLBACK_RESOLVED) ? MDNS_TYPE_A : MDNS_TYPE_PTR);
+	_mdns_put_u16(&w, MDNS_CLASS_IN);
+	_mdns_send(module, &w, NULL);
+}
+
+/**
+ * \brief Keep the timer ticking while something is pending.
+ */
+static void _mdns_arm_timer(struct mdns_module *const module)
+{
+	if (module->announce_left > 0 || module->query_type != MDNS_QUERY_NONE) {
+		sw_timer_enable_callback(module->config.timer_inst, module->timer_id, MDNS_TICK_MS);
+	}
+}
+
+/**
+ * \brief End the pending query and report it.
+ */
+static void _mdns_end_query(struct mdns_module *const module)
+{
+	union mdns_data data;
+	int8_t type = module->query_type;
+
+	module->query_type = MDNS_QUERY_NONE;
+	if (module->cb == NULL) {
+		return;
+	}
+	if (type == MDNS_CALLBACK_RESOLVED) {
+		data.resolved.name = module->query_name;
+		data.resolved.addr = 0;
+		module->cb(module, MDNS_CALLBACK_RESOLVED, &data);
+	} else if (type == MDNS_CALLBACK_SERVICE) {
+		data.browse_done.count = module->found;
+		module->cb(module, MDNS_CALLBACK_BROWSE_DONE, &data);
+	}
+}
+
+/**
+ * \brief Read a name, following the compression pointers.
+ *
+ * \return     Offset after the name where it starts, or -1 if malformed.
+ */
+static int _mdns_read_name(const uint8_t *msg, uint16_t length, uint16_t offset, char *name)
+{
+	int end = -1, jumps = 0;
+	uint16_t pos = 0;
+	uint8_t label;
+
+	for (;;) {
+		if (offset >= length) {
+			return -1;
+		}
+		label = msg[offset];
+		if (label == 0) {
+			break;
+		}
+		if ((label & 0xC0) == 0xC0) {
+			if (offset + 1 >= length || ++jumps > MDNS_MAX_POINTERS) {
+				return -1;
+			}
+			if (end < 0) {
+				end = offset + 2;
+			}
+			offset = (uint16_t)((label & 0x3F) << 8 | msg[offset + 1]);
+			continue;
+		}
+		if ((label & 0xC0) != 0 || offset + 1 + label > length || pos + label + 1 >= MDNS_MAX_NAME_LENGTH) {
+			return -1;
+		}
+		if (pos > 0) {
+			name[pos++] = '.';
+		}
+		memcpy(name + pos, msg + offset + 1, label);
+		pos += label;
+		offset += 1 + label;
+	}
+	name[pos] = '\0';
+
+	return (end < 0) ? offset + 1 : end;
+}
+
+/**
+ * \brief Read a resource record.
+ *
+ * \return     Offset of the next record, or -1 if malformed.
+ */
+static int _mdns_read_record(const uint8_t *msg, uint16_t length, uint16_t offset, struct mdns_record *record)
+{
+	int ret = _mdns_read_name(msg, length, offset, record->name);
+
+	if (ret < 0 || ret + 10 > length) {
+		return -1;
+	}
+	record->type = _mdns_get_u16(msg + ret);
+	record->rclass = _mdns_get_u16(msg + ret + 2) & ~MDNS_CLASS_FLUSH;
+	record->ttl = _mdns_get_u32(msg + ret + 4);
+	record->rdlength = _mdns_get_u16(msg + ret + 8);
+	record->rdata = (uint16_t)(ret + 10);
+	if (record->rdata + record->rdlength > length) {
+		return -1;
+	}
+	return record->rdata + record->rdlength;
+}
+
+/**
+ * \brief Check whether a name is a record of the responder.
+ */
+static uint8_t _mdns_match_question(struct mdns_module *const module, const char *name, uint16_t type)
+{
+	char own[MDNS_MAX_NAME_LENGTH];
+	uint8_t records = _mdns_own_records(module);
+
+	if (records & MDNS_RECORD_A) {
+		_mdns_host_name(module, own);
+		if (!strcasecmp(name, own) && (type == MDNS_TYPE_A || type == MDNS_TYPE_ANY)) {
+			return MDNS_RECORD_A;
+		}
+	}
+	if (records & MDNS_RECORD_PTR) {
+		_mdns_service_name(module, own);
+		if (!strcasecmp(name, own) && (type == MDNS_TYPE_PTR || type == MDNS_TYPE_ANY)) {
+			return MDNS_RECORD_PTR;
+		}
+		_mdns_instance_name(module, own);
+		if (!strcasecmp(name, own)) {
+			if (type == MDNS_TYPE_ANY) {
+				return MDNS_RECORD_SRV | MDNS_RECORD_TXT;
+			}
+			return (type == MDNS_TYPE_SRV) ? MDNS_RECORD_SRV : (type == MDNS_TYPE_TXT) ? MDNS_RECORD_TXT : 0;
+		}
+		if (!strcasecmp(name, MDNS_SERVICES_NAME) && (type == MDNS_TYPE_PTR || type == MDNS_TYPE_ANY)) {
+			return MDNS_RECORD_ENUM;
+		}
+	}
+	return 0;
+}
+
+/**
+ * \brief Answer the questions of a query about the records of the responder.
+ */
+static void _mdns_handle_query(struct mdns_module *const module, uint16_t length, struct sockaddr_in *from)
+{
+	const uint8_t *msg = module->recv_buffer;
+	char name[MDNS_MAX_NAME_LENGTH];
+	uint16_t nb_question = _mdns_get_u16(msg + 4);
+	uint16_t offset = MDNS_HEADER_SIZE, type, rclass;
+	uint8_t answers = 0;
+	/* A resolver that is not on the mDNS port only waits for a unicast answer. */
+	bool legacy = (from->sin_port != _htons(MDNS_PORT));
+	bool unicast = legacy;
+	int ret;
+
+	if (_mdns_own_records(module) == 0) {
+		return;
+	}
+
+	while (nb_question-- > 0) {
+		ret = _mdns_read_name(msg, length, offset, name);
+		if (ret < 0 || ret + 4 > length) {
+			return;
+		}
+		type = _mdns_get_u16(msg + ret);
+		rclass = _mdns_get_u16(msg + ret + 2);
+		offset = (uint16_t)(ret + 4);
+		if ((rclass & ~MDNS_CLASS_FLUSH) != MDNS_CLASS_IN && (rclass & ~MDNS_CLASS_FLUSH) != MDNS_TYPE_ANY) {
+			continue;
+		}
+		if (rclass & MDNS_CLASS_FLUSH) {
+			unicast = true;
+		}
+		answers |= _mdns_match_question(module, name, type);
+	}
+
+	if (answers != 0) {
+		_mdns_send_response(module, legacy ? offset - MDNS_HEADER_SIZE : 0, answers, module->config.ttl,
+				unicast ? from : NULL);
+	}
+}
+
+/**
+ * \brief Find the address of a host in the records of a response.
+ *
+ * \return     Address in network byte order, or 0 if not found.
+ */
+static uint32_t _mdns_find_addr(struct mdns_module *const module, uint16_t length, uint16_t offset,
+		uint16_t count, const char *host)
+{
+	const uint8_t *msg = module->recv_buffer;
+	struct mdns_record record;
+	uint32_t addr;
+	int ret;
+
+	while (count-- > 0) {
+		ret = _mdns_read_record(msg, length, offset, &record);
+		if (ret < 0) {
+			break;
+		}
+		offset = (uint16_t)ret;
+		if (record.type == MDNS_TYPE_A && record.rclass == MDNS_CLASS_IN && record.rdlength == 4
+				&& record.ttl > 0 && !strcasecmp(record.name, host)) {
+			memcpy(&addr, msg + record.rdata, 4);
+			return addr;
+		}
+	}
+	return 0;
+}
+
+/**
+ * \brief Hash of a name, whatever its case (FNV-1a).
+ */
+static uint32_t _mdns_hash_name(const char *name)
+{
+	uint32_t hash = 2166136261u;
+
+	while (*name != '\0') {
+		hash = (hash ^ (uint8_t)tolower((unsigned char)*name++)) * 16777619u;
+	}
+	return hash;
+}
+
+/**
+ * \brief Check whether an instance was reported by the browsing.
+ */
+static bool _mdns_was_found(struct mdns_module *const module, uint32_t hash)
+{
+	uint32_t i;
+
+	for (i = 0; i < module->found && i < MDNS_MAX_FOUND; i++) {
+		if (module->found_hash[i] == hash) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * \brief Look for the answer of the pending query in a response.
+ */
+static void _mdns_handle_response(struct mdns_module *const module, uint16_t length)
+{
+	const uint8_t *msg = module->recv_buffer;
+	struct mdns_record record;
+	char target[MDNS_MAX_NAME_LENGTH];
+	union mdns_data data;
+	uint16_t offset = MDNS_HEADER_SIZE, records_offset;
+	uint16_t nb_question = _mdns_get_u16(msg + 4);
+	uint16_t nb_record = _mdns_get_u16(msg + 6) + _mdns_get_u16(msg + 8) + _mdns_get_u16(msg + 10);
+	uint16_t i, suffix, name_length;
+	uint32_t hash;
+	int ret;
+
+	if (module->query_type == MDNS_QUERY_NONE) {
+		return;
+	}
+
+	while (nb_question-- > 0) {
+		ret = _mdns_read_name(msg, length, offset, target);
+		if (ret < 0 || ret + 4 > length) {
+			return;
+		}
+		offset = (uint16_t)(ret + 4);
+	}
+	records_offset = offset;
+	/* Instances are named <instance>.<query name>. */
+	suffix = (uint16_t)strlen(module->query_name);
+
+	for (i = 0; i < nb_record; i++) {
+		ret = _mdns_read_record(msg, length, offset, &record);
+		if (ret < 0) {
+			return;
+		}
+		offset = (uint16_t)ret;
+		if (record.rclass != MDNS_CLASS_IN || record.ttl == 0) {
+			/* Goodbye record. */
+			continue;
+		}
+
+		if (module->query_type == MDNS_CALLBACK_RESOLVED) {
+			if (record.type == MDNS_TYPE_A && record.rdlength == 4 && !strcasecmp(record.name, module->query_name)) {
+				module->query_type = MDNS_QUERY_NONE;
+				data.resolved.name = module->query_name;
+				memcpy(&data.resolved.addr, msg + record.rdata, 4);
+				if (module->cb != NULL) {
+					module->cb(module, MDNS_CALLBACK_RESOLVED, &data);
+				}
+				return;
+			}
+			continue;
+		}
+
+		name_length = (uint16_t)strlen(record.name);
+		if (record.type != MDNS_TYPE_SRV || record.rdlength < 7 || name_length <= suffix + 1
+				|| record.name[name_length - suffix - 1] != '.'
+				|| strcasecmp(record.name + name_length - suffix, module->query_name)) {
+			continue;
+		}
+		/* Each responder answers every query of the browsing. */
+		hash = _mdns_hash_name(record.name);
+		if (_mdns_was_found(module, hash)) {
+			continue;
+		}
+		if (_mdns_read_name(msg, length, record.rdata + 6, target) < 0) {
+			continue;
+		}
+		data.service.addr = _mdns_find_addr(module, length, records_offset, nb_record, target);
+		if (data.service.addr == 0) {
+			continue;
+		}
+		data.service.instance = record.name;
+		data.service.port = _mdns_get_u16(msg + record.rdata + 4);
+		if (module->found < MDNS_MAX_FOUND) {
+			module->found_hash[module->found] = hash;
+		}
+		module->found++;
+		if (module->cb != NULL) {
+			module->cb(module, MDNS_CALLBACK_SERVICE, &data);
+		}
+		if (module->query_type != MDNS_CALLBACK_SERVICE) {
+			/* Canceled by the callback. */
+			return;
+		}
+	}
+}
+
+/**
+ * \brief Handle a received message.
+ */
+static void _mdns_handle_message(struct mdns_module *const module, uint16_t length, struct sockaddr_in *from)
+{
+	uint16_t flags;
+
+	if (length < MDNS_HEADER_SIZE || from->sin_addr.s_addr == module->addr) {
+		return;
+	}
+	flags = _mdns_get_u16(module->recv_buffer + 2);
+	if (flags & MDNS_FLAG_CODES) {
+		return;
+	}
+	if (flags & MDNS_FLAG_RESPONSE) {
+		_mdns_handle_response(module, length);
+	} else {
+		_mdns_handle_query(module, length, from);
+	}
+}
+
+void mdns_get_config_defaults(struct mdns_config *const config)
+{
+	config->timer_inst = NULL;
+	config->host_name = NULL;
+	config->instance_name = NULL;
+	config->service_type = MDNS_SERVICE_FWCACHE;
+	config->service_port = 80;
+	config->service_txt = NULL;
+	config->ttl = 120;
+	config->timeout = 2000;
+}
+
+int mdns_init(struct mdns_module *const module, struct mdns_config *config)
+{
+	/* Checks the parameters. */
+	if (module == NULL || config == NULL || config->timer_inst == NULL || config->service_type == NULL) {
+		return -EINVAL;
+	}
+
+	if (config->instance_name != NULL && config->host_name == NULL) {
+		return -EINVAL;
+	}
+
+	/* Labels have at most 63 bytes. */
+	if (config->host_name != NULL && (strlen(config->host_name) > 63
+			|| strlen(config->host_name) + sizeof(".local") > MDNS_MAX_NAME_LENGTH)) {
+		return -EINVAL;
+	}
+
+	if (strlen(config->service_type) + sizeof(".local") > MDNS_MAX_NAME_LENGTH) {
+		return -EINVAL;
+	}
+
+	if (config->instance_name != NULL && (strlen(config->instance_name) > 63 || strchr(config->instance_name, '.')
+			|| strlen(config->instance_name) + 1 + strlen(config->service_type) + sizeof(".local") > MDNS_MAX_NAME_LENGTH)) {
+		return -EINVAL;
+	}
+
+	memset(module, 0, sizeof(struct mdns_module));
+	memcpy(&module->config, config, sizeof(struct mdns_config));
+	module->sock = -1;
+	module->query_type = MDNS_QUERY_NONE;
+
+	module->timer_id = sw_timer_register_callback(config->timer_inst, _mdns_timer_callback, (void *)module, 0);
+	if (module->timer_id < 0) {
+		return -ENOSPC;
+	}
+
+	return 0;
+}
+
+int mdns_register_callback(struct mdns_module *const module, mdns_callback_t callback)
+{
+	if (module == NULL) {
+		return -EINVAL;
+	}
+
+	module->cb = callback;
+
+	return 0;
+}
+
+int mdns_start(struct mdns_module *const module, uint32_t addr)
+{
+	struct sockaddr_in addr_in;
+
+	if (module == NULL) {
+		return -EINVAL;
+	}
+
+	if (module->sock >= 0) {
+		return -EALREADY;
+	}
+
+	module->sock = socket(AF_INET, SOCK_DGRAM, 0);
+	if (module->sock < 0) {
+		module->sock = -1;
+		return -ENOSPC;
+	}
+	module_ref_inst[module->sock] = module;
+	module->addr = addr;
+	module->bound = 0;
+	module->skip = 0;
+
+	/* The records are announced once bound. */
+	addr_in.sin_family = AF_INET;
+	addr_in.sin_port = _htons(MDNS_PORT);
+	addr_in.sin_addr.s_addr = 0;
+	bind(module->sock, (struct sockaddr *)&addr_in, sizeof(struct sockaddr_in));
+
+	return 0;
+}
+
+int mdns_stop(struct mdns_module *const module)
+{
+	uint32_t group = _htonl(MDNS_GROUP_ADDR);
+
+	if (module == NULL) {
+		return -EINVAL;
+	}
+
+	if (module->sock < 0) {
+		return 0;
+	}
+
+	if (module->bound) {
+		/* Records with a zero TTL are removed from the caches. */
+		if (_mdns_own_records(module) != 0) {
+			_mdns_send_response(module, 0, _mdns_own_records(module) & ~MDNS_RECORD_ENUM, 0, NULL);
+		}
+		setsockopt(module->sock, SOL_SOCKET, IP_DROP_MEMBERSHIP, &group, sizeof(group));
+	}
+	close(module->sock);
+	module_ref_inst[module->sock] = NULL;
+	module->sock = -1;
+	module->bound = 0;
+	module->query_type = MDNS_QUERY_NONE;
+	module->announce_left = 0;
+	sw_timer_disable_callback(module->config.timer_inst, module->timer_id);
+
+	return 0;
+}
+
+/**
+ * \brief Start a query, sent now or once bound.
+ */
+static int _mdns_start_query(struct mdns_module *const module, int8_t type)
+{
+	module->query_type = type;
+	module->query_ticks = (uint16_t)(module->config.timeout / MDNS_TICK_MS);
+	if (module->query_ticks == 0) {
+		module->query_ticks = 1;
+	}
+	module->found = 0;
+	if (module->bound) {
+		_mdns_send_query(module);
+	}
+	_mdns_arm_timer(module);
+
+	return 0;
+}
+
+int mdns_resolve(struct mdns_module *const module, const char *name)
+{
+	if (module == NULL || name == NULL) {
+		return -EINVAL;
+	}
+
+	if (module->sock < 0) {
+		return -ENOTCONN;
+	}
+
+	if (module->query_type != MDNS_QUERY_NONE) {
+		return -EALREADY;
+	}
+
+	if (strlen(name) >= MDNS_MAX_NAME_LENGTH) {
+		return -ENAMETOOLONG;
+	}
+
+	strcpy(module->query_name, name);
+	return _mdns_start_query(module, MDNS_CALLBACK_RESOLVED);
+}
+
+int mdns_browse(struct mdns_module *const module)
+{
+	if (module == NULL) {
+		return -EINVAL;
+	}
+
+	if (module->sock < 0) {
+		return -ENOTCONN;
+	}
+
+	if (module->query_type != MDNS_QUERY_NONE) {
+		return -EALREADY;
+	}
+
+	_mdns_service_name(module, module->query_name);
+	return _mdns_start_query(module, MDNS_CALLBACK_SERVICE);
+}
+
+void mdns_cancel(struct mdns_module *const module)
+{
+	if (module != NULL) {
+		module->query_type = MDNS_QUERY_NONE;
+	}
+}
+
+void mdns_socket_event_handler(SOCKET sock, uint8_t msg_type, void *msg_data)
+{
+	tstrSocketBindMsg *msg_bind;
+	tstrSocketRecvMsg *msg_recv;
+	uint32_t group = _htonl(MDNS_GROUP_ADDR);
+
+	/* Find instance using the socket descriptor. */
+	struct mdns_module *module = module_ref_inst[sock];
+	/* If cannot found reference, This socket is not mDNS socket. */
+	if (module == NULL) {
+		return;
+	}
+
+	switch (msg_type) {
+	case SOCKET_MSG_BIND:
+		msg_bind = (tstrSocketBindMsg *)msg_data;
+		if (msg_bind->status != 0) {
+			mdns_stop(module);
+			break;
+		}
+		module->bound = 1;
+		setsockopt(sock, SOL_SOCKET, IP_ADD_MEMBERSHIP, &group, sizeof(group));
+		recvfrom(sock, module->recv_buffer, MDNS_PACKET_SIZE, 0);
+		if (_mdns_own_records(module) != 0) {
+			_mdns_send_response(module, 0, _mdns_own_records(module), module->config.ttl, NULL);
+			module->announce_left = MDNS_ANNOUNCE_COUNT - 1;
+			module->announce_ticks = MDNS_REPEAT_TICKS;
+		}
+		if (module->query_type != MDNS_QUERY_NONE) {
+			_mdns_send_query(module);
+		}
+		_mdns_arm_timer(module);
+		break;
+	case SOCKET_MSG_RECVFROM:
+		msg_recv = (tstrSocketRecvMsg *)msg_data;
+		if (msg_recv->s16BufferSize > 0) {
+			if (msg_recv->u16RemainingSize > 0) {
+				/* The rest of the message comes in the next events. */
+				module->skip = 1;
+				break;
+			} else if (module->skip) {
+				module->skip = 0;
+			} else {
+				_mdns_handle_message(module, (uint16_t)msg_recv->s16BufferSize, &msg_recv->strRemoteAddr);
+			}
+		}
+		/* Continue to receive, unless stopped. */
+		if (module_ref_inst[sock] == module) {
+			recvfrom(sock, module->recv_buffer, MDNS_PACKET_SIZE, 0);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+static void _mdns_timer_callback(struct sw_timer_module *const module, int timer_id, void *context, int period)
+{
+	struct mdns_module *mdns = (struct mdns_module *)context;
+
+	if (mdns->sock < 0) {
+		return;
+	}
+
+	if (mdns->announce_left > 0 && --mdns->announce_ticks == 0) {
+		_mdns_send_response(mdns, 0, _mdns_own_records(mdns), mdns->config.ttl, NULL);
+		mdns->announce_left--;
+		mdns->announce_ticks = MDNS_REPEAT_TICKS;
+	}
+
+	if (mdns->query_type != MDNS_QUERY_NONE) {
+		if (--mdns->query_ticks == 0) {
+			_mdns_end_query(mdns);
+		} else if (mdns->bound && mdns->query_ticks % MDNS_REPEAT_TICKS == 0) {
+			_mdns_send_query(mdns);
+		}
+	}
+
+	_mdns_arm_timer(mdns);
+}
@@ -0,0 +1,321 @@
+/**
+ * \file
+ *
+ * \brief Multicast DNS responder and resolver with DNS service discovery.
+ *
+ * Names of the local link (.local) are resolved and services browsed with
+ * multicast queries on 224.0.0.251:5353, as described in RFC 6762 and RFC 6763:
+ * https://tools.ietf.org/html/rfc6762
+ * https://tools.ietf.org/html/rfc6763
+ *
+ * The responder answers the queries for the host name and, when an instance
+ * name is set, advertises a service of this host. Records are announced twice
+ * when started and withdrawn when stopped. There is no probing: the names must
+ * be unique on the link, e.g. built from the MAC address.
+ *
+ * A service is reported when a response holds its SRV record and the address
+ * of its target, as the responders add the SRV, TXT and A records of the
+ * instances to their PTR answers.
+ *
+ */
+
+#ifndef IOT_MDNS_H_INCLUDED
+#define IOT_MDNS_H_INCLUDED
+
+#include <stdint.h>
+#include "socket/include/socket.h"
+#include "iot/sw_timer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** UDP port of mDNS. */
+#define MDNS_PORT                       5353
+/** Multicast group of mDNS, 224.0.0.251. */
+#define MDNS_GROUP_ADDR                 0xE00000FB
+/** Largest mDNS message sent or received. Bigger messages are dropped. */
+#define MDNS_PACKET_SIZE                512
+/** Largest name handled, dots and terminating null included. */
+#define MDNS_MAX_NAME_LENGTH            96
+/** Most instances a browsing remembers, to report each of them once. */
+#define MDNS_MAX_FOUND                  8
+/** Service type of the firmware caches of the local network. */
+#define MDNS_SERVICE_FWCACHE            "_fwcache._tcp"
+
+/**
+ * \brief A type of mDNS callback.
+ */
+enum mdns_callback_type {
+	/** A .local name was resolved, or the query timed out. */
+	MDNS_CALLBACK_RESOLVED,
+	/** An instance of the browsed service was found. */
+	MDNS_CALLBACK_SERVICE,
+	/** Browsing ended after the query timeout. */
+	MDNS_CALLBACK_BROWSE_DONE,
+};
+
+/**
+ * \brief Structure of the MDNS_CALLBACK_RESOLVED callback.
+ */
+struct mdns_data_resolved {
+	/** Name of the query. */
+	const char *name;
+	/** IPv4 address in network byte order, 0 if no answer came. */
+	uint32_t addr;
+};
+
+/**
+ * \brief Structure of the MDNS_CALLBACK_SERVICE callback.
+ *
+ * An instance is reported once by a browsing, even if several responses hold
+ * it. Only the first MDNS_MAX_FOUND instances are remembered, by a hash of
+ * their name: the ones after them are reported again.
+ */
+struct mdns_data_service {
+	/** Full name of the instance. Only valid during the callback. */
+	const char *instance;
+	/** IPv4 address of the instance in network byte order. */
+	uint32_t addr;
+	/** TCP or UDP port of the instance. */
+	uint16_t port;
+};
+
+/**
+ * \brief Structure of the MDNS_CALLBACK_BROWSE_DONE callback.
+ */
+struct mdns_data_browse_done {
+	/** Number of MDNS_CALLBACK_SERVICE callbacks of the browsing. */
+	uint32_t count;
+};
+
+/**
+ * \brief Structure of the mDNS callback.
+ */
+union mdns_data {
+	struct mdns_data_resolved resolved;
+	struct mdns_data_service service;
+	struct mdns_data_browse_done browse_done;
+};
+
+/* Before declaring for the callback type. */
+struct mdns_module;
+/**
+ * \brief Callback interface of mDNS service.
+ *
+ * \param[in]  module_inst     Module instance of mDNS module.
+ * \param[in]  type            Type of event.
+ * \param[in]  data            Data structure of the event. \refer mdns_data
+ */
+typedef void (*mdns_callback_t)(struct mdns_module *module_inst, int type, union mdns_data *data);
+
+/**
+ * \brief mDNS configuration structure
+ *
+ * Configuration struct for a mDNS instance. This structure should be
+ * initialized by the \ref mdns_get_config_defaults function before being
+ * modified by the user application.
+ */
+struct mdns_config {
+	/**
+	 * Timer module for the announcements and the query timeout.
+	 * Default value is NULL.
+	 */
+	struct sw_timer_module *timer_inst;
+	/**
+	 * Host name answered by the responder, without the .local domain.
+	 * This value is must located in the Heap or code region.
+	 * Default value is NULL. (no responder)
+	 */
+	const char *host_name;
+	/**
+	 * Instance name of the advertised service, a single label.
+	 * It needs the host name.
+	 * This value is must located in the Heap or code region.
+	 * Default value is NULL. (no service advertised)
+	 */
+	const char *instance_name;
+	/**
+	 * Type of the advertised and browsed service.
+	 * Default value is MDNS_SERVICE_FWCACHE.
+	 */
+	const char *service_type;
+	/**
+	 * Port of the advertised service.
+	 * Default value is 80.
+	 */
+	uint16_t service_port;
+	/**
+	 * Text of the TXT record of the advertised service, "key=value" pairs
+	 * separated by commas.
+	 * Default value is NULL. (empty TXT record)
+	 */
+	const char *service_txt;
+	/**
+	 * Time to live of the records of the responder.
+	 * Unit is seconds.
+	 * Default value is 120.
+	 */
+	uint32_t ttl;
+	/**
+	 * Time a resolution or a browsing waits for the answers. The query is sent
+	 * again every second.
+	 * Unit is milliseconds.
+	 * Default value is 2000. (2 seconds)
+	 */
+	uint32_t timeout;
+};
+
+/**
+ * \brief Structure of mDNS instance.
+ */
+struct mdns_module {
+	/** UDP socket, bound to MDNS_PORT. */
+	SOCKET sock;
+	/** IPv4 address of this host in network byte order. */
+	uint32_t addr;
+
+	/** A flag for the socket being bound. */
+	uint8_t bound           : 1;
+	/** A flag for dropping the rest of a message bigger than the buffer. */
+	uint8_t skip            : 1;
+
+	/** Type of the pending query, MDNS_CALLBACK_RESOLVED or MDNS_CALLBACK_SERVICE, or -1 if none. */
+	int8_t query_type;
+	/** Name of the pending query. */
+	char query_name[MDNS_MAX_NAME_LENGTH];
+	/** Ticks left before the query times out. */
+	uint16_t query_ticks;
+	/** Number of services found by the browsing. */
+	uint32_t found;
+	/** Hashes of the names of the first services found, to report each once. */
+	uint32_t found_hash[MDNS_MAX_FOUND];
+	/** Announcements left to send. */
+	uint8_t announce_left;
+	/** Ticks left before the next announcement. */
+	uint16_t announce_ticks;
+
+	/** Buffer of the received messages. */
+	uint8_t recv_buffer[MDNS_PACKET_SIZE];
+	/** Buffer in which the messages are built. */
+	uint8_t send_buffer[MDNS_PACKET_SIZE];
+
+	/** SW Timer ID. */
+	int timer_id;
+
+	/** Callback interface entry. */
+	mdns_callback_t cb;
+
+	/** Configuration instance of mDNS module. That was registered from the \ref mdns_init*/
+	struct mdns_config config;
+};
+
+/**
+ * \brief Get default configuration of mDNS module.
+ *
+ * \param[in]  config          Pointer of configuration structure which will be used in the module.
+ */
+void mdns_get_config_defaults(struct mdns_config *const config);
+
+/**
+ * \brief Initialize mDNS service.
+ *
+ * \param[in]  module          Module instance of mDNS module.
+ * \param[in]  config          Pointer of configuration structure which will be used in the module.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ * \return     -ENOSPC         No timer left.
+ */
+int mdns_init(struct mdns_module *const module, struct mdns_config *config);
+
+/**
+ * \brief Register and enable the callback.
+ *
+ * \param[in]  module_inst     Instance of mDNS module.
+ * \param[in]  callback        Callback entry for the mDNS module.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ */
+int mdns_register_callback(struct mdns_module *const module, mdns_callback_t callback);
+
+/**
+ * \brief Join the multicast group and announce the records, once the IP address is known.
+ *
+ * \param[in]  module          Instance of mDNS module.
+ * \param[in]  addr            IPv4 address of this host in network byte order.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ * \return     -EALREADY       Already started.
+ * \return     -ENOSPC         No socket left.
+ */
+int mdns_start(struct mdns_module *const module, uint32_t addr);
+
+/**
+ * \brief Withdraw the records, leave the group and close the socket.
+ *
+ * A pending query ends without callback.
+ *
+ * \param[in]  module          Instance of mDNS module.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ */
+int mdns_stop(struct mdns_module *const module);
+
+/**
+ * \brief Resolve a name of the local link.
+ *
+ * The result is reported by MDNS_CALLBACK_RESOLVED.
+ *
+ * \param[in]  module          Instance of mDNS module.
+ * \param[in]  name            Name, ending with .local.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ * \return     -ENOTCONN       Not started.
+ * \return     -EALREADY       A query is pending.
+ * \return     -ENAMETOOLONG   Name is too long.
+ */
+int mdns_resolve(struct mdns_module *const module, const char *name);
+
+/**
+ * \brief Browse the instances of the configured service type.
+ *
+ * The instances are reported by MDNS_CALLBACK_SERVICE until
+ * MDNS_CALLBACK_BROWSE_DONE, or until \ref mdns_cancel.
+ *
+ * \param[in]  module          Instance of mDNS module.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ * \return     -ENOTCONN       Not started.
+ * \return     -EALREADY       A query is pending.
+ */
+int mdns_browse(struct mdns_module *const module);
+
+/**
+ * \brief End the pending query without callback.
+ *
+ * \param[in]  module          Instance of mDNS module.
+ */
+void mdns_cancel(struct mdns_module *const module);
+
+/**
+ * \brief Event handler of the socket.
+ *
+ * This function must be called from the socket callback registered with registerSocketCallback.
+ *
+ * \param[in]  sock            Socket descriptor.
+ * \param[in]  msg_type        Type of the socket event.
+ * \param[in]  msg_data        Data of the socket event.
+ */
+void mdns_socket_event_handler(SOCKET sock, uint8_t msg_type, void *msg_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOT_MDNS_H_INCLUDED */
@@ -0,0 +1,221 @@
+/**
+ * \file
+ *
+ * \brief Local network discovery of the HTTP File Downloader Example.
+ *
+ */
+
+#include "main.h"
+
+#ifdef MAIN_MDNS_HOST_NAME
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include "download.h"
+#include "iot/mdns_app.h"
+
+/** Instance of mDNS module. */
+static struct mdns_module mdns_inst;
+/** URL of the next download, NULL until the firmware caches were looked for. */
+static const char *download_url = NULL;
+/** URL of the image on a firmware cache, or on the .local host resolved. */
+static char local_url[sizeof("https://255.255.255.255") + HTTP_MAX_URI_LENGTH];
+/** The download comes from a firmware cache. */
+static bool cache_download = false;
+/** The last download from a firmware cache did not complete: the next one does not use a cache. */
+static bool cache_failed = false;
+
+/**
+ * \brief Get the path of MAIN_HTTP_FILE_URL, and its host.
+ * \param[out] host Host of the URL, HOSTNAME_MAX_SIZE bytes, or NULL.
+ */
+static const char *get_file_url_path(char *host)
+{
+	const char *start = strstr(MAIN_HTTP_FILE_URL, "://");
+	const char *path;
+
+	start = (start != NULL) ? start + 3 : MAIN_HTTP_FILE_URL;
+	path = strchr(start, '/');
+	if (path == NULL) {
+		path = start + strlen(start);
+	}
+	if (host != NULL) {
+		snprintf(host, HOSTNAME_MAX_SIZE, "%.*s", (int)(path - start), start);
+	}
+	return path;
+}
+
+/**
+ * \brief Set the URL of the next download and the port of the HTTP client.
+ * \param[in] url URL of the image.
+ * \param[in] port TCP port, or 0 for the default port of the scheme.
+ */
+static void set_download_url(const char *url, uint16_t port)
+{
+	bool tls = (strncmp(url, "https://", 8) == 0);
+
+	http_client_module_inst.config.tls = tls;
+	http_client_module_inst.config.port = (port != 0) ? port : tls ? 443 : 80;
+	download_url = url;
+	cache_download = false;
+}
+
+/**
+ * \brief Download the image from an address of the local network.
+ * \param[in] addr IPv4 address in network byte order.
+ * \param[in] port TCP port of a firmware cache, or 0 for the host of MAIN_HTTP_FILE_URL.
+ */
+static void set_local_url(uint32_t addr, uint16_t port)
+{
+	/* The caches serve plain HTTP. */
+	bool tls = (port == 0) && (strncmp(MAIN_HTTP_FILE_URL, "https://", 8) == 0);
+
+	snprintf(local_url, sizeof(local_url), "%s%d.%d.%d.%d%s", tls ? "https://" : "http://",
+			(int)IPV4_BYTE(addr, 0), (int)IPV4_BYTE(addr, 1),
+			(int)IPV4_BYTE(addr, 2), (int)IPV4_BYTE(addr, 3), get_file_url_path(NULL));
+	set_download_url(local_url, port);
+}
+
+/**
+ * \brief Resolve the host of MAIN_HTTP_FILE_URL with mDNS if it is a .local name.
+ * \return true if the download starts from the mDNS callback.
+ */
+static bool resolve_local_host(void)
+{
+	char host[HOSTNAME_MAX_SIZE];
+	size_t length;
+
+	get_file_url_path(host);
+	length = strlen(host);
+	if (length > 6 && !strcasecmp(host + length - 6, ".local") && mdns_resolve(&mdns_inst, host) == 0) {
+		printf("start_download: resolving %s...\r\n", host);
+		return true;
+	}
+	set_download_url(MAIN_HTTP_FILE_URL, 0);
+	return false;
+}
+
+/**
+ * \brief Look for a firmware cache of the local network, then for the .local host.
+ * \return true if the download starts from the mDNS callback.
+ */
+static bool start_mdns_lookup(void)
+{
+	int ret;
+
+	if (!cache_failed) {
+		ret = mdns_browse(&mdns_inst);
+		if (ret == 0) {
+			printf("start_download: looking for a firmware cache...\r\n");
+			return true;
+		} else if (ret == -EALREADY) {
+			printf("start_download: running mDNS query already.\r\n");
+			return true;
+		}
+	}
+	cache_failed = false;
+	return resolve_local_host();
+}
+
+/**
+ * \brief Callback of mDNS.
+ *
+ * \param[in]  module_inst     Module instance of mDNS module.
+ * \param[in]  type            Type of event.
+ * \param[in]  data            Data structure of the event. \refer mdns_data
+ */
+static void mdns_callback(struct mdns_module *module_inst, int type, union mdns_data *data)
+{
+	switch (type) {
+	case MDNS_CALLBACK_SERVICE:
+		printf("mdns_callback: firmware cache %s at %d.%d.%d.%d:%u\r\n", data->service.instance,
+				(int)IPV4_BYTE(data->service.addr, 0), (int)IPV4_BYTE(data->service.addr, 1),
+				(int)IPV4_BYTE(data->service.addr, 2), (int)IPV4_BYTE(data->service.addr, 3),
+				(unsigned int)data->service.port);
+		/* The first cache found serves the image. */
+		mdns_cancel(module_inst);
+		set_local_url(data->service.addr, data->service.port);
+		cache_download = true;
+		start_download();
+		break;
+
+	case MDNS_CALLBACK_BROWSE_DONE:
+		printf("mdns_callback: no firmware cache found.\r\n");
+		if (!resolve_local_host()) {
+			start_download();
+		}
+		break;
+
+	case MDNS_CALLBACK_RESOLVED:
+		if (data->resolved.addr != 0) {
+			printf("mdns_callback: %s IP address is %d.%d.%d.%d\r\n", data->resolved.name,
+					(int)IPV4_BYTE(data->resolved.addr, 0), (int)IPV4_BYTE(data->resolved.addr, 1),
+					(int)IPV4_BYTE(data->resolved.addr, 2), (int)IPV4_BYTE(data->resolved.addr, 3));
+			set_local_url(data->resolved.addr, 0);
+		} else {
+			printf("mdns_callback: %s not found.\r\n", data->resolved.name);
+			set_download_url(MAIN_HTTP_FILE_URL, 0);
+		}
+		start_download();
+		break;
+
+	default:
+		break;
+	}
+}
+
+void configure_mdns(void)
+{
+	struct mdns_config mdns_conf;
+	int ret;
+
+	mdns_get_config_defaults(&mdns_conf);
+	mdns_conf.timer_inst = &swt_module_inst;
+	mdns_conf.host_name = MAIN_MDNS_HOST_NAME;
+	mdns_conf.timeout = MAIN_MDNS_BROWSE_TIMEOUT_MS;
+
+	ret = mdns_init(&mdns_inst, &mdns_conf);
+	if (ret < 0) {
+		printf("configure_mdns: mDNS initialization failed! (res %d)\r\n", ret);
+		while (1) {
+		} /* Loop forever. */
+	}
+
+	mdns_register_callback(&mdns_inst, mdns_callback);
+}
+
+void start_mdns(const uint8_t *addr)
+{
+	uint32_t ip;
+
+	/* Already in network byte order. The queries wait for the socket to be bound. */
+	memcpy(&ip, addr, sizeof(ip));
+	mdns_start(&mdns_inst, ip);
+}
+
+void stop_mdns(void)
+{
+	mdns_stop(&mdns_inst);
+	download_url = NULL;
+}
+
+const char *get_mdns_download_url(void)
+{
+	const char *url;
+
+	if (download_url == NULL && start_mdns_lookup()) {
+		return NULL;
+	}
+	url = download_url;
+	download_url = NULL;
+	return url;
+}
+
+void end_mdns_download(bool completed)
+{
+	cache_failed = cache_download && !completed;
+}
+
+#endif /* MAIN_MDNS_HOST_NAME */
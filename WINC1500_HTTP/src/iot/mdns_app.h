@@ -0,0 +1,59 @@
+/**
+ * \file
+ *
+ * \brief Local network discovery of the HTTP File Downloader Example.
+ *
+ * With MAIN_MDNS_HOST_NAME, the device answers its .local name and looks for
+ * a firmware cache of the local network before each download. Without a
+ * cache, the image comes from MAIN_HTTP_FILE_URL, whose host is resolved
+ * with mDNS if it is a .local name. A download from a cache that did not
+ * complete is retried without the cache.
+ *
+ */
+
+#ifndef IOT_MDNS_APP_H_INCLUDED
+#define IOT_MDNS_APP_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "iot/mdns.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Configure mDNS, answering the host name and looking for the firmware caches.
+ */
+void configure_mdns(void);
+
+/**
+ * \brief Start mDNS once the device has an IP address.
+ * \param[in] addr IPv4 address of the device, 4 bytes in network byte order.
+ */
+void start_mdns(const uint8_t *addr);
+
+/**
+ * \brief Stop mDNS when the Wi-Fi is disconnected.
+ */
+void stop_mdns(void);
+
+/**
+ * \brief Get the URL of the next download, looking for a copy of the image on the local network first.
+ *
+ * The HTTP client is set up for the URL returned.
+ * \return URL of the image, or NULL if the download starts from the mDNS callback.
+ */
+const char *get_mdns_download_url(void);
+
+/**
+ * \brief Record the end of a download, before the next one.
+ * \param[in] completed true if the image was downloaded.
+ */
+void end_mdns_download(bool completed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOT_MDNS_APP_H_INCLUDED */
@@ -0,0 +1,57 @@
+/**
+ * \file
+ *
+ * \brief Lock-free queue of fixed-size messages between two tasks.
+ *
+ */
+
+#include <errno.h>
+#include <string.h>
+#include "iot/msg_queue.h"
+
+int msg_queue_init(struct msg_queue *const queue, void *buffer, uint16_t msg_size, uint16_t count)
+{
+	if (queue == NULL || buffer == NULL || msg_size == 0 || count == 0 || (count & (count - 1)) != 0) {
+		return -EINVAL;
+	}
+
+	queue->buffer = (uint8_t *)buffer;
+	queue->msg_size = msg_size;
+	queue->count = count;
+	queue->head = 0;
+	queue->tail = 0;
+
+	return 0;
+}
+
+bool msg_queue_push(struct msg_queue *const queue, const void *msg)
+{
+	uint32_t head = queue->head;
+
+	/* The consumer copied the message out of the slot before freeing it. */
+	if (head - MSG_QUEUE_LOAD(queue->tail) >= queue->count) {
+		return false;
+	}
+
+	memcpy(&queue->buffer[(head & (queue->count - 1)) * queue->msg_size], msg, queue->msg_size);
+	/* The message is in its slot before the consumer sees it. */
+	MSG_QUEUE_STORE(queue->head, head + 1);
+
+	return true;
+}
+
+bool msg_queue_pop(struct msg_queue *const queue, void *msg)
+{
+	uint32_t tail = queue->tail;
+
+	/* The index is read before the message. */
+	if (MSG_QUEUE_LOAD(queue->head) == tail) {
+		return false;
+	}
+
+	memcpy(msg, &queue->buffer[(tail & (queue->count - 1)) * queue->msg_size], queue->msg_size);
+	/* The message is copied out before the producer reuses its slot. */
+	MSG_QUEUE_STORE(queue->tail, tail + 1);
+
+	return true;
+}
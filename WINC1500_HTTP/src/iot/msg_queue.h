@@ -0,0 +1,107 @@
+/**
+ * \file
+ *
+ * \brief Lock-free queue of fixed-size messages between two tasks.
+ *
+ * One task pushes and one task pops, each on its own index, so no lock nor
+ * critical section is needed. The indexes run freely and the slot is the index
+ * modulo the number of slots, which must be a power of two. An index is
+ * published with a release store once the copy of its message is done, and read
+ * with an acquire load before the message is copied.
+ *
+ * Only the producer may call \ref msg_queue_push and only the consumer
+ * \ref msg_queue_pop. The counts may be read by both.
+ *
+ */
+
+#ifndef IOT_MSG_QUEUE_H_INCLUDED
+#define IOT_MSG_QUEUE_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Full barrier, for the users waiting on a count of the queue. */
+#define MSG_QUEUE_BARRIER()             __atomic_thread_fence(__ATOMIC_SEQ_CST)
+/** Read the index of the other task. */
+#define MSG_QUEUE_LOAD(index)           __atomic_load_n(&(index), __ATOMIC_ACQUIRE)
+/** Publish the own index to the other task. */
+#define MSG_QUEUE_STORE(index, value)   __atomic_store_n(&(index), (value), __ATOMIC_RELEASE)
+
+/**
+ * \brief Structure of a message queue.
+ */
+struct msg_queue {
+	/** Slots of the messages. */
+	uint8_t *buffer;
+	/** Size of a message. */
+	uint16_t msg_size;
+	/** Number of slots, a power of two. */
+	uint16_t count;
+	/** Messages pushed, written by the producer only. */
+	uint32_t head;
+	/** Messages popped, written by the consumer only. */
+	uint32_t tail;
+};
+
+/**
+ * \brief Initialize an empty queue.
+ *
+ * \param[in]  queue           Queue to initialize.
+ * \param[in]  buffer          Slots of the messages, msg_size * count bytes.
+ * \param[in]  msg_size        Size of a message.
+ * \param[in]  count           Number of slots, a power of two.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ */
+int msg_queue_init(struct msg_queue *const queue, void *buffer, uint16_t msg_size, uint16_t count);
+
+/**
+ * \brief Copy a message at the end of the queue. Producer only.
+ *
+ * \param[in]  queue           Queue of the message.
+ * \param[in]  msg             Message of msg_size bytes.
+ *
+ * \return     true if pushed, false if the queue is full.
+ */
+bool msg_queue_push(struct msg_queue *const queue, const void *msg);
+
+/**
+ * \brief Copy and remove the first message of the queue. Consumer only.
+ *
+ * \param[in]  queue           Queue of the message.
+ * \param[out] msg             Message of msg_size bytes.
+ *
+ * \return     true if popped, false if the queue is empty.
+ */
+bool msg_queue_pop(struct msg_queue *const queue, void *msg);
+
+/**
+ * \brief Get the number of messages in the queue.
+ *
+ * The other task may change it right after.
+ */
+static inline uint16_t msg_queue_get_length(const struct msg_queue *const queue)
+{
+	return (uint16_t)(MSG_QUEUE_LOAD(queue->head) - MSG_QUEUE_LOAD(queue->tail));
+}
+
+/**
+ * \brief Get the number of free slots of the queue.
+ *
+ * The other task may change it right after.
+ */
+static inline uint16_t msg_queue_get_space(const struct msg_queue *const queue)
+{
+	return queue->count - msg_queue_get_length(queue);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOT_MSG_QUEUE_H_INCLUDED */
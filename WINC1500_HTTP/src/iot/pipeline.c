@@ -0,0 +1,218 @@
+/**
+ * \file
+ *
+ * \brief Streaming pipeline of processing stages.
+ *
+ */
+
+#include <string.h>
+#include "iot/pipeline.h"
+
+static int _pipeline_fan_out(struct pipeline_stage *stage, uint8_t *data, uint32_t length);
+
+/**
+ * \brief Read the clock of the counters.
+ */
+static inline uint32_t _pipeline_clock(struct pipeline_stage *stage)
+{
+	return (stage->pipeline->clock != NULL) ? stage->pipeline->clock() : 0;
+}
+
+/**
+ * \brief Run the process function of a stage, then pass its input on unless it emits.
+ */
+static int _pipeline_call(struct pipeline_stage *stage, uint8_t *data, uint32_t length)
+{
+	uint32_t start = _pipeline_clock(stage);
+	uint32_t child_ticks = stage->child_ticks;
+	int ret;
+
+	ret = stage->process(stage, data, length);
+	stage->ticks += _pipeline_clock(stage) - start - (stage->child_ticks - child_ticks);
+	stage->bytes_in += length;
+	stage->calls++;
+
+	if (ret == 0 && !(stage->flags & PIPELINE_STAGE_EMITS)) {
+		stage->bytes_out += length;
+		ret = _pipeline_fan_out(stage->children, data, length);
+	}
+
+	return ret;
+}
+
+/**
+ * \brief Hand a slice to a stage, in whole blocks if it needs so.
+ */
+static int _pipeline_run(struct pipeline_stage *stage, uint8_t *data, uint32_t length)
+{
+	uint32_t piece;
+	int ret = 0;
+
+	if (stage->block_size <= 1) {
+		return _pipeline_call(stage, data, length);
+	}
+
+	while (length > 0 && ret == 0) {
+		if (stage->buffered == 0 && length >= stage->block_size) {
+			/* Whole blocks straight from the slice. */
+			piece = length - length % stage->block_size;
+			ret = _pipeline_call(stage, data, piece);
+		} else {
+			piece = stage->block_size - stage->buffered;
+			piece = (length < piece) ? length : piece;
+			memcpy(stage->buffer + stage->buffered, data, piece);
+			stage->buffered += piece;
+			if (stage->buffered == stage->block_size) {
+				stage->buffered = 0;
+				ret = _pipeline_call(stage, stage->buffer, stage->block_size);
+			}
+		}
+		data += piece;
+		length -= piece;
+	}
+
+	return ret;
+}
+
+/**
+ * \brief Hand a slice to a list of stages.
+ */
+static int _pipeline_fan_out(struct pipeline_stage *stage, uint8_t *data, uint32_t length)
+{
+	int ret;
+
+	for (; stage != NULL; stage = stage->sibling) {
+		ret = _pipeline_run(stage, data, length);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * \brief End the stream of a list of stages and of their children.
+ */
+static int _pipeline_finish_list(struct pipeline_stage *stage)
+{
+	uint32_t length;
+	int ret;
+
+	for (; stage != NULL; stage = stage->sibling) {
+		if (stage->buffered > 0) {
+			length = stage->buffered;
+			stage->buffered = 0;
+			ret = _pipeline_call(stage, stage->buffer, length);
+			if (ret < 0) {
+				return ret;
+			}
+		}
+		if (stage->finish != NULL) {
+			ret = stage->finish(stage);
+			if (ret < 0) {
+				return ret;
+			}
+		}
+		ret = _pipeline_finish_list(stage->children);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * \brief Clear the state of a list of stages and of their children.
+ */
+static void _pipeline_reset_list(struct pipeline_stage *stage)
+{
+	for (; stage != NULL; stage = stage->sibling) {
+		stage->buffered = 0;
+		stage->bytes_in = 0;
+		stage->bytes_out = 0;
+		stage->calls = 0;
+		stage->ticks = 0;
+		stage->child_ticks = 0;
+		_pipeline_reset_list(stage->children);
+	}
+}
+
+void pipeline_init(struct pipeline *pipeline, pipeline_clock_t clock)
+{
+	pipeline->stages = NULL;
+	pipeline->clock = clock;
+}
+
+void pipeline_stage_init(struct pipeline_stage *stage, const char *name, uint8_t flags,
+		pipeline_process_t process, pipeline_finish_t finish, void *priv_data)
+{
+	memset(stage, 0, sizeof(struct pipeline_stage));
+	stage->name = name;
+	stage->flags = flags;
+	stage->process = process;
+	stage->finish = finish;
+	stage->priv_data = priv_data;
+}
+
+void pipeline_stage_set_block(struct pipeline_stage *stage, uint32_t block_size, uint8_t *buffer)
+{
+	stage->block_size = block_size;
+	stage->buffer = buffer;
+	stage->buffered = 0;
+}
+
+void pipeline_attach(struct pipeline *pipeline, struct pipeline_stage *parent, struct pipeline_stage *stage)
+{
+	struct pipeline_stage **link = (parent != NULL) ? &parent->children : &pipeline->stages;
+
+	stage->pipeline = pipeline;
+	stage->sibling = NULL;
+	if (!(stage->flags & PIPELINE_STAGE_IN_PLACE)) {
+		/* Before the in-place stages, which change the slice. */
+		while (*link != NULL && !((*link)->flags & PIPELINE_STAGE_IN_PLACE)) {
+			link = &(*link)->sibling;
+		}
+		stage->sibling = *link;
+	} else {
+		while (*link != NULL) {
+			link = &(*link)->sibling;
+		}
+	}
+	*link = stage;
+}
+
+int pipeline_push(struct pipeline *pipeline, uint8_t *data, uint32_t length)
+{
+	if (length == 0) {
+		return 0;
+	}
+	return _pipeline_fan_out(pipeline->stages, data, length);
+}
+
+int pipeline_emit(struct pipeline_stage *stage, uint8_t *data, uint32_t length)
+{
+	uint32_t start;
+	int ret;
+
+	if (length == 0) {
+		return 0;
+	}
+	start = _pipeline_clock(stage);
+	stage->bytes_out += length;
+	ret = _pipeline_fan_out(stage->children, data, length);
+	stage->child_ticks += _pipeline_clock(stage) - start;
+
+	return ret;
+}
+
+int pipeline_finish(struct pipeline *pipeline)
+{
+	return _pipeline_finish_list(pipeline->stages);
+}
+
+void pipeline_reset(struct pipeline *pipeline)
+{
+	_pipeline_reset_list(pipeline->stages);
+}
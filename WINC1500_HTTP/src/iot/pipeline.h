@@ -0,0 +1,197 @@
+/**
+ * \file
+ *
+ * \brief Streaming pipeline of processing stages.
+ *
+ * The bytes of a stream are pushed once into the pipeline and handed to a tree
+ * of stages: every stage of a list gets the same slice (fan-out) and passes its
+ * output on to its children (chaining). Slices are not copied, except to gather
+ * the input of a stage that needs whole blocks.
+ *
+ * A stage either observes its input (hash, CRC, storage), transforms it in
+ * place (decryption), or produces a new output with \ref pipeline_emit
+ * (decompression). An in-place stage is run after its siblings so that they
+ * see its input unchanged.
+ *
+ * Each stage counts the bytes and calls it processed and the clock ticks spent
+ * in it, its children excluded, to show the bottleneck of the pipeline.
+ *
+ */
+
+#ifndef IOT_PIPELINE_H_INCLUDED
+#define IOT_PIPELINE_H_INCLUDED
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The stage transforms its input in place and passes it on. */
+#define PIPELINE_STAGE_IN_PLACE         0x01
+/** The stage passes its output on itself with \ref pipeline_emit. */
+#define PIPELINE_STAGE_EMITS            0x02
+
+/* Before declaring for the function types. */
+struct pipeline;
+struct pipeline_stage;
+
+/**
+ * \brief Process a slice of the stream.
+ *
+ * \param[in]  stage           Stage.
+ * \param[in]  data            Slice. Only valid during the call.
+ * \param[in]  length          Length of the slice.
+ *
+ * \return     0 if succeeded, negative to stop the stream.
+ */
+typedef int (*pipeline_process_t)(struct pipeline_stage *stage, uint8_t *data, uint32_t length);
+
+/**
+ * \brief End of the stream. A stage with PIPELINE_STAGE_EMITS may pass its last output on.
+ *
+ * \return     0 if succeeded, negative on error.
+ */
+typedef int (*pipeline_finish_t)(struct pipeline_stage *stage);
+
+/**
+ * \brief Millisecond, cycle or any other monotonic clock for the counters.
+ */
+typedef uint32_t (*pipeline_clock_t)(void);
+
+/**
+ * \brief Structure of a stage.
+ */
+struct pipeline_stage {
+	/** Name of the stage. */
+	const char *name;
+	/** PIPELINE_STAGE_IN_PLACE or PIPELINE_STAGE_EMITS, or zero to observe. */
+	uint8_t flags;
+	/** Process function. */
+	pipeline_process_t process;
+	/** Finish function, or NULL. */
+	pipeline_finish_t finish;
+	/** Private data of the stage functions. */
+	void *priv_data;
+
+	/** Input granularity. The stage only gets whole blocks, but the last one. */
+	uint32_t block_size;
+	/** Buffer of block_size bytes gathering a partial block. */
+	uint8_t *buffer;
+	/** Bytes in the buffer. */
+	uint32_t buffered;
+
+	/** Pipeline of the stage. */
+	struct pipeline *pipeline;
+	/** First stage of the output of this stage. */
+	struct pipeline_stage *children;
+	/** Next stage with the same input. */
+	struct pipeline_stage *sibling;
+
+	/** Bytes received. */
+	uint32_t bytes_in;
+	/** Bytes passed on. */
+	uint32_t bytes_out;
+	/** Number of process calls. */
+	uint32_t calls;
+	/** Clock ticks spent in the stage, its children excluded. */
+	uint32_t ticks;
+	/** Clock ticks spent in the children during the process calls. */
+	uint32_t child_ticks;
+};
+
+/**
+ * \brief Structure of a pipeline.
+ */
+struct pipeline {
+	/** First stage of the input. */
+	struct pipeline_stage *stages;
+	/** Clock of the counters, or NULL. */
+	pipeline_clock_t clock;
+};
+
+/**
+ * \brief Initialize a pipeline.
+ *
+ * \param[in]  pipeline        Pipeline.
+ * \param[in]  clock           Clock of the counters, or NULL to only count bytes and calls.
+ */
+void pipeline_init(struct pipeline *pipeline, pipeline_clock_t clock);
+
+/**
+ * \brief Initialize a stage.
+ *
+ * \param[in]  stage           Stage.
+ * \param[in]  name            Name of the stage.
+ * \param[in]  flags           PIPELINE_STAGE_IN_PLACE, PIPELINE_STAGE_EMITS, or zero.
+ * \param[in]  process         Process function.
+ * \param[in]  finish          Finish function, or NULL.
+ * \param[in]  priv_data       Private data of the stage functions.
+ */
+void pipeline_stage_init(struct pipeline_stage *stage, const char *name, uint8_t flags,
+		pipeline_process_t process, pipeline_finish_t finish, void *priv_data);
+
+/**
+ * \brief Give a stage its input in whole blocks.
+ *
+ * Whole blocks of a slice are handed over without copy, the rest is gathered
+ * in the buffer.
+ *
+ * \param[in]  stage           Stage.
+ * \param[in]  block_size      Size of a block.
+ * \param[in]  buffer          Buffer of block_size bytes.
+ */
+void pipeline_stage_set_block(struct pipeline_stage *stage, uint32_t block_size, uint8_t *buffer);
+
+/**
+ * \brief Add a stage to the pipeline.
+ *
+ * \param[in]  pipeline        Pipeline.
+ * \param[in]  parent          Stage whose output is the input of the stage, NULL for the pipeline input.
+ * \param[in]  stage           Stage.
+ */
+void pipeline_attach(struct pipeline *pipeline, struct pipeline_stage *parent, struct pipeline_stage *stage);
+
+/**
+ * \brief Push a slice of the stream into the pipeline.
+ *
+ * \param[in]  pipeline        Pipeline.
+ * \param[in]  data            Slice. In-place stages modify it.
+ * \param[in]  length          Length of the slice.
+ *
+ * \return     0 if succeeded, otherwise the error of the first stage that failed.
+ */
+int pipeline_push(struct pipeline *pipeline, uint8_t *data, uint32_t length);
+
+/**
+ * \brief Pass output on to the children of a stage.
+ *
+ * \param[in]  stage           Stage, called from its process or finish function.
+ * \param[in]  data            Output.
+ * \param[in]  length          Length of the output.
+ *
+ * \return     0 if succeeded, otherwise the error of the first stage that failed.
+ */
+int pipeline_emit(struct pipeline_stage *stage, uint8_t *data, uint32_t length);
+
+/**
+ * \brief End the stream: process the partial blocks and call the finish functions.
+ *
+ * \param[in]  pipeline        Pipeline.
+ *
+ * \return     0 if succeeded, otherwise the error of the first stage that failed.
+ */
+int pipeline_finish(struct pipeline *pipeline);
+
+/**
+ * \brief Drop the partial blocks and clear the counters for a new stream.
+ *
+ * \param[in]  pipeline        Pipeline.
+ */
+void pipeline_reset(struct pipeline *pipeline);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOT_PIPELINE_H_INCLUDED */
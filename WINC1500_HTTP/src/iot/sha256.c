@@ -0,0 +1,161 @@
+/**
+ * \file
+ *
+ * \brief SHA-256 message digest (FIPS 180-4).
+ *
+ */
+
+#include <string.h>
+#include "iot/sha256.h"
+
+/** Round constants. */
+static const uint32_t sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define SHA256_ROR(x, n)    (((x) >> (n)) | ((x) << (32 - (n))))
+
+/**
+ * \brief Process one message block.
+ *
+ * The message schedule is kept in a rolling window of 16 words to save stack.
+ *
+ * \param[in]  context         SHA-256 context.
+ * \param[in]  block           Message block of SHA256_BLOCK_LENGTH bytes.
+ */
+static void sha256_transform(struct sha256_context *const context, const uint8_t *block)
+{
+	uint32_t w[16];
+	uint32_t a, b, c, d, e, f, g, h, t1, t2, s0, s1;
+	int i;
+
+	for (i = 0; i < 16; i++) {
+		w[i] = (uint32_t)block[i * 4] << 24 | (uint32_t)block[i * 4 + 1] << 16
+				| (uint32_t)block[i * 4 + 2] << 8 | block[i * 4 + 3];
+	}
+
+	a = context->state[0];
+	b = context->state[1];
+	c = context->state[2];
+	d = context->state[3];
+	e = context->state[4];
+	f = context->state[5];
+	g = context->state[6];
+	h = context->state[7];
+
+	for (i = 0; i < 64; i++) {
+		if (i >= 16) {
+			s0 = w[(i + 1) & 15];
+			s0 = SHA256_ROR(s0, 7) ^ SHA256_ROR(s0, 18) ^ (s0 >> 3);
+			s1 = w[(i + 14) & 15];
+			s1 = SHA256_ROR(s1, 17) ^ SHA256_ROR(s1, 19) ^ (s1 >> 10);
+			w[i & 15] += s0 + s1 + w[(i + 9) & 15];
+		}
+		t1 = h + (SHA256_ROR(e, 6) ^ SHA256_ROR(e, 11) ^ SHA256_ROR(e, 25))
+				+ ((e & f) ^ (~e & g)) + sha256_k[i] + w[i & 15];
+		t2 = (SHA256_ROR(a, 2) ^ SHA256_ROR(a, 13) ^ SHA256_ROR(a, 22))
+				+ ((a & b) ^ (a & c) ^ (b & c));
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+
+	context->state[0] += a;
+	context->state[1] += b;
+	context->state[2] += c;
+	context->state[3] += d;
+	context->state[4] += e;
+	context->state[5] += f;
+	context->state[6] += g;
+	context->state[7] += h;
+}
+
+void sha256_init(struct sha256_context *const context)
+{
+	context->state[0] = 0x6a09e667;
+	context->state[1] = 0xbb67ae85;
+	context->state[2] = 0x3c6ef372;
+	context->state[3] = 0xa54ff53a;
+	context->state[4] = 0x510e527f;
+	context->state[5] = 0x9b05688c;
+	context->state[6] = 0x1f83d9ab;
+	context->state[7] = 0x5be0cd19;
+	context->length = 0;
+}
+
+void sha256_update(struct sha256_context *const context, const void *data, uint32_t length)
+{
+	const uint8_t *ptr = (const uint8_t *)data;
+	uint32_t used = context->length % SHA256_BLOCK_LENGTH;
+	uint32_t size;
+
+	context->length += length;
+
+	if (used > 0) {
+		size = SHA256_BLOCK_LENGTH - used;
+		if (size > length) {
+			size = length;
+		}
+		memcpy(context->buffer + used, ptr, size);
+		ptr += size;
+		length -= size;
+		if (used + size < SHA256_BLOCK_LENGTH) {
+			return;
+		}
+		sha256_transform(context, context->buffer);
+	}
+
+	/* Whole blocks are hashed in place. */
+	for (; length >= SHA256_BLOCK_LENGTH; length -= SHA256_BLOCK_LENGTH) {
+		sha256_transform(context, ptr);
+		ptr += SHA256_BLOCK_LENGTH;
+	}
+
+	memcpy(context->buffer, ptr, length);
+}
+
+void sha256_final(struct sha256_context *const context, uint8_t *digest)
+{
+	uint32_t used = context->length % SHA256_BLOCK_LENGTH;
+	uint32_t bits_high = context->length >> 29;
+	uint32_t bits_low = context->length << 3;
+	int i;
+
+	context->buffer[used++] = 0x80;
+	if (used > SHA256_BLOCK_LENGTH - 8) {
+		memset(context->buffer + used, 0, SHA256_BLOCK_LENGTH - used);
+		sha256_transform(context, context->buffer);
+		used = 0;
+	}
+	memset(context->buffer + used, 0, SHA256_BLOCK_LENGTH - 8 - used);
+	for (i = 0; i < 4; i++) {
+		context->buffer[SHA256_BLOCK_LENGTH - 8 + i] = (uint8_t)(bits_high >> (24 - i * 8));
+		context->buffer[SHA256_BLOCK_LENGTH - 4 + i] = (uint8_t)(bits_low >> (24 - i * 8));
+	}
+	sha256_transform(context, context->buffer);
+
+	for (i = 0; i < 32; i++) {
+		digest[i] = (uint8_t)(context->state[i >> 2] >> (24 - (i & 3) * 8));
+	}
+}
+
+void sha256(const void *data, uint32_t length, uint8_t *digest)
+{
+	struct sha256_context context;
+
+	sha256_init(&context);
+	sha256_update(&context, data, length);
+	sha256_final(&context, digest);
+}
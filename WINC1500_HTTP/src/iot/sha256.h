@@ -0,0 +1,74 @@
+/**
+ * \file
+ *
+ * \brief SHA-256 message digest (FIPS 180-4).
+ *
+ * Software implementation for the data streamed through the application,
+ * computed piece by piece as it is received or read back from the card.
+ *
+ */
+
+#ifndef IOT_SHA256_H_INCLUDED
+#define IOT_SHA256_H_INCLUDED
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Size of a SHA-256 digest in bytes. */
+#define SHA256_DIGEST_LENGTH            32
+/** Size of a SHA-256 message block in bytes. */
+#define SHA256_BLOCK_LENGTH             64
+
+/**
+ * \brief SHA-256 computation context.
+ */
+struct sha256_context {
+	/** Intermediate hash value. */
+	uint32_t state[8];
+	/** Number of bytes hashed so far. */
+	uint32_t length;
+	/** Incomplete message block. */
+	uint8_t buffer[SHA256_BLOCK_LENGTH];
+};
+
+/**
+ * \brief Start a new digest.
+ *
+ * \param[in]  context         SHA-256 context.
+ */
+void sha256_init(struct sha256_context *const context);
+
+/**
+ * \brief Add data to the digest.
+ *
+ * \param[in]  context         SHA-256 context.
+ * \param[in]  data            Data to be hashed.
+ * \param[in]  length          Size of the data.
+ */
+void sha256_update(struct sha256_context *const context, const void *data, uint32_t length);
+
+/**
+ * \brief Complete the digest.
+ *
+ * \param[in]  context         SHA-256 context. It must be initialized again to be reused.
+ * \param[out] digest          Buffer of SHA256_DIGEST_LENGTH bytes receiving the digest.
+ */
+void sha256_final(struct sha256_context *const context, uint8_t *digest);
+
+/**
+ * \brief Compute the digest of a buffer.
+ *
+ * \param[in]  data            Data to be hashed.
+ * \param[in]  length          Size of the data.
+ * \param[out] digest          Buffer of SHA256_DIGEST_LENGTH bytes receiving the digest.
+ */
+void sha256(const void *data, uint32_t length, uint8_t *digest);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOT_SHA256_H_INCLUDED */
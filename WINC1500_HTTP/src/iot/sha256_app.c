@@ -0,0 +1,55 @@
+/**
+ * \file
+ *
+ * \brief Digest of the image of the HTTP File Downloader Example.
+ *
+ */
+
+#include "main.h"
+
+#ifdef MAIN_IMAGE_DIGEST
+
+#include <stdio.h>
+#include "asf.h"
+#include "iot/sha256_app.h"
+
+/** Stage hashing the stored image. */
+struct pipeline_stage digest_stage;
+/** SHA-256 of the stored image. */
+static struct sha256_context image_digest;
+
+/**
+ * \brief Pipeline stage hashing the stored image.
+ */
+static int digest_stage_process(struct pipeline_stage *stage, uint8_t *data, uint32_t length)
+{
+	if (stage->bytes_in == 0) {
+		sha256_init(&image_digest);
+	}
+	sha256_update(&image_digest, data, length);
+	return 0;
+}
+
+/**
+ * \brief Print the SHA-256 of the stored image.
+ */
+static int digest_stage_finish(struct pipeline_stage *stage)
+{
+	uint8_t digest[SHA256_DIGEST_LENGTH];
+
+	UNUSED(stage);
+	sha256_final(&image_digest, digest);
+	printf("digest_stage_finish: SHA-256 ");
+	for (uint8_t i = 0; i < SHA256_DIGEST_LENGTH; i++) {
+		printf("%02x", digest[i]);
+	}
+	printf("\r\n");
+	return 0;
+}
+
+void configure_digest_stage(void)
+{
+	pipeline_stage_init(&digest_stage, "digest", 0, digest_stage_process, digest_stage_finish, NULL);
+}
+
+#endif /* MAIN_IMAGE_DIGEST */
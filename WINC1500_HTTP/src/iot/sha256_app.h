@@ -0,0 +1,33 @@
+/**
+ * \file
+ *
+ * \brief Digest of the image of the HTTP File Downloader Example.
+ *
+ * With MAIN_IMAGE_DIGEST, a stage of the store pipeline hashes the stored
+ * image and prints its SHA-256 once the download is over.
+ *
+ */
+
+#ifndef IOT_SHA256_APP_H_INCLUDED
+#define IOT_SHA256_APP_H_INCLUDED
+
+#include "iot/sha256.h"
+#include "iot/pipeline.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Stage hashing the stored image. */
+extern struct pipeline_stage digest_stage;
+
+/**
+ * \brief Initialize the stage hashing the stored image, before it is attached.
+ */
+void configure_digest_stage(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOT_SHA256_APP_H_INCLUDED */
@@ -0,0 +1,160 @@
+/**
+ * \file
+ *
+ * \brief Public key pinning of the TLS server on the ECC requests of the WINC.
+ *
+ */
+
+#include <errno.h>
+#include <string.h>
+#include "iot/ssl_pin.h"
+
+/** Status of a verified signature request. */
+#define SSL_PIN_STATUS_OK               0
+/** Status of a rejected signature request. */
+#define SSL_PIN_STATUS_FAIL             1
+/** Largest hash of a signed message, SHA-512. */
+#define SSL_PIN_MAX_HASH_SIZE           64
+
+/** Configuration given to \ref ssl_pin_init. */
+static struct ssl_pin_config ssl_pin_conf;
+/** Statistics of the requests. */
+static struct ssl_pin_stats ssl_pin_stats;
+
+/**
+ * \brief Read the clock of the statistics.
+ */
+static inline uint32_t _ssl_pin_clock(void)
+{
+	return (ssl_pin_conf.clock != NULL) ? ssl_pin_conf.clock() : 0;
+}
+
+/**
+ * \brief Check whether a public key is pinned.
+ */
+static bool _ssl_pin_match(const tstrECPoint *key)
+{
+	struct sha256_context context;
+	uint8_t digest[SHA256_DIGEST_LENGTH];
+	uint8_t i;
+
+	sha256_init(&context);
+	sha256_update(&context, key->X, key->u16Size);
+	sha256_update(&context, key->Y, key->u16Size);
+	sha256_final(&context, digest);
+
+	for (i = 0; i < ssl_pin_conf.nb_pin; i++) {
+		if (memcmp(digest, ssl_pin_conf.pins[i], SHA256_DIGEST_LENGTH) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * \brief Verify the signatures of a request, from the leaf up to the first pinned key.
+ *
+ * \return     Status of the response.
+ */
+static uint16_t _ssl_pin_verify_request(const tstrEccReqInfo *request)
+{
+	uint32_t nb_sig = request->strEcdsaVerifyREQ.u32nSig;
+	uint8_t hash[SSL_PIN_MAX_HASH_SIZE];
+	uint8_t signature[2 * ECC_POINT_MAX_SIZE];
+	tstrECPoint key;
+	uint16_t curve;
+	uint32_t i;
+	bool pinned = false, valid = true;
+
+	for (i = 0; i < nb_sig && valid && !pinned; i++) {
+		if (m2m_ssl_retrieve_cert(&curve, hash, signature, &key) != M2M_SUCCESS) {
+			/* The driver dropped the rest of the request. */
+			return SSL_PIN_STATUS_FAIL;
+		}
+		pinned = (ssl_pin_conf.nb_pin > 0) && _ssl_pin_match(&key);
+		valid = ssl_pin_conf.verify(curve, hash, signature, &key);
+		if (valid) {
+			ssl_pin_stats.nb_verified++;
+		}
+	}
+	if (i < nb_sig) {
+		/* Drop the signatures left. */
+		m2m_ssl_stop_processing_certs();
+		if (valid) {
+			/* The chain is trusted at the pinned key. */
+			ssl_pin_stats.nb_skipped += nb_sig - i;
+		}
+	}
+
+	if (!valid) {
+		return SSL_PIN_STATUS_FAIL;
+	}
+	if (ssl_pin_conf.nb_pin > 0 && !pinned) {
+		/* Valid chain, but not to our server. */
+		return SSL_PIN_STATUS_FAIL;
+	}
+	return SSL_PIN_STATUS_OK;
+}
+
+/**
+ * \brief Callback of the SSL layer of the WINC.
+ */
+static void _ssl_pin_ssl_cb(uint8 u8MsgType, void *pvMsg)
+{
+	tstrEccReqInfo *request = (tstrEccReqInfo *)pvMsg;
+	tstrEccReqInfo response;
+	uint32_t start;
+
+	if (u8MsgType != M2M_SSL_REQ_ECC || request->u16REQ != ECC_REQ_SIGN_VERIFY) {
+		if (ssl_pin_conf.ssl_cb != NULL) {
+			ssl_pin_conf.ssl_cb(u8MsgType, pvMsg);
+		}
+		return;
+	}
+
+	start = _ssl_pin_clock();
+	memset(&response, 0, sizeof(tstrEccReqInfo));
+	response.u16REQ = request->u16REQ;
+	response.u32UserData = request->u32UserData;
+	response.u32SeqNo = request->u32SeqNo;
+	response.u16Status = _ssl_pin_verify_request(request);
+	m2m_ssl_ecc_process_done();
+	m2m_ssl_handshake_rsp(&response, NULL, 0);
+
+	ssl_pin_stats.nb_request++;
+	if (response.u16Status != SSL_PIN_STATUS_OK) {
+		ssl_pin_stats.nb_rejected++;
+	}
+	ssl_pin_stats.ticks += _ssl_pin_clock() - start;
+}
+
+void ssl_pin_get_config_defaults(struct ssl_pin_config *const config)
+{
+	config->pins = NULL;
+	config->nb_pin = 0;
+	config->verify = NULL;
+	config->ssl_cb = NULL;
+	config->clock = NULL;
+}
+
+int ssl_pin_init(const struct ssl_pin_config *config)
+{
+	if (config == NULL || config->verify == NULL || (config->nb_pin > 0 && config->pins == NULL)) {
+		return -EINVAL;
+	}
+
+	memcpy(&ssl_pin_conf, config, sizeof(struct ssl_pin_config));
+	ssl_pin_clear_stats();
+
+	return (m2m_ssl_init(_ssl_pin_ssl_cb) == M2M_SUCCESS) ? 0 : -EIO;
+}
+
+const struct ssl_pin_stats *ssl_pin_get_stats(void)
+{
+	return &ssl_pin_stats;
+}
+
+void ssl_pin_clear_stats(void)
+{
+	memset(&ssl_pin_stats, 0, sizeof(struct ssl_pin_stats));
+}
@@ -0,0 +1,134 @@
+/**
+ * \file
+ *
+ * \brief Public key pinning of the TLS server on the ECC requests of the WINC.
+ *
+ * With the ECC cipher suites, the WINC asks the host to verify the signatures
+ * of the server handshake, from the leaf certificate up to the root. Each
+ * signature comes with the public key that made it. When the key is pinned,
+ * its signature is verified and the signatures above it are not: the chain
+ * is trusted at the pinned key instead of at a root, which saves the most
+ * expensive part of the handshake on the host. A chain without a pinned key is
+ * rejected. Without pins, every signature is verified.
+ *
+ * A pin is the SHA-256 of the public key as an uncompressed point without the
+ * leading 0x04 byte (X || Y), e.g. for P-256:
+ * openssl x509 -in cert.pem -pubkey -noout | openssl ec -pubin -outform DER | tail -c 64 | sha256sum
+ *
+ * The ECC cipher suites need an ECC engine on the host, such as an ATECC508,
+ * for the signatures and the ECDH requests.
+ *
+ */
+
+#ifndef IOT_SSL_PIN_H_INCLUDED
+#define IOT_SSL_PIN_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "driver/include/m2m_ssl.h"
+#include "iot/sha256.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Verify an ECDSA signature.
+ *
+ * \param[in]  curve           Named curve of the key, tenuEcNamedCurve.
+ * \param[in]  hash            Hash of the signed message, of the size of the curve.
+ * \param[in]  signature       Signature, r || s.
+ * \param[in]  key             Public key.
+ *
+ * \return     true if the signature is valid.
+ */
+typedef bool (*ssl_pin_verify_t)(uint16_t curve, const uint8_t *hash, const uint8_t *signature,
+		const tstrECPoint *key);
+
+/**
+ * \brief Millisecond, cycle or any other monotonic clock for the statistics.
+ */
+typedef uint32_t (*ssl_pin_clock_t)(void);
+
+/**
+ * \brief Configuration of the pinning.
+ */
+struct ssl_pin_config {
+	/**
+	 * Pinned keys of the server.
+	 * Default value is NULL.
+	 */
+	const uint8_t (*pins)[SHA256_DIGEST_LENGTH];
+	/**
+	 * Number of pinned keys. Zero verifies the whole chain.
+	 * Default value is 0.
+	 */
+	uint8_t nb_pin;
+	/**
+	 * Signature check of the ECC engine.
+	 * Default value is NULL.
+	 */
+	ssl_pin_verify_t verify;
+	/**
+	 * Callback of the other SSL messages, such as the ECDH requests.
+	 * Default value is NULL.
+	 */
+	tpfAppSSLCb ssl_cb;
+	/**
+	 * Clock of the statistics.
+	 * Default value is NULL.
+	 */
+	ssl_pin_clock_t clock;
+};
+
+/**
+ * \brief Statistics of the signature requests.
+ */
+struct ssl_pin_stats {
+	/** Signature requests answered. */
+	uint32_t nb_request;
+	/** Requests rejected. */
+	uint32_t nb_rejected;
+	/** Signatures verified. */
+	uint32_t nb_verified;
+	/** Signatures above a pinned key, not verified. */
+	uint32_t nb_skipped;
+	/** Clock ticks spent in the requests. */
+	uint32_t ticks;
+};
+
+/**
+ * \brief Get default configuration of the pinning.
+ *
+ * \param[out] config          Configuration.
+ */
+void ssl_pin_get_config_defaults(struct ssl_pin_config *const config);
+
+/**
+ * \brief Initialize the SSL layer of the WINC with the pinning.
+ *
+ * Replaces m2m_ssl_init(). Call it after m2m_wifi_init().
+ *
+ * \param[in]  config          Configuration. The pins are not copied.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ * \return     -EIO            The WINC driver failed.
+ */
+int ssl_pin_init(const struct ssl_pin_config *config);
+
+/**
+ * \brief Statistics since the initialization or the last call of \ref ssl_pin_clear_stats.
+ */
+const struct ssl_pin_stats *ssl_pin_get_stats(void);
+
+/**
+ * \brief Clear the statistics.
+ */
+void ssl_pin_clear_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOT_SSL_PIN_H_INCLUDED */
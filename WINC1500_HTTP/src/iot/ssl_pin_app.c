@@ -0,0 +1,65 @@
+/**
+ * \file
+ *
+ * \brief Public key pinning of the HTTP File Downloader Example.
+ *
+ */
+
+#include "main.h"
+
+#if defined(MAIN_TLS_PINS) && !defined(MAIN_TLS_ECC_VERIFY)
+#error "MAIN_TLS_PINS needs the ECC engine of MAIN_TLS_ECC_VERIFY."
+#endif
+
+#ifdef MAIN_TLS_ECC_VERIFY
+
+#include <stdio.h>
+#include "asf.h"
+#include "download.h"
+#include "iot/ssl_pin_app.h"
+
+/* Provided by the ECC engine. */
+bool MAIN_TLS_ECC_VERIFY(uint16_t curve, const uint8_t *hash, const uint8_t *signature, const tstrECPoint *key);
+void MAIN_TLS_ECC_HANDLER(uint8 u8MsgType, void *pvMsg);
+#ifdef MAIN_TLS_PINS
+/** Public keys of the update server. */
+static const uint8_t tls_pins[][SHA256_DIGEST_LENGTH] = MAIN_TLS_PINS;
+#endif
+
+void print_ssl_pin_stats(void)
+{
+	const struct ssl_pin_stats *stats = ssl_pin_get_stats();
+
+	printf("print_ssl_pin_stats: %lu signatures verified, %lu skipped, %lu ms, %lu rejected\r\n",
+			(unsigned long)stats->nb_verified, (unsigned long)stats->nb_skipped,
+			(unsigned long)(stats->ticks / (system_cpu_clock_get_hz() / 1000)),
+			(unsigned long)stats->nb_rejected);
+	ssl_pin_clear_stats();
+}
+
+void configure_ssl_pin(void)
+{
+	struct ssl_pin_config pin_conf;
+	int ret;
+
+	ssl_pin_get_config_defaults(&pin_conf);
+#ifdef MAIN_TLS_PINS
+	pin_conf.pins = tls_pins;
+	pin_conf.nb_pin = sizeof(tls_pins) / sizeof(tls_pins[0]);
+#endif
+	pin_conf.verify = MAIN_TLS_ECC_VERIFY;
+	pin_conf.ssl_cb = MAIN_TLS_ECC_HANDLER;
+	pin_conf.clock = get_cycles;
+
+	ret = ssl_pin_init(&pin_conf);
+	if (ret < 0) {
+		printf("configure_ssl_pin: initialization failed! (res %d)\r\n", ret);
+		while (1) {
+		} /* Loop forever. */
+	}
+
+	/* The server signatures are only passed to the host with the ECDSA cipher suites. */
+	m2m_ssl_set_active_ciphersuites(SSL_ECC_ONLY_CIPHERS);
+}
+
+#endif /* MAIN_TLS_ECC_VERIFY */
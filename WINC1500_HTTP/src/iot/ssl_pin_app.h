@@ -0,0 +1,37 @@
+/**
+ * \file
+ *
+ * \brief Public key pinning of the HTTP File Downloader Example.
+ *
+ * With MAIN_TLS_ECC_VERIFY, the host checks the server signatures of the ECC
+ * cipher suites with the ECC engine, trusting the chain at the keys of
+ * MAIN_TLS_PINS if any, see iot/ssl_pin.h.
+ *
+ */
+
+#ifndef IOT_SSL_PIN_APP_H_INCLUDED
+#define IOT_SSL_PIN_APP_H_INCLUDED
+
+#include "iot/ssl_pin.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Check the public key of the server on the host.
+ *
+ * Call once the Wi-Fi driver is initialized.
+ */
+void configure_ssl_pin(void);
+
+/**
+ * \brief Print the cost of the server signatures checked by the host, and clear it.
+ */
+void print_ssl_pin_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOT_SSL_PIN_APP_H_INCLUDED */
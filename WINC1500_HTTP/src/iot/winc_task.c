@@ -0,0 +1,136 @@
+/**
+ * \file
+ *
+ * \brief FreeRTOS network task of the WINC driver.
+ *
+ */
+
+#include "iot/winc_task.h"
+
+#ifdef CONF_WINC_USE_FREERTOS
+
+#include <errno.h>
+#include <string.h>
+#include "semphr.h"
+#include "driver/include/m2m_wifi.h"
+
+/** Configuration given to \ref winc_task_init. */
+static struct winc_task_config winc_task_conf;
+/** Counters of the task. */
+static struct winc_task_stats winc_task_stats;
+/** Semaphore given by the interrupt of the WINC and by \ref winc_task_wake. */
+static SemaphoreHandle_t winc_task_sem = NULL;
+/** Handle of the task. */
+static TaskHandle_t winc_task_handle = NULL;
+
+/**
+ * \brief Interrupt hook of the HIF layer, after the interrupt was counted.
+ */
+void os_hook_isr(void)
+{
+	BaseType_t woken = pdFALSE;
+
+	/* Interrupts before the task is created stay counted by the HIF layer. */
+	if (winc_task_sem == NULL) {
+		return;
+	}
+	winc_task_stats.interrupts++;
+	xSemaphoreGiveFromISR(winc_task_sem, &woken);
+	portYIELD_FROM_ISR(woken);
+}
+
+/**
+ * \brief Millisecond clock of the event budget.
+ */
+static uint32 _winc_task_tick_ms(void)
+{
+	return (uint32)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+}
+
+/**
+ * \brief Entry of the network task.
+ */
+static void _winc_task_entry(void *params)
+{
+	TickType_t start, ticks;
+
+	(void)params;
+	for (;;) {
+		xSemaphoreTake(winc_task_sem, pdMS_TO_TICKS(winc_task_conf.period));
+		winc_task_stats.wakeups++;
+
+		start = xTaskGetTickCount();
+		m2m_wifi_handle_events_budget(winc_task_conf.max_events, winc_task_conf.max_events_ms, _winc_task_tick_ms);
+		ticks = xTaskGetTickCount() - start;
+		if (ticks > winc_task_stats.max_events_ticks) {
+			winc_task_stats.max_events_ticks = ticks;
+		}
+
+		if (winc_task_conf.poll != NULL) {
+			winc_task_conf.poll();
+		}
+		if (m2m_wifi_events_pending()) {
+			/* Events left over by the budget, handled without sleeping. */
+			xSemaphoreGive(winc_task_sem);
+		}
+	}
+}
+
+void winc_task_get_config_defaults(struct winc_task_config *const config)
+{
+	config->stack_depth = 512;
+	config->priority = configMAX_PRIORITIES - 1;
+	config->period = 10;
+	config->max_events = 0;
+	config->max_events_ms = 0;
+	config->poll = NULL;
+}
+
+int winc_task_init(const struct winc_task_config *config)
+{
+	if (config == NULL || config->period == 0) {
+		return -EINVAL;
+	}
+
+	if (winc_task_handle != NULL) {
+		return -EALREADY;
+	}
+
+	memcpy(&winc_task_conf, config, sizeof(struct winc_task_config));
+	memset(&winc_task_stats, 0, sizeof(struct winc_task_stats));
+
+	winc_task_sem = xSemaphoreCreateBinary();
+	if (winc_task_sem == NULL) {
+		return -ENOMEM;
+	}
+	if (xTaskCreate(_winc_task_entry, "winc", config->stack_depth, NULL, config->priority,
+			&winc_task_handle) != pdPASS) {
+		vSemaphoreDelete(winc_task_sem);
+		winc_task_sem = NULL;
+		winc_task_handle = NULL;
+		return -ENOMEM;
+	}
+	/* Handles the interrupts counted before. */
+	xSemaphoreGive(winc_task_sem);
+
+	return 0;
+}
+
+void winc_task_wake(void)
+{
+	if (winc_task_sem != NULL) {
+		xSemaphoreGive(winc_task_sem);
+	}
+}
+
+TaskHandle_t winc_task_get_handle(void)
+{
+	return winc_task_handle;
+}
+
+const struct winc_task_stats *winc_task_get_stats(void)
+{
+	return &winc_task_stats;
+}
+
+#endif /* CONF_WINC_USE_FREERTOS */
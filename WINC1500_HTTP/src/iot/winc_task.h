@@ -0,0 +1,137 @@
+/**
+ * \file
+ *
+ * \brief FreeRTOS network task of the WINC driver.
+ *
+ * The task owns the driver: \ref m2m_wifi_handle_events and every call of the
+ * Wi-Fi and socket APIs must run in it, as the driver is not reentrant. It
+ * sleeps on a semaphore given by the interrupt of the WINC, through the
+ * os_hook_isr hook of the HIF layer, and wakes up at least every period to run
+ * the poll function of the application, e.g. the software timers.
+ *
+ * Other tasks exchange data with the network task through the queues of
+ * iot/msg_queue.h and wake it up with \ref winc_task_wake.
+ *
+ * Built with CONF_WINC_USE_FREERTOS only.
+ *
+ */
+
+#ifndef IOT_WINC_TASK_H_INCLUDED
+#define IOT_WINC_TASK_H_INCLUDED
+
+#include <stdint.h>
+#include "conf_winc.h"
+
+#ifdef CONF_WINC_USE_FREERTOS
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Network task configuration structure
+ *
+ * Configuration struct for the network task. This structure should be
+ * initialized by the \ref winc_task_get_config_defaults function before being
+ * modified by the user application.
+ */
+struct winc_task_config {
+	/**
+	 * Stack of the task.
+	 * Unit is words.
+	 * Default value is 512.
+	 */
+	uint16_t stack_depth;
+	/**
+	 * Priority of the task, above the tasks the WINC must not wait for.
+	 * Default value is configMAX_PRIORITIES - 1.
+	 */
+	UBaseType_t priority;
+	/**
+	 * Longest sleep of the task without interrupt.
+	 * Unit is milliseconds.
+	 * Default value is 10.
+	 */
+	uint32_t period;
+	/**
+	 * Maximum number of events handled per wake-up, the poll function running
+	 * in between while the WINC stays busy. Zero for no limit.
+	 * Default value is 0.
+	 */
+	uint16_t max_events;
+	/**
+	 * Maximum time spent handling the events per wake-up.
+	 * Unit is milliseconds. Zero for no limit.
+	 * Default value is 0.
+	 */
+	uint32_t max_events_ms;
+	/**
+	 * Function run by the task after the events at each wake-up.
+	 * Default value is NULL.
+	 */
+	void (*poll)(void);
+};
+
+/**
+ * \brief Counters of the network task.
+ */
+struct winc_task_stats {
+	/** Wake-ups of the task. */
+	uint32_t wakeups;
+	/** Semaphores given by the interrupt of the WINC. */
+	uint32_t interrupts;
+	/** Longest time spent handling the events of a wake-up, in ticks. */
+	uint32_t max_events_ticks;
+};
+
+/**
+ * \brief Get default configuration of the network task.
+ *
+ * \param[in]  config          Pointer of configuration structure which will be used in the module.
+ */
+void winc_task_get_config_defaults(struct winc_task_config *const config);
+
+/**
+ * \brief Create the network task, before the scheduler is started.
+ *
+ * The driver and the socket layer must be initialized already.
+ *
+ * \param[in]  config          Pointer of configuration structure which will be used in the module.
+ *
+ * \return     0               Function succeeded
+ * \return     -EINVAL         Invalid argument.
+ * \return     -EALREADY       Already created.
+ * \return     -ENOMEM         Task or semaphore allocation failed.
+ */
+int winc_task_init(const struct winc_task_config *config);
+
+/**
+ * \brief Interrupt hook of the HIF layer, waking the network task up.
+ */
+void os_hook_isr(void);
+
+/**
+ * \brief Wake the network task up from another task.
+ */
+void winc_task_wake(void);
+
+/**
+ * \brief Get the handle of the network task, for the task notifications.
+ */
+TaskHandle_t winc_task_get_handle(void);
+
+/**
+ * \brief Get the counters of the network task.
+ */
+const struct winc_task_stats *winc_task_get_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONF_WINC_USE_FREERTOS */
+
+#endif /* IOT_WINC_TASK_H_INCLUDED */
@@ -0,0 +1,234 @@
+/**
+ * \file
+ *
+ * \brief Storage task of the HTTP File Downloader Example.
+ *
+ */
+
+#include "main.h"
+#include "conf_winc.h"
+
+#ifdef CONF_WINC_USE_FREERTOS
+
+#ifndef FREERTOS_USED
+#error "CONF_WINC_USE_FREERTOS needs FREERTOS_USED in the project symbols, for the SD/MMC stack."
+#endif
+#if defined(MAIN_STORAGE_QUEUE_SIZE) || defined(MAIN_HTTP_SYNC_URL) || defined(MAIN_HTTP_MERKLE_URL) || defined(MAIN_DIRECT_SSID)
+#error "CONF_WINC_USE_FREERTOS writes the storage from its own task, which this option would access from the network task."
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include "asf.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "download.h"
+#include "iot/msg_queue.h"
+#include "iot/winc_task.h"
+#include "iot/winc_task_app.h"
+
+#if (configTICK_RATE_HZ != 1000) || !configUSE_TICK_HOOK || !configUSE_RECURSIVE_MUTEXES
+#error "CONF_WINC_USE_FREERTOS needs a 1 ms tick, the tick hook and the recursive mutexes."
+#endif
+#if (MAIN_RTOS_STORAGE_BUFFERS < 4) || (MAIN_RTOS_STORAGE_BUFFERS & (MAIN_RTOS_STORAGE_BUFFERS - 1))
+#error "MAIN_RTOS_STORAGE_BUFFERS must be a power of two, at least 4."
+#endif
+#if (MAIN_BUFFER_MAX_SIZE > 0xFFFF)
+#error "MAIN_BUFFER_MAX_SIZE must fit in the length of a storage message."
+#endif
+
+/** Message of the write queue, a filled buffer of the pool. */
+struct storage_msg {
+	/** Index of the buffer. */
+	uint16_t index;
+	/** Bytes in the buffer. */
+	uint16_t length;
+};
+/** Packets handed from the network task to the storage task. */
+static uint8_t storage_buffers[MAIN_RTOS_STORAGE_BUFFERS][MAIN_BUFFER_MAX_SIZE];
+/** Free buffers, from the storage task to the network task. */
+static struct msg_queue storage_free_queue;
+static uint16_t storage_free_slots[MAIN_RTOS_STORAGE_BUFFERS];
+/** Filled buffers, from the network task to the storage task. */
+static struct msg_queue storage_write_queue;
+static struct storage_msg storage_write_slots[MAIN_RTOS_STORAGE_BUFFERS];
+/** Held by the task accessing the storage and the store pipeline. */
+static SemaphoreHandle_t storage_mutex;
+/** Handle of the storage task. */
+static TaskHandle_t storage_task_handle;
+/** Network task waiting for free buffers, notified by the storage task. NULL if none. */
+static TaskHandle_t storage_waiter = NULL;
+/** Write error of the storage task, the next buffers being dropped. Read with is_storage_failed(). */
+static bool storage_error = false;
+/** The HTTP reception is paused until the storage task catches up. Network task only. */
+static bool storage_recv_paused = false;
+
+/**
+ * \brief Block the network task until count buffers are free.
+ *
+ * \param[in]  count           Free buffers waited for.
+ * \param[in]  timeout         Longest wait in ticks, portMAX_DELAY for none.
+ *
+ * \return     true once the buffers are free, false after the timeout.
+ */
+static bool storage_wait_free(uint16_t count, TickType_t timeout)
+{
+	TickType_t start = xTaskGetTickCount();
+	TickType_t elapsed;
+
+	while (msg_queue_get_length(&storage_free_queue) < count) {
+		__atomic_store_n(&storage_waiter, winc_task_get_handle(), __ATOMIC_SEQ_CST);
+		/* The waiter is seen by the storage task, or the buffer it freed is seen here. */
+		MSG_QUEUE_BARRIER();
+		if (msg_queue_get_length(&storage_free_queue) >= count) {
+			break;
+		}
+		elapsed = xTaskGetTickCount() - start;
+		if (timeout != portMAX_DELAY && elapsed >= timeout) {
+			__atomic_store_n(&storage_waiter, NULL, __ATOMIC_SEQ_CST);
+			return false;
+		}
+		/* A notification left by an earlier wait only loops once more. */
+		ulTaskNotifyTake(pdTRUE, (timeout == portMAX_DELAY) ? portMAX_DELAY : timeout - elapsed);
+	}
+	__atomic_store_n(&storage_waiter, NULL, __ATOMIC_SEQ_CST);
+	return true;
+}
+
+void storage_lock(void)
+{
+	if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) {
+		return;
+	}
+	/* Only the network task queues packets, none can be added meanwhile. */
+	storage_wait_free(MAIN_RTOS_STORAGE_BUFFERS, portMAX_DELAY);
+	xSemaphoreTakeRecursive(storage_mutex, portMAX_DELAY);
+}
+
+void storage_unlock(void)
+{
+	if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) {
+		return;
+	}
+	xSemaphoreGiveRecursive(storage_mutex);
+}
+
+/**
+ * \brief Storage task: run the store pipeline on the packets of the write queue.
+ *
+ * The decryption, the digest and the SD card writes run here while the network
+ * task keeps receiving. The SD card write transfer is completed once no packet
+ * came for MAIN_STORAGE_FLUSH_TIMEOUT_MS.
+ */
+static void storage_task_entry(void *params)
+{
+	struct storage_msg msg;
+	TaskHandle_t waiter;
+
+	(void)params;
+	for (;;) {
+		if (!msg_queue_pop(&storage_write_queue, &msg)) {
+			if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(MAIN_STORAGE_FLUSH_TIMEOUT_MS)) == 0) {
+				xSemaphoreTakeRecursive(storage_mutex, portMAX_DELAY);
+				flush_storage();
+				xSemaphoreGiveRecursive(storage_mutex);
+			}
+			continue;
+		}
+		xSemaphoreTakeRecursive(storage_mutex, portMAX_DELAY);
+		if (!is_storage_failed() && pipeline_push(&store_pipeline, storage_buffers[msg.index], msg.length) < 0) {
+			__atomic_store_n(&storage_error, true, __ATOMIC_RELAXED);
+		}
+		xSemaphoreGiveRecursive(storage_mutex);
+		/* As many slots as buffers, never full. */
+		msg_queue_push(&storage_free_queue, &msg.index);
+		/* The buffer is seen by the network task, or its wait is seen here. */
+		MSG_QUEUE_BARRIER();
+		waiter = __atomic_load_n(&storage_waiter, __ATOMIC_SEQ_CST);
+		if (waiter != NULL) {
+			xTaskNotifyGive(waiter);
+		}
+		if (is_storage_failed() || msg_queue_get_length(&storage_free_queue) == MAIN_RTOS_STORAGE_BUFFERS / 2) {
+			/* Cancels the download or resumes the reception. */
+			winc_task_wake();
+		}
+	}
+}
+
+bool storage_queue_packet(const uint8_t *data, uint32_t length)
+{
+	struct storage_msg msg;
+
+	/* A packet bigger than a buffer takes several. */
+	while (length > 0) {
+		if (is_storage_failed()) {
+			return false;
+		}
+		/* Data received before the pause took effect waits for a free buffer. */
+		if (!storage_wait_free(1, pdMS_TO_TICKS(MAIN_RTOS_STORAGE_WAIT_MS))) {
+			printf("storage_queue_packet: storage task stalled!\r\n");
+			return false;
+		}
+		msg_queue_pop(&storage_free_queue, &msg.index);
+		msg.length = (length > MAIN_BUFFER_MAX_SIZE) ? MAIN_BUFFER_MAX_SIZE : (uint16_t)length;
+		memcpy(storage_buffers[msg.index], data, msg.length);
+		msg_queue_push(&storage_write_queue, &msg);
+		xTaskNotifyGive(storage_task_handle);
+		data += msg.length;
+		length -= msg.length;
+	}
+	if (!storage_recv_paused && msg_queue_get_length(&storage_free_queue) < 2) {
+		storage_recv_paused = true;
+		http_client_pause_recv(&http_client_module_inst);
+	}
+	return true;
+}
+
+void storage_poll(void)
+{
+	if (is_storage_failed() && is_state_set(DOWNLOADING) && !is_state_set(CANCELED) && !is_state_set(COMPLETED)) {
+		printf("storage_poll: file write error, download canceled.\r\n");
+		close_file(false);
+		http_client_close(&http_client_module_inst);
+		add_state(CANCELED);
+		return;
+	}
+	if (storage_recv_paused && msg_queue_get_length(&storage_free_queue) >= MAIN_RTOS_STORAGE_BUFFERS / 2) {
+		storage_recv_paused = false;
+		http_client_resume_recv(&http_client_module_inst);
+	}
+}
+
+void configure_storage_task(void)
+{
+	uint16_t i;
+
+	msg_queue_init(&storage_free_queue, storage_free_slots, sizeof(uint16_t), MAIN_RTOS_STORAGE_BUFFERS);
+	msg_queue_init(&storage_write_queue, storage_write_slots, sizeof(struct storage_msg), MAIN_RTOS_STORAGE_BUFFERS);
+	for (i = 0; i < MAIN_RTOS_STORAGE_BUFFERS; i++) {
+		msg_queue_push(&storage_free_queue, &i);
+	}
+
+	storage_mutex = xSemaphoreCreateRecursiveMutex();
+	if (storage_mutex == NULL ||
+			xTaskCreate(storage_task_entry, "storage", MAIN_RTOS_STORAGE_STACK, NULL,
+				MAIN_RTOS_STORAGE_PRIORITY, &storage_task_handle) != pdPASS) {
+		printf("configure_storage_task: task creation failed!\r\n");
+		while (1) {
+		}
+	}
+}
+
+bool is_storage_failed(void)
+{
+	return __atomic_load_n(&storage_error, __ATOMIC_RELAXED);
+}
+
+void reset_storage_task(void)
+{
+	__atomic_store_n(&storage_error, false, __ATOMIC_RELAXED);
+	storage_recv_paused = false;
+}
+
+#endif /* CONF_WINC_USE_FREERTOS */
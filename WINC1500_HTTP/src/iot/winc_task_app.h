@@ -0,0 +1,77 @@
+/**
+ * \file
+ *
+ * \brief Storage task of the HTTP File Downloader Example.
+ *
+ * With CONF_WINC_USE_FREERTOS, the network task hands the received packets to
+ * a storage task, which runs the store pipeline while the next packets are
+ * received. The HTTP reception is paused while no buffer may be free for the
+ * next packet, and the download is canceled on a write error.
+ *
+ */
+
+#ifndef IOT_WINC_TASK_APP_H_INCLUDED
+#define IOT_WINC_TASK_APP_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Create the queues and the storage task, before the scheduler is started.
+ */
+void configure_storage_task(void);
+
+/**
+ * \brief Take the storage from the storage task once it wrote the queued packets.
+ *
+ * Recursive, so that the file can be closed and opened again in one hold.
+ */
+void storage_lock(void);
+
+/**
+ * \brief Hand the storage back to the storage task.
+ */
+void storage_unlock(void);
+
+/**
+ * \brief Hand a received packet to the storage task. Network task only.
+ *
+ * The reception is paused when the next packet may not find a free buffer, so
+ * that the WINC and the TCP window hold the sender until the storage catches up.
+ * A packet bigger than MAIN_BUFFER_MAX_SIZE takes several buffers.
+ * \param[in] data Data.
+ * \param[in] length Data length.
+ * \return true if succeeded, false after a write error or a stalled storage task.
+ */
+bool storage_queue_packet(const uint8_t *data, uint32_t length);
+
+/**
+ * \brief Follow the storage task from the network task.
+ *
+ * Cancels the download on a write error and resumes the reception once half of
+ * the buffers are free.
+ */
+void storage_poll(void);
+
+/**
+ * \brief The storage task failed to write a packet of the download.
+ * \return true after a write error, false otherwise.
+ */
+bool is_storage_failed(void);
+
+/**
+ * \brief Clear the write error and the paused reception, for a new download.
+ *
+ * Called with the storage held.
+ */
+void reset_storage_task(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOT_WINC_TASK_APP_H_INCLUDED */
@@ -49,12 +49,163 @@ extern "C" {
 /** Content URI for download. */
 #define MAIN_HTTP_FILE_URL                   "http://s3.amazonaws.com/ciqadamars/firmwares/1565028398_Humidor_2_63.img"
 
+/**
+ * WebSocket server pushing update notifications. When it is set, the image is
+ * downloaded again when the server sends MAIN_WS_UPDATE_MESSAGE instead of every
+ * MAIN_POLL_INTERVAL seconds; polling only resumes while the connection is down.
+ */
+//#define MAIN_WS_NOTIFY_URL                   "ws://example.com/firmware/notify"
+/** Message announcing a new image. */
+#define MAIN_WS_UPDATE_MESSAGE               "update"
+/**
+ * Block checksum file of the image (see iot/http/block_sync.h). When it is set and
+ * the image is already on the card, only the blocks that changed are downloaded
+ * and the new image is assembled in MAIN_SYNC_FILE_NAME. FAT storage only.
+ */
+//#define MAIN_HTTP_SYNC_URL                   MAIN_HTTP_FILE_URL ".bsync"
+/** Temporary file of the image assembled by the block synchronization. */
+#define MAIN_SYNC_FILE_NAME                  "sync.tmp"
+/**
+ * Merkle tree file of the image (see iot/http/merkle_download.h). When it is set,
+ * every block is verified once written and a block that fails is fetched again
+ * alone. An interrupted download resumes from the progress saved in
+ * MAIN_MERKLE_STATE_FILE_NAME. FAT storage only.
+ */
+//#define MAIN_HTTP_MERKLE_URL                 MAIN_HTTP_FILE_URL ".mrkl"
+/** Progress of the Merkle download, kept across reboots. */
+#define MAIN_MERKLE_STATE_FILE_NAME          "merkle.dat"
+/**
+ * AES-128 key of the image. When it is set, the image on the server is its
+ * initial counter block followed by the AES-128-CTR ciphertext, as written by
+ * "openssl enc -aes-128-ctr", and it is decrypted as it is received.
+ */
+//#define MAIN_IMAGE_AES_KEY                   {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F}
+/** Keystream blocks computed ahead per main loop iteration while the WINC is idle. */
+#define MAIN_AES_PRECOMPUTE_BLOCKS           (4)
+/** Print the SHA-256 of the stored image, computed in the same pass as the write. */
+//#define MAIN_IMAGE_DIGEST
+/**
+ * Check the signatures of the HTTPS server on the host with this function of
+ * an ECC engine (see ssl_pin_verify_t), the ECDH requests going to the SSL
+ * callback named below. Only the ECDSA cipher suites are then enabled.
+ */
+//#define MAIN_TLS_ECC_VERIFY                  ecc_engine_verify
+//#define MAIN_TLS_ECC_HANDLER                 ecc_engine_ssl_cb
+/**
+ * SHA-256 of the public keys (X || Y) pinned for the HTTPS server. The chain
+ * is trusted at a pinned key instead of being verified up to the root.
+ */
+//#define MAIN_TLS_PINS                        {{0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F}}
+/**
+ * Host name answered with mDNS, without the .local domain. Each download then
+ * comes from the first firmware cache of the local network advertising
+ * MDNS_SERVICE_FWCACHE, otherwise from MAIN_HTTP_FILE_URL, whose host is
+ * resolved with mDNS when it ends with .local.
+ */
+//#define MAIN_MDNS_HOST_NAME                  "winc1500"
+/** Time the firmware caches are looked for before each download (milliseconds). */
+#define MAIN_MDNS_BROWSE_TIMEOUT_MS          (1000)
+/**
+ * Download the image with CoAP block-wise transfers from this URL instead of
+ * HTTP, and print the messages, bytes and time of each transfer to compare
+ * both protocols.
+ */
+//#define MAIN_COAP_FILE_URL                   "coap://192.168.1.10/firmware/image.bin"
+/**
+ * Hand the image to the neighbours over a direct link. Once downloaded, the
+ * image is served over HTTP for MAIN_DIRECT_SERVE_TIME on an access point of
+ * this name. A device failing MAIN_DIRECT_JOIN_AFTER times in a row to connect
+ * to MAIN_WLAN_SSID downloads from the access point of a neighbour instead.
+ * The WINC firmware dropped Wi-Fi Direct (P2P), so the link is a soft AP.
+ */
+//#define MAIN_DIRECT_SSID                     "winc1500-fw"
+/** Passphrase of the direct link, WPA2. */
+#define MAIN_DIRECT_PSK                      "winc1500-fw-link"
+/** Channel of the direct link. */
+#define MAIN_DIRECT_CHANNEL                  M2M_WIFI_CH_6
+/** Address of the device serving the image, also the DHCP server of the link. */
+#define MAIN_DIRECT_ADDR                     {192, 168, 1, 1}
+/** Time the image is served after each download (seconds). */
+#define MAIN_DIRECT_SERVE_TIME               (120)
+/** Failed connections to MAIN_WLAN_SSID before joining a neighbour. */
+#define MAIN_DIRECT_JOIN_AFTER               (3)
+/** Power save mode outside the direct link, which runs without power save. */
+#define MAIN_DIRECT_IDLE_SLEEP_MODE          M2M_NO_PS
+/**
+ * Account the charge of each download and the average current between the
+ * downloads, from the time spent by the WINC and the SD card in each power
+ * state (needs CONF_WINC_ENERGY_STATS and SD_MMC_SPI_ENERGY_STATS).
+ */
+//#define MAIN_ENERGY_STATS
+/** Current of the MCU running and of the board, drawn all the time (uA). */
+#define MAIN_ENERGY_BASE_UA                  (3500)
+/** Current of the WINC awake, mostly receiving (uA). */
+#define MAIN_ENERGY_WINC_AWAKE_UA            (60000)
+/** Average current of the WINC let asleep, its beacon listens included (uA). */
+#define MAIN_ENERGY_WINC_SLEEP_UA            (1500)
+/** Current of the SD card while selected (uA). */
+#define MAIN_ENERGY_SD_ACTIVE_UA             (40000)
+/** Current of the SD card in standby (uA). */
+#define MAIN_ENERGY_SD_IDLE_UA               (250)
+/**
+ * Run the benchmark suite instead of the download: large Content-Length body,
+ * chunked body, keep-alive sequence, resume and slow reader, against a local
+ * origin serving this file. A CSV line per run is printed on the console, to
+ * compare builds, and the suite runs again at each MAIN_POLL_INTERVAL (needs
+ * CONF_WINC_BUS_STATS).
+ */
+//#define MAIN_BENCH_URL                       "http://192.168.1.10/bench/16M.bin"
+/** Same content sent with chunked transfer coding, e.g. by a CGI. Undefined skips the scenario. */
+#define MAIN_BENCH_CHUNKED_URL               "http://192.168.1.10/cgi-bin/chunked?f=16M.bin"
+/** Label of the results, e.g. the build or the link emulated by the origin. */
+#define MAIN_BENCH_TAG                       "default"
+/** Runs of each scenario. */
+#define MAIN_BENCH_RUNS                      (3)
+/** Requests of the keep-alive scenario, on one connection. */
+#define MAIN_BENCH_KEEP_ALIVE_REQUESTS       (4)
+/** Pause of the reception after each packet in the slow reader scenario (ms). */
+#define MAIN_BENCH_SLOW_PAUSE_MS             (20)
+/** Interval of the download retries, or of the polling without notifications (seconds). */
+#define MAIN_POLL_INTERVAL                   (60)
+
 /** Maximum size for packet buffer. */
 #define MAIN_BUFFER_MAX_SIZE                 (1446)
+/** Received content passed to the storage in multiples of this size, a sector (0 for each packet). */
+#define MAIN_HTTP_MIN_DELIVERY               (512)
+/** Stall of the download after which a partial delivery unit is passed anyway. */
+#define MAIN_HTTP_DELIVERY_TIMEOUT_MS        (100)
 /** Maximum file name length. */
 #define MAIN_MAX_FILE_NAME_LENGTH            (250)
 /** Maximum file extension length. */
 #define MAIN_MAX_FILE_EXT_LENGTH             (8)
+/** Store the download in the raw image slot (conf_image_slot.h) instead of a FAT file. */
+//#define MAIN_STORAGE_IMAGE_SLOT
+/** Idle time of the download sink before the SD card write is completed. */
+#define MAIN_STORAGE_FLUSH_TIMEOUT_MS        (200)
+/**
+ * Queue the image in RAM and write it from the main loop, pausing the
+ * reception while the SD card lags behind (bytes, a multiple of
+ * MAIN_STORAGE_WRITE_SIZE holding at least two packets).
+ */
+//#define MAIN_STORAGE_QUEUE_SIZE              (4096)
+/** Bytes of the queue written to the storage per main loop iteration. */
+#define MAIN_STORAGE_WRITE_SIZE              (512)
+/** Packet buffers between the network and the storage tasks, with CONF_WINC_USE_FREERTOS (a power of two, at least 4). */
+#define MAIN_RTOS_STORAGE_BUFFERS            (4)
+/** Longest wait of the network task for a free buffer before the download is canceled (ms). */
+#define MAIN_RTOS_STORAGE_WAIT_MS            (1000)
+/** Stack (words) and priority of the network task, above the storage task. */
+#define MAIN_RTOS_NET_STACK                  (768)
+#define MAIN_RTOS_NET_PRIORITY               (tskIDLE_PRIORITY + 2)
+/** Longest sleep of the network task without WINC interrupt (ms), the software timer resolution. */
+#define MAIN_RTOS_NET_PERIOD_MS              (10)
+/** Stack (words) and priority of the storage task. */
+#define MAIN_RTOS_STORAGE_STACK              (512)
+#define MAIN_RTOS_STORAGE_PRIORITY           (tskIDLE_PRIORITY + 1)
+/** Maximum number of WINC events handled per main loop iteration or network task wake-up (0 for no limit). */
+#define MAIN_WINC_EVENT_BUDGET               (8)
+/** Maximum time spent handling WINC events per main loop iteration or network task wake-up (0 for no limit). */
+#define MAIN_WINC_EVENT_BUDGET_MS            (5)
 /** Output format with '0'. */
 #define MAIN_ZERO_FMT(SZ)                    (SZ == 4) ? "%04d" : (SZ == 3) ? "%03d" : (SZ == 2) ? "%02d" : "%d"
 
@@ -65,7 +216,8 @@ typedef enum {
 	GET_REQUESTED = 0x04, /*!< GET request is sent. */
 	DOWNLOADING = 0x08, /*!< Running to download. */
 	COMPLETED = 0x10, /*!< Download completed. */
-	CANCELED = 0x20 /*!< Download canceled. */
+	CANCELED = 0x20, /*!< Download canceled. */
+	SYNCING = 0x40 /*!< Running the block synchronization. */
 } download_state;
 
 
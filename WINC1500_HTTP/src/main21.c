@@ -115,6 +115,58 @@
 #include "driver/include/m2m_wifi.h"
 #include "socket/include/socket.h"
 #include "iot/http/http_client.h"
+#include "download.h"
+#ifdef MAIN_WS_NOTIFY_URL
+#include "iot/http/websocket_client_app.h"
+#endif
+#include "conf_ramfunc.h"
+#ifdef MAIN_STORAGE_IMAGE_SLOT
+#include "iot/image_slot.h"
+#endif
+#ifdef MAIN_HTTP_SYNC_URL
+#include "iot/http/block_sync_app.h"
+#endif
+#ifdef MAIN_HTTP_MERKLE_URL
+#include "iot/http/merkle_download_app.h"
+#endif
+#ifdef MAIN_IMAGE_AES_KEY
+#include "iot/aes_ctr_app.h"
+#endif
+#ifdef MAIN_IMAGE_DIGEST
+#include "iot/sha256_app.h"
+#endif
+#ifdef MAIN_TLS_ECC_VERIFY
+#include "iot/ssl_pin_app.h"
+#endif
+#ifdef MAIN_MDNS_HOST_NAME
+#include "iot/mdns_app.h"
+#endif
+#ifdef MAIN_COAP_FILE_URL
+#include "iot/coap/coap_client_app.h"
+#endif
+#ifdef MAIN_DIRECT_SSID
+#include "iot/http/http_server_app.h"
+#endif
+#ifdef MAIN_STORAGE_QUEUE_SIZE
+#include "iot/http/http_client_queue.h"
+#endif
+#include "iot/pipeline.h"
+#ifdef SD_MMC_SPI_BUSY_STATS
+#include "sd_mmc_spi.h"
+#endif
+#include "conf_winc.h"
+#ifdef CONF_WINC_USE_FREERTOS
+#include "FreeRTOS.h"
+#include "task.h"
+#include "iot/winc_task.h"
+#include "iot/winc_task_app.h"
+#endif
+#ifdef MAIN_ENERGY_STATS
+#include "iot/energy_app.h"
+#endif
+#ifdef MAIN_BENCH_URL
+#include "iot/http/http_client_bench.h"
+#endif
 
 #define STRING_EOL                      "\r\n"
 #define STRING_HEADER                   "-- HTTP file downloader example --"STRING_EOL \
@@ -123,13 +175,41 @@
 
 static uint32_t milliSeconds = 0;
 
+#ifdef CONF_RAMFUNC_ENABLE
+/** Bounds of the code run from RAM, from the linker script. */
+extern uint32_t _sramfunc;
+extern uint32_t _eramfunc;
+#endif
+
 
 /** File download processing state. */
 static download_state down_state = NOT_READY;
+/** SD/MMC mount. */
+static FATFS fatfs;
+#ifndef MAIN_STORAGE_IMAGE_SLOT
+/** File pointer for file download. */
+FIL file_object;
+#endif
+/** File name for file download. */
+char save_file_name[MAIN_MAX_FILE_NAME_LENGTH + 1] = "0:";
+#ifdef MAIN_STORAGE_IMAGE_SLOT
+/** Raw image slot receiving the download. */
+static struct image_slot_module image_slot_inst;
+#endif
+/** Idle time before the SD card write transfer is completed. */
+static Timer storage_flush_timer;
+/** Written data is waiting to be completed on the SD card. */
+static bool storage_flush_pending = false;
 /** Http content length. */
-static uint32_t http_file_size = 0;
+uint32_t http_file_size = 0;
 /** Receiving content length. */
-static uint32_t received_file_size = 0;
+uint32_t received_file_size = 0;
+/** Processing of the received content, from the HTTP client to the storage. */
+struct pipeline store_pipeline;
+/** Stage writing the image to the storage. */
+static struct pipeline_stage write_stage;
+/** Start of the connection to the server (CPU cycles). */
+static uint32_t connect_start_cycles = 0;
 
 
 /** UART module for debug. */
@@ -153,7 +233,7 @@ static void init_state(void)
  * \brief Clear state parameter at download processing state.
  * \param[in] mask Check download_state.
  */
-static void clear_state(download_state mask)
+void clear_state(download_state mask)
 {
 	down_state &= ~mask;
 }
@@ -162,7 +242,7 @@ static void clear_state(download_state mask)
  * \brief Add state parameter at download processing state.
  * \param[in] mask Check download_state.
  */
-static void add_state(download_state mask)
+void add_state(download_state mask)
 {
 	down_state |= mask;
 }
@@ -172,17 +252,261 @@ static void add_state(download_state mask)
  * \param[in] mask Check download_state.
  * \return true if this state is set, false otherwise.
  */
-
-static inline bool is_state_set(download_state mask)
+bool is_state_set(download_state mask)
 {
 	return ((down_state & mask) != 0);
 }
 
+/**
+ * \brief Initialize SD/MMC storage.
+ */
+static void init_storage(void)
+{
+	FRESULT res;
+	Ctrl_status status;
+
+	/* Initialize SD/MMC stack. */
+	sd_mmc_init();
+	printf("init_storage: please plug an SD/MMC card in slot...\r\n");
+
+	/* Wait card present and ready. */
+	do {
+		status = sd_mmc_test_unit_ready(0);
+		if (CTRL_FAIL == status) {
+			printf("init_storage: SD Card install failed.\r\n");
+			printf("init_storage: try unplug and re-plug the card.\r\n");
+			while (CTRL_NO_PRESENT != sd_mmc_check(0)) {
+			}
+		}
+	} while (CTRL_GOOD != status);
+
+	/* Keep the card selected, the SD card has its own SPI bus. */
+	if (SD_MMC_OK != sd_mmc_exclusive_open(0)) {
+		printf("init_storage: SD card selection failed!\r\n");
+		return;
+	}
+
+	printf("init_storage: mounting SD card...\r\n");
+	memset(&fatfs, 0, sizeof(FATFS));
+	res = f_mount(LUN_ID_SD_MMC_0_MEM, &fatfs);
+	if (FR_INVALID_DRIVE == res) {
+		printf("init_storage: SD card mount failed! (res %d)\r\n", res);
+		return;
+	}
+
+	printf("init_storage: SD card mount OK.\r\n");
+#ifdef MAIN_STORAGE_IMAGE_SLOT
+	{
+		struct image_slot_config slot_conf;
+		int ret;
+
+		image_slot_get_config_defaults(&slot_conf);
+		ret = image_slot_init(&image_slot_inst, &slot_conf);
+		if (ret < 0) {
+			printf("init_storage: image slot initialization failed! (res %d)\r\n", ret);
+			return;
+		}
+		printf("init_storage: image slot at block %lu, %lu blocks.\r\n",
+				(unsigned long)slot_conf.start_block, (unsigned long)slot_conf.nb_block);
+	}
+#endif
+	add_state(STORAGE_READY);
+}
+
+/**
+ * \brief Create the download file.
+ * \param[in] name File name, with drive prefix.
+ * \return true if the file is created, false otherwise.
+ */
+bool open_file(const char *name)
+{
+#ifdef MAIN_STORAGE_IMAGE_SLOT
+	/* Chunked transfer, the image size is unknown. */
+	uint32_t size = (http_file_size == (uint32_t)-1) ? 0 : http_file_size;
+	int ret;
+
+	printf("store_file_packet: writing image slot [%s]\r\n", name);
+	ret = image_slot_open(&image_slot_inst, size, &name[2]);
+	if (ret < 0) {
+		printf("store_file_packet: image slot error! ret:%d\r\n", ret);
+		return false;
+	}
+#else
+	FRESULT ret;
+
+	printf("store_file_packet: creating file [%s]\r\n", name);
+	ret = f_open(&file_object, name, FA_CREATE_ALWAYS | FA_WRITE);
+	if (ret != FR_OK) {
+		printf("store_file_packet: file creation error! ret:%d\r\n", ret);
+		return false;
+	}
+#endif
+	return true;
+}
+
+/**
+ * \brief Append data to the download file.
+ * \param[in] data Data.
+ * \param[in] length Data length.
+ * \return true if the data is written, false otherwise.
+ */
+bool write_file(const char *data, uint32_t length)
+{
+#ifdef MAIN_STORAGE_IMAGE_SLOT
+	if (image_slot_write(&image_slot_inst, data, length) != 0) {
+		return false;
+	}
+#else
+	UINT wsize = 0;
+
+	if ((f_write(&file_object, (const void *)data, length, &wsize) != FR_OK)
+			|| (wsize != length)) {
+		return false;
+	}
+#endif
+	/* Completed by flush_storage() once the sink is idle. */
+	storage_flush_pending = true;
+	TimerCountdownMS(&storage_flush_timer, MAIN_STORAGE_FLUSH_TIMEOUT_MS);
+	return true;
+}
+
+/**
+ * \brief Close the download file if it is opened.
+ * \param[in] completed true if the whole file is written.
+ */
+void close_file(bool completed)
+{
+#ifdef CONF_WINC_USE_FREERTOS
+	storage_lock();
+#endif
+#ifdef MAIN_STORAGE_QUEUE_SIZE
+	if (!close_storage_queue(completed)) {
+		printf("close_file: file write error!\r\n");
+		completed = false;
+	}
+#endif
+#ifdef MAIN_STORAGE_IMAGE_SLOT
+	if (!completed) {
+		image_slot_abort(&image_slot_inst);
+	} else if (image_slot_close(&image_slot_inst) < 0) {
+		printf("close_file: image slot error!\r\n");
+	}
+#else
+	UNUSED(completed);
+	if (file_object.fs != NULL) {
+		/* Also completes the pending SD card write transfer. */
+		f_close(&file_object);
+	}
+#endif
+	storage_flush_pending = false;
+#ifdef CONF_WINC_USE_FREERTOS
+	storage_unlock();
+#endif
+}
+
+/**
+ * \brief Complete the pending SD card write transfer once the sink is idle.
+ *
+ * Sequential sector writes are kept in one opened write transfer on the card,
+ * which is only completed on the next non-sequential access. Call this
+ * periodically so that a stalled download does not hold the transfer opened.
+ */
+void flush_storage(void)
+{
+	if (storage_flush_pending && TimerIsExpired(&storage_flush_timer)) {
+		storage_flush_pending = false;
+		if (disk_ioctl(LUN_ID_SD_MMC_0_MEM, CTRL_SYNC, NULL) != RES_OK) {
+			printf("flush_storage: SD card write error!\r\n");
+		}
+	}
+}
+
+#ifndef MAIN_STORAGE_IMAGE_SLOT
+/**
+ * \brief Complete the written data of the download file on the card.
+ * \return true if succeeded, false otherwise.
+ */
+bool sync_file(void)
+{
+	storage_flush_pending = false;
+	return (f_sync(&file_object) == FR_OK);
+}
+#endif
+
+#ifdef SD_MMC_SPI_BUSY_STATS
+/**
+ * \brief Print the histogram of the SD card busy durations.
+ */
+void print_busy_stats(void)
+{
+	const uint32_t *stats = sd_mmc_spi_get_busy_stats();
+
+	printf("print_busy_stats: SD card busy polls histogram\r\n");
+	for (uint8_t i = 0; i < SD_MMC_SPI_BUSY_STATS_NB_BIN; i++) {
+		printf("  < %6lu: %lu\r\n", 1ul << i, (unsigned long)stats[i]);
+	}
+}
+#endif
+
+/**
+ * \brief Set the name of the download file from the URL.
+ * \return true if the name is valid, false otherwise.
+ */
+bool set_file_name(void)
+{
+	char *cp = (char *)(MAIN_HTTP_FILE_URL + strlen(MAIN_HTTP_FILE_URL));
+	while (*cp != '/') 
+	{
+		cp--;
+	}
+	if ((strlen(cp) <= 1) || (strlen(cp) > MAIN_MAX_FILE_NAME_LENGTH - 2)) 
+	{
+		return false;
+	}
+	save_file_name[0] = LUN_ID_SD_MMC_0_MEM + '0';
+	save_file_name[1] = ':';
+	strcpy(&save_file_name[2], cp + 1);
+	return true;
+}
+
+/**
+ * \brief CPU cycle clock of the pipeline counters and the connection time, from the SysTick.
+ */
+uint32_t get_cycles(void)
+{
+	/* Updated by the SysTick interrupt. */
+	volatile uint32_t *const ticks = &milliSeconds;
+	uint32_t ms, val;
+
+	do {
+		ms = *ticks;
+		val = SysTick->VAL;
+	} while (ms != *ticks);
+	return ms * (SysTick->LOAD + 1) + (SysTick->LOAD - val);
+}
+
+/**
+ * \brief Send the GET request of the image, timing the connection.
+ * \param[in] url URL of the image.
+ */
+void send_download_request(const char *url)
+{
+	connect_start_cycles = get_cycles();
+	http_client_send_request(&http_client_module_inst, url, HTTP_METHOD_GET, NULL, NULL);
+}
+
 /**
  * \brief Start file download via HTTP connection.
  */
-static void start_download(void)
+void start_download(void)
 {
+	const char *url = MAIN_HTTP_FILE_URL;
+
+	if (!is_state_set(STORAGE_READY)) {
+		printf("start_download: MMC storage not ready.\r\n");
+		return;
+	}
+
 	if (!is_state_set(WIFI_CONNECTED)) {
 		printf("start_download: Wi-Fi is not connected.\r\n");
 		return;
@@ -198,9 +522,131 @@ static void start_download(void)
 		return;
 	}
 
+#ifdef MAIN_BENCH_URL
+	/* Runs the benchmark suite instead. */
+	UNUSED(url);
+	bench_start();
+#else
+#ifdef MAIN_DIRECT_SSID
+	/* Download from the neighbour while joined to its access point. */
+	if (start_direct_download()) {
+		return;
+	}
+#endif
+
+#ifdef MAIN_HTTP_SYNC_URL
+	/* Only fetch the blocks that changed when the previous image is on the card. */
+	if (start_sync()) {
+		return;
+	}
+#endif
+
+#ifdef MAIN_HTTP_MERKLE_URL
+	/* Verify each block, and resume an interrupted download. */
+	if (start_merkle_download()) {
+		return;
+	}
+#endif
+
+#ifdef MAIN_COAP_FILE_URL
+	/* The image comes block by block. */
+	start_coap_download();
+	return;
+#endif
+
+#ifdef MAIN_MDNS_HOST_NAME
+	/* Prefer a copy of the image on the local network. */
+	url = get_mdns_download_url();
+	if (url == NULL) {
+		return;
+	}
+#endif
+
 	/* Send the HTTP request. */
-	printf("start_download: sending HTTP request...\r\n");
-	http_client_send_request(&http_client_module_inst, MAIN_HTTP_FILE_URL, HTTP_METHOD_GET, NULL, NULL);
+	printf("start_download: sending HTTP request to %s...\r\n", url);
+	send_download_request(url);
+#endif
+}
+
+/**
+ * \brief Pipeline stage writing the image to the storage.
+ */
+static int write_stage_process(struct pipeline_stage *stage, uint8_t *data, uint32_t length)
+{
+	UNUSED(stage);
+#ifdef MAIN_STORAGE_QUEUE_SIZE
+	if (!queue_storage(data, length)) {
+		return -EIO;
+	}
+#else
+	if (!write_file((const char *)data, length)) {
+		return -EIO;
+	}
+#endif
+	return 0;
+}
+
+/**
+ * \brief Build the pipeline from the HTTP client to the storage.
+ */
+static void configure_store_pipeline(void)
+{
+	struct pipeline_stage *image_source = NULL;
+
+	pipeline_init(&store_pipeline, get_cycles);
+#ifdef MAIN_IMAGE_AES_KEY
+	configure_decrypt_stage();
+	pipeline_attach(&store_pipeline, NULL, &decrypt_stage);
+	image_source = &decrypt_stage;
+#endif
+	pipeline_stage_init(&write_stage, "write", 0, write_stage_process, NULL, NULL);
+	pipeline_attach(&store_pipeline, image_source, &write_stage);
+#ifdef MAIN_IMAGE_DIGEST
+	configure_digest_stage();
+	pipeline_attach(&store_pipeline, image_source, &digest_stage);
+#endif
+}
+
+/**
+ * \brief Print the counters of a pipeline stage.
+ */
+static void print_stage_stats(const struct pipeline_stage *stage)
+{
+	printf("  %-8s %7lu bytes %5lu calls %9lu cycles", stage->name, (unsigned long)stage->bytes_in,
+			(unsigned long)stage->calls, (unsigned long)stage->ticks);
+	if (stage->bytes_in > 0) {
+		printf(" (%lu/byte)", (unsigned long)(stage->ticks / stage->bytes_in));
+	}
+	printf("\r\n");
+}
+
+/**
+ * \brief Complete the processing of the received content and print where the time went.
+ * \return true if succeeded, false otherwise.
+ */
+bool finish_store_pipeline(void)
+{
+	int ret;
+
+#ifdef CONF_WINC_USE_FREERTOS
+	storage_lock();
+	ret = is_storage_failed() ? -EIO : pipeline_finish(&store_pipeline);
+	storage_unlock();
+#else
+	ret = pipeline_finish(&store_pipeline);
+#endif
+	if (ret < 0) {
+		printf("finish_store_pipeline: error %d\r\n", ret);
+	}
+	printf("finish_store_pipeline: stages\r\n");
+#ifdef MAIN_IMAGE_AES_KEY
+	print_stage_stats(&decrypt_stage);
+#endif
+	print_stage_stats(&write_stage);
+#ifdef MAIN_IMAGE_DIGEST
+	print_stage_stats(&digest_stage);
+#endif
+	return (ret == 0);
 }
 
 /**
@@ -208,7 +654,7 @@ static void start_download(void)
  * \param[in] data Packet data.
  * \param[in] length Packet data length.
  */
-static void store_file_packet(char *data, uint32_t length)
+void store_file_packet(char *data, uint32_t length)
 {
 	if ((data == NULL) || (length < 1)) 
 	{
@@ -218,12 +664,54 @@ static void store_file_packet(char *data, uint32_t length)
 
 	if (!is_state_set(DOWNLOADING)) 
 	{
+		if (!set_file_name()) 
+		{
+			printf("store_file_packet: file name is invalid. Download canceled.\r\n");
+			add_state(CANCELED);
+			return;
+		}
+
+#ifdef CONF_WINC_USE_FREERTOS
+		storage_lock();
+#endif
+		/* A retried download starts over. */
+		close_file(false);
+		if (!open_file(save_file_name)) 
+		{
+#ifdef CONF_WINC_USE_FREERTOS
+			storage_unlock();
+#endif
+			add_state(CANCELED);
+			return;
+		}
+
 		received_file_size = 0;
+		pipeline_reset(&store_pipeline);
+#ifdef CONF_WINC_USE_FREERTOS
+		reset_storage_task();
+		storage_unlock();
+#endif
 		add_state(DOWNLOADING);
+#ifdef SD_MMC_SPI_BUSY_STATS
+		sd_mmc_spi_clear_busy_stats();
+#endif
 	}
 
 	if (data != NULL) 
 	{
+#ifdef CONF_WINC_USE_FREERTOS
+		/* Written by the storage task while the next packets are received. */
+		if (!storage_queue_packet((const uint8_t *)data, length)) 
+#else
+		if (pipeline_push(&store_pipeline, (uint8_t *)data, length) < 0) 
+#endif
+		{
+			close_file(false);
+			add_state(CANCELED);
+			printf("store_file_packet: file write error, download canceled.\r\n");
+			return;
+		}
+
 		received_file_size += length;
 		printf("Packet size: %4lu,  Total:  %5lu/%5lu\r\n",
 				(unsigned long) length, 
@@ -232,7 +720,22 @@ static void store_file_packet(char *data, uint32_t length)
 		
 		if (received_file_size >= http_file_size) 
 		{
+#ifdef CONF_WINC_USE_FREERTOS
+			if (!finish_store_pipeline() && is_storage_failed()) 
+			{
+				close_file(false);
+				add_state(CANCELED);
+				printf("store_file_packet: file write error, download canceled.\r\n");
+				return;
+			}
+#else
+			finish_store_pipeline();
+#endif
+			close_file(true);
 			printf("store_file_packet: file downloaded successfully.\r\n");
+#ifdef SD_MMC_SPI_BUSY_STATS
+			print_busy_stats();
+#endif
 			add_state(COMPLETED);
 			return;
 		}
@@ -248,11 +751,22 @@ static void store_file_packet(char *data, uint32_t length)
  */
 static void http_client_callback(struct http_client_module *module_inst, int type, union http_client_data *data)
 {
+#ifdef MAIN_BENCH_URL
+	if (is_bench_running()) {
+		bench_http_callback(module_inst, type, data);
+		return;
+	}
+#endif
 	switch (type) 
 	{
 		case HTTP_CLIENT_CALLBACK_SOCK_CONNECTED:
 		{
-			printf("http_client_callback: HTTP client socket connected.\r\n");
+			/* Includes the TLS handshake on HTTPS. */
+			printf("http_client_callback: HTTP client socket connected in %lu ms.\r\n",
+					(unsigned long)((get_cycles() - connect_start_cycles) / (system_cpu_clock_get_hz() / 1000)));
+#ifdef MAIN_TLS_ECC_VERIFY
+			print_ssl_pin_stats();
+#endif
 		}
 		break;
 
@@ -295,6 +809,11 @@ static void http_client_callback(struct http_client_module *module_inst, int typ
 			if (data->recv_chunked_data.is_complete) 
 			{
 				printf("Download Completed (HTTP_CLIENT_CALLBACK_RECV_CHUNKED_DATA): Closing connection\r\n");
+				if (is_state_set(DOWNLOADING)) 
+				{
+					finish_store_pipeline();
+				}
+				close_file(true);
 				http_client_close(module_inst);
 				add_state(COMPLETED);
 			}
@@ -314,6 +833,7 @@ static void http_client_callback(struct http_client_module *module_inst, int typ
 				/* Server has not responded. Retry immediately. */
 				if (is_state_set(DOWNLOADING)) 
 				{
+					close_file(false);
 					clear_state(DOWNLOADING);
 				}
 
@@ -352,6 +872,18 @@ static void http_client_callback(struct http_client_module *module_inst, int typ
 static void socket_cb(SOCKET sock, uint8_t u8Msg, void *pvMsg)
 {
 	http_client_socket_event_handler(sock, u8Msg, pvMsg);
+#ifdef MAIN_MDNS_HOST_NAME
+	mdns_socket_event_handler(sock, u8Msg, pvMsg);
+#endif
+#ifdef MAIN_COAP_FILE_URL
+	coap_client_socket_event_handler(sock, u8Msg, pvMsg);
+#endif
+#ifdef MAIN_DIRECT_SSID
+	http_server_socket_event_handler(sock, u8Msg, pvMsg);
+#endif
+#ifdef MAIN_WS_NOTIFY_URL
+	websocket_client_socket_event_handler(sock, u8Msg, pvMsg);
+#endif
 }
 
 /**
@@ -364,7 +896,12 @@ static void resolve_cb(uint8_t *pu8DomainName, uint32_t u32ServerIP)
 	printf("resolve_cb: %s IP address is %d.%d.%d.%d\r\n\r\n", pu8DomainName,
 			(int)IPV4_BYTE(u32ServerIP, 0), (int)IPV4_BYTE(u32ServerIP, 1),
 			(int)IPV4_BYTE(u32ServerIP, 2), (int)IPV4_BYTE(u32ServerIP, 3));
+	/* The connection time does not include the DNS resolution. */
+	connect_start_cycles = get_cycles();
 	http_client_socket_resolve_handler(pu8DomainName, u32ServerIP);
+#ifdef MAIN_COAP_FILE_URL
+	coap_client_socket_resolve_handler(pu8DomainName, u32ServerIP);
+#endif
 }
 
 /**
@@ -398,6 +935,17 @@ static void wifi_cb(uint8_t u8MsgType, void *pvMsg)
 	case M2M_WIFI_RESP_CON_STATE_CHANGED:
 	{
 		tstrM2mWifiStateChanged *pstrWifiState = (tstrM2mWifiStateChanged *)pvMsg;
+#ifdef MAIN_DIRECT_SSID
+		bool was_connected = is_state_set(WIFI_CONNECTED);
+
+		if (is_direct_ap_open()) 
+		{
+			/* A neighbour joined or left the access point. */
+			printf("wifi_cb: neighbour %s\r\n",
+					(pstrWifiState->u8CurrState == M2M_WIFI_CONNECTED) ? "connected" : "disconnected");
+			break;
+		}
+#endif
 		if (pstrWifiState->u8CurrState == M2M_WIFI_CONNECTED) 
 		{
 			printf("wifi_cb: M2M_WIFI_CONNECTED\r\n");
@@ -407,8 +955,18 @@ static void wifi_cb(uint8_t u8MsgType, void *pvMsg)
 		{
 			printf("wifi_cb: M2M_WIFI_DISCONNECTED\r\n");
 			clear_state(WIFI_CONNECTED);
+#ifdef MAIN_HTTP_SYNC_URL
+			block_sync_abort(&block_sync_inst);
+#endif
+#ifdef MAIN_HTTP_MERKLE_URL
+			merkle_download_abort(&merkle_download_inst);
+#endif
+#ifdef MAIN_MDNS_HOST_NAME
+			stop_mdns();
+#endif
 			if (is_state_set(DOWNLOADING)) 
 			{
+				close_file(false);
 				clear_state(DOWNLOADING);
 			}
 
@@ -417,6 +975,12 @@ static void wifi_cb(uint8_t u8MsgType, void *pvMsg)
 				clear_state(GET_REQUESTED);
 			}
 
+#ifdef MAIN_DIRECT_SSID
+			if (start_direct_link(was_connected)) 
+			{
+				break;
+			}
+#endif
 			m2m_wifi_connect(
 					(char *)MAIN_WLAN_SSID, 
 					sizeof(MAIN_WLAN_SSID),
@@ -430,10 +994,23 @@ static void wifi_cb(uint8_t u8MsgType, void *pvMsg)
 	case M2M_WIFI_REQ_DHCP_CONF:
 	{
 		uint8_t *pu8IPAddress = (uint8_t *)pvMsg;
+#ifdef MAIN_DIRECT_SSID
+		if (is_direct_ap_open()) {
+			printf("wifi_cb: neighbour IP address is %u.%u.%u.%u\r\n",
+					pu8IPAddress[0], pu8IPAddress[1], pu8IPAddress[2], pu8IPAddress[3]);
+			break;
+		}
+#endif
 		printf("wifi_cb: IP address is %u.%u.%u.%u\r\n",
 				pu8IPAddress[0], pu8IPAddress[1], pu8IPAddress[2], pu8IPAddress[3]);
 		add_state(WIFI_CONNECTED);
+#ifdef MAIN_MDNS_HOST_NAME
+		start_mdns(pu8IPAddress);
+#endif
 		start_download();
+#ifdef MAIN_WS_NOTIFY_URL
+		connect_ws_client();
+#endif
 		break;
 	}
 
@@ -486,6 +1063,13 @@ static void configure_http_client(void)
 
 	httpc_conf.recv_buffer_size = MAIN_BUFFER_MAX_SIZE;
 	httpc_conf.timer_inst = &swt_module_inst;
+	if (strncmp(MAIN_HTTP_FILE_URL, "https://", 8) == 0) {
+		httpc_conf.tls = 1;
+		httpc_conf.port = 443;
+	}
+	/* Whole sectors go straight from the receive buffer to the SD card. */
+	httpc_conf.recv_min_delivery = MAIN_HTTP_MIN_DELIVERY;
+	httpc_conf.recv_delivery_timeout = MAIN_HTTP_DELIVERY_TIMEOUT_MS;
 
 	ret = http_client_init(&http_client_module_inst, &httpc_conf);
 	if (ret < 0) {
@@ -497,6 +1081,115 @@ static void configure_http_client(void)
 	http_client_register_callback(&http_client_module_inst, http_client_callback);
 }
 
+/**
+ * \brief Download the image again once the previous download is over.
+ */
+void restart_download(void)
+{
+	if ((is_state_set(COMPLETED) || is_state_set(CANCELED))) {
+#ifdef MAIN_MDNS_HOST_NAME
+		end_mdns_download(is_state_set(COMPLETED));
+#endif
+		close_file(false);
+		down_state &= STORAGE_READY;
+		add_state(WIFI_CONNECTED);
+		start_download();
+	}
+}
+
+/** Interval of the download retries. */
+static Timer poll_timer;
+/** Blink of the LED. */
+static Timer oneSecondTimer;
+
+/**
+ * \brief Run the application once the pending events of the WINC are handled.
+ *
+ * Called by the main loop, or by the network task with CONF_WINC_USE_FREERTOS.
+ */
+static void main_poll(void)
+{
+	/* Checks the timer timeout. */
+	sw_timer_task(&swt_module_inst);
+#ifdef CONF_WINC_USE_FREERTOS
+	/* Cancels on a write error and resumes the reception once the storage task caught up. */
+	storage_poll();
+#else
+	/* Completes the SD card write transfer when the download stalls. */
+	flush_storage();
+#endif
+#ifdef MAIN_ENERGY_STATS
+	/* Reports the charge of the downloads and of the idle time. */
+	energy_poll();
+#endif
+#ifdef MAIN_BENCH_URL
+	/* Sends the requests of the benchmark suite. */
+	bench_poll();
+#endif
+#ifdef MAIN_STORAGE_QUEUE_SIZE
+	/* Writes the queued image, the reception being paused while the queue is full. */
+	storage_task();
+#endif
+#ifdef MAIN_HTTP_SYNC_URL
+	/* Searches the previous image and requests the missing blocks. */
+	block_sync_task(&block_sync_inst);
+#endif
+#if defined(MAIN_IMAGE_AES_KEY) && !defined(CONF_WINC_USE_FREERTOS)
+	/* Computes the keystream of the next packets while the WINC is idle. */
+	if (is_state_set(DOWNLOADING) && (received_file_size >= AES_BLOCK_SIZE) && !m2m_wifi_events_pending()) {
+		precompute_decrypt_stage();
+	}
+#endif
+#ifdef MAIN_HTTP_MERKLE_URL
+	/* Re-hashes the resumed blocks and requests the blocks left. */
+	merkle_download_task(&merkle_download_inst);
+#endif
+#ifdef MAIN_DIRECT_SSID
+	/* Hands the image to the neighbours once downloaded, for a while. */
+	direct_link_task();
+#endif
+		
+	if(TimerIsExpired(&oneSecondTimer))
+	{
+		port_pin_toggle_output_level(LED_0_PIN);
+		TimerCountdown(&oneSecondTimer, 1);
+		printf("    %2u\r", TimerLeftMS(&poll_timer)/1000);
+	}
+	
+	if(TimerIsExpired(&poll_timer))
+	{
+		TimerCountdown(&poll_timer, MAIN_POLL_INTERVAL);
+		printf("\r\nTimer Expired\r\n");
+#ifdef MAIN_DIRECT_SSID
+		if (is_direct_serving())
+		{
+			/* Downloads again after the serving. */
+			return;
+		}
+#endif
+#ifdef MAIN_WS_NOTIFY_URL
+		if (is_ws_client_connected())
+		{
+			/* The server tells when a new image is available. */
+			return;
+		}
+		if (is_state_set(WIFI_CONNECTED))
+		{
+			connect_ws_client();
+		}
+#endif
+		restart_download();
+	}
+}
+
+/**
+ * \brief Millisecond clock, also bounding the time spent handling WINC events.
+ */
+uint32 get_tick_ms(void)
+{
+	return milliSeconds;
+}
+
 /**
  * \brief Main application function.
  *
@@ -507,6 +1200,9 @@ static void configure_http_client(void)
 int main(void)
 {
 	tstrWifiInitParam param;
+#ifdef CONF_WINC_USE_FREERTOS
+	struct winc_task_config winc_conf;
+#endif
 	int8_t ret;
 	init_state();
 
@@ -517,12 +1213,33 @@ int main(void)
 	configure_console();
 	printf(STRING_HEADER);
 	printf("\r\nThis example requires the AP to have internet access.\r\n\r\n");
+#ifdef CONF_RAMFUNC_ENABLE
+	printf("main: %lu bytes of code run from RAM.\r\n",
+			(unsigned long)((uint32_t)&_eramfunc - (uint32_t)&_sramfunc));
+#endif
 
 	/* Initialize the Timer. */
 	configure_timer();
 
+#ifdef MAIN_ENERGY_STATS
+	/* Initialize the energy meter. */
+	configure_energy();
+#endif
+
+	/* Initialize SD/MMC storage. */
+	init_storage();
+	configure_store_pipeline();
+
 	/* Initialize the HTTP client service. */
 	configure_http_client();
+#ifdef MAIN_HTTP_SYNC_URL
+	/* Initialize the block synchronization. */
+	configure_block_sync();
+#endif
+#ifdef MAIN_HTTP_MERKLE_URL
+	/* Initialize the Merkle download. */
+	configure_merkle_download();
+#endif
 
 	/* Initialize the BSP. */
 	nm_bsp_init();
@@ -539,54 +1256,89 @@ int main(void)
 		}
 	}
 
+#ifdef MAIN_TLS_ECC_VERIFY
+	/* Initialize the SSL layer with the server pinning. */
+	configure_ssl_pin();
+#endif
+
 	/* Initialize socket module. */
 	socketInit();
 	/* Register socket callback function. */
 	registerSocketCallback(socket_cb, resolve_cb);
+#ifdef MAIN_MDNS_HOST_NAME
+	/* Initialize mDNS. */
+	configure_mdns();
+#endif
+#ifdef MAIN_COAP_FILE_URL
+	/* Initialize the CoAP client service. */
+	configure_coap_client();
+#endif
+#ifdef MAIN_DIRECT_SSID
+	/* Initialize the HTTP server of the direct link. */
+	configure_direct();
+#endif
+#ifdef MAIN_WS_NOTIFY_URL
+	/* Initialize the WebSocket client service. */
+	configure_ws_client();
+#endif
 
 	/* Connect to router. */
 	printf("main: connecting to WiFi AP %s...\r\n", (char *)MAIN_WLAN_SSID);
 	m2m_wifi_connect((char *)MAIN_WLAN_SSID, sizeof(MAIN_WLAN_SSID), MAIN_WLAN_AUTH, (char *)MAIN_WLAN_PSK, M2M_WIFI_CH_ALL);
 	
+#ifndef CONF_WINC_USE_FREERTOS
 	if (SysTick_Config(system_cpu_clock_get_hz() / 1000)) 
 	{
 		puts("ERR>> Systick configuration error\r\n");
 		while (1);
 	}
+#endif
+#ifdef MAIN_ENERGY_STATS
+	/* Counts from the clock running. */
+	clear_energy();
+#endif
 	
-	Timer timer;
-	TimerInit(&timer);
-	TimerCountdown(&timer, 40);
+	TimerInit(&poll_timer);
+	TimerCountdown(&poll_timer, 40);
 	
-	Timer oneSecondTimer;
 	TimerInit(&oneSecondTimer);
 	TimerCountdown(&oneSecondTimer, 1);
 	
-	while (true) {
-		/* Handle pending events from network controller. */
-		m2m_wifi_handle_events(NULL);
-		/* Checks the timer timeout. */
-		sw_timer_task(&swt_module_inst);
-			
-		if(TimerIsExpired(&oneSecondTimer))
-		{
-			port_pin_toggle_output_level(LED_0_PIN);
-			TimerCountdown(&oneSecondTimer, 1);
-			printf("    %2u\r", TimerLeftMS(&timer)/1000);
+#ifdef CONF_WINC_USE_FREERTOS
+	/* Hand the storage and the driver to their tasks, the SysTick to the kernel. */
+	configure_storage_task();
+	winc_task_get_config_defaults(&winc_conf);
+	winc_conf.stack_depth = MAIN_RTOS_NET_STACK;
+	winc_conf.priority = MAIN_RTOS_NET_PRIORITY;
+	winc_conf.period = MAIN_RTOS_NET_PERIOD_MS;
+	winc_conf.max_events = MAIN_WINC_EVENT_BUDGET;
+	winc_conf.max_events_ms = MAIN_WINC_EVENT_BUDGET_MS;
+	winc_conf.poll = main_poll;
+	ret = winc_task_init(&winc_conf);
+	if (ret < 0) {
+		printf("main: winc_task_init call error! (res %d)\r\n", ret);
+		while (1) {
 		}
-		
-		if(TimerIsExpired(&timer))
-		{
-			TimerCountdown(&timer, 60);
-			printf("\r\nTimer Expired\r\n");
-			if((is_state_set(COMPLETED) || is_state_set(CANCELED)))
-			{
-				down_state = NOT_READY;
-				add_state(WIFI_CONNECTED);
-				start_download();
-			}
+	}
+	vTaskStartScheduler();
+#else
+	while (true) {
+#ifdef MAIN_BENCH_URL
+		/* Counts the turns of the loop with work, the others being idle. */
+		bool busy = m2m_wifi_events_pending();
+		uint32_t start = get_cycles();
+#endif
+		/* Handle pending events from network controller, leaving the rest of
+		 * the loop a turn when a fast download keeps the WINC busy. */
+		m2m_wifi_handle_events_budget(MAIN_WINC_EVENT_BUDGET, MAIN_WINC_EVENT_BUDGET_MS, get_tick_ms);
+		main_poll();
+#ifdef MAIN_BENCH_URL
+		if (busy) {
+			bench_add_busy_cycles(get_cycles() - start);
 		}
+#endif
 	}
+#endif
 	printf("main: done.\r\n");
 
 	while (1) {
@@ -596,9 +1348,19 @@ int main(void)
 }
 
 
+#ifdef CONF_WINC_USE_FREERTOS
+/**
+ * \brief Tick hook of the kernel, which owns the SysTick interrupt.
+ */
+void vApplicationTickHook(void)
+{
+	milliSeconds++;
+}
+#else
 void SysTick_Handler(void){
 	milliSeconds++;
 }
+#endif
 
 char TimerIsExpired(Timer* timer) {
 	long left = timer->end_time - milliSeconds;
@@ -0,0 +1,36 @@
+/**
+ * \file
+ *
+ * \brief Host stand-in for the FreeRTOS kernel, over POSIX threads.
+ *
+ * Only the calls of the modules built by the tests, with a 1 ms tick. A task
+ * is a thread, a recursive mutex a recursive pthread mutex, and the task
+ * notifications a counter with a condition variable.
+ */
+
+#ifndef INC_FREERTOS_H
+#define INC_FREERTOS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE                         ((BaseType_t)0)
+#define pdTRUE                          ((BaseType_t)1)
+#define pdPASS                          pdTRUE
+#define pdFAIL                          pdFALSE
+#define portMAX_DELAY                   ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS              ((TickType_t)1)
+#define pdMS_TO_TICKS(ms)               ((TickType_t)(ms))
+#define portYIELD_FROM_ISR(woken)       ((void)(woken))
+
+#define configTICK_RATE_HZ              1000
+#define configUSE_TICK_HOOK             1
+#define configUSE_RECURSIVE_MUTEXES     1
+#define configMAX_PRIORITIES            5
+#define tskIDLE_PRIORITY                ((UBaseType_t)0)
+
+#endif /* INC_FREERTOS_H */
@@ -0,0 +1,164 @@
+/**
+ * \file
+ *
+ * \brief Host stand-in for the FreeRTOS kernel, over POSIX threads.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+struct freertos_task {
+	TaskFunction_t code;
+	void *params;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t notified;
+	uint32_t notify_value;
+};
+
+struct freertos_mutex {
+	pthread_mutex_t mutex;
+};
+
+/** Task of the calling thread, the main thread getting one when it asks. */
+static __thread struct freertos_task *current_task;
+
+static struct freertos_task *task_alloc(TaskFunction_t code, void *params)
+{
+	struct freertos_task *task = calloc(1, sizeof(struct freertos_task));
+
+	if (task != NULL) {
+		task->code = code;
+		task->params = params;
+		pthread_mutex_init(&task->lock, NULL);
+		pthread_cond_init(&task->notified, NULL);
+	}
+	return task;
+}
+
+static void *task_entry(void *arg)
+{
+	current_task = arg;
+	current_task->code(current_task->params);
+	return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name, uint16_t stack_depth, void *params,
+		UBaseType_t priority, TaskHandle_t *created)
+{
+	struct freertos_task *task = task_alloc(code, params);
+
+	(void)name;
+	(void)stack_depth;
+	(void)priority;
+	if (task == NULL) {
+		return pdFAIL;
+	}
+	if (created != NULL) {
+		*created = task;
+	}
+	if (pthread_create(&task->thread, NULL, task_entry, task) != 0) {
+		return pdFAIL;
+	}
+	pthread_detach(task->thread);
+	return pdPASS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+	if (current_task == NULL) {
+		current_task = task_alloc(NULL, NULL);
+	}
+	return current_task;
+}
+
+BaseType_t xTaskGetSchedulerState(void)
+{
+	return taskSCHEDULER_RUNNING;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (TickType_t)(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+	struct timespec delay;
+
+	delay.tv_sec = ticks / 1000;
+	delay.tv_nsec = (long)(ticks % 1000) * 1000000;
+	nanosleep(&delay, NULL);
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+	pthread_mutex_lock(&task->lock);
+	task->notify_value++;
+	pthread_cond_signal(&task->notified);
+	pthread_mutex_unlock(&task->lock);
+	return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+	struct freertos_task *task = xTaskGetCurrentTaskHandle();
+	struct timespec deadline;
+	uint32_t value;
+
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += ticks / 1000;
+	deadline.tv_nsec += (long)(ticks % 1000) * 1000000;
+	if (deadline.tv_nsec >= 1000000000) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+	pthread_mutex_lock(&task->lock);
+	while (task->notify_value == 0 && ticks > 0) {
+		if (ticks == portMAX_DELAY) {
+			pthread_cond_wait(&task->notified, &task->lock);
+		} else if (pthread_cond_timedwait(&task->notified, &task->lock, &deadline) == ETIMEDOUT) {
+			break;
+		}
+	}
+	value = task->notify_value;
+	if (value > 0) {
+		task->notify_value = clear ? 0 : value - 1;
+	}
+	pthread_mutex_unlock(&task->lock);
+	return value;
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void)
+{
+	struct freertos_mutex *mutex = malloc(sizeof(struct freertos_mutex));
+	pthread_mutexattr_t attr;
+
+	if (mutex == NULL) {
+		return NULL;
+	}
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&mutex->mutex, &attr);
+	pthread_mutexattr_destroy(&attr);
+	return mutex;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t mutex, TickType_t ticks)
+{
+	(void)ticks;
+	return (pthread_mutex_lock(&mutex->mutex) == 0) ? pdPASS : pdFAIL;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t mutex)
+{
+	return (pthread_mutex_unlock(&mutex->mutex) == 0) ? pdPASS : pdFAIL;
+}
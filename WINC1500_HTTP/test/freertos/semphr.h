@@ -0,0 +1,18 @@
+/**
+ * \file
+ *
+ * \brief Host stand-in for the FreeRTOS semaphores, over POSIX threads.
+ */
+
+#ifndef SEMAPHORE_H
+#define SEMAPHORE_H
+
+#include "task.h"
+
+typedef struct freertos_mutex *SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void);
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t mutex, TickType_t ticks);
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t mutex);
+
+#endif /* SEMAPHORE_H */
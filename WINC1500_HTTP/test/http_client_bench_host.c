@@ -0,0 +1,764 @@
+/**
+ * \file
+ *
+ * \brief Host build of the benchmark suite of the HTTP client.
+ *
+ * The scenarios of iot/http/http_client_bench.c run on the host over the whole
+ * driver stack, http_client_send_request to socket, HIF and SPI, with the SPI
+ * bus and the WINC replaced by winc_spi_model.c. The origin is served by the
+ * model, its body checked byte by byte by the sink, and a lossy link is added.
+ *
+ * Each run appends a line to the results file, with the columns of the target:
+ * - ms and kB/s in the virtual time of the model: the network and the SPI bus
+ *   at CONF_WINC_SPI_CLOCK, the host CPU taking no time;
+ * - cpu_ms_per_MB, the host time in the driver and the client, without the
+ *   model (one thread that never sleeps, so it is CPU time);
+ * - spi_transfers_per_MB and spi_bytes_per_MB, counted as on the target;
+ * - ram_static, the .data and .bss of the stack given by -s, ram_heap, the
+ *   peak of the heap in use, and ram_stack, the peak of the stack of the run.
+ *   The pointers are 64 bits wide, so they are larger than on the SAMD21.
+ *
+ * Usage: http_client_bench_host [-o results.csv] [-t tag] [-s ram_static]
+ */
+
+#include <asf.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "iot/http/http_client.h"
+#include "iot/sw_timer.h"
+#include "socket/include/socket.h"
+#include "driver/include/m2m_wifi.h"
+#include "driver/source/m2m_hif.h"
+#include "driver/source/nmspi.h"
+#include "bus_wrapper/include/nm_bus_wrapper.h"
+#include "winc_spi_model.h"
+#include "main.h"
+
+/* Same client configuration as configure_http_client() of main21.c. */
+#define BENCH_HOST                  "192.168.1.10"
+#define BENCH_URL                   "http://" BENCH_HOST "/bench/1M.bin"
+#define BENCH_CHUNKED_URL           "http://" BENCH_HOST "/cgi-bin/chunked?f=1M.bin"
+#define BENCH_BODY_SIZE             (1024 * 1024)
+#define BENCH_KEEP_ALIVE_SIZE       (256 * 1024)
+/* Chunks larger than the receive buffer, as from a CGI relaying a file. */
+#define BENCH_CHUNK_SIZE            (16 * 1024)
+#define BENCH_RUN_TIMEOUT_MS        (600 * 1000)
+/* Cost of a transfer besides its bytes: chip select and DMA setup. */
+#define BENCH_TRANSFER_NS           2000
+#define BENCH_STACK_SIZE            (1024 * 1024)
+#define BENCH_STACK_PATTERN         0xC5C5C5C5
+
+/** Scenarios of the benchmark suite. */
+typedef enum {
+	/** Content-Length body larger than the receive buffer. */
+	BENCH_LARGE = 0,
+	/** Same body in big chunks. */
+	BENCH_CHUNKED,
+	/** Requests one after the other on one connection. */
+	BENCH_KEEP_ALIVE,
+	/** Second half of the body, from a range request. */
+	BENCH_RESUME,
+	/** Reader pausing the reception after each packet, which closes the TCP window. */
+	BENCH_SLOW,
+	/** Same as the large body, over a link losing segments. */
+	BENCH_LOSSY,
+	BENCH_COUNT
+} bench_scenario_t;
+/** Names of the scenarios in the results. */
+static const char *const bench_names[BENCH_COUNT] = {"large", "chunked", "keep-alive", "resume", "slow", "lossy"};
+
+/** Wi-Fi link to a local origin. */
+static const struct winc_spi_model_link bench_lan = {
+	.bandwidth_kbps = 20000,
+	.latency_us = 1000,
+	.mss = 1460,
+	.window = 4 * 1460,
+	.loss_ppm = 0,
+	.rto_us = 0,
+	.seed = 1,
+};
+/** Same link losing 2% of the segments, each retransmitted after 200 ms. */
+static const struct winc_spi_model_link bench_lossy = {
+	.bandwidth_kbps = 20000,
+	.latency_us = 10000,
+	.mss = 1460,
+	.window = 4 * 1460,
+	.loss_ppm = 20000,
+	.rto_us = 200000,
+	.seed = 1,
+};
+
+static struct http_client_module bench_client;
+static struct sw_timer_module bench_timer;
+static const char *bench_tag = "host";
+static const char *bench_results = "bench_results.csv";
+static unsigned long bench_ram_static;
+static FILE *bench_out;
+
+/** Current scenario and run. */
+static bench_scenario_t bench_scenario;
+static uint8_t bench_run;
+static uint8_t bench_requests;
+static bool bench_pending;
+static bool bench_done;
+static bool bench_ok;
+static uint32_t bench_bytes;
+/** Offset in the body of the next byte expected by the sink. */
+static uint32_t bench_expect;
+static uint32_t bench_entity_length;
+/** End of the pause of the slow reader, 0 if not paused. */
+static uint64_t bench_resume_us;
+
+/*
+ * Origin.
+ */
+
+enum origin_coding {
+	ORIGIN_LENGTH,
+	ORIGIN_CHUNKED,
+};
+
+static char origin_request[1024];
+static uint32_t origin_request_len;
+static char origin_header[256];
+static uint32_t origin_header_len;
+static uint32_t origin_header_pos;
+static enum origin_coding origin_coding;
+static uint32_t origin_body_pos;
+static uint32_t origin_body_end;
+static uint32_t origin_body_size;
+/* Chunk being sent: its size line, data and CRLF. */
+static char origin_chunk_line[16];
+static uint32_t origin_chunk_line_len;
+static uint32_t origin_chunk_line_pos;
+static uint32_t origin_chunk_remain;
+static uint32_t origin_chunk_tail;
+static bool origin_last_chunk;
+static bool origin_busy;
+
+/** Content of the resource served by the origin. */
+static inline uint8_t origin_byte(uint32_t offset)
+{
+	return (uint8_t)(offset * 7 + (offset >> 11));
+}
+
+static void origin_respond(void)
+{
+	uint32_t first = 0;
+	char *range = strstr(origin_request, "Range: bytes=");
+
+	origin_body_size = (bench_scenario == BENCH_KEEP_ALIVE) ? BENCH_KEEP_ALIVE_SIZE : BENCH_BODY_SIZE;
+	origin_coding = (strstr(origin_request, "/cgi-bin/chunked") != NULL) ? ORIGIN_CHUNKED : ORIGIN_LENGTH;
+	if (range != NULL) {
+		first = strtoul(range + strlen("Range: bytes="), NULL, 10);
+	}
+	if (first >= origin_body_size) {
+		first = 0;
+		range = NULL;
+	}
+	origin_body_pos = first;
+	origin_body_end = origin_body_size;
+
+	if (origin_coding == ORIGIN_CHUNKED) {
+		origin_header_len = sprintf(origin_header, "HTTP/1.1 200 OK\r\nConnection: keep-alive\r\n"
+				"Transfer-Encoding: chunked\r\n\r\n");
+		origin_chunk_line_len = 0;
+		origin_chunk_line_pos = 0;
+		origin_chunk_remain = 0;
+		origin_chunk_tail = 0;
+		origin_last_chunk = false;
+	} else if (range != NULL) {
+		origin_header_len = sprintf(origin_header, "HTTP/1.1 206 Partial Content\r\nConnection: keep-alive\r\n"
+				"Content-Range: bytes %lu-%lu/%lu\r\nContent-Length: %lu\r\n\r\n", (unsigned long)first,
+				(unsigned long)(origin_body_size - 1), (unsigned long)origin_body_size,
+				(unsigned long)(origin_body_size - first));
+	} else {
+		origin_header_len = sprintf(origin_header, "HTTP/1.1 200 OK\r\nConnection: keep-alive\r\n"
+				"Content-Length: %lu\r\n\r\n", (unsigned long)origin_body_size);
+	}
+	origin_header_pos = 0;
+	origin_busy = true;
+}
+
+static void origin_connected(void)
+{
+	origin_request_len = 0;
+	origin_busy = false;
+}
+
+static void origin_closed(void)
+{
+	origin_busy = false;
+}
+
+static void origin_received(const uint8_t *data, uint32_t length)
+{
+	char *end;
+
+	if (origin_request_len + length >= sizeof(origin_request)) {
+		fprintf(stderr, "origin: request too long\n");
+		abort();
+	}
+	memcpy(origin_request + origin_request_len, data, length);
+	origin_request_len += length;
+	origin_request[origin_request_len] = '\0';
+	end = strstr(origin_request, "\r\n\r\n");
+	if (end != NULL && !origin_busy) {
+		/* One request at a time, the client waits for the response. */
+		origin_respond();
+		origin_request_len = 0;
+	}
+}
+
+static uint32_t origin_copy_body(uint8_t *data, uint32_t length)
+{
+	uint32_t i;
+
+	for (i = 0; i < length; i++) {
+		data[i] = origin_byte(origin_body_pos++);
+	}
+	return length;
+}
+
+static uint32_t origin_read(uint8_t *data, uint32_t length)
+{
+	uint32_t done = 0;
+
+	while (origin_busy && done < length) {
+		uint32_t n;
+
+		if (origin_header_pos < origin_header_len) {
+			n = origin_header_len - origin_header_pos;
+			n = (n < length - done) ? n : length - done;
+			memcpy(data + done, origin_header + origin_header_pos, n);
+			origin_header_pos += n;
+			done += n;
+			continue;
+		}
+		if (origin_coding == ORIGIN_LENGTH) {
+			n = origin_body_end - origin_body_pos;
+			n = (n < length - done) ? n : length - done;
+			done += origin_copy_body(data + done, n);
+			if (origin_body_pos == origin_body_end) {
+				origin_busy = false;
+			}
+			continue;
+		}
+
+		/* Chunked: size line, data, CRLF, and a last chunk of zero length. */
+		if (origin_chunk_line_pos == origin_chunk_line_len && origin_chunk_remain == 0 && origin_chunk_tail == 0) {
+			if (origin_last_chunk) {
+				origin_busy = false;
+				break;
+			}
+			origin_chunk_remain = origin_body_end - origin_body_pos;
+			if (origin_chunk_remain > BENCH_CHUNK_SIZE) {
+				origin_chunk_remain = BENCH_CHUNK_SIZE;
+			}
+			origin_last_chunk = (origin_chunk_remain == 0);
+			origin_chunk_line_len = sprintf(origin_chunk_line, "%lx\r\n", (unsigned long)origin_chunk_remain);
+			origin_chunk_line_pos = 0;
+			origin_chunk_tail = 2;
+		}
+		if (origin_chunk_line_pos < origin_chunk_line_len) {
+			n = origin_chunk_line_len - origin_chunk_line_pos;
+			n = (n < length - done) ? n : length - done;
+			memcpy(data + done, origin_chunk_line + origin_chunk_line_pos, n);
+			origin_chunk_line_pos += n;
+		} else if (origin_chunk_remain > 0) {
+			n = (origin_chunk_remain < length - done) ? origin_chunk_remain : length - done;
+			origin_copy_body(data + done, n);
+			origin_chunk_remain -= n;
+		} else {
+			n = (origin_chunk_tail < length - done) ? origin_chunk_tail : length - done;
+			memcpy(data + done, "\r\n" + (2 - origin_chunk_tail), n);
+			origin_chunk_tail -= n;
+		}
+		done += n;
+	}
+	return done;
+}
+
+static const struct winc_spi_model_peer bench_origin = {
+	origin_connected,
+	origin_closed,
+	origin_received,
+	origin_read,
+};
+
+/*
+ * Host glue: the timers on the virtual clock, the WINC events and the RAM.
+ */
+
+static uint32_t bench_now_ms(void)
+{
+	return (uint32_t)(winc_spi_model_now_us() / 1000);
+}
+
+int sw_timer_register_callback(struct sw_timer_module *const module_inst,
+		sw_timer_callback_t callback, void *context, uint32_t period)
+{
+	int index;
+
+	for (index = 0; index < CONF_SW_TIMER_COUNT; index++) {
+		struct sw_timer_handle *handler = &module_inst->handler[index];
+		if (handler->used == 0) {
+			handler->callback = callback;
+			handler->callback_enable = 0;
+			handler->context = context;
+			handler->period = period;
+			handler->used = 1;
+			return index;
+		}
+	}
+	return -1;
+}
+
+void sw_timer_enable_callback(struct sw_timer_module *const module_inst, int timer_id, uint32_t delay)
+{
+	module_inst->handler[timer_id].callback_enable = 1;
+	module_inst->handler[timer_id].expire_time = bench_now_ms() + delay;
+}
+
+void sw_timer_disable_callback(struct sw_timer_module *const module_inst, int timer_id)
+{
+	module_inst->handler[timer_id].callback_enable = 0;
+}
+
+void sw_timer_task(struct sw_timer_module *const module_inst)
+{
+	int index;
+
+	for (index = 0; index < CONF_SW_TIMER_COUNT; index++) {
+		struct sw_timer_handle *handler = &module_inst->handler[index];
+		if (handler->used && handler->callback_enable && (int32_t)(handler->expire_time - bench_now_ms()) <= 0) {
+			if (handler->period > 0) {
+				handler->expire_time = bench_now_ms() + handler->period;
+			} else {
+				handler->callback_enable = 0;
+			}
+			handler->callback(module_inst, index, handler->context, handler->period);
+		}
+	}
+}
+
+/** Next expiry of the timers (us), UINT64_MAX for none. */
+static uint64_t bench_next_deadline_us(void)
+{
+	uint64_t next = bench_resume_us ? bench_resume_us : UINT64_MAX;
+	int index;
+
+	for (index = 0; index < CONF_SW_TIMER_COUNT; index++) {
+		struct sw_timer_handle *handler = &bench_timer.handler[index];
+		if (handler->used && handler->callback_enable && (uint64_t)handler->expire_time * 1000 < next) {
+			next = (uint64_t)handler->expire_time * 1000;
+		}
+	}
+	return next;
+}
+
+/*
+ * Same as m2m_wifi.c, the rest of which needs the firmware. The client spins on
+ * it while it waits for a send, the time then moves to the next event.
+ */
+sint8 m2m_wifi_handle_events(void *arg)
+{
+	(void)arg;
+	if (!winc_spi_model_poll() && !hif_pending() && !winc_spi_model_wait(bench_next_deadline_us())) {
+		printf("m2m_wifi_handle_events: the WINC stalled\n");
+		exit(1);
+	}
+	return hif_handle_isr();
+}
+
+/*
+ * Heap in use, counted by the wrappers given to the linker (--wrap). The sizes
+ * are those of the allocator, as the C library allocates without the wrappers.
+ */
+static size_t bench_heap;
+static size_t bench_heap_peak;
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static void bench_heap_add(void *ptr)
+{
+	if (ptr != NULL) {
+		bench_heap += malloc_usable_size(ptr);
+		if (bench_heap > bench_heap_peak) {
+			bench_heap_peak = bench_heap;
+		}
+	}
+}
+
+static void bench_heap_remove(void *ptr)
+{
+	size_t size = (ptr != NULL) ? malloc_usable_size(ptr) : 0;
+
+	bench_heap = (bench_heap > size) ? bench_heap - size : 0;
+}
+
+void *__wrap_malloc(size_t size)
+{
+	void *ptr = __real_malloc(size);
+
+	bench_heap_add(ptr);
+	return ptr;
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+	void *ptr = __real_calloc(count, size);
+
+	bench_heap_add(ptr);
+	return ptr;
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+	bench_heap_remove(ptr);
+	ptr = __real_realloc(ptr, size);
+	bench_heap_add(ptr);
+	return ptr;
+}
+
+void __wrap_free(void *ptr)
+{
+	bench_heap_remove(ptr);
+	__real_free(ptr);
+}
+
+/* Stack of the thread running the suite, painted to find the peak of each run. */
+static uint32_t *bench_stack;
+
+/* Not inlined, so that its frame is below the frames of its callers. */
+static __attribute__((noinline)) void bench_paint_stack(void)
+{
+	/* Leaves the frame of this function and a margin. */
+	uint32_t *top = (uint32_t *)__builtin_frame_address(0) - 64;
+	uint32_t *p;
+
+	for (p = bench_stack; p < top; p++) {
+		*p = BENCH_STACK_PATTERN;
+	}
+}
+
+static uint32_t bench_get_stack_peak(void)
+{
+	uint32_t *p = bench_stack;
+	uint32_t *end = bench_stack + BENCH_STACK_SIZE / sizeof(uint32_t);
+
+	while (p < end && *p == BENCH_STACK_PATTERN) {
+		p++;
+	}
+	return (uint32_t)((uint8_t *)end - (uint8_t *)p);
+}
+
+static uint64_t bench_clock_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/*
+ * Suite.
+ */
+
+static void bench_print_header(FILE *out)
+{
+	fprintf(out, "bench,tag,scenario,run,status,bytes,ms,kB/s,cpu_ms_per_MB,spi_transfers_per_MB,"
+			"spi_bytes_per_MB,ram_static,ram_heap,ram_stack\n");
+}
+
+/** Counters at the start of the run. */
+static uint64_t bench_start_us;
+static uint64_t bench_start_ns;
+static uint64_t bench_start_model_ns;
+static tstrNmBusStats bench_start_bus;
+
+static void bench_print_result(void)
+{
+	const tstrNmBusStats *bus = nm_bus_get_stats();
+	uint32_t ms = (uint32_t)((winc_spi_model_now_us() - bench_start_us) / 1000);
+	uint64_t cpu_ns = (bench_clock_ns() - bench_start_ns) - (winc_spi_model_get_stats()->cpu_ns - bench_start_model_ns);
+	uint32_t mb_bytes = (bench_bytes > 0) ? bench_bytes : 1;
+	char line[256];
+
+	snprintf(line, sizeof(line), "bench,%s,%s,%u,%s,%lu,%lu,%lu,%.3f,%lu,%lu,%lu,%lu,%lu\n", bench_tag,
+			bench_names[bench_scenario], (unsigned int)bench_run, bench_ok ? "ok" : "failed",
+			(unsigned long)bench_bytes, (unsigned long)ms, (unsigned long)(ms ? bench_bytes / ms : 0),
+			(double)cpu_ns / 1e6 * 1048576 / mb_bytes,
+			(unsigned long)((uint64_t)(bus->u32Transfers - bench_start_bus.u32Transfers) * 1048576 / mb_bytes),
+			(unsigned long)((uint64_t)(bus->u32Bytes - bench_start_bus.u32Bytes) * 1048576 / mb_bytes),
+			bench_ram_static, (unsigned long)bench_heap_peak, (unsigned long)bench_get_stack_peak());
+	fputs(line, bench_out);
+	fputs(line, stdout);
+}
+
+static void bench_request_done(bool ok)
+{
+	if (!bench_pending) {
+		return;
+	}
+	bench_pending = false;
+	bench_ok = bench_ok && ok;
+	bench_requests++;
+	if (bench_ok && bench_scenario == BENCH_KEEP_ALIVE && bench_requests < MAIN_BENCH_KEEP_ALIVE_REQUESTS) {
+		return;
+	}
+	bench_done = true;
+}
+
+static void bench_send(void)
+{
+	const char *url = (bench_scenario == BENCH_CHUNKED) ? BENCH_CHUNKED_URL : BENCH_URL;
+	int ret;
+
+	bench_resume_us = 0;
+	bench_expect = 0;
+	if (bench_scenario == BENCH_RESUME) {
+		struct http_client_range range = {bench_entity_length / 2, 0};
+
+		bench_expect = range.offset;
+		ret = http_client_send_ranges(&bench_client, url, &range, 1, NULL);
+	} else {
+		ret = http_client_send_request(&bench_client, url, HTTP_METHOD_GET, NULL, NULL);
+	}
+	bench_pending = true;
+	if (ret < 0) {
+		printf("bench_send: request error %d\n", ret);
+		bench_request_done(false);
+	}
+}
+
+static void bench_sink(struct http_client_module *module_inst, const char *data, uint32_t offset, uint32_t length,
+		bool is_complete)
+{
+	uint32_t i;
+
+	for (i = 0; i < length; i++) {
+		if ((uint8_t)data[i] != origin_byte(offset + i)) {
+			printf("bench_sink: data at %lu is corrupted\n", (unsigned long)(offset + i));
+			bench_request_done(false);
+			http_client_close(module_inst);
+			return;
+		}
+	}
+	bench_expect = offset + length;
+	bench_bytes += length;
+
+	if (is_complete) {
+		bench_request_done(true);
+	} else if (bench_scenario == BENCH_SLOW && bench_resume_us == 0) {
+		http_client_pause_recv(module_inst);
+		bench_resume_us = winc_spi_model_now_us() + MAIN_BENCH_SLOW_PAUSE_MS * 1000ull;
+	}
+}
+
+static void bench_http_callback(struct http_client_module *module_inst, int type, union http_client_data *data)
+{
+	switch (type) {
+	case HTTP_CLIENT_CALLBACK_RECV_RESPONSE:
+		if (data->recv_response.response_code != 200 && data->recv_response.response_code != 206) {
+			printf("bench_http_callback: response %u\n", (unsigned int)data->recv_response.response_code);
+			bench_request_done(false);
+			http_client_close(module_inst);
+			break;
+		}
+		if (bench_scenario == BENCH_LARGE && !data->recv_response.is_chunked) {
+			bench_entity_length = data->recv_response.content_length;
+		}
+		if (data->recv_response.content != NULL) {
+			bench_sink(module_inst, data->recv_response.content, bench_expect,
+					data->recv_response.content_length, true);
+		}
+		break;
+
+	case HTTP_CLIENT_CALLBACK_RECV_CHUNKED_DATA:
+		bench_sink(module_inst, data->recv_chunked_data.data, bench_expect, data->recv_chunked_data.length,
+				data->recv_chunked_data.is_complete);
+		break;
+
+	case HTTP_CLIENT_CALLBACK_RECV_PART:
+		bench_sink(module_inst, data->recv_part.data, data->recv_part.offset, data->recv_part.length,
+				data->recv_part.is_complete);
+		break;
+
+	case HTTP_CLIENT_CALLBACK_DISCONNECTED:
+		if (bench_pending) {
+			printf("bench_http_callback: disconnected %d\n", data->disconnected.reason);
+			bench_request_done(false);
+		}
+		break;
+	}
+}
+
+static void bench_socket_cb(SOCKET sock, uint8 u8Msg, void *pvMsg)
+{
+	http_client_socket_event_handler(sock, u8Msg, pvMsg);
+}
+
+static void bench_resolve_cb(uint8 *pu8DomainName, uint32 u32ServerIP)
+{
+	http_client_socket_resolve_handler(pu8DomainName, u32ServerIP);
+}
+
+/**
+ * \brief Run the events until the run completes, the time moving when the host waits.
+ */
+static void bench_loop(void)
+{
+	uint64_t limit_us = winc_spi_model_now_us() + BENCH_RUN_TIMEOUT_MS * 1000ull;
+
+	while (!bench_done) {
+		int progress = winc_spi_model_poll();
+
+		if (hif_pending()) {
+			m2m_wifi_handle_events(NULL);
+			continue;
+		}
+		sw_timer_task(&bench_timer);
+		if (bench_resume_us != 0 && winc_spi_model_now_us() >= bench_resume_us) {
+			bench_resume_us = 0;
+			http_client_resume_recv(&bench_client);
+			progress = 1;
+		}
+		if (bench_pending == false && !bench_done) {
+			/* Next request of the keep-alive sequence. */
+			bench_send();
+			progress = 1;
+		}
+		if (progress || bench_done) {
+			continue;
+		}
+		if (winc_spi_model_now_us() > limit_us || !winc_spi_model_wait(bench_next_deadline_us())) {
+			printf("bench_loop: stalled at %lu bytes\n", (unsigned long)bench_bytes);
+			bench_pending = true;
+			bench_request_done(false);
+			bench_done = true;
+		}
+	}
+}
+
+static void bench_run_once(void)
+{
+	const struct winc_spi_model_link *link = &bench_lan;
+	struct winc_spi_model_link lossy = bench_lossy;
+
+	if (bench_scenario == BENCH_LOSSY) {
+		lossy.seed = bench_run + 1;
+		link = &lossy;
+	}
+	/* Each run starts on a new connection, with the chip as after m2m_wifi_init(). */
+	winc_spi_model_init(link, &bench_origin, CONF_WINC_SPI_CLOCK, BENCH_TRANSFER_NS);
+	nm_spi_init();
+	hif_init(NULL);
+	socketDeinit();
+	socketInit();
+	registerSocketCallback(bench_socket_cb, bench_resolve_cb);
+
+	bench_ok = true;
+	bench_done = false;
+	bench_bytes = 0;
+	bench_requests = 0;
+	bench_heap_peak = bench_heap;
+	bench_paint_stack();
+	bench_start_us = winc_spi_model_now_us();
+	bench_start_ns = bench_clock_ns();
+	bench_start_model_ns = winc_spi_model_get_stats()->cpu_ns;
+	memcpy(&bench_start_bus, nm_bus_get_stats(), sizeof(tstrNmBusStats));
+
+	bench_send();
+	bench_loop();
+	if (bench_ok && bench_bytes != ((bench_scenario == BENCH_KEEP_ALIVE)
+			? (uint32_t)MAIN_BENCH_KEEP_ALIVE_REQUESTS * BENCH_KEEP_ALIVE_SIZE
+			: (bench_scenario == BENCH_RESUME) ? BENCH_BODY_SIZE - bench_entity_length / 2 : BENCH_BODY_SIZE)) {
+		printf("bench_run_once: %lu bytes received\n", (unsigned long)bench_bytes);
+		bench_ok = false;
+	}
+	bench_print_result();
+	http_client_close(&bench_client);
+}
+
+static void *bench_main(void *arg)
+{
+	struct http_client_config httpc_conf;
+	int failed = 0;
+
+	(void)arg;
+	http_client_get_config_defaults(&httpc_conf);
+	httpc_conf.recv_buffer_size = MAIN_BUFFER_MAX_SIZE;
+	httpc_conf.timer_inst = &bench_timer;
+	httpc_conf.recv_min_delivery = MAIN_HTTP_MIN_DELIVERY;
+	httpc_conf.recv_delivery_timeout = MAIN_HTTP_DELIVERY_TIMEOUT_MS;
+	if (http_client_init(&bench_client, &httpc_conf) < 0) {
+		printf("bench_main: HTTP client initialization failed\n");
+		return (void *)1;
+	}
+	http_client_register_callback(&bench_client, bench_http_callback);
+
+	for (bench_scenario = BENCH_LARGE; bench_scenario < BENCH_COUNT; bench_scenario++) {
+		for (bench_run = 0; bench_run < MAIN_BENCH_RUNS; bench_run++) {
+			bench_run_once();
+			failed |= !bench_ok;
+		}
+	}
+	return failed ? (void *)1 : NULL;
+}
+
+int main(int argc, char **argv)
+{
+	pthread_attr_t attr;
+	pthread_t thread;
+	void *ret;
+	int i;
+
+	/* unistd.h, for getopt(), would clash with close() of the socket API. */
+	for (i = 1; i + 1 < argc && argv[i][0] == '-'; i += 2) {
+		if (strcmp(argv[i], "-o") == 0) {
+			bench_results = argv[i + 1];
+		} else if (strcmp(argv[i], "-t") == 0) {
+			bench_tag = argv[i + 1];
+		} else if (strcmp(argv[i], "-s") == 0) {
+			bench_ram_static = strtoul(argv[i + 1], NULL, 0);
+		} else {
+			break;
+		}
+	}
+	if (i != argc) {
+		fprintf(stderr, "usage: %s [-o results.csv] [-t tag] [-s ram_static]\n", argv[0]);
+		return 2;
+	}
+
+	/* The results show up as the runs complete. */
+	setvbuf(stdout, NULL, _IOLBF, 0);
+	/* The results of each build are added to the file, to compare them. */
+	bench_out = fopen(bench_results, "a");
+	if (bench_out == NULL) {
+		perror(bench_results);
+		return 1;
+	}
+	/* The header is not repeated in the file. */
+	if (ftell(bench_out) == 0) {
+		bench_print_header(bench_out);
+	}
+	bench_print_header(stdout);
+
+	pthread_attr_init(&attr);
+	if (posix_memalign((void **)&bench_stack, 4096, BENCH_STACK_SIZE) != 0
+			|| pthread_attr_setstack(&attr, bench_stack, BENCH_STACK_SIZE) != 0
+			|| pthread_create(&thread, &attr, bench_main, NULL) != 0) {
+		fprintf(stderr, "cannot start the suite\n");
+		return 1;
+	}
+	pthread_join(thread, &ret);
+	fclose(bench_out);
+	return ret != NULL;
+}
@@ -0,0 +1,160 @@
+/**
+ * \file
+ *
+ * \brief Host test of the entity in chunked transfer coding.
+ *
+ * The chunks have sizes in both cases of hexadecimal, extensions, a trailer,
+ * and sizes bigger than the receive buffer, and the WINC gives them in packets
+ * of any size. The data must reach the sink whole and in order, in multiples
+ * of recv_min_delivery but the last delivery.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "iot/http/http_client.h"
+#include "winc_model.h"
+
+#define TEST_RECV_BUFFER_SIZE    64
+#define TEST_BODY_SIZE           3000
+
+static struct http_client_module client;
+static struct sw_timer_module timer;
+static char recv_buffer[TEST_RECV_BUFFER_SIZE];
+
+static uint8_t body[TEST_BODY_SIZE];
+static char entity[TEST_BODY_SIZE * 2];
+static uint32_t min_delivery;
+static uint32_t received;
+static uint32_t deliveries;
+static int complete;
+static int disconnected;
+static int failures;
+
+#define TEST_CHECK(cond, ...) \
+	do { \
+		if (!(cond)) { \
+			printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+			printf(__VA_ARGS__); \
+			printf("\r\n"); \
+			failures++; \
+			return; \
+		} \
+	} while (0)
+
+static void test_http_callback(struct http_client_module *module, int type, union http_client_data *data)
+{
+	switch (type) {
+	case HTTP_CLIENT_CALLBACK_RECV_CHUNKED_DATA:
+		if (complete || received + data->recv_chunked_data.length > TEST_BODY_SIZE
+				|| memcmp(data->recv_chunked_data.data, body + received, data->recv_chunked_data.length) != 0) {
+			printf("FAIL: data at %lu is corrupted\r\n", (unsigned long)received);
+			failures++;
+			http_client_close(module);
+			break;
+		}
+		if (!data->recv_chunked_data.is_complete && min_delivery > 1
+				&& (data->recv_chunked_data.length == 0 || data->recv_chunked_data.length % min_delivery != 0)) {
+			printf("FAIL: delivery of %lu bytes at %lu\r\n", (unsigned long)data->recv_chunked_data.length,
+					(unsigned long)received);
+			failures++;
+			http_client_close(module);
+			break;
+		}
+		received += data->recv_chunked_data.length;
+		deliveries++;
+		if (data->recv_chunked_data.is_complete) {
+			complete = 1;
+		}
+		break;
+	case HTTP_CLIENT_CALLBACK_DISCONNECTED:
+		disconnected = 1;
+		break;
+	default:
+		break;
+	}
+}
+
+/** Encode the body in chunks of the given sizes, taken in turn. */
+static uint32_t test_encode(const uint32_t *sizes, unsigned count)
+{
+	uint32_t length = 0, offset = 0, size;
+	unsigned i = 0;
+
+	while (offset < TEST_BODY_SIZE) {
+		size = sizes[i++ % count];
+		if (size > TEST_BODY_SIZE - offset) {
+			size = TEST_BODY_SIZE - offset;
+		}
+		/* Both cases of hexadecimal, and an extension on every other chunk. */
+		length += sprintf(entity + length, (i & 1) ? "%lx\r\n" : "%lX;name=value\r\n", (unsigned long)size);
+		memcpy(entity + length, body + offset, size);
+		length += size;
+		length += sprintf(entity + length, "\r\n");
+		offset += size;
+	}
+	length += sprintf(entity + length, "0\r\nX-Trailer: 1\r\n\r\n");
+	return length;
+}
+
+static void test_download(const uint32_t *sizes, unsigned count, uint16_t packet_size, uint32_t delivery)
+{
+	static const char header[] = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n";
+	struct http_client_config config;
+	uint32_t length, i;
+	int failed = failures;
+
+	for (i = 0; i < TEST_BODY_SIZE; i++) {
+		body[i] = (uint8_t)(i * 7 + i / 251);
+	}
+	min_delivery = delivery;
+	received = 0;
+	deliveries = 0;
+	complete = 0;
+	disconnected = 0;
+
+	winc_model_init(http_client_socket_event_handler);
+	http_client_get_config_defaults(&config);
+	config.timer_inst = &timer;
+	config.timeout = 0;
+	config.recv_buffer = recv_buffer;
+	config.recv_buffer_size = TEST_RECV_BUFFER_SIZE;
+	config.recv_min_delivery = delivery;
+	TEST_CHECK(http_client_init(&client, &config) == 0, "init");
+	http_client_register_callback(&client, test_http_callback);
+	TEST_CHECK(http_client_send_request(&client, "http://10.0.0.1/file", HTTP_METHOD_GET, NULL, NULL) == 0, "request");
+
+	length = test_encode(sizes, count);
+	winc_model_server_write(header, strlen(header), packet_size);
+	winc_model_server_write(entity, length, packet_size);
+	TEST_CHECK(winc_model_server_remain() == strlen(header) + length, "entity too big for the model");
+
+	while (!complete && !disconnected && failures == failed && winc_model_step());
+
+	TEST_CHECK(failures == failed, "chunks of %lu, packets of %u, delivery of %lu", (unsigned long)sizes[0],
+			packet_size, (unsigned long)delivery);
+	TEST_CHECK(complete && received == TEST_BODY_SIZE, "%lu of %u bytes received, chunks of %lu, packets of %u",
+			(unsigned long)received, TEST_BODY_SIZE, (unsigned long)sizes[0], packet_size);
+	TEST_CHECK(winc_model_server_remain() == 0 && client.recved_size == 0, "trailer left in the buffer");
+	printf("ok: chunks of %4lu, packets of %4u, delivery of %2lu: %lu deliveries\r\n", (unsigned long)sizes[0],
+			packet_size, (unsigned long)delivery, (unsigned long)deliveries);
+	http_client_close(&client);
+	http_client_deinit(&client);
+}
+
+int main(void)
+{
+	static const uint32_t small[] = {1, 0x1a, 0x3f};
+	static const uint32_t large[] = {0xc8, 0x3e8, 7};
+	static const uint16_t packet_sizes[] = {11, 40, 100, 1400};
+	static const uint32_t deliveries[] = {0, 16, 48};
+	unsigned i, j;
+
+	for (i = 0; i < sizeof(packet_sizes) / sizeof(packet_sizes[0]); i++) {
+		for (j = 0; j < sizeof(deliveries) / sizeof(deliveries[0]); j++) {
+			test_download(small, 3, packet_sizes[i], deliveries[j]);
+			test_download(large, 3, packet_sizes[i], deliveries[j]);
+		}
+	}
+	printf("%s\r\n", failures ? "FAILED" : "PASSED");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,143 @@
+/**
+ * \file
+ *
+ * \brief Host test of the reception paused by http_client_pause_recv.
+ *
+ * The body comes in packets bigger than the receive buffer, so the WINC gives
+ * them in pieces, and the sink pauses the client on any of them. The data must
+ * reach the sink whole and in order, the held data never overwritten by the
+ * pending receive, and the sender held once the pause takes effect.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "iot/http/http_client.h"
+#include "winc_model.h"
+
+#define TEST_RECV_BUFFER_SIZE    64
+#define TEST_BODY_SIZE           3000
+
+static struct http_client_module client;
+static struct sw_timer_module timer;
+static char recv_buffer[TEST_RECV_BUFFER_SIZE];
+
+static uint8_t body[TEST_BODY_SIZE];
+static uint32_t sink_capacity;
+static uint32_t sink_level;
+static uint32_t received;
+static int complete;
+static int disconnected;
+static int failures;
+
+#define TEST_CHECK(cond, ...) \
+	do { \
+		if (!(cond)) { \
+			printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+			printf(__VA_ARGS__); \
+			printf("\r\n"); \
+			failures++; \
+			return; \
+		} \
+	} while (0)
+
+static void test_http_callback(struct http_client_module *module, int type, union http_client_data *data)
+{
+	switch (type) {
+	case HTTP_CLIENT_CALLBACK_RECV_CHUNKED_DATA:
+		if (received + data->recv_chunked_data.length > TEST_BODY_SIZE
+				|| memcmp(data->recv_chunked_data.data, body + received, data->recv_chunked_data.length) != 0) {
+			printf("FAIL: data at %lu is corrupted\r\n", (unsigned long)received);
+			failures++;
+			http_client_close(module);
+			break;
+		}
+		received += data->recv_chunked_data.length;
+		sink_level += data->recv_chunked_data.length;
+		if (data->recv_chunked_data.is_complete) {
+			complete = 1;
+		} else if (sink_level >= sink_capacity) {
+			http_client_pause_recv(module);
+		}
+		break;
+	case HTTP_CLIENT_CALLBACK_DISCONNECTED:
+		disconnected = 1;
+		break;
+	default:
+		break;
+	}
+}
+
+static void test_download(uint16_t packet_size, uint32_t capacity)
+{
+	static const char header_fmt[] = "HTTP/1.1 200 OK\r\nContent-Length: %u\r\n\r\n";
+	struct http_client_config config;
+	char header[64];
+	uint32_t stalls = 0, i;
+	int failed = failures;
+
+	for (i = 0; i < TEST_BODY_SIZE; i++) {
+		body[i] = (uint8_t)(i * 7 + i / 251);
+	}
+	sink_capacity = capacity;
+	sink_level = 0;
+	received = 0;
+	complete = 0;
+	disconnected = 0;
+
+	winc_model_init(http_client_socket_event_handler);
+	http_client_get_config_defaults(&config);
+	config.timer_inst = &timer;
+	config.timeout = 0;
+	config.recv_buffer = recv_buffer;
+	config.recv_buffer_size = TEST_RECV_BUFFER_SIZE;
+	TEST_CHECK(http_client_init(&client, &config) == 0, "init");
+	http_client_register_callback(&client, test_http_callback);
+	TEST_CHECK(http_client_send_request(&client, "http://10.0.0.1/file", HTTP_METHOD_GET, NULL, NULL) == 0, "request");
+
+	sprintf(header, header_fmt, TEST_BODY_SIZE);
+	winc_model_server_write(header, strlen(header), packet_size);
+	winc_model_server_write(body, TEST_BODY_SIZE, packet_size);
+
+	while (!complete && !disconnected && failures == failed) {
+		if (winc_model_step()) {
+			TEST_CHECK(client.recved_size <= TEST_RECV_BUFFER_SIZE, "%lu bytes held in the buffer",
+					(unsigned long)client.recved_size);
+			continue;
+		}
+		/* Stalled: the pause took effect at the end of a packet, or all is held. */
+		TEST_CHECK(client.recv_paused, "stalled with %lu bytes left", (unsigned long)winc_model_server_remain());
+		TEST_CHECK(winc_model_server_remain() == 0 || !winc_model_recv_pending(),
+				"stalled with a receive pending");
+		stalls++;
+		sink_level = 0;
+		http_client_resume_recv(&client);
+	}
+
+	TEST_CHECK(failures == failed, "packets of %u, sink of %lu", packet_size, (unsigned long)capacity);
+	TEST_CHECK(complete && received == TEST_BODY_SIZE, "%lu of %u bytes received, packets of %u, sink of %lu",
+			(unsigned long)received, TEST_BODY_SIZE, packet_size, (unsigned long)capacity);
+	/* The last stall holds the end of the body, the others held the sender, even
+	 * with packets read in pieces. */
+	TEST_CHECK(capacity >= TEST_BODY_SIZE || stalls > 1,
+			"the pause never held the sender");
+	printf("ok: packets of %4u, sink of %4lu: %lu pieces, %lu stalls, %lu recv moved\r\n",
+			packet_size, (unsigned long)capacity, (unsigned long)winc_model_get_stats()->pieces,
+			(unsigned long)stalls, (unsigned long)winc_model_get_stats()->recv_moved);
+	http_client_close(&client);
+	http_client_deinit(&client);
+}
+
+int main(void)
+{
+	static const uint16_t packet_sizes[] = {40, 64, 100, 150, 1400};
+	static const uint32_t capacities[] = {1, 30, 64, 100, 500, TEST_BODY_SIZE};
+	unsigned i, j;
+
+	for (i = 0; i < sizeof(packet_sizes) / sizeof(packet_sizes[0]); i++) {
+		for (j = 0; j < sizeof(capacities) / sizeof(capacities[0]); j++) {
+			test_download(packet_sizes[i], capacities[j]);
+		}
+	}
+	printf("%s\r\n", failures ? "FAILED" : "PASSED");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,14 @@
+/**
+ * \file
+ *
+ * \brief Host stand-in for the ASF header, for the modules built by the tests.
+ */
+
+#ifndef TEST_ASF_H_INCLUDED
+#define TEST_ASF_H_INCLUDED
+
+#include <compiler.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#endif /* TEST_ASF_H_INCLUDED */
@@ -0,0 +1,10 @@
+/**
+ * \file
+ *
+ * \brief Host stand-in for the ASF board definitions, none being used.
+ */
+
+#ifndef TEST_BOARD_H_INCLUDED
+#define TEST_BOARD_H_INCLUDED
+
+#endif /* TEST_BOARD_H_INCLUDED */
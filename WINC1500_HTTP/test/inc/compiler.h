@@ -0,0 +1,12 @@
+/**
+ * \file
+ *
+ * \brief Host stand-in for the ASF compiler abstraction.
+ */
+
+#ifndef TEST_COMPILER_H_INCLUDED
+#define TEST_COMPILER_H_INCLUDED
+
+#define RAMFUNC
+
+#endif /* TEST_COMPILER_H_INCLUDED */
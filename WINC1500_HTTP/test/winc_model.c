@@ -0,0 +1,258 @@
+/**
+ * \file
+ *
+ * \brief Host model of the WINC1500 socket layer for the tests.
+ */
+
+#include <asf.h>
+#include <stdlib.h>
+#include <string.h>
+#include "winc_model.h"
+#include "driver/include/m2m_wifi.h"
+#include "iot/sw_timer.h"
+
+#define MODEL_SOCK           0
+#define MODEL_SERVER_MAX     (64 * 1024)
+#define MODEL_PACKET_MAX     512
+#define MODEL_REQUEST_MAX    2048
+
+static tpfAppSocketCb model_cb;
+static struct winc_model_stats model_stats;
+
+static int model_open;
+static int model_connect_pending;
+static int model_send_pending;
+static int16_t model_send_size;
+
+static uint8_t *model_user_buffer;
+static uint16_t model_user_size;
+static int model_recv_pending;
+
+static uint8_t model_server[MODEL_SERVER_MAX];
+static uint32_t model_server_length;
+static uint32_t model_server_offset;
+static uint16_t model_packet[MODEL_PACKET_MAX];
+static uint32_t model_packet_count;
+static uint32_t model_packet_next;
+
+static char model_request[MODEL_REQUEST_MAX];
+static uint32_t model_request_length;
+
+void winc_model_init(tpfAppSocketCb callback)
+{
+	model_cb = callback;
+	memset(&model_stats, 0, sizeof(model_stats));
+	model_open = 0;
+	model_connect_pending = 0;
+	model_send_pending = 0;
+	model_user_buffer = NULL;
+	model_user_size = 0;
+	model_recv_pending = 0;
+	model_server_length = 0;
+	model_server_offset = 0;
+	model_packet_count = 0;
+	model_packet_next = 0;
+	model_request_length = 0;
+	model_request[0] = '\0';
+}
+
+void winc_model_server_write(const void *data, uint32_t length, uint16_t packet_size)
+{
+	while (length > 0 && model_server_length < MODEL_SERVER_MAX && model_packet_count < MODEL_PACKET_MAX) {
+		uint16_t size = (length > packet_size) ? packet_size : (uint16_t)length;
+		memcpy(model_server + model_server_length, data, size);
+		model_server_length += size;
+		model_packet[model_packet_count++] = size;
+		data = (const uint8_t *)data + size;
+		length -= size;
+	}
+}
+
+uint32_t winc_model_server_remain(void)
+{
+	return model_server_length - model_server_offset;
+}
+
+int winc_model_recv_pending(void)
+{
+	return model_recv_pending;
+}
+
+const char *winc_model_request(void)
+{
+	return model_request;
+}
+
+const struct winc_model_stats *winc_model_get_stats(void)
+{
+	return &model_stats;
+}
+
+/** As Socket_ReadSocketData: the pieces follow the buffer of the last recv(). */
+static void model_read_packet(uint16_t size)
+{
+	tstrSocketRecvMsg msg;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.u16RemainingSize = size;
+	while (size > 0 && model_open && model_user_buffer != NULL && model_user_size > 0) {
+		uint16_t read = (size > model_user_size) ? model_user_size : size;
+		memcpy(model_user_buffer, model_server + model_server_offset, read);
+		model_server_offset += read;
+		size -= read;
+		msg.pu8Buffer = model_user_buffer;
+		msg.s16BufferSize = (sint16)read;
+		msg.u16RemainingSize = size;
+		/* A recv() given before the last piece does not ask for the next packet. */
+		model_recv_pending = (size > 0);
+		model_stats.pieces++;
+		model_stats.bytes += read;
+		model_cb(MODEL_SOCK, SOCKET_MSG_RECV, &msg);
+	}
+	/* The rest of a packet of a closed socket is dropped. */
+	model_server_offset += size;
+}
+
+int winc_model_step(void)
+{
+	if (!model_open) {
+		return 0;
+	}
+	if (model_connect_pending) {
+		tstrSocketConnectMsg msg;
+		model_connect_pending = 0;
+		msg.sock = MODEL_SOCK;
+		msg.s8Error = 0;
+		model_cb(MODEL_SOCK, SOCKET_MSG_CONNECT, &msg);
+		return 1;
+	}
+	if (model_send_pending) {
+		model_send_pending = 0;
+		model_cb(MODEL_SOCK, SOCKET_MSG_SEND, &model_send_size);
+		return 1;
+	}
+	if (model_recv_pending && model_packet_next < model_packet_count) {
+		/* As m2m_ip_recv_reply: the pending flag is dropped first. */
+		model_recv_pending = 0;
+		model_stats.packets++;
+		model_read_packet(model_packet[model_packet_next++]);
+		return 1;
+	}
+	return 0;
+}
+
+SOCKET socket(uint16 u16Domain, uint8 u8Type, uint8 u8Flags)
+{
+	(void)u16Domain;
+	(void)u8Type;
+	(void)u8Flags;
+	if (model_open) {
+		return SOCK_ERR_MAX_TCP_SOCK;
+	}
+	model_open = 1;
+	model_recv_pending = 0;
+	return MODEL_SOCK;
+}
+
+sint8 connect(SOCKET sock, struct sockaddr *pstrAddr, uint8 u8AddrLen)
+{
+	(void)pstrAddr;
+	(void)u8AddrLen;
+	if (sock != MODEL_SOCK || !model_open) {
+		return SOCK_ERR_INVALID_ARG;
+	}
+	model_connect_pending = 1;
+	return SOCK_ERR_NO_ERROR;
+}
+
+sint16 send(SOCKET sock, void *pvSendBuffer, uint16 u16SendLength, uint16 u16Flags)
+{
+	(void)u16Flags;
+	if (sock != MODEL_SOCK || !model_open || model_send_pending) {
+		return SOCK_ERR_INVALID_ARG;
+	}
+	if (model_request_length + u16SendLength < MODEL_REQUEST_MAX) {
+		memcpy(model_request + model_request_length, pvSendBuffer, u16SendLength);
+		model_request_length += u16SendLength;
+		model_request[model_request_length] = '\0';
+	}
+	model_send_size = (int16_t)u16SendLength;
+	model_send_pending = 1;
+	return SOCK_ERR_NO_ERROR;
+}
+
+sint16 recv(SOCKET sock, void *pvRecvBuf, uint16 u16BufLen, uint32 u32Timeoutmsec)
+{
+	(void)u32Timeoutmsec;
+	if (sock != MODEL_SOCK || !model_open || pvRecvBuf == NULL || u16BufLen == 0) {
+		return SOCK_ERR_INVALID_ARG;
+	}
+	model_user_buffer = (uint8_t *)pvRecvBuf;
+	model_user_size = u16BufLen;
+	if (!model_recv_pending) {
+		model_recv_pending = 1;
+		model_stats.recv_started++;
+	} else {
+		model_stats.recv_moved++;
+	}
+	return SOCK_ERR_NO_ERROR;
+}
+
+sint8 close(SOCKET sock)
+{
+	if (sock != MODEL_SOCK || !model_open) {
+		return SOCK_ERR_INVALID_ARG;
+	}
+	model_open = 0;
+	model_connect_pending = 0;
+	model_send_pending = 0;
+	model_recv_pending = 0;
+	return SOCK_ERR_NO_ERROR;
+}
+
+sint8 gethostbyname(uint8 *pcHostName)
+{
+	(void)pcHostName;
+	return SOCK_ERR_INVALID_ARG;
+}
+
+uint32 nmi_inet_addr(char *pcIpAddr)
+{
+	(void)pcIpAddr;
+	return 0x0100000a;
+}
+
+sint8 m2m_wifi_handle_events(void *arg)
+{
+	(void)arg;
+	while (winc_model_step());
+	return M2M_SUCCESS;
+}
+
+int sw_timer_register_callback(struct sw_timer_module *const module_inst,
+	sw_timer_callback_t callback, void *context, uint32_t period)
+{
+	(void)module_inst;
+	(void)callback;
+	(void)context;
+	(void)period;
+	return 0;
+}
+
+void sw_timer_enable_callback(struct sw_timer_module *const module_inst, int timer_id, uint32_t delay)
+{
+	(void)module_inst;
+	(void)timer_id;
+	(void)delay;
+}
+
+void sw_timer_disable_callback(struct sw_timer_module *const module_inst, int timer_id)
+{
+	(void)module_inst;
+	(void)timer_id;
+}
+
+void sw_timer_task(struct sw_timer_module *const module_inst)
+{
+	(void)module_inst;
+}
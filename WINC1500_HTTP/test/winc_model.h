@@ -0,0 +1,89 @@
+/**
+ * \file
+ *
+ * \brief Host model of the WINC1500 socket layer for the tests.
+ *
+ * One TCP socket whose receive follows the driver: recv() starts a receive
+ * only when none is pending, else it only moves the buffer of the pending one.
+ * A packet bigger than the buffer is given in pieces, each written to the
+ * buffer of the last recv(). The pending flag is dropped before the last piece
+ * is given to the callback, so only a recv() given then asks for the next packet.
+ * The sw_timer calls are no-ops.
+ */
+
+#ifndef TEST_WINC_MODEL_H_INCLUDED
+#define TEST_WINC_MODEL_H_INCLUDED
+
+#include <stdint.h>
+#include "socket/include/socket.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Calls made by the client under test, and its receives. */
+struct winc_model_stats {
+	/** recv() calls that started a receive in the WINC. */
+	uint32_t recv_started;
+	/** recv() calls that only moved the buffer of the pending receive. */
+	uint32_t recv_moved;
+	/** Packets taken by the host. */
+	uint32_t packets;
+	/** Pieces given to the socket callback. */
+	uint32_t pieces;
+	/** Bytes given to the socket callback. */
+	uint32_t bytes;
+};
+
+/**
+ * \brief Reset the model, with the socket callback of the client under test.
+ *
+ * \param[in]  callback        Socket callback, such as http_client_socket_event_handler.
+ */
+void winc_model_init(tpfAppSocketCb callback);
+
+/**
+ * \brief Queue data sent by the server.
+ *
+ * \param[in]  data            Data of the server.
+ * \param[in]  length          Length of the data.
+ * \param[in]  packet_size     Size of the packets the WINC hands the data in.
+ */
+void winc_model_server_write(const void *data, uint32_t length, uint16_t packet_size);
+
+/**
+ * \brief Give the next event to the socket callback.
+ *
+ * The connection and the sends complete first. A packet is given only while a
+ * receive is pending.
+ *
+ * \return     1               An event was given.
+ * \return     0               Nothing to do until the client calls recv().
+ */
+int winc_model_step(void);
+
+/**
+ * \brief Bytes of the server not given to the client yet.
+ */
+uint32_t winc_model_server_remain(void);
+
+/**
+ * \brief Whether a receive is pending in the WINC.
+ */
+int winc_model_recv_pending(void);
+
+/**
+ * \brief Request sent by the client so far, null terminated.
+ */
+const char *winc_model_request(void);
+
+/**
+ * \brief Counters of the model.
+ */
+const struct winc_model_stats *winc_model_get_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TEST_WINC_MODEL_H_INCLUDED */
@@ -0,0 +1,914 @@
+/**
+ * \file
+ *
+ * \brief Host model of the WINC1500 behind the SPI bus, for the benchmark.
+ */
+
+#include <asf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "winc_spi_model.h"
+#include "common/include/nm_common.h"
+#include "bsp/include/nm_bsp.h"
+#include "bus_wrapper/include/nm_bus_wrapper.h"
+#include "driver/source/nmasic.h"
+#include "driver/source/m2m_hif.h"
+#include "driver/include/m2m_types.h"
+#include "socket/source/socket_internal.h"
+
+/* Commands of the SPI protocol, see nmspi.c. */
+#define CMD_DMA_EXT_WRITE        0xc7
+#define CMD_DMA_EXT_READ         0xc8
+#define CMD_INTERNAL_WRITE       0xc3
+#define CMD_INTERNAL_READ        0xc4
+#define CMD_SINGLE_WRITE         0xc9
+#define CMD_SINGLE_READ          0xca
+#define CMD_RESET                0xcf
+/* Start of a data block, the low bits give its order. */
+#define SPI_DATA_TOKEN           0xf3
+/* Size of the data blocks, set by nmspi.c in the protocol register. */
+#define SPI_DATA_PKT_SZ          (8 * 1024)
+#define NMI_SPI_PROTOCOL_CONFIG  (0xe800 + 0x24)
+#define MODEL_REG_CHIPID         (0x1000)
+#define MODEL_CHIPID             (0x1503a0)
+
+/* Same as the bus wrapper of the SAMD21. */
+#define NM_BUS_MAX_TRX_SZ        256
+
+/* Shared memory of the HIF: a message of the host, then one of the WINC. */
+#define MODEL_SHM_BASE           0x28000
+#define MODEL_SHM_TX             MODEL_SHM_BASE
+#define MODEL_SHM_RX             (MODEL_SHM_BASE + 0x1000)
+#define MODEL_SHM_SIZE           0x2000
+
+#define MODEL_REG_MAX            32
+#define MODEL_MISO_MAX           1024
+#define MODEL_CTRL_MAX           8
+#define MODEL_CTRL_SIZE          sizeof(tstrDnsReply)
+#define MODEL_SEGMENT_MAX        1460
+#define MODEL_RX_SEGMENTS        64
+#define MODEL_EVENT_MAX          (MODEL_RX_SEGMENTS + 16)
+
+/* Offset of the data in the send command, see socket.c. */
+#define MODEL_TCP_TX_OFFSET      (14 + 34 + 40)
+/* Address of the peer given by the name resolution. */
+#define MODEL_PEER_ADDR          0x0a01a8c0
+
+tstrNmBusCapabilities egstrNmBusCapabilities = {
+	NM_BUS_MAX_TRX_SZ
+};
+
+enum model_spi_state {
+	SPI_CMD,
+	SPI_WR_TOKEN,
+	SPI_WR_DATA,
+	SPI_WR_CRC,
+};
+
+enum model_event_type {
+	EVENT_CONNECTED,
+	EVENT_RESOLVED,
+	EVENT_SEGMENT,
+	EVENT_ACK,
+	EVENT_PEER_DATA,
+};
+
+struct model_event {
+	uint8_t used;
+	uint8_t type;
+	uint32_t conn;
+	uint64_t time_ns;
+	uint32_t seq;
+	uint16_t length;
+	uint8_t data[MODEL_SEGMENT_MAX];
+};
+
+struct model_ctrl {
+	uint8_t opcode;
+	uint16_t length;
+	uint8_t data[MODEL_CTRL_SIZE];
+};
+
+struct model_segment {
+	uint16_t length;
+	uint8_t data[MODEL_SEGMENT_MAX];
+};
+
+static struct winc_spi_model_link model_link;
+static const struct winc_spi_model_peer *model_peer;
+static struct winc_spi_model_stats model_stats;
+static tstrNmBusStats model_bus_stats;
+static uint32_t model_spi_clock_hz;
+static uint32_t model_transfer_ns;
+static uint64_t model_now_ns;
+static uint64_t model_spi_ns;
+static uint32_t model_rand;
+static struct timespec model_cpu_start;
+static int model_cpu_depth;
+
+/* Bus and registers. */
+static uint32_t model_reg_addr[MODEL_REG_MAX];
+static uint32_t model_reg_val[MODEL_REG_MAX];
+static uint32_t model_reg_count;
+static uint8_t model_shm[MODEL_SHM_SIZE];
+static uint8_t model_miso[MODEL_MISO_MAX];
+static uint32_t model_miso_len;
+static uint32_t model_miso_pos;
+static enum model_spi_state model_spi;
+static int model_crc_off;
+static uint32_t model_wr_addr;
+static uint32_t model_wr_remain;
+static uint32_t model_wr_block;
+
+/* Interrupt line. */
+static tpfNmBspIsr model_isr;
+static int model_irq_enabled;
+static int model_irq_pending;
+
+/* Messages to the host. */
+static int model_rx_busy;
+static struct model_ctrl model_ctrl[MODEL_CTRL_MAX];
+static uint32_t model_ctrl_head;
+static uint32_t model_ctrl_count;
+
+/* Events of the network, in time then in creation order. */
+static struct model_event model_events[MODEL_EVENT_MAX];
+static uint32_t model_event_seq;
+
+/* The TCP connection. */
+static int model_open;
+static SOCKET model_sock;
+static uint32_t model_conn;
+static int model_recv_pending;
+static uint16_t model_recv_session;
+static uint64_t model_recv_deadline_ns;
+static struct model_segment model_rx[MODEL_RX_SEGMENTS];
+static uint32_t model_rx_head;
+static uint32_t model_rx_count;
+static uint32_t model_outstanding;
+static uint64_t model_link_free_ns;
+static uint64_t model_last_arrival_ns;
+static uint8_t model_peer_buf[MODEL_SEGMENT_MAX];
+
+static void model_fail(const char *what, uint32_t value)
+{
+	fprintf(stderr, "winc_spi_model: %s (0x%lx)\n", what, (unsigned long)value);
+	abort();
+}
+
+static uint64_t model_clock_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* The time of the model is taken off the time of the driver under test. */
+static void model_cpu_enter(void)
+{
+	if (model_cpu_depth++ == 0) {
+		clock_gettime(CLOCK_MONOTONIC, &model_cpu_start);
+	}
+}
+
+static void model_cpu_leave(void)
+{
+	if (--model_cpu_depth == 0) {
+		model_stats.cpu_ns += model_clock_ns()
+				- ((uint64_t)model_cpu_start.tv_sec * 1000000000ull + model_cpu_start.tv_nsec);
+	}
+}
+
+static uint32_t model_random(void)
+{
+	/* xorshift32, the same losses for the same seed. */
+	model_rand ^= model_rand << 13;
+	model_rand ^= model_rand >> 17;
+	model_rand ^= model_rand << 5;
+	return model_rand;
+}
+
+/*
+ * Registers.
+ */
+
+static uint32_t *model_reg(uint32_t addr)
+{
+	uint32_t i;
+
+	for (i = 0; i < model_reg_count; i++) {
+		if (model_reg_addr[i] == addr) {
+			return &model_reg_val[i];
+		}
+	}
+	if (model_reg_count == MODEL_REG_MAX) {
+		model_fail("too many registers", addr);
+	}
+	model_reg_addr[model_reg_count] = addr;
+	model_reg_val[model_reg_count] = 0;
+	return &model_reg_val[model_reg_count++];
+}
+
+static uint8_t *model_shm_at(uint32_t addr, uint32_t length)
+{
+	if (addr < MODEL_SHM_BASE || addr + length > MODEL_SHM_BASE + MODEL_SHM_SIZE) {
+		model_fail("access outside of the shared memory", addr);
+	}
+	return &model_shm[addr - MODEL_SHM_BASE];
+}
+
+static void model_irq(void)
+{
+	if (model_isr == NULL) {
+		return;
+	}
+	if (model_irq_enabled) {
+		model_isr();
+	} else {
+		model_irq_pending = 1;
+	}
+}
+
+/* Hand a message to the host, which takes it and sets RX done. */
+static void model_send_msg(uint8_t opcode, const void *reply, uint16_t reply_size, const void *data, uint16_t size)
+{
+	tstrHifHdr hdr;
+	uint16_t length = M2M_HIF_HDR_OFFSET + reply_size + size;
+
+	hdr.u8Gid = M2M_REQ_GROUP_IP;
+	hdr.u8Opcode = opcode;
+	hdr.u16Length = length;
+	memcpy(model_shm_at(MODEL_SHM_RX, sizeof(hdr)), &hdr, sizeof(hdr));
+	memcpy(model_shm_at(MODEL_SHM_RX + M2M_HIF_HDR_OFFSET, reply_size), reply, reply_size);
+	if (size > 0) {
+		memcpy(model_shm_at(MODEL_SHM_RX + M2M_HIF_HDR_OFFSET + reply_size, size), data, size);
+	}
+	*model_reg(WIFI_HOST_RCV_CTRL_1) = MODEL_SHM_RX;
+	*model_reg(WIFI_HOST_RCV_CTRL_0) = ((uint32_t)length << 2) | NBIT0;
+	model_rx_busy = 1;
+	model_stats.messages++;
+	model_irq();
+}
+
+static void model_queue_ctrl(uint8_t opcode, const void *reply, uint16_t size)
+{
+	struct model_ctrl *ctrl;
+
+	if (model_ctrl_count == MODEL_CTRL_MAX) {
+		model_fail("too many replies", opcode);
+	}
+	ctrl = &model_ctrl[(model_ctrl_head + model_ctrl_count++) % MODEL_CTRL_MAX];
+	ctrl->opcode = opcode;
+	ctrl->length = size;
+	memcpy(ctrl->data, reply, size);
+}
+
+static struct model_event *model_add_event(uint8_t type, uint64_t time_ns)
+{
+	uint32_t i;
+
+	for (i = 0; i < MODEL_EVENT_MAX; i++) {
+		if (!model_events[i].used) {
+			model_events[i].used = 1;
+			model_events[i].type = type;
+			model_events[i].conn = model_conn;
+			model_events[i].time_ns = time_ns;
+			model_events[i].seq = model_event_seq++;
+			model_events[i].length = 0;
+			return &model_events[i];
+		}
+	}
+	model_fail("too many events", type);
+	return NULL;
+}
+
+static struct model_event *model_next_event(void)
+{
+	struct model_event *next = NULL;
+	uint32_t i;
+
+	for (i = 0; i < MODEL_EVENT_MAX; i++) {
+		struct model_event *ev = &model_events[i];
+		if (ev->used && (next == NULL || ev->time_ns < next->time_ns
+				|| (ev->time_ns == next->time_ns && ev->seq < next->seq))) {
+			next = ev;
+		}
+	}
+	return next;
+}
+
+/*
+ * Firmware.
+ */
+
+/* Send the data of the peer while the window allows. */
+static void model_pump(void)
+{
+	while (model_open && model_outstanding < model_link.window) {
+		uint32_t room = model_link.window - model_outstanding;
+		uint32_t length;
+		uint64_t start;
+		struct model_event *ev;
+
+		if (room < model_link.mss && model_outstanding > 0) {
+			/* Waits for a full segment. */
+			break;
+		}
+		length = model_peer->read(model_peer_buf, room < model_link.mss ? room : model_link.mss);
+		if (length == 0) {
+			break;
+		}
+		start = (model_link_free_ns > model_now_ns) ? model_link_free_ns : model_now_ns;
+		model_link_free_ns = start + (uint64_t)length * 8 * 1000000 / model_link.bandwidth_kbps;
+		ev = model_add_event(EVENT_SEGMENT, model_link_free_ns + (uint64_t)model_link.latency_us * 1000);
+		if (model_link.loss_ppm > 0 && model_random() % 1000000 < model_link.loss_ppm) {
+			ev->time_ns += (uint64_t)model_link.rto_us * 1000;
+			model_stats.lost++;
+		}
+		/* The segments after a lost one are held until it is retransmitted. */
+		if (ev->time_ns < model_last_arrival_ns) {
+			ev->time_ns = model_last_arrival_ns;
+		}
+		model_last_arrival_ns = ev->time_ns;
+		ev->length = (uint16_t)length;
+		memcpy(ev->data, model_peer_buf, length);
+		model_outstanding += length;
+		model_stats.segments++;
+	}
+}
+
+static void model_close(void)
+{
+	if (model_open) {
+		model_open = 0;
+		model_peer->closed();
+	}
+	model_conn++;
+	model_recv_pending = 0;
+	model_rx_head = 0;
+	model_rx_count = 0;
+	model_outstanding = 0;
+}
+
+static void model_run_cmd(uint32_t addr)
+{
+	tstrHifHdr hdr;
+	uint8_t *cmd;
+
+	memcpy(&hdr, model_shm_at(addr, sizeof(hdr)), sizeof(hdr));
+	if (hdr.u8Gid != M2M_REQ_GROUP_IP) {
+		model_fail("unsupported group", hdr.u8Gid);
+	}
+	cmd = model_shm_at(addr + M2M_HIF_HDR_OFFSET, hdr.u16Length - M2M_HIF_HDR_OFFSET);
+
+	switch (hdr.u8Opcode) {
+	case SOCKET_CMD_DNS_RESOLVE:
+	{
+		struct model_event *ev = model_add_event(EVENT_RESOLVED, model_now_ns + 2000ull * model_link.latency_us);
+		ev->length = hdr.u16Length - M2M_HIF_HDR_OFFSET;
+		memcpy(ev->data, cmd, ev->length);
+		break;
+	}
+
+	case SOCKET_CMD_CONNECT:
+	{
+		tstrConnectCmd connect_cmd;
+
+		memcpy(&connect_cmd, cmd, sizeof(connect_cmd));
+		model_close();
+		model_sock = connect_cmd.sock;
+		/* SYN, then SYN-ACK. */
+		model_add_event(EVENT_CONNECTED, model_now_ns + 2000ull * model_link.latency_us);
+		break;
+	}
+
+	case SOCKET_CMD_SEND:
+	{
+		tstrSendCmd send_cmd;
+		tstrSendReply reply;
+		struct model_event *ev;
+
+		memcpy(&send_cmd, cmd, sizeof(send_cmd));
+		if (!model_open || send_cmd.sock != model_sock || send_cmd.u16DataSize > MODEL_SEGMENT_MAX) {
+			model_fail("send on a closed socket", send_cmd.sock);
+		}
+		ev = model_add_event(EVENT_PEER_DATA, model_now_ns + 1000ull * model_link.latency_us);
+		ev->length = send_cmd.u16DataSize;
+		memcpy(ev->data, model_shm_at(addr + hdr.u16Length - send_cmd.u16DataSize, send_cmd.u16DataSize),
+				send_cmd.u16DataSize);
+		memset(&reply, 0, sizeof(reply));
+		reply.sock = send_cmd.sock;
+		reply.s16SentBytes = send_cmd.u16DataSize;
+		reply.u16SessionID = send_cmd.u16SessionID;
+		model_queue_ctrl(SOCKET_CMD_SEND, &reply, sizeof(reply));
+		break;
+	}
+
+	case SOCKET_CMD_RECV:
+	{
+		tstrRecvCmd recv_cmd;
+
+		memcpy(&recv_cmd, cmd, sizeof(recv_cmd));
+		if (recv_cmd.sock != model_sock) {
+			model_fail("receive on another socket", recv_cmd.sock);
+		}
+		model_recv_pending = 1;
+		model_recv_session = recv_cmd.u16SessionID;
+		model_recv_deadline_ns = (recv_cmd.u32Timeoutmsec == 0xFFFFFFFF) ? UINT64_MAX
+				: model_now_ns + (uint64_t)recv_cmd.u32Timeoutmsec * 1000000;
+		break;
+	}
+
+	case SOCKET_CMD_CLOSE:
+		/* The socket and its session come first, see tstrCloseCmd in socket.c. */
+		if ((SOCKET)cmd[0] == model_sock) {
+			model_close();
+		}
+		break;
+
+	default:
+		/* Options and the like have no reply. */
+		break;
+	}
+}
+
+static void model_run_event(struct model_event *ev)
+{
+	ev->used = 0;
+	if (ev->conn != model_conn && ev->type != EVENT_RESOLVED) {
+		/* Left by a closed connection. */
+		return;
+	}
+
+	switch (ev->type) {
+	case EVENT_RESOLVED:
+	{
+		tstrDnsReply reply;
+
+		memset(&reply, 0, sizeof(reply));
+		memcpy(reply.acHostName, ev->data, (ev->length < HOSTNAME_MAX_SIZE) ? ev->length : HOSTNAME_MAX_SIZE - 1);
+		reply.u32HostIP = MODEL_PEER_ADDR;
+		model_queue_ctrl(SOCKET_CMD_DNS_RESOLVE, &reply, sizeof(reply));
+		break;
+	}
+
+	case EVENT_CONNECTED:
+	{
+		tstrConnectReply reply;
+
+		model_open = 1;
+		model_link_free_ns = model_now_ns;
+		model_last_arrival_ns = model_now_ns;
+		model_peer->connected();
+		memset(&reply, 0, sizeof(reply));
+		reply.sock = model_sock;
+		reply.s8Error = SOCK_ERR_NO_ERROR;
+		reply.u16AppDataOffset = MODEL_TCP_TX_OFFSET;
+		model_queue_ctrl(SOCKET_CMD_CONNECT, &reply, sizeof(reply));
+		break;
+	}
+
+	case EVENT_PEER_DATA:
+		model_peer->received(ev->data, ev->length);
+		break;
+
+	case EVENT_SEGMENT:
+	{
+		struct model_segment *seg;
+
+		if (model_rx_count == MODEL_RX_SEGMENTS) {
+			model_fail("window larger than the receive segments", model_link.window);
+		}
+		seg = &model_rx[(model_rx_head + model_rx_count++) % MODEL_RX_SEGMENTS];
+		seg->length = ev->length;
+		memcpy(seg->data, ev->data, ev->length);
+		break;
+	}
+
+	case EVENT_ACK:
+		model_outstanding -= ev->length;
+		break;
+	}
+	model_pump();
+}
+
+/* Post the next message once the host took the previous one. */
+static int model_post(void)
+{
+	tstrRecvReply reply;
+
+	if (model_rx_busy) {
+		return 0;
+	}
+	if (model_ctrl_count > 0) {
+		struct model_ctrl *ctrl = &model_ctrl[model_ctrl_head];
+
+		model_ctrl_head = (model_ctrl_head + 1) % MODEL_CTRL_MAX;
+		model_ctrl_count--;
+		model_send_msg(ctrl->opcode, ctrl->data, ctrl->length, NULL, 0);
+		return 1;
+	}
+	if (!model_recv_pending) {
+		return 0;
+	}
+
+	memset(&reply, 0, sizeof(reply));
+	reply.strRemoteAddr.u16Family = AF_INET;
+	reply.strRemoteAddr.u16Port = _htons(80);
+	reply.strRemoteAddr.u32IPAddr = MODEL_PEER_ADDR;
+	reply.sock = model_sock;
+	reply.u16SessionID = model_recv_session;
+	if (model_rx_count > 0) {
+		struct model_segment *seg = &model_rx[model_rx_head];
+		struct model_event *ack;
+
+		model_rx_head = (model_rx_head + 1) % MODEL_RX_SEGMENTS;
+		model_rx_count--;
+		model_recv_pending = 0;
+		/* The window opens again once the ACK reaches the peer. */
+		ack = model_add_event(EVENT_ACK, model_now_ns + 1000ull * model_link.latency_us);
+		ack->length = seg->length;
+		reply.s16RecvStatus = seg->length;
+		reply.u16DataOffset = sizeof(reply);
+		model_send_msg(SOCKET_CMD_RECV, &reply, sizeof(reply), seg->data, seg->length);
+		return 1;
+	}
+	if (model_now_ns >= model_recv_deadline_ns) {
+		model_recv_pending = 0;
+		reply.s16RecvStatus = SOCK_ERR_TIMEOUT;
+		model_send_msg(SOCKET_CMD_RECV, &reply, sizeof(reply), NULL, 0);
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * Registers with an effect.
+ */
+
+static uint32_t model_read_reg(uint32_t addr)
+{
+	if (addr == MODEL_REG_CHIPID) {
+		return MODEL_CHIPID;
+	}
+	return *model_reg(addr);
+}
+
+static void model_write_reg(uint32_t addr, uint32_t value)
+{
+	switch (addr) {
+	case WIFI_HOST_RCV_CTRL_2:
+		/* Buffer of the next message of the host, allocated at once. */
+		if (value & NBIT1) {
+			*model_reg(WIFI_HOST_RCV_CTRL_4) = MODEL_SHM_TX;
+			value &= ~NBIT1;
+		}
+		break;
+
+	case WIFI_HOST_RCV_CTRL_3:
+		if (value & NBIT1) {
+			model_run_cmd(value >> 2);
+		}
+		break;
+
+	case WIFI_HOST_RCV_CTRL_0:
+		if (value & NBIT1) {
+			/* RX done. */
+			*model_reg(addr) = value & ~NBIT1;
+			model_rx_busy = 0;
+			model_post();
+			return;
+		}
+		break;
+
+	case NMI_SPI_PROTOCOL_CONFIG:
+		model_crc_off = (value & 0xc) == 0;
+		break;
+	}
+	*model_reg(addr) = value;
+}
+
+/*
+ * SPI slave.
+ */
+
+static void model_miso_put(const uint8_t *data, uint32_t length)
+{
+	if (model_miso_pos == model_miso_len) {
+		model_miso_pos = 0;
+		model_miso_len = 0;
+	}
+	if (model_miso_len + length > MODEL_MISO_MAX) {
+		model_fail("SPI response too long", length);
+	}
+	memcpy(&model_miso[model_miso_len], data, length);
+	model_miso_len += length;
+}
+
+static void model_miso_byte(uint8_t value)
+{
+	model_miso_put(&value, 1);
+}
+
+static void model_miso_read(uint32_t value, int crc)
+{
+	uint8_t data[4] = {(uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24)};
+	model_miso_byte(SPI_DATA_TOKEN);
+	model_miso_put(data, sizeof(data));
+	if (crc && !model_crc_off) {
+		model_miso_put((const uint8_t *)"\0\0", 2);
+	}
+}
+
+static void model_spi_cmd(const uint8_t *bc, uint16_t size)
+{
+	uint8_t cmd = bc[0];
+	uint32_t addr24 = ((uint32_t)bc[1] << 16) | ((uint32_t)bc[2] << 8) | bc[3];
+	uint32_t addr_internal = ((uint32_t)(bc[1] & 0x7f) << 8) | bc[2];
+
+	if (cmd == CMD_RESET) {
+		model_miso_byte(0xff);
+	}
+	model_miso_byte(cmd);
+	model_miso_byte(0x00);
+
+	switch (cmd) {
+	case CMD_SINGLE_READ:
+		model_miso_read(model_read_reg(addr24), 1);
+		break;
+
+	case CMD_INTERNAL_READ:
+		/* Clockless, without CRC. */
+		model_miso_read(model_read_reg(addr_internal), 0);
+		break;
+
+	case CMD_SINGLE_WRITE:
+		model_write_reg(addr24, ((uint32_t)bc[4] << 24) | ((uint32_t)bc[5] << 16) | ((uint32_t)bc[6] << 8) | bc[7]);
+		break;
+
+	case CMD_INTERNAL_WRITE:
+		model_write_reg(addr_internal, ((uint32_t)bc[3] << 24) | ((uint32_t)bc[4] << 16) | ((uint32_t)bc[5] << 8) | bc[6]);
+		break;
+
+	case CMD_DMA_EXT_READ:
+	{
+		uint32_t length = ((uint32_t)bc[4] << 16) | ((uint32_t)bc[5] << 8) | bc[6];
+
+		if (length > SPI_DATA_PKT_SZ) {
+			model_fail("DMA read larger than a block", length);
+		}
+		model_miso_byte(SPI_DATA_TOKEN);
+		model_miso_put(model_shm_at(addr24, length), length);
+		if (!model_crc_off) {
+			model_miso_put((const uint8_t *)"\0\0", 2);
+		}
+		break;
+	}
+
+	case CMD_DMA_EXT_WRITE:
+		model_wr_addr = addr24;
+		model_wr_remain = ((uint32_t)bc[4] << 16) | ((uint32_t)bc[5] << 8) | bc[6];
+		model_shm_at(model_wr_addr, model_wr_remain);
+		model_spi = SPI_WR_TOKEN;
+		break;
+
+	case CMD_RESET:
+		break;
+
+	default:
+		model_fail("unsupported SPI command", cmd);
+	}
+	(void)size;
+}
+
+static void model_spi_write(const uint8_t *data, uint16_t size)
+{
+	switch (model_spi) {
+	case SPI_CMD:
+		model_spi_cmd(data, size);
+		return;
+
+	case SPI_WR_TOKEN:
+		if ((data[0] & 0xf0) != 0xf0) {
+			model_fail("bad data token", data[0]);
+		}
+		model_wr_block = (model_wr_remain < SPI_DATA_PKT_SZ) ? model_wr_remain : SPI_DATA_PKT_SZ;
+		model_spi = SPI_WR_DATA;
+		return;
+
+	case SPI_WR_DATA:
+		if (size > model_wr_block) {
+			model_fail("data block overrun", size);
+		}
+		memcpy(model_shm_at(model_wr_addr, size), data, size);
+		model_wr_addr += size;
+		model_wr_remain -= size;
+		model_wr_block -= size;
+		if (model_wr_block > 0) {
+			return;
+		}
+		if (!model_crc_off) {
+			model_spi = SPI_WR_CRC;
+			return;
+		}
+		break;
+
+	case SPI_WR_CRC:
+		break;
+	}
+
+	/* End of a data block. */
+	if (model_wr_remain > 0) {
+		model_spi = SPI_WR_TOKEN;
+		return;
+	}
+	model_spi = SPI_CMD;
+	/* Data response, read as 3 bytes with the CRC off and 2 with it on. */
+	if (model_crc_off) {
+		model_miso_byte(0x00);
+	}
+	model_miso_byte(0xc3);
+	model_miso_byte(0x00);
+}
+
+static void model_spi_read(uint8_t *data, uint16_t size)
+{
+	uint16_t i;
+
+	for (i = 0; i < size; i++) {
+		/* Idle line once the response is over. */
+		data[i] = (model_miso_pos < model_miso_len) ? model_miso[model_miso_pos++] : 0xff;
+	}
+}
+
+/*
+ * Bus wrapper and BSP.
+ */
+
+sint8 nm_bus_init(void *pvinit)
+{
+	(void)pvinit;
+	return M2M_SUCCESS;
+}
+
+sint8 nm_bus_deinit(void)
+{
+	return M2M_SUCCESS;
+}
+
+sint8 nm_bus_reinit(void *config)
+{
+	(void)config;
+	return M2M_SUCCESS;
+}
+
+sint8 nm_bus_ioctl(uint8 u8Cmd, void *pvParameter)
+{
+	tstrNmSpiRw *param = (tstrNmSpiRw *)pvParameter;
+	uint64_t ns;
+
+	if (u8Cmd != NM_BUS_IOCTL_RW) {
+		return M2M_ERR_BUS_FAIL;
+	}
+	model_cpu_enter();
+	model_bus_stats.u32Transfers++;
+	model_bus_stats.u32Bytes += param->u16Sz;
+	model_stats.spi_transfers++;
+	model_stats.spi_bytes += param->u16Sz;
+	/* The bus moves the time, the host waits for the transfer. */
+	ns = model_transfer_ns + (uint64_t)param->u16Sz * 8 * 1000000000ull / model_spi_clock_hz;
+	model_spi_ns += ns;
+	model_now_ns += ns;
+	model_stats.spi_us = model_spi_ns / 1000;
+	if (param->pu8InBuf != NULL) {
+		model_spi_write(param->pu8InBuf, param->u16Sz);
+	}
+	if (param->pu8OutBuf != NULL) {
+		model_spi_read(param->pu8OutBuf, param->u16Sz);
+	}
+	model_cpu_leave();
+	return M2M_SUCCESS;
+}
+
+const tstrNmBusStats *nm_bus_get_stats(void)
+{
+	return &model_bus_stats;
+}
+
+void nm_bsp_register_isr(tpfNmBspIsr pfIsr)
+{
+	model_isr = pfIsr;
+	model_irq_enabled = 1;
+}
+
+void nm_bsp_interrupt_ctrl(uint8 u8Enable)
+{
+	model_irq_enabled = u8Enable;
+	if (u8Enable && model_irq_pending) {
+		model_irq_pending = 0;
+		model_isr();
+	}
+}
+
+void nm_bsp_sleep(uint32 u32TimeMsec)
+{
+	model_now_ns += (uint64_t)u32TimeMsec * 1000000;
+}
+
+/*
+ * Model.
+ */
+
+void winc_spi_model_init(const struct winc_spi_model_link *link, const struct winc_spi_model_peer *peer,
+		uint32_t spi_clock_hz, uint32_t transfer_ns)
+{
+	model_link = *link;
+	model_peer = peer;
+	model_spi_clock_hz = spi_clock_hz;
+	model_transfer_ns = transfer_ns;
+	model_rand = link->seed ? link->seed : 1;
+	model_now_ns = 0;
+	model_spi_ns = 0;
+	memset(&model_stats, 0, sizeof(model_stats));
+	memset(&model_bus_stats, 0, sizeof(model_bus_stats));
+	model_cpu_depth = 0;
+
+	model_reg_count = 0;
+	/* CRC on, as after a reset of the chip. */
+	*model_reg(NMI_SPI_PROTOCOL_CONFIG) = 0x2e;
+	model_crc_off = 0;
+	model_miso_len = 0;
+	model_miso_pos = 0;
+	model_spi = SPI_CMD;
+
+	model_isr = NULL;
+	model_irq_enabled = 0;
+	model_irq_pending = 0;
+	model_rx_busy = 0;
+	model_ctrl_head = 0;
+	model_ctrl_count = 0;
+	memset(model_events, 0, sizeof(model_events));
+	model_event_seq = 0;
+
+	model_open = 0;
+	model_sock = -1;
+	model_conn = 0;
+	model_recv_pending = 0;
+	model_rx_head = 0;
+	model_rx_count = 0;
+	model_outstanding = 0;
+	if (link->window > (uint32_t)MODEL_RX_SEGMENTS * link->mss || link->mss > MODEL_SEGMENT_MAX) {
+		model_fail("window or MSS too large", link->window);
+	}
+}
+
+int winc_spi_model_poll(void)
+{
+	int done = 0;
+	struct model_event *ev;
+
+	model_cpu_enter();
+	while ((ev = model_next_event()) != NULL && ev->time_ns <= model_now_ns) {
+		model_run_event(ev);
+		done = 1;
+	}
+	done |= model_post();
+	model_cpu_leave();
+	return done;
+}
+
+int winc_spi_model_wait(uint64_t deadline_us)
+{
+	struct model_event *ev = model_next_event();
+	uint64_t next = UINT64_MAX;
+
+	if (ev != NULL) {
+		next = ev->time_ns;
+	}
+	if (model_recv_pending && model_recv_deadline_ns < next) {
+		next = model_recv_deadline_ns;
+	}
+	if (deadline_us != UINT64_MAX && deadline_us * 1000 < next) {
+		next = deadline_us * 1000;
+	}
+	if (next == UINT64_MAX) {
+		return 0;
+	}
+	if (next > model_now_ns) {
+		model_now_ns = next;
+	}
+	return 1;
+}
+
+uint64_t winc_spi_model_now_us(void)
+{
+	return model_now_ns / 1000;
+}
+
+const struct winc_spi_model_stats *winc_spi_model_get_stats(void)
+{
+	return &model_stats;
+}
@@ -0,0 +1,121 @@
+/**
+ * \file
+ *
+ * \brief Host model of the WINC1500 behind the SPI bus, for the benchmark.
+ *
+ * The model replaces the SPI bus wrapper (nm_bus_ioctl) and the BSP interrupt
+ * glue, so that the whole host driver runs unchanged on top of it: nmspi.c,
+ * nmbus.c, m2m_hif.c and socket.c. It answers the SPI commands of nmspi.c,
+ * holds the registers and the shared memory used by the HIF, and runs the
+ * socket commands like the firmware does, for one TCP connection to a peer.
+ *
+ * The peer is linked through an emulated network: bandwidth, one-way latency,
+ * segments of at most one MSS, a receive window held by the WINC until the
+ * host takes the data, and segment losses which delay the segment and the
+ * ones after it by a retransmission timeout.
+ *
+ * The time is virtual: it moves with the SPI transfers, at the bus clock, and
+ * jumps to the next event of the network when the host waits.
+ */
+
+#ifndef TEST_WINC_SPI_MODEL_H_INCLUDED
+#define TEST_WINC_SPI_MODEL_H_INCLUDED
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Emulated network between the WINC and the peer. */
+struct winc_spi_model_link {
+	/** Bandwidth from the peer to the WINC (kbit/s). */
+	uint32_t bandwidth_kbps;
+	/** One-way latency (us). */
+	uint32_t latency_us;
+	/** Largest segment (bytes). */
+	uint16_t mss;
+	/** Receive window of the WINC (bytes). */
+	uint32_t window;
+	/** Segments lost, per million. */
+	uint32_t loss_ppm;
+	/** Delay of a lost segment, until its retransmission arrives (us). */
+	uint32_t rto_us;
+	/** Seed of the losses. */
+	uint32_t seed;
+};
+
+/** Peer of the TCP connection, such as an HTTP origin. */
+struct winc_spi_model_peer {
+	/** A connection was opened to the peer. */
+	void (*connected)(void);
+	/** The connection was closed by the host. */
+	void (*closed)(void);
+	/** Data sent by the host arrived at the peer. */
+	void (*received)(const uint8_t *data, uint32_t length);
+	/** Take up to length bytes to send to the host, 0 for none now. */
+	uint32_t (*read)(uint8_t *data, uint32_t length);
+};
+
+/** Counters of the model. */
+struct winc_spi_model_stats {
+	/** SPI transfers, each framed by the chip select as counted on the target. */
+	uint32_t spi_transfers;
+	/** Bytes of the SPI transfers. */
+	uint32_t spi_bytes;
+	/** Time on the bus (us). */
+	uint64_t spi_us;
+	/** Messages of the WINC to the host. */
+	uint32_t messages;
+	/** Segments sent by the peer. */
+	uint32_t segments;
+	/** Segments lost once. */
+	uint32_t lost;
+	/** Process CPU time spent in the model (ns), not part of the driver. */
+	uint64_t cpu_ns;
+};
+
+/**
+ * \brief Reset the model, with no connection and a bus at a given clock.
+ *
+ * \param[in]  link            Emulated network.
+ * \param[in]  peer            Peer of the connections.
+ * \param[in]  spi_clock_hz    Clock of the SPI bus, such as CONF_WINC_SPI_CLOCK.
+ * \param[in]  transfer_ns     Cost of a transfer besides its bytes (chip select, DMA setup).
+ */
+void winc_spi_model_init(const struct winc_spi_model_link *link, const struct winc_spi_model_peer *peer,
+		uint32_t spi_clock_hz, uint32_t transfer_ns);
+
+/**
+ * \brief Run the events due and post the next message of the WINC.
+ *
+ * \return     1               Something happened.
+ * \return     0               Nothing to do before the time moves.
+ */
+int winc_spi_model_poll(void);
+
+/**
+ * \brief Move the time to the next event of the WINC, or to a deadline of the host.
+ *
+ * \param[in]  deadline_us     Time the host waits for, UINT64_MAX for none.
+ *
+ * \return     1               The time moved.
+ * \return     0               Nothing will happen: no event and no deadline.
+ */
+int winc_spi_model_wait(uint64_t deadline_us);
+
+/**
+ * \brief Virtual time (us).
+ */
+uint64_t winc_spi_model_now_us(void);
+
+/**
+ * \brief Counters of the model.
+ */
+const struct winc_spi_model_stats *winc_spi_model_get_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TEST_WINC_SPI_MODEL_H_INCLUDED */
@@ -0,0 +1,268 @@
+/**
+ * \file
+ *
+ * \brief Host test of the storage task of CONF_WINC_USE_FREERTOS.
+ *
+ * winc_task_app.c runs on the FreeRTOS stand-in of freertos/, the main thread
+ * being the network task: it queues packets, pauses and resumes the reception
+ * as the HTTP client would, and takes the storage. The storage task checks the
+ * data in the store pipeline, slowed down at random.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "download.h"
+#include "iot/winc_task.h"
+#include "iot/winc_task_app.h"
+
+#define TEST_PACKETS             100000
+
+struct http_client_module http_client_module_inst;
+struct pipeline store_pipeline;
+
+static TaskHandle_t net_task;
+static volatile int slow_ms;
+static volatile int fail_push;
+static volatile int locked;
+static uint32_t pushed_bytes;
+static uint32_t queued_bytes;
+static uint32_t flushes;
+static uint32_t pauses;
+static uint32_t resumes;
+static uint32_t closes;
+static int paused;
+static int failures;
+static download_state state = DOWNLOADING;
+static pthread_mutex_t wake_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake_cond = PTHREAD_COND_INITIALIZER;
+
+#define TEST_CHECK(cond, ...) \
+	do { \
+		if (!(cond)) { \
+			printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+			printf(__VA_ARGS__); \
+			printf("\r\n"); \
+			failures++; \
+		} \
+	} while (0)
+
+static uint8_t pattern(uint32_t offset)
+{
+	return (uint8_t)((offset * 2654435761u) >> 24);
+}
+
+int pipeline_push(struct pipeline *pipeline, uint8_t *data, uint32_t length)
+{
+	uint32_t i;
+
+	(void)pipeline;
+	TEST_CHECK(!locked, "pipeline used while the storage is held");
+	for (i = 0; i < length; i++) {
+		if (data[i] != pattern(pushed_bytes + i)) {
+			TEST_CHECK(0, "data at %lu is corrupted", (unsigned long)(pushed_bytes + i));
+			break;
+		}
+	}
+	pushed_bytes += length;
+	if (slow_ms) {
+		vTaskDelay(slow_ms);
+	} else if (rand() % 50 == 0) {
+		vTaskDelay(rand() % 3);
+	}
+	return fail_push ? -5 : 0;
+}
+
+void flush_storage(void)
+{
+	TEST_CHECK(!locked, "flush while the storage is held");
+	flushes++;
+}
+
+bool is_state_set(download_state mask)
+{
+	return (state & mask) != 0;
+}
+
+void add_state(download_state mask)
+{
+	state |= mask;
+}
+
+void close_file(bool completed)
+{
+	(void)completed;
+	storage_lock();
+	closes++;
+	storage_unlock();
+}
+
+int http_client_close(struct http_client_module *const module)
+{
+	(void)module;
+	return 0;
+}
+
+int http_client_pause_recv(struct http_client_module *const module)
+{
+	(void)module;
+	TEST_CHECK(!paused, "paused twice");
+	paused = 1;
+	pauses++;
+	return 0;
+}
+
+int http_client_resume_recv(struct http_client_module *const module)
+{
+	(void)module;
+	TEST_CHECK(paused, "resumed while not paused");
+	paused = 0;
+	resumes++;
+	return 0;
+}
+
+void winc_task_wake(void)
+{
+	pthread_mutex_lock(&wake_lock);
+	pthread_cond_signal(&wake_cond);
+	pthread_mutex_unlock(&wake_lock);
+}
+
+TaskHandle_t winc_task_get_handle(void)
+{
+	return net_task;
+}
+
+/** Sleep of the network task, until woken up or for its period. */
+static void net_sleep(void)
+{
+	struct timespec deadline;
+
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_nsec += MAIN_RTOS_NET_PERIOD_MS * 1000000L;
+	if (deadline.tv_nsec >= 1000000000) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+	pthread_mutex_lock(&wake_lock);
+	pthread_cond_timedwait(&wake_cond, &wake_lock, &deadline);
+	pthread_mutex_unlock(&wake_lock);
+}
+
+static bool queue_packet(uint32_t length)
+{
+	static uint8_t packet[4 * MAIN_BUFFER_MAX_SIZE];
+	uint32_t i;
+
+	for (i = 0; i < length; i++) {
+		packet[i] = pattern(queued_bytes + i);
+	}
+	if (!storage_queue_packet(packet, length)) {
+		return false;
+	}
+	queued_bytes += length;
+	return true;
+}
+
+/** Packets of random size, some bigger than a buffer, the storage task randomly slower. */
+static void test_stream(void)
+{
+	uint32_t n = 0, locks = 0;
+
+	while (n < TEST_PACKETS && !failures) {
+		storage_poll();
+		if (paused) {
+			net_sleep();
+			continue;
+		}
+		TEST_CHECK(queue_packet((n % 101 == 0) ? 3 * MAIN_BUFFER_MAX_SIZE + n % 7 : 1 + rand() % MAIN_BUFFER_MAX_SIZE),
+				"packet %lu refused", (unsigned long)n);
+		n++;
+		if (n % 997 == 0) {
+			/* Closing and opening the file: the storage task wrote all. */
+			storage_lock();
+			storage_lock();
+			locked = 1;
+			TEST_CHECK(pushed_bytes == queued_bytes, "%lu of %lu bytes written under the lock",
+					(unsigned long)pushed_bytes, (unsigned long)queued_bytes);
+			locked = 0;
+			storage_unlock();
+			storage_unlock();
+			locks++;
+		}
+	}
+	storage_lock();
+	TEST_CHECK(pushed_bytes == queued_bytes, "%lu of %lu bytes written", (unsigned long)pushed_bytes,
+			(unsigned long)queued_bytes);
+	storage_unlock();
+	vTaskDelay(MAIN_STORAGE_FLUSH_TIMEOUT_MS + 100);
+	storage_lock();
+	TEST_CHECK(flushes > 0, "no flush after the last packet");
+	TEST_CHECK(pauses > 0 && pauses - resumes <= 1, "%lu pauses, %lu resumes", (unsigned long)pauses,
+			(unsigned long)resumes);
+	printf("stream: %lu packets, %lu bytes in order, %lu locks, %lu pauses, %lu flushes\r\n",
+			(unsigned long)n, (unsigned long)pushed_bytes, (unsigned long)locks, (unsigned long)pauses,
+			(unsigned long)flushes);
+	storage_unlock();
+	while (paused) {
+		storage_poll();
+		net_sleep();
+	}
+}
+
+/** A stalled storage task times the network task out instead of blocking it. */
+static void test_stall(void)
+{
+	TickType_t start, ticks;
+	uint32_t n;
+
+	slow_ms = MAIN_RTOS_STORAGE_WAIT_MS + 500;
+	start = xTaskGetTickCount();
+	for (n = 0; queue_packet(100); n++) {
+	}
+	ticks = xTaskGetTickCount() - start;
+	printf("stall: timed out after %lu packets in %lu ms\r\n", (unsigned long)n, (unsigned long)ticks);
+	TEST_CHECK(n == MAIN_RTOS_STORAGE_BUFFERS, "%lu packets queued", (unsigned long)n);
+	TEST_CHECK(ticks >= MAIN_RTOS_STORAGE_WAIT_MS, "timed out after %lu ms", (unsigned long)ticks);
+	storage_lock();
+	slow_ms = 0;
+	storage_unlock();
+	TEST_CHECK(pushed_bytes == queued_bytes, "%lu of %lu bytes written", (unsigned long)pushed_bytes,
+			(unsigned long)queued_bytes);
+	while (paused) {
+		storage_poll();
+		net_sleep();
+	}
+}
+
+/** A write error cancels the download from the network task. */
+static void test_write_error(void)
+{
+	storage_lock();
+	reset_storage_task();
+	paused = 0;
+	fail_push = 1;
+	storage_unlock();
+	TEST_CHECK(queue_packet(10), "packet refused before the error");
+	while (!is_storage_failed()) {
+		net_sleep();
+	}
+	TEST_CHECK(!queue_packet(10), "packet queued after the error");
+	storage_poll();
+	printf("write error: canceled %d, file closed %lu\r\n", is_state_set(CANCELED), (unsigned long)closes);
+	TEST_CHECK(is_state_set(CANCELED) && closes == 1, "download not canceled");
+}
+
+int main(void)
+{
+	srand(1);
+	net_task = xTaskGetCurrentTaskHandle();
+	configure_storage_task();
+	test_stream();
+	test_stall();
+	test_write_error();
+	printf("%s\r\n", failures ? "FAILED" : "PASSED");
+	return failures ? 1 : 0;
+}